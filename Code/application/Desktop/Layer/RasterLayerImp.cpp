@@ -281,22 +281,22 @@ void RasterLayerImp::elementDeletedBlue(Subject& subject, const string& signal,
 
 void RasterLayerImp::fullImageRegenGray(Subject& subject, const std::string& signal, const boost::any& v)
 {
-   setImage(NULL);
+   invalidateImage(dynamic_cast<RasterElement*>(&subject), v);
 }
 
 void RasterLayerImp::fullImageRegenRed(Subject& subject, const std::string& signal, const boost::any& v)
 {
-   setImage(NULL);
+   invalidateImage(dynamic_cast<RasterElement*>(&subject), v);
 }
 
 void RasterLayerImp::fullImageRegenGreen(Subject& subject, const std::string& signal, const boost::any& v)
 {
-   setImage(NULL);
+   invalidateImage(dynamic_cast<RasterElement*>(&subject), v);
 }
 
 void RasterLayerImp::fullImageRegenBlue(Subject& subject, const std::string& signal, const boost::any& v)
 {
-   setImage(NULL);
+   invalidateImage(dynamic_cast<RasterElement*>(&subject), v);
 }
 
 bool RasterLayerImp::isKindOfLayer(const string& className)
@@ -1782,11 +1782,11 @@ double RasterLayerImp::convertStretchValue(const RasterChannelType& eColor, cons
       return dNewValue;
    }
 
-   double dMin = pStatistics->getMin(mComplexComponent);
-   double dMax = pStatistics->getMax(mComplexComponent);
-   double dAverage = pStatistics->getAverage(mComplexComponent);
-   double dStdDev = pStatistics->getStandardDeviation(mComplexComponent);
-   const double* pdPercentiles = pStatistics->getPercentiles(mComplexComponent);
+   double dMin = pStatistics->getEstimatedMin(mComplexComponent);
+   double dMax = pStatistics->getEstimatedMax(mComplexComponent);
+   double dAverage = pStatistics->getEstimatedAverage(mComplexComponent);
+   double dStdDev = pStatistics->getEstimatedStandardDeviation(mComplexComponent);
+   const double* pdPercentiles = pStatistics->getEstimatedPercentiles(mComplexComponent);
 
    // Convert the stretch value to a raw value
    double dRawValue = 0.0;
@@ -3075,6 +3075,36 @@ void RasterLayerImp::setImageChanged(bool bChanged)
    mbRegenerate = bChanged;
 }
 
+void RasterLayerImp::invalidateImage(const RasterElement* pRasterElement, const boost::any& dataRegion)
+{
+   typedef boost::tuple<DimensionDescriptor, DimensionDescriptor, DimensionDescriptor, DimensionDescriptor,
+      vector<DimensionDescriptor> > DataRegion;
+
+   // When only part of the data has changed, only the tiles which display it need to be regenerated
+   const DataRegion* pRegion = boost::any_cast<DataRegion>(&dataRegion);
+   if ((mpImage == NULL) || (pRasterElement == NULL) || (pRegion == NULL))
+   {
+      setImage(NULL);
+      return;
+   }
+
+   const DimensionDescriptor& startRow = pRegion->get<0>();
+   const DimensionDescriptor& stopRow = pRegion->get<1>();
+   const DimensionDescriptor& startColumn = pRegion->get<2>();
+   const DimensionDescriptor& stopColumn = pRegion->get<3>();
+   if ((startRow.isActiveNumberValid() == false) || (stopRow.isActiveNumberValid() == false) ||
+      (startColumn.isActiveNumberValid() == false) || (stopColumn.isActiveNumberValid() == false))
+   {
+      setImage(NULL);
+      return;
+   }
+
+   mpImage->invalidateRegion(pRasterElement, pRegion->get<4>(), static_cast<int>(startColumn.getActiveNumber()),
+      static_cast<int>(startRow.getActiveNumber()), static_cast<int>(stopColumn.getActiveNumber()),
+      static_cast<int>(stopRow.getActiveNumber()));
+   setImageChanged(true);
+}
+
 vector<double> RasterLayerImp::getRawStretchValues(const RasterChannelType& eColor) const
 {
    double dLower = 0.0;
@@ -3147,6 +3177,9 @@ void RasterLayerImp::generateImage()
 
    pImage->setAlpha(getAlpha());
 
+   // Display the image with an estimate of the statistics of large bands, which is refined in the background
+   calculateStatisticsProgressively(eMode, eComponent);
+
    if (eMode == GRAYSCALE_MODE)
    {
       vector<double> lstStretchValues = getRawStretchValues(GRAY);
@@ -3173,8 +3206,8 @@ void RasterLayerImp::generateImage()
          {
             if (pStatistics != NULL)
             {
-               lstStretchValues[0] = pStatistics->getMin(eComponent);
-               lstStretchValues[1] = pStatistics->getMax(eComponent);
+               lstStretchValues[0] = pStatistics->getEstimatedMin(eComponent);
+               lstStretchValues[1] = pStatistics->getEstimatedMax(eComponent);
             }
          }
 
@@ -3210,8 +3243,8 @@ void RasterLayerImp::generateImage()
       {
          if (applyFastContrastStretch)
          {
-            lstRedStretchValues[0] = pStatistics->getMin(eComponent);
-            lstRedStretchValues[1] = pStatistics->getMax(eComponent);
+            lstRedStretchValues[0] = pStatistics->getEstimatedMin(eComponent);
+            lstRedStretchValues[1] = pStatistics->getEstimatedMax(eComponent);
          }
 
          pRedBadValues = pStatistics->getBadValues();
@@ -3222,8 +3255,8 @@ void RasterLayerImp::generateImage()
       {
          if (applyFastContrastStretch)
          {
-            lstGreenStretchValues[0] = pStatistics->getMin(eComponent);
-            lstGreenStretchValues[1] = pStatistics->getMax(eComponent);
+            lstGreenStretchValues[0] = pStatistics->getEstimatedMin(eComponent);
+            lstGreenStretchValues[1] = pStatistics->getEstimatedMax(eComponent);
          }
 
          pGreenBadValues = pStatistics->getBadValues();
@@ -3234,8 +3267,8 @@ void RasterLayerImp::generateImage()
       {
          if (applyFastContrastStretch)
          {
-            lstBlueStretchValues[0] = pStatistics->getMin(eComponent);
-            lstBlueStretchValues[1] = pStatistics->getMax(eComponent);
+            lstBlueStretchValues[0] = pStatistics->getEstimatedMin(eComponent);
+            lstBlueStretchValues[1] = pStatistics->getEstimatedMax(eComponent);
          }
 
          pBlueBadValues = pStatistics->getBadValues();
@@ -3311,6 +3344,42 @@ void RasterLayerImp::generateFullImage()
    }
 }
 
+void RasterLayerImp::calculateStatisticsProgressively(const DisplayMode& eMode, ComplexComponent eComponent) const
+{
+   vector<RasterChannelType> channels;
+   if (eMode == GRAYSCALE_MODE)
+   {
+      if (mGrayBand.isValid() == true)
+      {
+         channels.push_back(GRAY);
+      }
+   }
+   else if (eMode == RGB_MODE)
+   {
+      if (mRedBand.isValid() == true)
+      {
+         channels.push_back(RED);
+      }
+      if (mGreenBand.isValid() == true)
+      {
+         channels.push_back(GREEN);
+      }
+      if (mBlueBand.isValid() == true)
+      {
+         channels.push_back(BLUE);
+      }
+   }
+
+   for (vector<RasterChannelType>::const_iterator iter = channels.begin(); iter != channels.end(); ++iter)
+   {
+      Statistics* pStatistics = getStatistics(*iter);
+      if (pStatistics != NULL)
+      {
+         pStatistics->calculateProgressively(eComponent);
+      }
+   }
+}
+
 Statistics* RasterLayerImp::getStatistics(RasterChannelType eColor) const
 {
    DimensionDescriptor band;
@@ -3854,11 +3923,11 @@ void RasterLayerImp::applyFastContrastStretch(RasterChannelType element)
 
    const unsigned int* pHistogram = NULL;
    const double* pBinCenters = NULL;
-   pStatistics->getHistogram(pBinCenters, pHistogram);
+   pStatistics->getEstimatedHistogram(pBinCenters, pHistogram, COMPLEX_MAGNITUDE);
    VERIFYNRV(pBinCenters != NULL);
    VERIFYNRV(pHistogram != NULL);
-   double minData = pStatistics->getMin(mComplexComponent);
-   double maxData = pStatistics->getMax(mComplexComponent);
+   double minData = pStatistics->getEstimatedMin(mComplexComponent);
+   double maxData = pStatistics->getEstimatedMax(mComplexComponent);
    double range = maxData - minData;
 
    vector<double> stretch = getRawStretchValues(element);
@@ -194,12 +194,14 @@ protected:
    Image* getImage();
    void setImage(Image* pImage);
    void setImageChanged(bool bChanged);
+   void invalidateImage(const RasterElement* pRasterElement, const boost::any& dataRegion);
    std::vector<double> getRawStretchValues(const RasterChannelType& eColor) const;
    const std::vector<ColorType>& getColorTable() const;
 
    virtual void generateImage();
    virtual void applyFastContrastStretch();
    void applyFastContrastStretch(RasterChannelType element);
+   void calculateStatisticsProgressively(const DisplayMode& eMode, ComplexComponent eComponent) const;
    virtual Statistics* getStatistics(RasterChannelType eColor) const;
    double percentileToRaw(double value, const double* pdPercentiles) const;
    double rawToPercentile(double value, const double* pdPercentiles) const;
@@ -1817,8 +1817,8 @@ bool HistogramPlotImp::getDataMinMax(double& minValue, double& maxValue) const
          eComponent = pRasterLayer->getComplexComponent();
       }
 
-      minValue = pStatistics->getMin(eComponent);
-      maxValue = pStatistics->getMax(eComponent);
+      minValue = pStatistics->getEstimatedMin(eComponent);
+      maxValue = pStatistics->getEstimatedMax(eComponent);
       return true;
    }
 
@@ -3166,7 +3166,9 @@ void HistogramPlotImp::updateHistogramValues(bool force)
             eComponent = pRasterLayer->getComplexComponent();
          }
 
-         pStatistics->getHistogram(pHistogramLocations, pHistogramCounts, eComponent);
+         // Display an estimate of the histogram of a large band, which is updated when it is refined
+         pStatistics->calculateProgressively(eComponent);
+         pStatistics->getEstimatedHistogram(pHistogramLocations, pHistogramCounts, eComponent);
       }
 
       if ((pHistogramLocations != NULL) && (pHistogramCounts != NULL))
@@ -37,6 +37,7 @@
 #include "LayerUndo.h"
 #include "MathUtil.h"
 #include "MeasurementLayerAdapter.h"
+#include "MemoryBudget.h"
 #include "ModelServices.h"
 #include "MouseModeImp.h"
 #include "PropertiesSpatialDataView.h"
@@ -1223,6 +1224,8 @@ bool SpatialDataViewImp::deleteLayer(Layer* pLayer, bool bClearUndo)
       {
          pElement->detach(SIGNAL_NAME(Subject, Deleted), Slot(this, &SpatialDataViewImp::elementDeleted));
       }
+
+      updateMemoryPriority(pElement, pLayer);
    }
 
    // Get the layer type
@@ -1776,6 +1779,7 @@ bool SpatialDataViewImp::showLayer(Layer* pLayer)
    if (bSuccess == true)
    {
       addUndoAction(new ShowLayer(pLayer));
+      updateMemoryPriority(pLayer->getDataElement());
 
       emit layerShown(pLayer);
       notify(SIGNAL_NAME(SpatialDataView, LayerShown), boost::any(pLayer));
@@ -1804,6 +1808,7 @@ bool SpatialDataViewImp::hideLayer(Layer* pLayer)
    if (bSuccess == true)
    {
       addUndoAction(new HideLayer(pLayer));
+      updateMemoryPriority(pLayer->getDataElement());
 
       emit layerHidden(pLayer);
       notify(SIGNAL_NAME(SpatialDataView, LayerHidden), boost::any(pLayer));
@@ -1816,6 +1821,31 @@ bool SpatialDataViewImp::hideLayer(Layer* pLayer)
    return bSuccess;
 }
 
+void SpatialDataViewImp::updateMemoryPriority(DataElement* pElement, const Layer* pDeletedLayer)
+{
+   if ((dynamic_cast<RasterElement*>(pElement) == NULL) || (mpLayerList == NULL))
+   {
+      return;
+   }
+
+   // Keep the element's data in memory in preference to other data while it is displayed in this view
+   MemoryBudget::PriorityType priority = MemoryBudget::PRIORITY_NORMAL;
+
+   vector<Layer*> layers = mpLayerList->getLayers();
+   for (vector<Layer*>::const_iterator iter = layers.begin(); iter != layers.end(); ++iter)
+   {
+      Layer* pLayer = *iter;
+      if ((pLayer != NULL) && (pLayer != pDeletedLayer) && (pLayer->getDataElement() == pElement) &&
+         (isLayerDisplayed(pLayer) == true))
+      {
+         priority = MemoryBudget::PRIORITY_VISIBLE;
+         break;
+      }
+   }
+
+   Service<ModelServices>()->getMemoryBudget()->setPriority(pElement, priority, this);
+}
+
 bool SpatialDataViewImp::zoomToLayer(Layer* pLayer)
 {
    if (pLayer == NULL)
@@ -209,6 +209,7 @@ protected slots:
 
 private:
    SpatialDataViewImp(const SpatialDataViewImp& rhs);
+   void updateMemoryPriority(DataElement* pElement, const Layer* pDeletedLayer = NULL);
 
    AttachmentPtr<SessionExplorer> mpExplorer;
 
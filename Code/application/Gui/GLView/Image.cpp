@@ -8,6 +8,7 @@
  */
 
 #include "AppVerify.h"
+#include "BadValues.h"
 #include "DataAccessorImpl.h"
 #include "DrawUtil.h"
 #include "Image.h"
@@ -16,11 +17,13 @@
 #include "MultiThreadedAlgorithm.h"
 #include "RasterElement.h"
 #include "RasterDataDescriptor.h"
+#include "RasterUtilities.h"
 #include "Statistics.h"
 #include "switchOnEncoding.h"
 #include "Tile.h"
 #include "UtilityServicesImp.h"
 
+#include <algorithm>
 #include <limits>
 #include <math.h>
 
@@ -499,7 +502,7 @@ public:
       mTiles(input.mTiles),
       mTileZoomIndices(input.mTileZoomIndices),
       mInfo(input.mInfo),
-      mTileRange(getThreadRange(threadCount, mTiles.size()))
+      mTileCount(static_cast<int>(mTiles.size()))
    {
    }
    virtual ~TileThread() {};
@@ -509,15 +512,35 @@ private:
    vector<Tile*>& mTiles;
    vector<unsigned int>& mTileZoomIndices;
    Image::ImageData& mInfo;
-   Range mTileRange;
+   int mTileCount;
 
    TileThread& operator=(const TileThread& rhs);
 
+   // Tests the bad values of the displayed columns of the current row together.  This is not done for complex
+   // data, since the tested value depends on the displayed component.
+   static bool getRowValidity(const BadValues* pBadValues, DataAccessor& da, EncodingType encoding,
+      unsigned int columns, int reductionFactor, vector<unsigned char>& validity)
+   {
+      if (pBadValues == NULL || columns == 0 || encoding == INT4SCOMPLEX || encoding == FLT8COMPLEX)
+      {
+         return false;
+      }
+
+      size_t bytesPerElement = RasterUtilities::bytesInEncoding(encoding);
+      VERIFY(bytesPerElement > 0);
+
+      ptrdiff_t stride = static_cast<ptrdiff_t>(da->getColumnPitch() / bytesPerElement) * reductionFactor;
+      validity.resize(columns);
+
+      size_t badValueCount = 0;
+      return pBadValues->getValidityMask(da->getColumn(), encoding, columns, stride, &validity[0], badValueCount);
+   }
+
    // grayscale, channel specifies the band to display
    template <class T>
    void createGrayscale(T* pData, ComplexComponent component)
    {
-      if (mTileRange.mLast < mTileRange.mFirst)
+      if (mTileCount == 0)
       {
          return;
       }
@@ -542,11 +565,15 @@ private:
       }
 
       vector<unsigned char> pTexData(bufSize);
+      vector<unsigned char> validity;
 
       int oldPercentDone = -1;
 
-      for (int tileId = mTileRange.mFirst; tileId <= mTileRange.mLast; ++tileId)
+      // The tiles are claimed one at a time, since the tiles whose textures are ready take no time at all
+      Range chunk;
+      while (getNextChunk(mTileCount, chunk, 1, false))
       {
+         const int tileId = chunk.mFirst;
          Tile* pTile = mTiles[tileId];
          if (pTile->isTextureReady(mTileZoomIndices[tileId]) == false)
          {
@@ -590,6 +617,13 @@ private:
                vector<unsigned char>::iterator targetStop = target + geomSizeX / reductionFactor *
                   (hasBadValues ? 2 : 1);
 
+               const unsigned char* pValidity = NULL;
+               if (hasBadValues && getRowValidity(mInfo.mKey.mpBadValues1, da, mInfo.mRawType[0],
+                  geomSizeX / reductionFactor, reductionFactor, validity))
+               {
+                  pValidity = &validity[0];
+               }
+
                for (; target < targetStop; ++target)
                {
                   double dValue = ModelServices::getDataValue(*source, component);
@@ -597,7 +631,12 @@ private:
                   if (hasBadValues)
                   {
                      ++target;
-                     if (hasSingleBadValueRange)
+                     if (pValidity != NULL)
+                     {
+                        *target = *pValidity;
+                        ++pValidity;
+                     }
+                     else if (hasSingleBadValueRange)
                      {
                         if (dValue > singleBadValueLower && dValue < singleBadValueUpper)
                         {
@@ -637,7 +676,7 @@ private:
             runInMainThread(cmd);
          }
 
-         int percentDone = 100 * (tileId - mTileRange.mFirst + 1) / (mTileRange.mLast - mTileRange.mFirst + 1);
+         int percentDone = computeChunkPercent(mTileCount, chunk, tileId + 1);
          if (percentDone >= oldPercentDone + 10)
          {
             oldPercentDone = percentDone;
@@ -650,7 +689,7 @@ private:
    template <class T>
    void createColormap(T* pData, ComplexComponent component)
    {
-      if (mTileRange.mLast < mTileRange.mFirst)
+      if (mTileCount == 0)
       {
          return;
       }
@@ -673,11 +712,14 @@ private:
       int channels = (mInfo.mFormat == GL_RGBA ? 4 : 3);
       int bufSize = mInfo.mTileSizeX * mInfo.mTileSizeY * channels * sizeof(unsigned char);
       vector<unsigned char> pTexData(bufSize);
+      vector<unsigned char> validity;
 
       int oldPercentDone = -1;
 
-      for (int tileId = mTileRange.mFirst; tileId <= mTileRange.mLast; ++tileId)
+      Range chunk;
+      while (getNextChunk(mTileCount, chunk, 1, false))
       {
+         const int tileId = chunk.mFirst;
          Tile* pTile = mTiles[tileId];
          if (pTile->isTextureReady(mTileZoomIndices[tileId]) == false)
          {
@@ -715,6 +757,14 @@ private:
             {
                VERIFYNRV(da.isValid())
                vector<unsigned char>::iterator target = targetBase;
+
+               const unsigned char* pValidity = NULL;
+               if (hasBadValues && getRowValidity(mInfo.mKey.mpBadValues1, da, mInfo.mRawType[0],
+                  (geomSizeX + reductionFactor - 1) / reductionFactor, reductionFactor, validity))
+               {
+                  pValidity = &validity[0];
+               }
+
                for (unsigned int x1 = 0; x1 < geomSizeX; x1 += reductionFactor)
                {
                   T* source = static_cast<T*>(da->getColumn());
@@ -733,8 +783,12 @@ private:
 
                   if (hasBadValues)
                   {
-//                     bool badValue = false;
-                     if (hasSingleBadValueRange)
+                     if (pValidity != NULL)
+                     {
+                        *target = (*pValidity == 0) ? 0 : mInfo.mKey.mColorMap[index].mAlpha;
+                        ++pValidity;
+                     }
+                     else if (hasSingleBadValueRange)
                      {
                         if (dValue > singleBadValueLower && dValue < singleBadValueUpper)
                         {
@@ -774,7 +828,7 @@ private:
             runInMainThread(cmd);
          }
 
-         int percentDone = 100 * (tileId- mTileRange.mFirst + 1) / (mTileRange.mLast - mTileRange.mFirst + 1);
+         int percentDone = computeChunkPercent(mTileCount, chunk, tileId + 1);
          if (percentDone >= oldPercentDone + 10)
          {
             oldPercentDone = percentDone;
@@ -787,7 +841,7 @@ private:
    void createRgb(EncodingType encodingRed, EncodingType encodingGreen, EncodingType encodingBlue,
       ComplexComponent component)
    {
-      if (mTileRange.mLast < mTileRange.mFirst)
+      if (mTileCount == 0)
       {
          return;
       }
@@ -834,11 +888,16 @@ private:
 
       int bufSize = mInfo.mTileSizeX * mInfo.mTileSizeY * sizeof(unsigned char) * (mInfo.mFormat == GL_RGBA ? 4 : 3);
       std::vector<unsigned char> pTexData(bufSize);
+      vector<unsigned char> redValidity;
+      vector<unsigned char> greenValidity;
+      vector<unsigned char> blueValidity;
 
       int oldPercentDone = -1;
 
-      for (int tileId = mTileRange.mFirst; tileId <= mTileRange.mLast; ++tileId)
+      Range chunk;
+      while (getNextChunk(mTileCount, chunk, 1, false))
       {
+         const int tileId = chunk.mFirst;
          Tile* pTile = mTiles[tileId];
          if (pTile->isTextureReady(mTileZoomIndices[tileId]) == false)
          {
@@ -926,6 +985,29 @@ private:
                y1 += reductionFactor, targetBase += mInfo.mTileSizeX / reductionFactor * (hasBadValues ? 4 : 3))
             {
                unsigned char* target = &*targetBase;
+
+               unsigned int columns = (geomSizeX + reductionFactor - 1) / reductionFactor;
+               const unsigned char* pRedValidity = NULL;
+               if (hasRedBadValues && haveRedData && getRowValidity(mInfo.mKey.mpBadValues1, daRed, encodingRed,
+                  columns, reductionFactor, redValidity))
+               {
+                  pRedValidity = &redValidity[0];
+               }
+
+               const unsigned char* pGreenValidity = NULL;
+               if (hasGreenBadValues && haveGreenData && getRowValidity(mInfo.mKey.mpBadValues2, daGreen,
+                  encodingGreen, columns, reductionFactor, greenValidity))
+               {
+                  pGreenValidity = &greenValidity[0];
+               }
+
+               const unsigned char* pBlueValidity = NULL;
+               if (hasBlueBadValues && haveBlueData && getRowValidity(mInfo.mKey.mpBadValues3, daBlue, encodingBlue,
+                  columns, reductionFactor, blueValidity))
+               {
+                  pBlueValidity = &blueValidity[0];
+               }
+
                for (unsigned int x1 = 0; x1 < geomSizeX; x1 += reductionFactor)
                {
                   // Red
@@ -939,7 +1021,12 @@ private:
 
                      if (hasRedBadValues)
                      {
-                        if (hasSingleRedBadValueRange)
+                        if (pRedValidity != NULL)
+                        {
+                           isRedValueBad = (*pRedValidity == 0);
+                           ++pRedValidity;
+                        }
+                        else if (hasSingleRedBadValueRange)
                         {
                            isRedValueBad = dValue > singleRangeLowRed && dValue < singleRangeHighRed;
                         }
@@ -974,7 +1061,12 @@ private:
 
                      if (hasGreenBadValues)
                      {
-                        if (hasSingleGreenBadValueRange)
+                        if (pGreenValidity != NULL)
+                        {
+                           isGreenValueBad = (*pGreenValidity == 0);
+                           ++pGreenValidity;
+                        }
+                        else if (hasSingleGreenBadValueRange)
                         {
                            isGreenValueBad = dValue > singleRangeLowGreen && dValue < singleRangeHighGreen;
                         }
@@ -1009,7 +1101,12 @@ private:
 
                      if (hasBlueBadValues)
                      {
-                        if (hasSingleBlueBadValueRange)
+                        if (pBlueValidity != NULL)
+                        {
+                           isBlueValueBad = (*pBlueValidity == 0);
+                           ++pBlueValidity;
+                        }
+                        else if (hasSingleBlueBadValueRange)
                         {
                            isBlueValueBad = dValue > singleRangeLowBlue && dValue < singleRangeHighBlue;
                         }
@@ -1074,7 +1171,7 @@ private:
             runInMainThread(cmd);
          }
 
-         int percentDone = 100 * (tileId - mTileRange.mFirst + 1) / (mTileRange.mLast - mTileRange.mFirst + 1);
+         int percentDone = computeChunkPercent(mTileCount, chunk, tileId + 1);
          if (percentDone >= oldPercentDone + 10)
          {
             oldPercentDone = percentDone;
@@ -1429,6 +1526,57 @@ void Image::generateAllFullResTextures()
    }
 }
 
+void Image::invalidateRegion(const RasterElement* pRasterElement, const vector<DimensionDescriptor>& bands,
+                             int startColumn, int startRow, int stopColumn, int stopRow)
+{
+   if (pRasterElement == NULL)
+   {
+      return;
+   }
+
+   map<ImageKey, TileSet>::iterator iter;
+   for (iter = mTileSets.begin(); iter != mTileSets.end(); ++iter)
+   {
+      // Find whether any channel of the tile set displays a changed band
+      const ImageKey& key = iter->first;
+      const DimensionDescriptor keyBands[3] = { key.mBand1, key.mBand2, key.mBand3 };
+
+      bool bandChanged = false;
+      for (unsigned int i = 0; i < key.mChannels && i < 3; ++i)
+      {
+         if ((key.mpRasterElement[i] == pRasterElement) && (keyBands[i].isValid() == true) &&
+            (bands.empty() == true || find(bands.begin(), bands.end(), keyBands[i]) != bands.end()))
+         {
+            bandChanged = true;
+            break;
+         }
+      }
+
+      if (bandChanged == false)
+      {
+         continue;
+      }
+
+      vector<Tile*>& tiles = iter->second.getTiles();
+
+      vector<Tile*>::iterator tileIter;
+      for (tileIter = tiles.begin(); tileIter != tiles.end(); ++tileIter)
+      {
+         Tile* pTile = *tileIter;
+         if (pTile != NULL)
+         {
+            LocationType pos = pTile->getPos();
+            LocationType size = pTile->getGeomSize();
+            if ((pos.mX <= stopColumn) && (pos.mX + size.mX > startColumn) &&
+               (pos.mY <= stopRow) && (pos.mY + size.mY > startRow))
+            {
+               pTile->invalidate();
+            }
+         }
+      }
+   }
+}
+
 const Image::ImageData& Image::getImageData() const
 {
    return mInfo;
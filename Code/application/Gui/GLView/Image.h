@@ -678,6 +678,11 @@ public:
    bool generateFullResTexture();
    void generateAllFullResTextures();
 
+   // Regenerates the tiles which display the given active columns and rows of any of the given bands, or of
+   // all bands if none are given, at all zoom levels when they are next drawn
+   void invalidateRegion(const RasterElement* pRasterElement, const std::vector<DimensionDescriptor>& bands,
+      int startColumn, int startRow, int stopColumn, int stopRow);
+
    const ImageData& getImageData() const;
 
    void setColorMapChanged(bool changed);
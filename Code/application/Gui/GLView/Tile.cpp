@@ -167,6 +167,12 @@ void Tile::setupTexture(unsigned int index, unsigned char* pTextureData)
    glFlush();
 }
 
+void Tile::invalidate()
+{
+   // Release the textures at all zoom levels, so that they are set up again when the tile is next drawn
+   mTextures.clear();
+}
+
 void Tile::setAlpha(unsigned int alpha)
 {
    mAlpha = alpha;
@@ -66,6 +66,7 @@ public:
 
    virtual bool isTextureReady(unsigned int index) const;
    virtual void setupTexture(unsigned int index, unsigned char* pTextureData);
+   virtual void invalidate();
    void draw(GLfloat textureMode);
    unsigned int getTextureIndex() const;
 
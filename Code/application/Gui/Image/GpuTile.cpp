@@ -25,7 +25,8 @@ GpuTile::GpuTile() :
    mpImageLoader(NULL),
    mpImageReader(NULL),
    mpOutputColorBuffer(NULL),
-   mbInitialized(false)
+   mbInitialized(false),
+   mbDataChanged(false)
 {
 }
 
@@ -105,6 +106,7 @@ void GpuTile::setupTile(void *pData, EncodingType encodingType, unsigned int ind
    if (mpImageLoader != NULL)
    {
       mpImageLoader->loadData(pData);
+      mbDataChanged = false;
    }
 
    // Run the filters and set the output image buffer
@@ -317,7 +319,13 @@ bool GpuTile::getFilterFreezeFlag(ImageFilterDescriptor *pDescriptor) const
 
 bool GpuTile::isTextureReady(unsigned int index) const
 {
-   return mbInitialized;
+   return mbInitialized && !mbDataChanged;
+}
+
+void GpuTile::invalidate()
+{
+   // The color buffer and filters are kept, and the data is loaded into them again when the tile is next drawn
+   mbDataChanged = true;
 }
 
 vector<ImageFilterDescriptor*> GpuTile::getFilters() const
@@ -44,6 +44,7 @@ public:
    unsigned int writeFilterBuffer( GLint tileOffsetX, GLint tileOffsetY,GLint xCoord, GLint yCoord, GLint width,GLint height, GLint chipWidth, GLint chipHeight, GLvoid* pPixels);
 
    bool isTextureReady(unsigned int index) const;
+   void invalidate();
 
    std::vector<ImageFilterDescriptor*> getFilters() const;
 
@@ -58,6 +59,7 @@ private:
    ColorBuffer* mpOutputColorBuffer;
 
    bool mbInitialized;
+   bool mbDataChanged;
 
    std::vector<ImageFilter*> mFilters;
    std::vector<unsigned int> mTexData;
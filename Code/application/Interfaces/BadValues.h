@@ -13,7 +13,9 @@
 #include "ConfigurationSettings.h"
 #include "Serializable.h"
 #include "Subject.h"
+#include "TypesFile.h"
 
+#include <stddef.h>
 #include <string>
 #include <vector>
 
@@ -339,6 +341,43 @@ protected:
     *  FactoryResource object or by calling ObjectFactory::destroyObject().
     */
    virtual ~BadValues() {}
+
+public:
+   // Methods added to the interface are declared after the existing methods so
+   // that plug-ins built against an earlier version keep working
+
+   /**
+    *  Tests a span of data values against the bad value criteria.
+    *
+    *  This method gives the same result as calling isBadValue() for each value, but the criteria are
+    *  compiled for each data type when they change, so that integer data is tested against integer
+    *  bounds and a hash of the individual bad values, and floating point data with at most one bad value
+    *  range is tested with SIMD instructions.  It should be used instead of isBadValue() whenever the
+    *  values of a row or a block of data are tested together.
+    *
+    *  @param   pData
+    *           The first value to test.
+    *  @param   type
+    *           The data type of the values.  Complex data types are not supported since the value
+    *           which is tested depends on the complex component.
+    *  @param   count
+    *           The number of values to test.
+    *  @param   stride
+    *           The number of values from one tested value to the next, which is 1 for contiguous values.
+    *  @param   pMask
+    *           Returns one byte for each tested value, which is \c 0 for a bad value and \c 0xff for a
+    *           valid value, so that the mask can be used directly as an alpha channel.  This must hold
+    *           at least \em count bytes.
+    *  @param   badValueCount
+    *           Returns the number of bad values.
+    *
+    *  @return  Returns \c true if the values were tested, or \c false if the data type is not supported
+    *           or \em pData or \em pMask is \c NULL.
+    *
+    *  @see     isBadValue()
+    */
+   virtual bool getValidityMask(const void* pData, EncodingType type, size_t count, ptrdiff_t stride,
+      unsigned char* pMask, size_t& badValueCount) const = 0;
 };
 
 #endif
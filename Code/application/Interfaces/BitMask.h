@@ -13,6 +13,9 @@
 #include "Serializable.h"
 #include "TypesFile.h"
 
+#include <utility>
+#include <vector>
+
 /**
  *  Mask for selecting indiviual pixel locations
  *
@@ -259,6 +262,40 @@ protected:
     * This should be destroyed by calling ObjectFactory::destroyObject.
     */
    virtual ~BitMask() {}
+
+public:
+   // Methods added to the interface are declared after the existing methods so
+   // that plug-ins built against an earlier version keep working
+
+   /**
+    *  Gets the runs of selected pixels in part of a row.
+    *
+    *  Each run is returned as a pair of the first column in the run and the
+    *  column after the last column in the run, so that the run covers the
+    *  columns [first, second).  Adjacent selected pixels are always returned
+    *  in a single run, and the runs are ordered from left to right.  The
+    *  outside flag is included, so pixels outside of the bounding box are
+    *  selected if isOutsideSelected() returns \c true.
+    *
+    *  Runs of 32 pixels which are all on or all off are found without
+    *  testing each pixel, so this is much faster than calling getPixel()
+    *  for each pixel of a sparse mask.
+    *
+    *  @param   y
+    *           The row of the pixels.
+    *  @param   x1
+    *           The first column in which to find selected pixels.
+    *  @param   x2
+    *           The last column in which to find selected pixels.
+    *  @param   spans
+    *           Populated with the runs of selected pixels between \em x1 and
+    *           \em x2 inclusive.  This is empty if none of the pixels are
+    *           selected.
+    *
+    *  @return  The number of selected pixels between \em x1 and \em x2
+    *           inclusive.
+    */
+   virtual int getRowSpans(int y, int x1, int x2, std::vector<std::pair<int, int> >& spans) const = 0;
 };
 
 #endif // _BITMASK_
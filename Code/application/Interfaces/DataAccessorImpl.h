@@ -11,13 +11,16 @@
 #define DATA_ACCESSOR_IMPL_H
 
 #include "AppConfig.h"
+#include "DataBlock.h"
 #include "RasterElement.h"
 #include "RasterPager.h"
 #include "DataRequest.h"
 #include "TypesFile.h"
 #include "ObjectResource.h"
+#include <algorithm>
 #include <exception>
 #include <stdexcept>
+#include <stddef.h>
 
 class RasterPage;
 
@@ -56,6 +59,41 @@ typedef int64_t (*convertToInteger)(const void*, int, ComplexComponent);
  *    nextRow()
  * @endcode
  *
+ * Windowed algorithms can instead request a tile shape by setting both the
+ * concurrent rows and the concurrent columns in the DataRequest, and then walk
+ * the requested area one tile at a time.  Pagers for natively tiled data can
+ * then return their own tiles without reading or reassembling full rows.
+ *
+ * @code
+ *   while isValid()
+ *      for row in [0, getTileRowCount())
+ *         for column in [0, getTileColumnCount())
+ *            value = *getColumn()
+ *            nextColumn()
+ *         nextRow()
+ *      nextTile()
+ * @endcode
+ *
+ * Algorithms which only need a sample of the data, such as subsampled
+ * statistics, can set strides in the DataRequest.  The pages then contain only
+ * the sampled rows, columns and bands, so nextRow() and nextColumn() move
+ * directly to the next sample and the skipped data is never read.
+ *
+ * Inner loops which should run at memory bandwidth can take the rest of the
+ * current page as a typed DataBlock instead of stepping one column at a time.
+ * The block gives the column and band strides of the interleave explicitly,
+ * so its row spans can be processed with plain indexed loops or with the
+ * functions in SpanReductions.
+ *
+ * @code
+ *   while isValid()
+ *      block = getBlock<float>()
+ *      for row in [0, block.getRowCount())
+ *         span = block.getRowSpan(row, band)
+ *         // Process span[0] through span[span.getCount() - 1].
+ *      nextRow(block.getRowCount())
+ * @endcode
+ *
  * @see      RasterElement::getDataAccessor()
  */
 class DataAccessorImpl
@@ -107,6 +145,11 @@ public:
       mCurrentColumn(0),
       mRowOffset(0),
       mColumnOffset(0),
+      mTileRow(0),
+      mTileColumn(0),
+      mRowStride(1),
+      mColumnStride(1),
+      mElementSize(0),
       mRefCount(0),
       mConvertToDoubleFunc(NULL),
       mConvertToIntegerFunc(NULL)
@@ -118,6 +161,10 @@ public:
       mAccessorRow = mpRequest->getStartRow().getActiveNumber();
       mAccessorColumn = mpRequest->getStartColumn().getActiveNumber();
       mAccessorBand = mpRequest->getStartBand().getActiveNumber();
+      mTileRow = mAccessorRow;
+      mTileColumn = mAccessorColumn;
+      mRowStride = std::max(mpRequest->getRowStride(), 1U);
+      mColumnStride = std::max(mpRequest->getColumnStride(), 1U);
       updateDataSizes(elementSize, interLineBytes);
    }
 
@@ -284,7 +331,8 @@ public:
     *  Jumps to the specified pixel in the current band.
     *
     *  This method updates the current offset to the given pixel at row, column
-    *  in the current band.
+    *  in the current band.  For a decimated DataRequest, the row and column
+    *  must be ones which are returned by the request.
     *
     *  @param   row
     *           The row to access in the current band.  This must be non-negative
@@ -295,13 +343,100 @@ public:
     */
    inline void toPixel(int row, int column) 
    { 
-      mCurrentRow = row-mAccessorRow; 
-      mCurrentColumn = column-mAccessorColumn; 
+      // A row before the current page wraps around, which incrementDataAccessor() undoes
+      mCurrentRow = static_cast<size_t>((row - static_cast<ptrdiff_t>(mAccessorRow)) /
+         static_cast<ptrdiff_t>(mRowStride));
+      mCurrentColumn = static_cast<size_t>((column - static_cast<ptrdiff_t>(mAccessorColumn)) /
+         static_cast<ptrdiff_t>(mColumnStride));
       mRowOffset = mCurrentRow * mRowSize;
       mColumnOffset = mCurrentColumn * mColumnSize;
       updateIfNeeded(); 
    }
 
+   /**
+    *  Advances to the next tile of the requested area.
+    *
+    *  Tiles are the size of the concurrent rows and concurrent columns of the
+    *  DataRequest and are visited left to right and then top to bottom.  The
+    *  tiles in the last tile row and column are clipped to the stop row and
+    *  stop column of the request.  For a decimated DataRequest, the tile
+    *  size counts the returned rows and columns.  After the call, the accessor is positioned
+    *  at the first row and column of the new tile.  If there are no more
+    *  tiles, the accessor becomes invalid.
+    *
+    *  @see     getTileStartRow(), getTileStartColumn()
+    */
+   inline void nextTile()
+   {
+      if (mpRasterElement == NULL)
+      {
+         throw std::logic_error("DataAccessor back-pointer to data cube has become corrupted");
+      }
+
+      mTileColumn += mpRequest->getConcurrentColumns() * mColumnStride;
+      if (mTileColumn > mpRequest->getStopColumn().getActiveNumber())
+      {
+         mTileColumn = mpRequest->getStartColumn().getActiveNumber();
+         mTileRow += mpRequest->getConcurrentRows() * mRowStride;
+      }
+
+      if (mTileRow > mpRequest->getStopRow().getActiveNumber())
+      {
+         mbValid = false;
+         return;
+      }
+
+      mAccessorRow = mTileRow;
+      mAccessorColumn = mTileColumn;
+      mCurrentRow = mCurrentColumn = 0;
+      mRowOffset = mColumnOffset = 0;
+      mpRasterElement->incrementDataAccessor(*this);
+   }
+
+   /**
+    *  Returns the first row of the current tile.
+    *
+    *  @return  The active row number of the first row in the current tile.
+    */
+   inline size_t getTileStartRow() const
+   {
+      return mTileRow;
+   }
+
+   /**
+    *  Returns the first column of the current tile.
+    *
+    *  @return  The active column number of the first column in the current tile.
+    */
+   inline size_t getTileStartColumn() const
+   {
+      return mTileColumn;
+   }
+
+   /**
+    *  Returns the number of rows in the current tile.
+    *
+    *  @return  The number of rows in the current tile, clipped to the stop row
+    *           of the request.
+    */
+   inline size_t getTileRowCount() const
+   {
+      size_t stopRow = mpRequest->getStopRow().getActiveNumber();
+      return std::min<size_t>(mpRequest->getConcurrentRows(), (stopRow - mTileRow) / mRowStride + 1);
+   }
+
+   /**
+    *  Returns the number of columns in the current tile.
+    *
+    *  @return  The number of columns in the current tile, clipped to the stop
+    *           column of the request.
+    */
+   inline size_t getTileColumnCount() const
+   {
+      size_t stopColumn = mpRequest->getStopColumn().getActiveNumber();
+      return std::min<size_t>(mpRequest->getConcurrentColumns(), (stopColumn - mTileColumn) / mColumnStride + 1);
+   }
+
    /**
     *  Returns the RasterElement associated with this DataAccessor.
     *
@@ -387,6 +522,160 @@ public:
       return mConcurrentColumns;
    }
 
+   /**
+    *  Access the number of bands available concurrently.
+    *
+    *  @return The number of concurrent bands, which is 1 for BSQ data.
+    */
+   inline size_t getConcurrentBands() const
+   {
+      return mConcurrentBands;
+   }
+
+   /**
+    *  Access the number of bytes from one row to the next.
+    *
+    *  @return The number of bytes from the start of one row in the page to the
+    *          start of the next, including interline bytes.
+    */
+   inline size_t getRowPitch() const
+   {
+      return mRowSize;
+   }
+
+   /**
+    *  Access the number of bytes from one column to the next.
+    *
+    *  @return The number of bytes from one column of a band to the next
+    *          column of the same band.
+    */
+   inline size_t getColumnPitch() const
+   {
+      return mColumnSize;
+   }
+
+   /**
+    *  Access the number of bytes from one band to the next.
+    *
+    *  @return The number of bytes from one band of a column to the next band
+    *          of the same column, or 0 for BSQ data.
+    */
+   inline size_t getBandPitch() const
+   {
+      switch (mpRequest->getInterleaveFormat())
+      {
+      case BIP:
+         return mElementSize;
+      case BIL:
+         return mElementSize * mConcurrentColumns;
+      default:
+         return 0;
+      }
+   }
+
+   /**
+    *  Returns the number of rows available in the page from the current row.
+    *
+    *  @return  The number of rows which can be accessed from getRow() before
+    *           nextRow() reads another page, clipped to the stop row of the
+    *           request.
+    */
+   inline size_t getBlockRowCount() const
+   {
+      if (mCurrentRow >= mConcurrentRows)
+      {
+         return 0;
+      }
+
+      size_t row = mAccessorRow + mCurrentRow * mRowStride;
+      size_t stopRow = mpRequest->getStopRow().getActiveNumber();
+      if (row > stopRow)
+      {
+         return 0;
+      }
+
+      return std::min<size_t>(mConcurrentRows - mCurrentRow, (stopRow - row) / mRowStride + 1);
+   }
+
+   /**
+    *  Returns the number of columns available in the page from the current column.
+    *
+    *  @return  The number of columns which can be accessed from getColumn(),
+    *           clipped to the stop column of the request.
+    */
+   inline size_t getBlockColumnCount() const
+   {
+      if (mCurrentColumn >= mConcurrentColumns)
+      {
+         return 0;
+      }
+
+      size_t column = mAccessorColumn + mCurrentColumn * mColumnStride;
+      size_t stopColumn = mpRequest->getStopColumn().getActiveNumber();
+      if (column > stopColumn)
+      {
+         return 0;
+      }
+
+      return std::min<size_t>(mConcurrentColumns - mCurrentColumn, (stopColumn - column) / mColumnStride + 1);
+   }
+
+   /**
+    *  Gets one band of the current row as a typed span.
+    *
+    *  The span starts at the current column and contains getBlockColumnCount()
+    *  elements.  The template type must match the data type of the
+    *  RasterElement, or the data type set in the DataRequest.
+    *
+    *  @param   band
+    *           The band in the page, counting from the first band of the page.
+    *
+    *  @return  The elements of the band in the current row.
+    */
+   template<typename T>
+   inline DataSpan<T> getRowSpan(size_t band = 0)
+   {
+      char* pData = &mpPage[mRowOffset + mColumnOffset] + band * getBandPitch();
+      return DataSpan<T>(reinterpret_cast<T*>(pData), getBlockColumnCount(),
+         static_cast<ptrdiff_t>(mColumnSize / mElementSize));
+   }
+
+   /**
+    *  Gets the rest of the current page as a typed block.
+    *
+    *  The block starts at the current row and column and contains every band of
+    *  the page.  Call nextRow() with the number of rows of the block to move to
+    *  the next page.  The template type must match the data type of the
+    *  RasterElement, or the data type set in the DataRequest.
+    *
+    *  @param   maxRows
+    *           The maximum number of rows in the block, or 0 for no maximum.
+    *  @param   maxColumns
+    *           The maximum number of columns in the block, or 0 for no maximum.
+    *
+    *  @return  The block of data at the current position.
+    *
+    *  @see     getBlockRowCount(), getBlockColumnCount()
+    */
+   template<typename T>
+   inline DataBlock<T> getBlock(size_t maxRows = 0, size_t maxColumns = 0)
+   {
+      size_t rows = getBlockRowCount();
+      if (maxRows > 0)
+      {
+         rows = std::min(rows, maxRows);
+      }
+
+      size_t columns = getBlockColumnCount();
+      if (maxColumns > 0)
+      {
+         columns = std::min(columns, maxColumns);
+      }
+
+      return DataBlock<T>(&mpPage[mRowOffset + mColumnOffset], rows, columns, mConcurrentBands, mRowSize,
+         static_cast<ptrdiff_t>(mColumnSize / mElementSize), static_cast<ptrdiff_t>(getBandPitch() / mElementSize));
+   }
+
 private:
    friend class RasterElementImp;
 
@@ -424,6 +713,7 @@ private:
    void updateDataSizes(size_t elementSize, size_t interLineBytes)
    {
       mInterlineBytes = interLineBytes;
+      mElementSize = elementSize;
       switch(mpRequest->getInterleaveFormat())
       {
       case BIP:
@@ -459,6 +749,11 @@ private:
    size_t mRowOffset;                  // Row offset into the cube
    size_t mColumnOffset;               // Column offset into the cube
    size_t mInterlineBytes;             // Number of bytes of non-data between rows
+   size_t mTileRow;                    // First row of the current tile
+   size_t mTileColumn;                 // First column of the current tile
+   size_t mRowStride;                  // Rows in the dataset from one returned row to the next
+   size_t mColumnStride;               // Columns in the dataset from one returned column to the next
+   size_t mElementSize;                // Size of a single element
 
    size_t mAccessorColumn;
    size_t mAccessorRow;
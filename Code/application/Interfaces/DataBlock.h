@@ -0,0 +1,316 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef DATABLOCK_H
+#define DATABLOCK_H
+
+#include <stddef.h>
+
+/**
+ * A typed view of evenly spaced data elements.
+ *
+ * A DataSpan is usually one band of one row of a DataAccessor, as returned by
+ * DataAccessorImpl::getRowSpan() or DataBlock::getRowSpan().  The elements are
+ * a fixed number of elements apart, which is 1 for contiguous elements, so
+ * loops over a span are plain indexed loops which the compiler can vectorize.
+ *
+ * @see SpanReductions
+ */
+template<typename T>
+class DataSpan
+{
+public:
+   /**
+    * Creates an empty span.
+    */
+   DataSpan() :
+      mpData(NULL),
+      mCount(0),
+      mStride(1)
+   {
+   }
+
+   /**
+    * Creates a span.
+    *
+    * @param pData
+    *        The address of the first element.
+    * @param count
+    *        The number of elements in the span.
+    * @param stride
+    *        The number of elements from one element of the span to the next.
+    */
+   DataSpan(T* pData, size_t count, ptrdiff_t stride = 1) :
+      mpData(pData),
+      mCount(count),
+      mStride(stride)
+   {
+   }
+
+   /**
+    * Returns the address of the first element.
+    *
+    * @return The address of the first element, or \c NULL for an empty span.
+    */
+   T* getData() const
+   {
+      return mpData;
+   }
+
+   /**
+    * Returns the number of elements.
+    *
+    * @return The number of elements in the span.
+    */
+   size_t getCount() const
+   {
+      return mCount;
+   }
+
+   /**
+    * Returns the spacing of the elements.
+    *
+    * @return The number of elements from one element of the span to the next.
+    */
+   ptrdiff_t getStride() const
+   {
+      return mStride;
+   }
+
+   /**
+    * Returns whether the elements are contiguous.
+    *
+    * @return True if the stride is 1, false otherwise.
+    */
+   bool isContiguous() const
+   {
+      return mStride == 1;
+   }
+
+   /**
+    * Accesses an element.
+    *
+    * No bounds checking is performed.
+    *
+    * @param index
+    *        The index of the element in the span.
+    *
+    * @return The element.
+    */
+   T& operator[](size_t index) const
+   {
+      return mpData[static_cast<ptrdiff_t>(index) * mStride];
+   }
+
+private:
+   T* mpData;
+   size_t mCount;
+   ptrdiff_t mStride;
+};
+
+/**
+ * A typed view of the rows, columns and bands of a page of raster data.
+ *
+ * A DataBlock is returned by DataAccessorImpl::getBlock() and covers the rows
+ * and columns of the current page from the current position of the accessor.
+ * The column and band strides are in elements and make the BIP, BIL and BSQ
+ * layouts explicit:
+ *
+ * @code
+ *          column stride    band stride
+ *    BIP:  bands            1
+ *    BIL:  1                columns
+ *    BSQ:  1                (one band)
+ * @endcode
+ *
+ * Rows are a number of bytes apart, since a page may have interline bytes
+ * which are not a multiple of the element size.
+ */
+template<typename T>
+class DataBlock
+{
+public:
+   /**
+    * Creates an empty block.
+    */
+   DataBlock() :
+      mpData(NULL),
+      mRows(0),
+      mColumns(0),
+      mBands(0),
+      mRowPitch(0),
+      mColumnStride(1),
+      mBandStride(1)
+   {
+   }
+
+   /**
+    * Creates a block.
+    *
+    * @param pData
+    *        The address of the element at the first row, column and band.
+    * @param rows
+    *        The number of rows in the block.
+    * @param columns
+    *        The number of columns in the block.
+    * @param bands
+    *        The number of bands in the block.
+    * @param rowPitch
+    *        The number of bytes from one row to the next.
+    * @param columnStride
+    *        The number of elements from one column to the next.
+    * @param bandStride
+    *        The number of elements from one band to the next.
+    */
+   DataBlock(void* pData, size_t rows, size_t columns, size_t bands, size_t rowPitch, ptrdiff_t columnStride,
+      ptrdiff_t bandStride) :
+      mpData(reinterpret_cast<char*>(pData)),
+      mRows(rows),
+      mColumns(columns),
+      mBands(bands),
+      mRowPitch(rowPitch),
+      mColumnStride(columnStride),
+      mBandStride(bandStride)
+   {
+   }
+
+   /**
+    * Returns the number of rows.
+    *
+    * @return The number of rows in the block.
+    */
+   size_t getRowCount() const
+   {
+      return mRows;
+   }
+
+   /**
+    * Returns the number of columns.
+    *
+    * @return The number of columns in the block.
+    */
+   size_t getColumnCount() const
+   {
+      return mColumns;
+   }
+
+   /**
+    * Returns the number of bands.
+    *
+    * @return The number of bands in the block.
+    */
+   size_t getBandCount() const
+   {
+      return mBands;
+   }
+
+   /**
+    * Returns the spacing of the rows.
+    *
+    * @return The number of bytes from one row to the next.
+    */
+   size_t getRowPitch() const
+   {
+      return mRowPitch;
+   }
+
+   /**
+    * Returns the spacing of the columns.
+    *
+    * @return The number of elements from one column to the next.
+    */
+   ptrdiff_t getColumnStride() const
+   {
+      return mColumnStride;
+   }
+
+   /**
+    * Returns the spacing of the bands.
+    *
+    * @return The number of elements from one band to the next.
+    */
+   ptrdiff_t getBandStride() const
+   {
+      return mBandStride;
+   }
+
+   /**
+    * Returns the first element of a row.
+    *
+    * @param row
+    *        The row in the block.
+    *
+    * @return The address of the element at the first column and first band
+    *         of the row.
+    */
+   T* getRow(size_t row) const
+   {
+      return reinterpret_cast<T*>(mpData + row * mRowPitch);
+   }
+
+   /**
+    * Returns the columns of one band of a row.
+    *
+    * @param row
+    *        The row in the block.
+    * @param band
+    *        The band in the block.
+    *
+    * @return A span of getColumnCount() elements.
+    */
+   DataSpan<T> getRowSpan(size_t row, size_t band = 0) const
+   {
+      return DataSpan<T>(getRow(row) + static_cast<ptrdiff_t>(band) * mBandStride, mColumns, mColumnStride);
+   }
+
+   /**
+    * Returns the bands of one pixel.
+    *
+    * @param row
+    *        The row in the block.
+    * @param column
+    *        The column in the block.
+    *
+    * @return A span of getBandCount() elements.
+    */
+   DataSpan<T> getPixelSpan(size_t row, size_t column) const
+   {
+      return DataSpan<T>(getRow(row) + static_cast<ptrdiff_t>(column) * mColumnStride, mBands, mBandStride);
+   }
+
+   /**
+    * Accesses an element.
+    *
+    * No bounds checking is performed.
+    *
+    * @param row
+    *        The row in the block.
+    * @param column
+    *        The column in the block.
+    * @param band
+    *        The band in the block.
+    *
+    * @return The element.
+    */
+   T& operator()(size_t row, size_t column, size_t band = 0) const
+   {
+      return getRow(row)[static_cast<ptrdiff_t>(column) * mColumnStride + static_cast<ptrdiff_t>(band) * mBandStride];
+   }
+
+private:
+   char* mpData;
+   size_t mRows;
+   size_t mColumns;
+   size_t mBands;
+   size_t mRowPitch;
+   ptrdiff_t mColumnStride;
+   ptrdiff_t mBandStride;
+};
+
+#endif
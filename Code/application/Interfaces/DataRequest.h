@@ -10,6 +10,7 @@
 #ifndef DATAREQUEST_H
 #define DATAREQUEST_H
 
+#include "ComplexData.h"
 #include "DimensionDescriptor.h"
 #include "TypesFile.h"
 
@@ -81,7 +82,8 @@ public:
     *        The descriptor to use to determine required version.
     *
     * @return The smallest version number which can properly use this
-    *         DataRequest.  Currently always returns 1.
+    *         DataRequest.  This is 3 if a data type has been requested, 2 if
+    *         any of the strides is greater than 1, and 1 otherwise.
     *
     * @see RasterPager::getSupportedRequestVersion()
     */
@@ -150,7 +152,8 @@ public:
     *        to apply the default.
     * @param concurrentRows
     *        The requested number of concurrent rows.  This may be 0 to apply
-    *        the default.
+    *        the default.  Together with the concurrent columns, this is the
+    *        tile shape visited by DataAccessorImpl::nextTile().
     *
     * @see getStartRow(), getStopRow(), getConcurrentRows()
     */
@@ -200,7 +203,9 @@ public:
     *        to apply the default.
     * @param concurrentColumns
     *        The requested number of concurrent columns.  This may be 0 to apply
-    *        the default.
+    *        the default.  When this is less than the number of requested columns,
+    *        the pager may return a page containing only a tile of the data
+    *        instead of full rows.
     *
     * @see getStartColumn(), getStopColumn(), getConcurrentColumns()
     */
@@ -291,6 +296,138 @@ protected:
     * This should be destroyed by calling ObjectFactory::destroyObject.
     */
    virtual ~DataRequest() {}
+
+public:
+   // Methods added to the interface are declared after the existing methods so
+   // that plug-ins built against an earlier version keep working
+
+   /**
+    * Get the requested row stride.
+    *
+    * This defaults to 1.
+    *
+    * @return The requested number of rows from one returned row to the next.
+    *
+    * @see setStrides()
+    */
+   virtual unsigned int getRowStride() const = 0;
+
+   /**
+    * Get the requested column stride.
+    *
+    * This defaults to 1.
+    *
+    * @return The requested number of columns from one returned column to the next.
+    *
+    * @see setStrides()
+    */
+   virtual unsigned int getColumnStride() const = 0;
+
+   /**
+    * Get the requested band stride.
+    *
+    * This defaults to 1.
+    *
+    * @return The requested number of bands from one returned band to the next.
+    *
+    * @see setStrides()
+    */
+   virtual unsigned int getBandStride() const = 0;
+
+   /**
+    * Set the row, column, and band strides.
+    *
+    * A stride greater than 1 requests decimated data.  Only every
+    * \em stride'th row, column or band counting from the start row, column or
+    * band is returned, and the returned elements are packed together in the
+    * pages so that the skipped data is never read.  For example, a row stride
+    * of 4 with a start row of 2 returns rows 2, 6, 10 and so on.
+    *
+    * polish() moves the stop row, column and band back to the last returned
+    * row, column and band.  The concurrent rows, columns and bands, and their
+    * defaults, count the returned elements rather than all of the elements
+    * between the start and the stop.  For a DataAccessor, nextRow() and
+    * nextColumn() move to the next returned row or column, and toPixel() must
+    * be given a returned row and column.
+    *
+    * Decimated requests cannot be writable.  The band stride is ignored for BSQ
+    * requests, which always access a single band.
+    *
+    * @param rowStride
+    *        The requested row stride.  This may be 0 to apply the default.
+    * @param columnStride
+    *        The requested column stride.  This may be 0 to apply the default.
+    * @param bandStride
+    *        The requested band stride.  This may be 0 to apply the default.
+    *
+    * @see getRowStride(), getColumnStride(), getBandStride(), getRequestVersion()
+    */
+   virtual void setStrides(unsigned int rowStride, unsigned int columnStride, unsigned int bandStride) = 0;
+
+   /**
+    * Get the requested data type.
+    *
+    * This defaults to an invalid EncodingType, which returns the data in the
+    * data type of the RasterElement.
+    *
+    * @return The requested data type.
+    *
+    * @see setDataType()
+    */
+   virtual EncodingType getDataType() const = 0;
+
+   /**
+    * Get the complex component returned for complex data.
+    *
+    * This defaults to ::COMPLEX_MAGNITUDE.
+    *
+    * @return The requested complex component.
+    *
+    * @see setDataType()
+    */
+   virtual ComplexComponent getComplexComponent() const = 0;
+
+   /**
+    * Get whether bad values are returned as NaN.
+    *
+    * This defaults to false.
+    *
+    * @return True if the bad values of the RasterElement are replaced with NaN
+    *         in the returned data, false otherwise.
+    *
+    * @see setDataType()
+    */
+   virtual bool getBadValuesAsNan() const = 0;
+
+   /**
+    * Set the data type of the returned data.
+    *
+    * Requesting a data type lets an algorithm be written once for a single
+    * data type instead of once for each data type of the RasterElement.  The
+    * pages are converted in bulk before they are given to the DataAccessor,
+    * so DataAccessor::getColumn() returns elements of the requested type and
+    * no per-element conversion is needed.  The returned pages are copies of
+    * the data, so a request with a data type cannot be writable.
+    *
+    * polish() removes the requested data type if the RasterElement already has
+    * that data type and no bad values are replaced.
+    *
+    * @param dataType
+    *        The requested data type.  This must be ::FLT4BYTES or ::FLT8BYTES,
+    *        or an invalid EncodingType to return the data in the data type of
+    *        the RasterElement.
+    * @param component
+    *        The component of complex data which is returned.  This is ignored
+    *        for data which is not complex.
+    * @param badValuesAsNan
+    *        If true, elements which are bad values in the RasterDataDescriptor
+    *        are returned as NaN.
+    *
+    * @see getDataType(), getComplexComponent(), getBadValuesAsNan(),
+    *      getRequestVersion()
+    */
+   virtual void setDataType(EncodingType dataType, ComplexComponent component = COMPLEX_MAGNITUDE,
+      bool badValuesAsNan = false) = 0;
 };
 
 #endif
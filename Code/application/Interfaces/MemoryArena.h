@@ -0,0 +1,108 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef MEMORYARENA_H
+#define MEMORYARENA_H
+
+#include "ConfigurationSettings.h"
+#include "TypesFile.h"
+
+#include <stddef.h>
+
+/**
+ *  Allocates the large zero-filled blocks which hold in-memory raster data.
+ *
+ *  Large blocks are mapped directly from the operating system instead of the
+ *  heap.  The operating system provides zeroed pages when they are first
+ *  touched, so a block is not written until it is used and allocating a
+ *  multi-gigabyte element takes no time.  On Linux, the blocks are aligned to
+ *  and advised for transparent huge pages when the HugePages setting is
+ *  enabled, which reduces TLB misses when the data is traversed.
+ *
+ *  Freed blocks are kept in size classes, up to CacheSize megabytes of
+ *  address space, and reused for later allocations of the same class.  The
+ *  physical pages of a freed block are returned to the operating system, so
+ *  a reused block is zero-filled again on first touch.
+ *
+ *  Blocks of less than a megabyte are allocated from the heap.
+ *
+ *  An instance of this interface is obtained from
+ *  ModelServices::getMemoryArena().  ModelServices::getMemoryBlock() and
+ *  ModelServices::deleteMemoryBlock() allocate from the arena.
+ */
+class MemoryArena
+{
+public:
+   SETTING(CacheSize, MemoryArena, unsigned int, 1024)
+   SETTING(HugePages, MemoryArena, bool, true)
+
+   /**
+    *  Allocates a zero-filled block of memory.
+    *
+    *  @param   size
+    *           The number of bytes in the block.
+    *
+    *  @return  The block, or \c NULL if \em size is 0 or the block cannot be
+    *           allocated.
+    *
+    *  @see     deallocate()
+    */
+   virtual char* allocate(size_t size) = 0;
+
+   /**
+    *  Frees a block of memory.
+    *
+    *  @param   pBlock
+    *           A block returned by allocate().  This may be \c NULL.  A
+    *           block which was not returned by allocate() is assumed to have
+    *           been allocated with \c new[] and is deleted with \c delete[].
+    */
+   virtual void deallocate(char* pBlock) = 0;
+
+   /**
+    *  Returns the size of the allocated blocks.
+    *
+    *  @return  The total number of bytes requested for the blocks which have
+    *           not been freed.
+    */
+   virtual int64_t getAllocatedBytes() const = 0;
+
+   /**
+    *  Returns the physical memory used by the allocated blocks.
+    *
+    *  Since pages are only provided when they are first touched, this is
+    *  less than getAllocatedBytes() until the blocks have been written.
+    *
+    *  @return  The number of bytes of the allocated blocks which are resident
+    *           in physical memory.  If the platform cannot report residency,
+    *           this is the same as getAllocatedBytes().
+    */
+   virtual int64_t getResidentBytes() const = 0;
+
+   /**
+    *  Returns the address space held by freed blocks kept for reuse.
+    *
+    *  @return  The number of bytes in the freed blocks.  These blocks use no
+    *           physical memory.
+    */
+   virtual int64_t getCachedBytes() const = 0;
+
+   /**
+    *  Returns all of the freed blocks kept for reuse to the operating system.
+    */
+   virtual void releaseCache() = 0;
+
+protected:
+   /**
+    *  This object is owned by ModelServices and should not be deleted.
+    */
+   virtual ~MemoryArena() {}
+};
+
+#endif
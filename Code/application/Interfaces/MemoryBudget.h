@@ -0,0 +1,214 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include "ConfigurationSettings.h"
+#include "EnumWrapper.h"
+#include "TypesFile.h"
+
+class DataElement;
+
+/**
+ *  Memory held by a cache or pager which is accounted by the MemoryBudget.
+ *
+ *  Caches implement this interface and register with
+ *  MemoryBudget::addConsumer() so that the memory they hold counts toward the
+ *  process-wide budget.  When the budget is exceeded, the budget releases the
+ *  least recently used memory from the consumers with the lowest priority
+ *  until the total usage is within the limit.
+ *
+ *  The methods are called by the budget while it holds its own lock, so an
+ *  implementation may lock its own data but must not call back into the
+ *  MemoryBudget.
+ *
+ *  @see     MemoryBudget
+ */
+class MemoryConsumer
+{
+public:
+   /**
+    *  Returns the memory held by the consumer.
+    *
+    *  @return  The number of bytes held, including memory which cannot be
+    *           released.
+    */
+   virtual int64_t getMemoryUsage() const = 0;
+
+   /**
+    *  Returns the access time of the least recently used memory which can be
+    *  released.
+    *
+    *  @param   accessTime
+    *           Set to the value returned by MemoryBudget::getAccessTime() when
+    *           the memory was last used.
+    *
+    *  @return  True if the consumer holds memory which can be released, false
+    *           otherwise.
+    */
+   virtual bool getOldestAccess(uint64_t& accessTime) const = 0;
+
+   /**
+    *  Releases the least recently used memory which can be released.
+    *
+    *  @return  The number of bytes released, or 0 if nothing was released.
+    */
+   virtual int64_t releaseOldest() = 0;
+
+protected:
+   /**
+    *  The consumer must be removed with MemoryBudget::removeConsumer() before
+    *  it is destroyed.
+    */
+   virtual ~MemoryConsumer() {}
+};
+
+/**
+ *  A process-wide limit on the memory held by raster pagers and caches.
+ *
+ *  Each cache which holds raster data registers itself as a MemoryConsumer
+ *  along with the DataElement whose data it holds.  Instead of each cache
+ *  enforcing a fixed size, the budget keeps the total memory of all consumers
+ *  within the CacheSize setting by releasing the least recently used memory
+ *  across all of the elements.  Memory of elements with a lower priority is
+ *  released first, so data displayed in a view is kept in preference to data
+ *  which is only being read by a background algorithm.
+ *
+ *  Access times are taken from getAccessTime() so that the least recently
+ *  used memory can be compared between caches in different plug-ins.
+ *
+ *  An instance of this interface is obtained from
+ *  ModelServices::getMemoryBudget().
+ *
+ *  @see     MemoryConsumer
+ */
+class MemoryBudget
+{
+public:
+   SETTING(CacheSize, MemoryBudget, unsigned int, 1024)
+
+   /**
+    *  The priority of the memory held for an element.
+    */
+   enum PriorityTypeEnum
+   {
+      PRIORITY_BACKGROUND = 0,   /**< The element is only used by background processing. */
+      PRIORITY_NORMAL,           /**< The default priority. */
+      PRIORITY_VISIBLE           /**< The element is displayed in a view. */
+   };
+
+   /**
+    *  @EnumWrapper ::PriorityTypeEnum.
+    */
+   typedef EnumWrapper<PriorityTypeEnum> PriorityType;
+
+   /**
+    *  Registers a consumer with the budget.
+    *
+    *  @param   pConsumer
+    *           The consumer to add.  Its memory counts toward the budget
+    *           until it is removed.
+    *  @param   pElement
+    *           The element whose data is held by the consumer.  This may be
+    *           \c NULL for memory which is not held for a single element.
+    */
+   virtual void addConsumer(MemoryConsumer* pConsumer, const DataElement* pElement) = 0;
+
+   /**
+    *  Removes a consumer from the budget.
+    *
+    *  @param   pConsumer
+    *           The consumer to remove.  This must be called before the
+    *           consumer is destroyed.
+    */
+   virtual void removeConsumer(MemoryConsumer* pConsumer) = 0;
+
+   /**
+    *  Returns a new access time.
+    *
+    *  Consumers stamp their memory with the returned value each time it is
+    *  used.  The value is larger than any previously returned value.
+    *
+    *  @return  The access time.
+    */
+   virtual uint64_t getAccessTime() = 0;
+
+   /**
+    *  Releases memory from the consumers until the total usage is within the
+    *  limit.
+    *
+    *  Consumers should call this method after their memory usage increases.
+    *  Since the budget locks each consumer while releasing memory, this
+    *  method must not be called while holding a lock which is also locked
+    *  by MemoryConsumer::releaseOldest().
+    */
+   virtual void update() = 0;
+
+   /**
+    *  Returns the maximum total memory of all consumers.
+    *
+    *  @return  The limit in bytes, from the CacheSize setting in megabytes.
+    */
+   virtual int64_t getLimit() const = 0;
+
+   /**
+    *  Returns the total memory of all consumers.
+    *
+    *  @return  The number of bytes held by all registered consumers.
+    */
+   virtual int64_t getUsage() const = 0;
+
+   /**
+    *  Returns the memory held for an element.
+    *
+    *  @param   pElement
+    *           The element.
+    *
+    *  @return  The number of bytes held by the consumers registered with
+    *           \em pElement.
+    */
+   virtual int64_t getUsage(const DataElement* pElement) const = 0;
+
+   /**
+    *  Sets the priority requested for an element.
+    *
+    *  Several objects can request a priority for the same element, such as
+    *  several views displaying the element.  The element has the highest of
+    *  the requested priorities.
+    *
+    *  @param   pElement
+    *           The element.
+    *  @param   priority
+    *           The requested priority.  Requesting #PRIORITY_NORMAL removes
+    *           the request.
+    *  @param   pRequester
+    *           The object requesting the priority, or \c NULL.
+    */
+   virtual void setPriority(const DataElement* pElement, PriorityType priority, const void* pRequester = NULL) = 0;
+
+   /**
+    *  Returns the priority of an element.
+    *
+    *  @param   pElement
+    *           The element.
+    *
+    *  @return  The highest priority requested for the element, or
+    *           #PRIORITY_NORMAL if no priority has been requested.
+    */
+   virtual PriorityType getPriority(const DataElement* pElement) const = 0;
+
+protected:
+   /**
+    *  This object is owned by ModelServices and should not be deleted.
+    */
+   virtual ~MemoryBudget() {}
+};
+
+#endif
@@ -25,6 +25,8 @@
 class DataDescriptor;
 class DataElement;
 class ImportDescriptor;
+class MemoryArena;
+class MemoryBudget;
 
 /**
  *  \ingroup ServiceModule
@@ -699,6 +701,10 @@ public:
     *  2^64, which is well over 18 million GB.  On a 32-bit platform, the
     *  maximum available bytes to allocate is 4 GB.
     *
+    *  The block is filled with zeros.  Large blocks are allocated by the
+    *  MemoryArena, so their pages are not zeroed or made resident until they
+    *  are first touched.
+    *
     *  @param   size
     *           The size in bytes of the requested memory block.
     *  @return  A pointer to the new memory block.  \b NULL is returned if
@@ -1057,6 +1063,33 @@ protected:
     * need to destroy it.
     */
    virtual ~ModelServices() {}
+
+public:
+   // Methods added to the interface are declared after the existing methods so
+   // that plug-ins built against an earlier version keep working
+
+   /**
+    *  Returns the memory budget shared by the raster pagers and caches.
+    *
+    *  Caches which hold raster data should register with the budget instead
+    *  of enforcing a fixed size of their own, so that memory is released from
+    *  the least recently used data of all elements.
+    *
+    *  @return  The memory budget.  The budget is owned by ModelServices and
+    *           should not be deleted.
+    */
+   virtual MemoryBudget* getMemoryBudget() = 0;
+
+   /**
+    *  Returns the arena which allocates the blocks of getMemoryBlock().
+    *
+    *  The arena reports the memory allocated for in-memory data and how much
+    *  of it is resident.
+    *
+    *  @return  The memory arena.  The arena is owned by ModelServices and
+    *           should not be deleted.
+    */
+   virtual MemoryArena* getMemoryArena() = 0;
 };
 
 /**
@@ -37,7 +37,8 @@ class Statistics;
  *  before doing anything with the dataset. Failure to do so may lead to unexpected results.
  *
  *  This subclass of Subject will notify upon the following conditions:
- *  - The following method is called: updateData().
+ *  - The following methods are called: updateData(), updateDataRegion().
+ *  - Statistics estimated by Statistics::calculateProgressively() are refined.
  *  - Everything else documented in DataElement.
  *
  *  @see   DataElement
@@ -57,9 +58,25 @@ public:
 
    /**
     *  Emitted when the RasterElement's data has been changed.
+    *
+    *  When all of the data may have changed, the signal is emitted with an
+    *  empty value.  When only part of the data has changed, the signal is
+    *  emitted with any<boost::tuple<DimensionDescriptor,DimensionDescriptor,
+    *  DimensionDescriptor,DimensionDescriptor,std::vector<DimensionDescriptor> > >
+    *  holding the start row, stop row, start column, stop column and bands
+    *  passed into updateDataRegion().  An empty band vector indicates that
+    *  all bands have changed.
     */
    SIGNAL_METHOD(RasterElement, DataModified);
 
+   /**
+    *  Emitted with any<Statistics*> when the estimated statistics of a band
+    *  have been replaced by more accurate statistics.
+    *
+    *  @see Statistics::calculateProgressively()
+    */
+   SIGNAL_METHOD(RasterElement, StatisticsRefined);
+
    /**
     *  Returns an individual data value in the cube.
     *
@@ -617,6 +634,87 @@ protected:
     * This should be destroyed by calling ModelServices::destroyElement.
     */
    virtual ~RasterElement() {}
+
+public:
+   // Methods added to the interface are declared after the existing methods so
+   // that plug-ins built against an earlier version keep working
+
+   /**
+    * This method will create a new RasterElement which is a chip of the object
+    * it is called on without copying its data.
+    *
+    * The chip has the same data descriptor as one created by createChip(), but
+    * its data is read from this RasterElement each time it is accessed.  This
+    * takes no time and no memory, which is useful when the chip is only read,
+    * such as a subset of the bands given to an algorithm.  Changes to this
+    * RasterElement are visible in the chip.
+    *
+    * The data of the chip is copied into memory when a writable DataAccessor is
+    * first requested from the chip, or when this RasterElement is destroyed.
+    * RasterElement::getRawData() returns \c NULL for a chip which has not
+    * been copied.
+    *
+    * If this RasterElement has no pager, or its data cannot be mapped onto the
+    * chip, the data is copied as in createChip().
+    *
+    *  @param   pParent
+    *           The element to use for the parent of the created cube.
+    *  @param   appendName
+    *           What to append to the name of the RasterElement.
+    *  @param   selectedRows
+    *           The DimensionDescriptors (unmodified from this object) for the rows
+    *           which should be included in this chip.  Passing an empty vector
+    *           will result in using the RasterElement's rows as the chipped rows.
+    *  @param   selectedColumns
+    *           The DimensionDescriptors (unmodified from this object) for the columns
+    *           which should be included in this chip.  Passing an empty vector
+    *           will result in using the RasterElement's columns as the chipped columns.
+    *  @param   selectedBands
+    *           The DimensionDescriptors (unmodified from this object) for the bands
+    *           which should be included in this chip.  Passing an empty vector
+    *           will result in using the RasterElement's bands as the chipped bands.
+    *
+    *  @return  A pointer to the created RasterElement
+    *
+    *  @see RasterElement::createChip()
+    */
+   virtual RasterElement* createVirtualChip(DataElement* pParent, const std::string& appendName,
+      const std::vector<DimensionDescriptor>& selectedRows, const std::vector<DimensionDescriptor>& selectedColumns,
+      const std::vector<DimensionDescriptor>& selectedBands = std::vector<DimensionDescriptor>()) const = 0;
+
+   /**
+    *  Notifies all observers of the object that part of its data has changed.
+    *
+    *  Only the statistics of the given bands are reset, and observers which
+    *  display the data can update only the part of the display which shows
+    *  the changed data.  This allows algorithms which write their results a
+    *  few rows at a time to update the display as they run without the cost
+    *  of regenerating the entire display each time.
+    *
+    *  @param   startRow
+    *           The first row which has changed.  If invalid, the first row
+    *           in the element is used.
+    *  @param   stopRow
+    *           The last row which has changed.  If invalid, the last row in
+    *           the element is used.
+    *  @param   startColumn
+    *           The first column which has changed.  If invalid, the first
+    *           column in the element is used.
+    *  @param   stopColumn
+    *           The last column which has changed.  If invalid, the last
+    *           column in the element is used.
+    *  @param   bands
+    *           The bands which have changed.  If empty, all bands have
+    *           changed.
+    *
+    *  @notify  This method will notify RasterElement::signalDataModified with
+    *           the changed rows, columns and bands.
+    *
+    *  @see     updateData()
+    */
+   virtual void updateDataRegion(DimensionDescriptor startRow, DimensionDescriptor stopRow,
+      DimensionDescriptor startColumn, DimensionDescriptor stopColumn,
+      const std::vector<DimensionDescriptor>& bands = std::vector<DimensionDescriptor>()) = 0;
 };
 
 #endif
@@ -43,6 +43,9 @@ public:
     *  from the initial pointer returned by getRawData()
     *  in order to access the same column in the second row.
     *
+    *  For a page containing a tile of the data rather than
+    *  full rows, this is the width of the tile in memory.
+    *
     *  @return the number of columns that must be skipped.
     *          If a value of zero is returned, the RasterElement
     *          will assume that it will require DataDescriptor::getColumnNum()
@@ -145,6 +145,17 @@ public:
     * If any higher-version fields are changed from the defaults, the core will
     * assume that the RasterPager is unable to handle them, and the request will not be fulfilled.
     *
+    * Version 2 adds the strides of a decimated request.  A pager which
+    * supports version 2 must return pages containing only the requested rows,
+    * columns and bands, packed together.  When the pager of a RasterElement
+    * only supports version 1, RasterElement::getDataAccessor() decimates the
+    * pager's full pages instead.
+    *
+    * Version 3 adds the requested data type.  A pager which supports version 3
+    * must return pages already converted to the requested data type.  When a
+    * pager does not support version 3, RasterElement::getDataAccessor()
+    * converts the pages of a request for the native data type instead.
+    *
     * @return The highest request version supported.
     *
     * @see DataRequest::getRequestVersion()
@@ -44,6 +44,7 @@ class Statistics : public Serializable
 {
 public:
    SETTING(Resolution, Statistics, int, 0);
+   SETTING(Progressive, Statistics, bool, true);
 
    /**
     *  Sets the minimum value for the data.
@@ -342,8 +343,10 @@ public:
    /**
     *  Sets the step size used when computing the statistics for the data.
     *
-    *  This method sets the number of rows and columns that will be stepped
-    *  over while looping through the data to compute the statistics. 
+    *  This method sets the number of rows that will be stepped over while
+    *  looping through the data to compute the statistics.  Only every
+    *  resolution'th row is read, so a step size of \em N reads about
+    *  1/\em N of the data.
     *
     *  @param   resolution
     *           The step size for the data. Must be at least 1.
@@ -353,8 +356,8 @@ public:
    /**
     *  Gets the step size used when computing the statistics for the data.
     *
-    *  This method gets the number of rows and columns that will be stepped
-    *  over while looping through the data to compute the statistics. 
+    *  This method gets the number of rows that will be stepped over while
+    *  looping through the data to compute the statistics.
     *
     *  @return   The step size for the data. Will be at least 1.
     */
@@ -456,6 +459,169 @@ protected:
     * any instances of this object.
     */
    virtual ~Statistics() {}
+
+public:
+   // Methods added to the interface are declared after the existing methods so
+   // that plug-ins built against an earlier version keep working
+
+   /**
+    *  Returns the minimum value for the data, or its estimate.
+    *
+    *  If the statistics are being refined after calculateProgressively(),
+    *  the current estimate is returned instead of computing the statistics at
+    *  the statistics resolution.  Otherwise, this method is the same as
+    *  getMin().
+    *
+    *  @param   component
+    *           The complex data component for which to get its minimum value.
+    *
+    *  @return  The minimum value detected in the data, or -99999.9 if the
+    *           statistics could not be calculated successfully.
+    */
+   virtual double getEstimatedMin(ComplexComponent component) = 0;
+
+   /**
+    *  Returns the maximum value for the data, or its estimate.
+    *
+    *  If the statistics are being refined after calculateProgressively(),
+    *  the current estimate is returned instead of computing the statistics at
+    *  the statistics resolution.  Otherwise, this method is the same as
+    *  getMax().
+    *
+    *  @param   component
+    *           The complex data component for which to get its maximum value.
+    *
+    *  @return  The maximum value detected in the data, or -99999.9 if the
+    *           statistics could not be calculated successfully.
+    */
+   virtual double getEstimatedMax(ComplexComponent component) = 0;
+
+   /**
+    *  Returns the average value for the data, or its estimate.
+    *
+    *  If the statistics are being refined after calculateProgressively(),
+    *  the current estimate is returned instead of computing the statistics at
+    *  the statistics resolution.  Otherwise, this method is the same as
+    *  getAverage().
+    *
+    *  @param   component
+    *           The complex data component for which to get its average value.
+    *
+    *  @return  The average of all values in the data, or -99999.9 if the
+    *           statistics could not be calculated successfully.
+    */
+   virtual double getEstimatedAverage(ComplexComponent component) = 0;
+
+   /**
+    *  Returns the standard deviation for the data, or its estimate.
+    *
+    *  If the statistics are being refined after calculateProgressively(),
+    *  the current estimate is returned instead of computing the statistics at
+    *  the statistics resolution.  Otherwise, this method is the same as
+    *  getStandardDeviation().
+    *
+    *  @param   component
+    *           The complex data component for which to get its standard
+    *           deviation.
+    *
+    *  @return  The standard deviation of all values in the data, or -99999.9
+    *           if the statistics could not be calculated successfully.
+    */
+   virtual double getEstimatedStandardDeviation(ComplexComponent component) = 0;
+
+   /**
+    *  Returns the percentile boundaries for the data, or their estimate.
+    *
+    *  If the statistics are being refined after calculateProgressively(),
+    *  the current estimate is returned instead of computing the statistics at
+    *  the statistics resolution.  Otherwise, this method is the same as
+    *  getPercentiles().
+    *
+    *  @param   component
+    *           The complex data component for which to get its percentile
+    *           values.
+    *
+    *  @return  An array of 1001 values that contain the percentile boundaries
+    *           for the data, or \c NULL if the statistics could not be
+    *           calculated successfully.
+    */
+   virtual const double* getEstimatedPercentiles(ComplexComponent component) = 0;
+
+   /**
+    *  Returns the histogram values for the data, or their estimate.
+    *
+    *  If the statistics are being refined after calculateProgressively(),
+    *  the current estimate is returned instead of computing the statistics at
+    *  the statistics resolution.  Otherwise, this method is the same as
+    *  getHistogram().
+    *
+    *  @param   pBinCenters
+    *           Populated with an array of 256 values that specify the center
+    *           location of the histogram bins.  This value is set to \c NULL
+    *           if the histogram cannot be computed successfully.
+    *  @param   pHistogramCounts
+    *           Populated with an array of 256 values that specify the number
+    *           of values contained in each histogram bin.  This value is set
+    *           to \c NULL if the histogram cannot be computed successfully.
+    *  @param   component
+    *           The complex data component for which to get its histogram
+    *           values.
+    */
+   virtual void getEstimatedHistogram(const double*& pBinCenters, const unsigned int*& pHistogramCounts,
+      ComplexComponent component) = 0;
+
+   /**
+    *  Computes an estimate of the statistics and refines it in the background.
+    *
+    *  If the statistics have not been calculated, this method computes them
+    *  from a sparse sample of rows spread over the data, which takes a small
+    *  fraction of the time needed to compute them at the statistics
+    *  resolution, and returns.  The statistics are then computed from
+    *  successively more rows on a background thread until they have been
+    *  computed at the statistics resolution.  Each time that more accurate
+    *  statistics are set, the RasterElement notifies
+    *  RasterElement::signalStatisticsRefined().
+    *
+    *  While the statistics are being refined, areStatisticsApproximate()
+    *  returns \c true and the getEstimated methods, such as
+    *  getEstimatedMin(), return the current estimate.  The other get methods
+    *  stop the refinement and compute the statistics at the statistics
+    *  resolution, so callers which do not expect an estimate are never given
+    *  one.
+    *  Changing the resolution or the bad values, resetting the statistics,
+    *  updating the data or destroying the RasterElement cancels the
+    *  refinement.  Only one complex component is refined at a time, so
+    *  calling this method for another component discards the estimate of the
+    *  component being refined.
+    *
+    *  The statistics are computed before returning, as if one of the get
+    *  methods had been called, if the Progressive setting is disabled, if
+    *  the application is running in batch mode, if the statistics are not for
+    *  a single band of the whole RasterElement, or if the data is too small
+    *  for an estimate to save any time.
+    *
+    *  @param   component
+    *           The complex data component for which to compute the statistics.
+    *
+    *  @return  Returns \c true if the statistics are an estimate which is
+    *           being refined; otherwise returns \c false.
+    *
+    *  @see     areStatisticsApproximate()
+    */
+   virtual bool calculateProgressively(ComplexComponent component) = 0;
+
+   /**
+    *  Queries whether the statistics are an estimate which is being refined
+    *  in the background.
+    *
+    *  @param   component
+    *           The complex data component for which to query its statistics.
+    *
+    *  @return  Returns \c true if the statistics were estimated by
+    *           calculateProgressively() and have not yet been computed at the
+    *           statistics resolution; otherwise returns \c false.
+    */
+   virtual bool areStatisticsApproximate(ComplexComponent component) const = 0;
 };
 
 #endif
@@ -0,0 +1,128 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+/**
+ *  Work which is run by the ThreadPool.
+ *
+ *  Plug-ins should derive from mta::Task, which implements this interface
+ *  with a future that can be waited for, instead of implementing this
+ *  interface directly.
+ *
+ *  @see     ThreadPool
+ */
+class ThreadPoolTask
+{
+public:
+   /**
+    *  Runs the task.
+    *
+    *  This method is called once for each time that the task is submitted,
+    *  either in a worker thread of the pool or in a thread which is running
+    *  queued tasks with ThreadPool::runPendingTask().
+    */
+   virtual void execute() = 0;
+
+protected:
+   /**
+    *  A task must not be destroyed until it has been executed.
+    */
+   virtual ~ThreadPoolTask() {}
+};
+
+/**
+ *  A process-wide pool of worker threads.
+ *
+ *  The worker threads are created when the first task is submitted and are
+ *  kept until the application exits, so that running work in parallel does
+ *  not create and destroy threads each time.  Up to one worker is created for
+ *  each processor, and no more workers run than the ThreadCount setting in
+ *  ConfigurationSettings, which is read each time that a task is submitted.
+ *
+ *  Each worker has its own queue.  Tasks which are submitted by a worker are
+ *  added to its own queue, and the worker runs the most recently submitted of
+ *  them first.  A worker whose queue is empty takes the oldest task submitted
+ *  from outside of the pool, or steals the oldest task from the queue of
+ *  another worker.
+ *
+ *  Tasks which do not hold up the user, such as refining statistics which
+ *  are already displayed, can be submitted with submitBackground().  A
+ *  background task is only run when no other task is queued, and background
+ *  tasks never run on every worker at once, so tasks submitted while the
+ *  user waits do not queue behind them.
+ *
+ *  A worker which waits for another task should run queued tasks with
+ *  runPendingTask() until the task has finished, so that tasks which submit
+ *  and wait for tasks of their own do not leave the pool without a worker to
+ *  run them.  mta::Task::wait() does this.
+ *
+ *  An instance of this interface is obtained from
+ *  UtilityServices::getThreadPool().
+ *
+ *  @see     ThreadPoolTask
+ */
+class ThreadPool
+{
+public:
+   /**
+    *  Queues a task to be run by a worker.
+    *
+    *  @param   pTask
+    *           The task to run.  The pool does not take ownership of the
+    *           task, which must not be destroyed until it has been executed.
+    */
+   virtual void submit(ThreadPoolTask* pTask) = 0;
+
+   /**
+    *  Queues a task to be run by a worker when no other tasks are queued.
+    *
+    *  Background tasks are run in the order in which they are submitted, on
+    *  all but one of the workers when there is more than one.
+    *
+    *  @param   pTask
+    *           The task to run.  The pool does not take ownership of the
+    *           task, which must not be destroyed until it has been executed.
+    */
+   virtual void submitBackground(ThreadPoolTask* pTask) = 0;
+
+   /**
+    *  Runs one queued task in the calling thread.
+    *
+    *  Background tasks are not run by this method.
+    *
+    *  @return  True if a task was run, or false if no tasks were queued.
+    */
+   virtual bool runPendingTask() = 0;
+
+   /**
+    *  Queries whether the calling thread is a worker of the pool.
+    *
+    *  @return  True if the calling thread is a worker, false otherwise.
+    */
+   virtual bool isWorkerThread() const = 0;
+
+   /**
+    *  Returns the number of worker threads.
+    *
+    *  @return  The number of workers which are running, which is 0 until
+    *           the first task is submitted.  Workers above a lowered
+    *           ThreadCount setting stop once they are idle.
+    */
+   virtual unsigned int getThreadCount() const = 0;
+
+protected:
+   /**
+    *  This object is owned by UtilityServices and should not be deleted.
+    */
+   virtual ~ThreadPool() {}
+};
+
+#endif
@@ -18,6 +18,8 @@
 
 #include <string>
 
+class ThreadPool;
+
 /**
  *  \ingroup ServiceModule
  *  Provides access to data objects not available in the object factory
@@ -220,6 +222,22 @@ protected:
     * need to destroy it.
     */
    virtual ~UtilityServices() {}
+
+public:
+   // Methods added to the interface are declared after the existing methods so
+   // that plug-ins built against an earlier version keep working
+
+   /**
+    *  Returns the thread pool shared by the application and plug-ins.
+    *
+    *  Work which is run in parallel should be submitted to the pool, with
+    *  mta::Task or mta::MultiThreadedAlgorithm, instead of creating threads
+    *  of its own.
+    *
+    *  @return  The thread pool.  The pool is owned by UtilityServices and
+    *           should not be deleted.
+    */
+   virtual ThreadPool* getThreadPool() = 0;
 };
 
 #endif
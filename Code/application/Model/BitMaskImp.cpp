@@ -1649,3 +1649,86 @@ void BitMaskImp::getMinimalBoundingBox(int& x1, int& y1, int& x2, int& y2) const
       y2 = 0;
    }
 }
+
+namespace
+{
+   void addSpan(vector<pair<int, int> >& spans, int first, int end)
+   {
+      if (spans.empty() == false && spans.back().second == first)
+      {
+         spans.back().second = end;
+      }
+      else
+      {
+         spans.push_back(make_pair(first, end));
+      }
+   }
+}
+
+int BitMaskImp::getRowSpans(int y, int x1, int x2, vector<pair<int, int> >& spans) const
+{
+   spans.clear();
+   if (x2 < x1)
+   {
+      return 0;
+   }
+
+   // Pixels outside of the bounding box have the outside value, as in getPixel()
+   if (y > mbby2 || y < mbby1 || mpMask == NULL)
+   {
+      if (mOutside)
+      {
+         spans.push_back(make_pair(x1, x2 + 1));
+      }
+      return mOutside ? x2 - x1 + 1 : 0;
+   }
+
+   int count = 0;
+   if (mOutside && x1 < mbbx1)
+   {
+      int end = min(x2 + 1, mbbx1);
+      addSpan(spans, x1, end);
+      count += end - x1;
+   }
+
+   const unsigned int* pRow = mpMask[y - my1];
+   int x = max(x1, mbbx1);
+   const int last = min(x2, mbbx2);
+   while (x <= last)
+   {
+      int offset = x - mx1;
+      int shift = offset & 0x1f;   // mod 32
+      int bits = min(static_cast<int>(LONG_BITS) - shift, last - x + 1);
+
+      // The pixels from x to the end of its word are in the high bits
+      unsigned int values = pRow[offset >> 5] << shift;
+      if (values == 0)
+      {
+         x += bits;
+      }
+      else if (((~values) >> (LONG_BITS - bits)) == 0)
+      {
+         addSpan(spans, x, x + bits);
+         count += bits;
+         x += bits;
+      }
+      else
+      {
+         if ((values & 0x80000000) != 0)
+         {
+            addSpan(spans, x, x + 1);
+            ++count;
+         }
+         ++x;
+      }
+   }
+
+   if (mOutside && x2 > mbbx2)
+   {
+      int first = max(x1, mbbx2 + 1);
+      addSpan(spans, first, x2 + 1);
+      count += x2 + 1 - first;
+   }
+
+   return count;
+}
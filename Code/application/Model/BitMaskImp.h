@@ -358,6 +358,27 @@ public:
     */
    virtual void getMinimalBoundingBox(int& x1, int& y1, int& x2, int& y2) const;
 
+   /**
+    *  Gets the runs of selected pixels in part of a row.
+    *
+    *  The words of the mask are tested a word at a time where they are all
+    *  on or all off, so the time taken depends on the number of runs rather
+    *  than the number of pixels.
+    *
+    *  @param  y
+    *          The row of the pixels.
+    *  @param  x1
+    *          The first column in which to find selected pixels.
+    *  @param  x2
+    *          The last column in which to find selected pixels.
+    *  @param  spans
+    *          Populated with the [first, last + 1) columns of each run.
+    *
+    *  @return
+    *         the number of selected pixels between x1 and x2
+    */
+   virtual int getRowSpans(int y, int x1, int x2, std::vector<std::pair<int, int> >& spans) const;
+
 private:
    int mx1;
    int my1;                // the pixel coordinate of the lower left corner of the bitmask
@@ -0,0 +1,57 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "CompressedMemoryPage.h"
+
+CompressedMemoryPage::CompressedMemoryPage(void* pData, unsigned int numRows, size_t tile, bool writable) :
+   mpData(pData),
+   mNumRows(numRows),
+   mTile(tile),
+   mWritable(writable)
+{
+}
+
+CompressedMemoryPage::~CompressedMemoryPage()
+{
+}
+
+void* CompressedMemoryPage::getRawData()
+{
+   return mpData;
+}
+
+unsigned int CompressedMemoryPage::getNumRows()
+{
+   return mNumRows;
+}
+
+unsigned int CompressedMemoryPage::getNumColumns()
+{
+   return 0;
+}
+
+unsigned int CompressedMemoryPage::getNumBands()
+{
+   return 0;
+}
+
+unsigned int CompressedMemoryPage::getInterlineBytes()
+{
+   return 0;
+}
+
+size_t CompressedMemoryPage::getTile() const
+{
+   return mTile;
+}
+
+bool CompressedMemoryPage::isWritable() const
+{
+   return mWritable;
+}
@@ -0,0 +1,39 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef COMPRESSEDMEMORYPAGE_H
+#define COMPRESSEDMEMORYPAGE_H
+
+#include "RasterPage.h"
+
+#include <stddef.h>
+
+class CompressedMemoryPage : public RasterPage
+{
+public:
+   CompressedMemoryPage(void* pData, unsigned int numRows, size_t tile, bool writable);
+   ~CompressedMemoryPage();
+
+   void* getRawData();
+   unsigned int getNumRows();
+   unsigned int getNumColumns();
+   unsigned int getNumBands();
+   unsigned int getInterlineBytes();
+
+   size_t getTile() const;
+   bool isWritable() const;
+
+private:
+   void* mpData;
+   unsigned int mNumRows;
+   size_t mTile;
+   bool mWritable;
+};
+
+#endif
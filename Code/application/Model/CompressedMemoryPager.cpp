@@ -0,0 +1,348 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVersion.h"
+#include "AppVerify.h"
+#include "CompressedMemoryPage.h"
+#include "CompressedMemoryPager.h"
+#include "DataRequest.h"
+#include "ModelServices.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "TileCodec.h"
+
+#include <algorithm>
+#include <new>
+
+using namespace std;
+
+CompressedMemoryPager::CompressedMemoryPager() :
+   mpRaster(NULL),
+   mpBudget(NULL),
+   mNumRows(0),
+   mBytesPerElement(0),
+   mRowSize(0),
+   mRowsPerTile(0),
+   mTilesPerBand(0),
+   mHotTiles(0),
+   mMemoryUsage(0)
+{
+   setName("Compressed Memory Pager");
+   setCopyright(APP_COPYRIGHT);
+   setCreator("Ball Aerospace & Technologies Corp.");
+   setDescription("Provides access to data held in memory as compressed tiles");
+   setDescriptorId("{8D1B3C52-4F0E-4B8A-9E25-3A7C61D0F4B9}");
+   setVersion(APP_VERSION_NUMBER);
+   setProductionStatus(APP_IS_PRODUCTION_RELEASE);
+   setShortDescription("Provides a compressed RAM backing for data");
+}
+
+CompressedMemoryPager::~CompressedMemoryPager()
+{
+   if (mpBudget != NULL)
+   {
+      mpBudget->removeConsumer(this);
+   }
+
+   for (vector<size_t>::iterator iter = mCachedTiles.begin(); iter != mCachedTiles.end(); ++iter)
+   {
+      delete [] mTiles[*iter].mpData;
+   }
+}
+
+bool CompressedMemoryPager::getInputSpecification(PlugInArgList*& pArgList)
+{
+   Service<PlugInManagerServices> pPlugInMgr;
+
+   pArgList = pPlugInMgr->getPlugInArgList();
+   VERIFY(pArgList != NULL);
+
+   VERIFY(pArgList->addArg<RasterElement>("Raster Element"));
+
+   return true;
+}
+
+bool CompressedMemoryPager::execute(PlugInArgList* pInput, PlugInArgList* pOutput)
+{
+   VERIFY(mpRaster == NULL);
+   VERIFY(pInput != NULL);
+
+   mpRaster = pInput->getPlugInArgValue<RasterElement>("Raster Element");
+   VERIFY(mpRaster != NULL);
+
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+   VERIFY(pDescriptor != NULL);
+
+   mInterleave = pDescriptor->getInterleaveFormat();
+   mNumRows = pDescriptor->getRowCount();
+   mBytesPerElement = pDescriptor->getBytesPerElement();
+   unsigned int numColumns = pDescriptor->getColumnCount();
+   unsigned int numBands = pDescriptor->getBandCount();
+   VERIFY(mNumRows > 0 && numColumns > 0 && numBands > 0 && mBytesPerElement > 0);
+
+   size_t numTileBands = 1;
+   mRowSize = static_cast<size_t>(numColumns) * mBytesPerElement;
+   if (mInterleave == BSQ)
+   {
+      numTileBands = numBands;
+   }
+   else
+   {
+      mRowSize *= numBands;
+   }
+
+   size_t tileSize = static_cast<size_t>(max(getSettingTileSize(), 1U)) * 1024;
+   mRowsPerTile = static_cast<unsigned int>(min(max(tileSize / mRowSize, static_cast<size_t>(1)),
+      static_cast<size_t>(mNumRows)));
+   mTilesPerBand = (mNumRows + mRowsPerTile - 1) / mRowsPerTile;
+   mHotTiles = max(getSettingHotTiles(), 1U);
+
+   try
+   {
+      mTiles.resize(mTilesPerBand * numTileBands);
+   }
+   catch (const bad_alloc&)
+   {
+      return false;
+   }
+
+   mpBudget = Service<ModelServices>()->getMemoryBudget();
+   mpBudget->addConsumer(this, mpRaster);
+
+   return true;
+}
+
+RasterPage* CompressedMemoryPager::getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
+                                           DimensionDescriptor startColumn, DimensionDescriptor startBand)
+{
+   VERIFYRV(mpRaster != NULL, NULL);
+   VERIFYRV(pOriginalRequest != NULL, NULL);
+
+   if (pOriginalRequest->getInterleaveFormat() != mInterleave)
+   {
+      return NULL;
+   }
+
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+   VERIFYRV(pDescriptor != NULL, NULL);
+
+   unsigned int numColumns = pDescriptor->getColumnCount();
+   unsigned int numBands = pDescriptor->getBandCount();
+
+   unsigned int rowNumber = startRow.getActiveNumber();
+   unsigned int colNumber = startColumn.getActiveNumber();
+   unsigned int bandNumber = startBand.getActiveNumber();
+   if (rowNumber >= mNumRows || colNumber >= numColumns || bandNumber >= numBands)
+   {
+      return NULL;
+   }
+
+   size_t tile = rowNumber / mRowsPerTile;
+   unsigned int tileRow = rowNumber % mRowsPerTile;
+   size_t offset = tileRow * mRowSize;
+   switch (mInterleave)
+   {
+   case BIP:
+      offset += (static_cast<size_t>(colNumber) * numBands + bandNumber) * mBytesPerElement;
+      break;
+   case BSQ:
+      tile += bandNumber * mTilesPerBand;
+      offset += static_cast<size_t>(colNumber) * mBytesPerElement;
+      break;
+   case BIL:
+      offset += (static_cast<size_t>(bandNumber) * numColumns + colNumber) * mBytesPerElement;
+      break;
+   default:
+      return NULL;
+   }
+
+   unsigned int numRows = min(mRowsPerTile - tileRow, mNumRows - rowNumber);
+   CompressedMemoryPage* pPage = NULL;
+   bool cached = false;
+   {
+      mta::MutexLock lock(mMutex);
+      Tile& currentTile = mTiles[tile];
+      if (currentTile.mpData == NULL)
+      {
+         if (!cacheTile(tile))
+         {
+            return NULL;
+         }
+         cached = true;
+      }
+
+      ++currentTile.mPins;
+      currentTile.mAccessTime = mpBudget->getAccessTime();
+      pPage = new CompressedMemoryPage(currentTile.mpData + offset, numRows, tile, pOriginalRequest->getWritable());
+   }
+
+   if (cached)
+   {
+      mpBudget->update();
+   }
+
+   return pPage;
+}
+
+void CompressedMemoryPager::releasePage(RasterPage* pPage)
+{
+   CompressedMemoryPage* pCompressedPage = dynamic_cast<CompressedMemoryPage*>(pPage);
+   if (pCompressedPage == NULL)
+   {
+      return;
+   }
+
+   size_t tile = pCompressedPage->getTile();
+   bool writable = pCompressedPage->isWritable();
+   delete pCompressedPage;
+
+   VERIFYNRV(tile < mTiles.size());
+
+   mta::MutexLock lock(mMutex);
+   Tile& releasedTile = mTiles[tile];
+   VERIFYNRV(releasedTile.mpData != NULL && releasedTile.mPins > 0);
+   if (!writable)
+   {
+      --releasedTile.mPins;
+      return;
+   }
+
+   // Compress the tile without holding the lock so that other pages can be requested meanwhile.
+   // The pin keeps the tile cached, and the version detects a newer release of the tile.
+   releasedTile.mDirty = true;
+   unsigned int version = ++releasedTile.mVersion;
+   char* pData = releasedTile.mpData;
+   size_t tileSize = getTileSize(tile);
+
+   vector<char> compressed;
+   mMutex.MutexUnlock();
+   TileCodec::compress(pData, tileSize, mBytesPerElement, compressed);
+   mMutex.MutexLock();
+
+   if (releasedTile.mVersion == version)
+   {
+      mMemoryUsage += static_cast<int64_t>(compressed.size()) - static_cast<int64_t>(releasedTile.mCompressed.size());
+      releasedTile.mCompressed.swap(compressed);
+      releasedTile.mDirty = false;
+   }
+   --releasedTile.mPins;
+}
+
+int CompressedMemoryPager::getSupportedRequestVersion() const
+{
+   // Decimated requests are handled by the DecimatingPager of the element
+   return 1;
+}
+
+int64_t CompressedMemoryPager::getMemoryUsage() const
+{
+   mta::MutexLock lock(mMutex);
+   return mMemoryUsage;
+}
+
+bool CompressedMemoryPager::getOldestAccess(uint64_t& accessTime) const
+{
+   mta::MutexLock lock(mMutex);
+   size_t tile = findOldestTile();
+   if (tile == mTiles.size())
+   {
+      return false;
+   }
+
+   accessTime = mTiles[tile].mAccessTime;
+   return true;
+}
+
+int64_t CompressedMemoryPager::releaseOldest()
+{
+   mta::MutexLock lock(mMutex);
+   size_t tile = findOldestTile();
+   if (tile == mTiles.size())
+   {
+      return 0;
+   }
+
+   return evictTile(tile);
+}
+
+size_t CompressedMemoryPager::getTileSize(size_t tile) const
+{
+   size_t tileRow = (tile % mTilesPerBand) * mRowsPerTile;
+   return min(static_cast<size_t>(mRowsPerTile), mNumRows - tileRow) * mRowSize;
+}
+
+bool CompressedMemoryPager::cacheTile(size_t tile)
+{
+   // Keep the cache within its size by evicting the least recently used tiles which are not in use
+   while (mCachedTiles.size() >= mHotTiles)
+   {
+      size_t oldest = findOldestTile();
+      if (oldest == mTiles.size())
+      {
+         break;
+      }
+      evictTile(oldest);
+   }
+
+   size_t tileSize = getTileSize(tile);
+   Tile& newTile = mTiles[tile];
+   newTile.mpData = new (nothrow) char[tileSize];
+   if (newTile.mpData == NULL)
+   {
+      return false;
+   }
+
+   if (!TileCodec::decompress(newTile.mCompressed, newTile.mpData, tileSize, mBytesPerElement))
+   {
+      delete [] newTile.mpData;
+      newTile.mpData = NULL;
+      VERIFY_MSG(false, "A compressed tile is corrupt");
+   }
+
+   mCachedTiles.push_back(tile);
+   mMemoryUsage += tileSize;
+   return true;
+}
+
+int64_t CompressedMemoryPager::evictTile(size_t tile)
+{
+   Tile& oldTile = mTiles[tile];
+   int64_t released = static_cast<int64_t>(getTileSize(tile));
+   if (oldTile.mDirty)
+   {
+      // A release compressing the tile was superseded by a later write
+      vector<char> compressed;
+      TileCodec::compress(oldTile.mpData, getTileSize(tile), mBytesPerElement, compressed);
+      released -= static_cast<int64_t>(compressed.size()) - static_cast<int64_t>(oldTile.mCompressed.size());
+      oldTile.mCompressed.swap(compressed);
+      oldTile.mDirty = false;
+   }
+
+   delete [] oldTile.mpData;
+   oldTile.mpData = NULL;
+   mCachedTiles.erase(find(mCachedTiles.begin(), mCachedTiles.end(), tile));
+   mMemoryUsage -= released;
+   return max(released, static_cast<int64_t>(0));
+}
+
+size_t CompressedMemoryPager::findOldestTile() const
+{
+   size_t oldest = mTiles.size();
+   for (vector<size_t>::const_iterator iter = mCachedTiles.begin(); iter != mCachedTiles.end(); ++iter)
+   {
+      const Tile& cachedTile = mTiles[*iter];
+      if (cachedTile.mPins == 0 && (oldest == mTiles.size() || cachedTile.mAccessTime < mTiles[oldest].mAccessTime))
+      {
+         oldest = *iter;
+      }
+   }
+   return oldest;
+}
@@ -0,0 +1,104 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef COMPRESSEDMEMORYPAGER_H
+#define COMPRESSEDMEMORYPAGER_H
+
+#include "ConfigurationSettings.h"
+#include "DMutex.h"
+#include "MemoryBudget.h"
+#include "RasterPagerShell.h"
+#include "TypesFile.h"
+
+#include <vector>
+
+class RasterElement;
+
+/**
+ * Holds the data of an in-memory element as independently compressed tiles.
+ *
+ * Each tile holds the rows of about TileSize kilobytes of one band for BSQ
+ * data, or of all bands for BIP and BIL data.  Tiles are decompressed into a
+ * cache of at most HotTiles tiles when a page is requested, and the tile of a
+ * writable page is compressed again when the page is released.  Tiles of zeros
+ * take no memory, so a new element does not use memory until it is written.
+ *
+ * The compressed tiles and the cache are accounted by the MemoryBudget.  Only
+ * the cached tiles which are not in use can be released.
+ *
+ * Since the data is not contiguous, RasterElement::getRawData() returns \c NULL
+ * for an element using this pager.  The pager is used for new in-memory
+ * elements when the Enabled setting is true.
+ */
+class CompressedMemoryPager : public RasterPagerShell, public MemoryConsumer
+{
+public:
+   SETTING(Enabled, CompressedMemoryPager, bool, false)
+   SETTING(TileSize, CompressedMemoryPager, unsigned int, 1024)
+   SETTING(HotTiles, CompressedMemoryPager, unsigned int, 16)
+
+   CompressedMemoryPager();
+   ~CompressedMemoryPager();
+
+   bool getInputSpecification(PlugInArgList*& pArgList);
+   bool execute(PlugInArgList* pInput, PlugInArgList* pOutput);
+
+   RasterPage* getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow, DimensionDescriptor startColumn,
+      DimensionDescriptor startBand);
+   void releasePage(RasterPage* pPage);
+
+   int getSupportedRequestVersion() const;
+
+   int64_t getMemoryUsage() const;
+   bool getOldestAccess(uint64_t& accessTime) const;
+   int64_t releaseOldest();
+
+private:
+   struct Tile
+   {
+      Tile() :
+         mpData(NULL),
+         mPins(0),
+         mDirty(false),
+         mVersion(0),
+         mAccessTime(0)
+      {
+      }
+
+      std::vector<char> mCompressed;   // Empty if the tile is all zeros
+      char* mpData;                    // The decompressed tile, or NULL if the tile is not cached
+      unsigned int mPins;              // The number of pages and compressions using mpData
+      bool mDirty;                     // mCompressed is older than mpData
+      unsigned int mVersion;           // Incremented each time a writable page of the tile is released
+      uint64_t mAccessTime;
+   };
+
+   // These must be called with mMutex locked
+   size_t getTileSize(size_t tile) const;
+   bool cacheTile(size_t tile);
+   int64_t evictTile(size_t tile);
+   size_t findOldestTile() const;
+
+   RasterElement* mpRaster;
+   MemoryBudget* mpBudget;
+   InterleaveFormatType mInterleave;
+   unsigned int mNumRows;
+   unsigned int mBytesPerElement;
+   size_t mRowSize;                    // The bytes of one row of a tile
+   unsigned int mRowsPerTile;
+   size_t mTilesPerBand;
+   size_t mHotTiles;
+
+   mutable mta::DMutex mMutex;
+   std::vector<Tile> mTiles;
+   std::vector<size_t> mCachedTiles;
+   int64_t mMemoryUsage;
+};
+
+#endif
@@ -10,7 +10,7 @@
 #ifndef CONVERTTOBILPAGE_H
 #define CONVERTTOBILPAGE_H
 
-#include "ObjectResource.h"
+#include "ConvertedPageCache.h"
 #include "RasterPage.h"
 
 /**
@@ -20,7 +20,7 @@
 class ConvertToBilPage : public RasterPage
 {
 public:
-   ConvertToBilPage(unsigned int rows, unsigned int columns, unsigned int bands, unsigned int bytesPerElement);
+   ConvertToBilPage(unsigned int rows, unsigned int columns, unsigned int bands, ConvertedPageCache::Block pData);
    virtual ~ConvertToBilPage();
 
    // RasterPage methods
@@ -31,7 +31,7 @@ public:
    void* getRawData();
 
 private:
-   ArrayResource<unsigned char> mCache;
+   ConvertedPageCache::Block mpData;
 
    unsigned int mRows;
    unsigned int mColumns;
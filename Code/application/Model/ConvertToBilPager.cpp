@@ -8,17 +8,22 @@
  */
 
 #include "AppVerify.h"
+#include "ConvertedPageCache.h"
+#include "ConfigurationSettings.h"
 #include "ConvertToBilPage.h"
 #include "ConvertToBilPager.h"
 #include "DataAccessorImpl.h"
 #include "RasterDataDescriptor.h"
 #include "RasterElement.h"
+#include "TransposeUtilities.h"
 
 #include <algorithm>
 #include <memory>
+#include <new>
 
-ConvertToBilPager::ConvertToBilPager(RasterElement* pRaster) :
+ConvertToBilPager::ConvertToBilPager(RasterElement* pRaster, ConvertedPageCache* pCache) :
    mpRaster(pRaster),
+   mpCache(pCache),
    mBytesPerElement(0)
 {
    if (mpRaster != NULL)
@@ -42,7 +47,7 @@ void ConvertToBilPager::releasePage(RasterPage* pPage)
 
 int ConvertToBilPager::getSupportedRequestVersion() const
 {
-   return 1;
+   return 2;
 }
 
 RasterPage* ConvertToBilPager::getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
@@ -89,11 +94,27 @@ RasterPage* ConvertToBilPager::getPage(DataRequest* pOriginalRequest, DimensionD
       return NULL;
    }
 
-   unsigned int cols = stopColumn.getActiveNumber() - startColumn.getActiveNumber() + 1;
+   unsigned int rowStride = pOriginalRequest->getRowStride();
+   unsigned int columnStride = pOriginalRequest->getColumnStride();
+   unsigned int bandStride = pOriginalRequest->getBandStride();
+   unsigned int cols = (stopColumn.getActiveNumber() - startColumn.getActiveNumber()) / columnStride + 1;
    unsigned int rows = std::min(pOriginalRequest->getConcurrentRows(),
-      stopRow.getActiveNumber() - startRow.getActiveNumber() + 1);
-   unsigned int bands = stopBand.getActiveNumber() - startBand.getActiveNumber() + 1;
-   std::auto_ptr<ConvertToBilPage> pPage(new ConvertToBilPage(rows, cols, bands, mBytesPerElement));
+      (stopRow.getActiveNumber() - startRow.getActiveNumber()) / rowStride + 1);
+   unsigned int bands = (stopBand.getActiveNumber() - startBand.getActiveNumber()) / bandStride + 1;
+   ConvertedPageCache::Key key(pOriginalRequest, startRow.getActiveNumber(), rows, startColumn.getActiveNumber(), cols,
+      startBand.getActiveNumber(), bands);
+   if (mpCache != NULL)
+   {
+      ConvertedPageCache::Block pCachedData = mpCache->find(key);
+      if (pCachedData.get() != NULL)
+      {
+         return new ConvertToBilPage(rows, cols, bands, pCachedData);
+      }
+   }
+
+   const size_t pageSize = static_cast<size_t>(rows) * cols * bands * mBytesPerElement;
+   ConvertedPageCache::Block pData(new (std::nothrow) unsigned char[pageSize]);
+   std::auto_ptr<ConvertToBilPage> pPage(new ConvertToBilPage(rows, cols, bands, pData));
    if (pPage->getRawData() == NULL)
    {
       return NULL;
@@ -101,12 +122,13 @@ RasterPage* ConvertToBilPager::getPage(DataRequest* pOriginalRequest, DimensionD
 
    if (interleave == BSQ)
    {
-      for (unsigned int band = 0; iter <= stopIter; ++iter, ++band)
+      for (unsigned int band = 0; band < bands; ++band)
       {
          FactoryResource<DataRequest> pRequest;
-         pRequest->setRows(startRow, stopRow, 1);
+         pRequest->setRows(startRow, stopRow, rows);
          pRequest->setColumns(startColumn, stopColumn, cols);
-         pRequest->setBands(*iter, DimensionDescriptor());
+         pRequest->setBands(*(iter + band * bandStride), DimensionDescriptor());
+         pRequest->setStrides(rowStride, columnStride, 1);
 
          DataAccessor da = mpRaster->getDataAccessor(pRequest.release());
          unsigned char* pDst = reinterpret_cast<unsigned char*>(pPage->getRawData()) + (band * cols * mBytesPerElement);
@@ -127,36 +149,35 @@ RasterPage* ConvertToBilPager::getPage(DataRequest* pOriginalRequest, DimensionD
    {
       // Optimize for CachedPager subclasses by iterating row, column, band instead of band, row, column.
       FactoryResource<DataRequest> pRequest;
-      pRequest->setRows(startRow, stopRow, 1);
+      pRequest->setRows(startRow, stopRow, rows);
       pRequest->setColumns(startColumn, stopColumn, cols);
       pRequest->setBands(*iter, DimensionDescriptor());
+      pRequest->setStrides(rowStride, columnStride, bandStride);
 
+      // Each BIL row is the transpose of the columns x bands matrix of the BIP row
+      const unsigned int threadCount = ConfigurationSettings::getSettingThreadCount();
       DataAccessor da = mpRaster->getDataAccessor(pRequest.release());
+      unsigned char* pDst = reinterpret_cast<unsigned char*>(pPage->getRawData());
       for (unsigned int row = 0; row < rows; ++row)
       {
-         for (unsigned int col = 0; col < cols; ++col)
+         if (da.isValid() == false)
          {
-            if (da.isValid() == false)
-            {
-               return NULL;
-            }
-
-            unsigned char* pDst = reinterpret_cast<unsigned char*>(pPage->getRawData()) +
-               (row * cols * bands + col) * mBytesPerElement;
-            unsigned char* pSrc = reinterpret_cast<unsigned char*>(da->getColumn());
-            for (unsigned int band = 0; band < bands; ++band)
-            {
-               memcpy(pDst, pSrc, mBytesPerElement);
-               pDst += cols * mBytesPerElement;
-               pSrc += mBytesPerElement;
-            }
-
-            da->nextColumn();
+            return NULL;
          }
 
+         const size_t srcColumnSize = da->getRowSize() / da->getConcurrentColumns();
+         TransposeUtilities::transpose(da->getRow(), srcColumnSize, cols, bands,
+            pDst, cols * mBytesPerElement, mBytesPerElement, threadCount);
+         pDst += bands * cols * mBytesPerElement;
+
          da->nextRow();
       }
    }
 
+   if (mpCache != NULL)
+   {
+      mpCache->insert(key, pData, pageSize);
+   }
+
    return pPage.release();
 }
@@ -12,6 +12,7 @@
 
 #include "RasterPager.h"
 
+class ConvertedPageCache;
 class RasterElement;
 
 /**
@@ -20,7 +21,7 @@ class RasterElement;
 class ConvertToBilPager : public RasterPager
 {
 public:
-   ConvertToBilPager(RasterElement* pRaster);
+   ConvertToBilPager(RasterElement* pRaster, ConvertedPageCache* pCache = NULL);
 
    virtual ~ConvertToBilPager(void);
 
@@ -37,6 +38,7 @@ private:
    ConvertToBilPager& operator=(const ConvertToBilPager& rhs);
 
    RasterElement* const mpRaster;
+   ConvertedPageCache* const mpCache;
    unsigned int mBytesPerElement;
 };
 
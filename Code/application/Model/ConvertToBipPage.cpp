@@ -10,8 +10,8 @@
 #include "ConvertToBipPage.h"
 
 ConvertToBipPage::ConvertToBipPage(unsigned int rows, unsigned int columns, unsigned int bands,
-                                   unsigned int bytesPerElement) :
-   mCache(rows * columns * bands * bytesPerElement, true),
+                                   ConvertedPageCache::Block pData) :
+   mpData(pData),
    mRows(rows),
    mColumns(columns),
    mBands(bands)
@@ -44,5 +44,5 @@ unsigned int ConvertToBipPage::getInterlineBytes()
 
 void* ConvertToBipPage::getRawData()
 {
-   return mCache.get();
+   return mpData.get();
 }
@@ -10,7 +10,7 @@
 #ifndef CONVERTTOBIPPAGE_H
 #define CONVERTTOBIPPAGE_H
 
-#include "ObjectResource.h"
+#include "ConvertedPageCache.h"
 #include "RasterPage.h"
 
 /**
@@ -20,7 +20,7 @@
 class ConvertToBipPage : public RasterPage
 {
 public:
-   ConvertToBipPage(unsigned int rows, unsigned int columns, unsigned int bands, unsigned int bytesPerElement);
+   ConvertToBipPage(unsigned int rows, unsigned int columns, unsigned int bands, ConvertedPageCache::Block pData);
    virtual ~ConvertToBipPage();
 
    // RasterPage methods
@@ -31,7 +31,7 @@ public:
    void* getRawData();
 
 private:
-   ArrayResource<unsigned char> mCache;
+   ConvertedPageCache::Block mpData;
 
    unsigned int mRows;
    unsigned int mColumns;
@@ -8,17 +8,23 @@
  */
 
 #include "AppVerify.h"
+#include "ConvertedPageCache.h"
+#include "ConfigurationSettings.h"
 #include "ConvertToBipPage.h"
 #include "ConvertToBipPager.h"
 #include "DataAccessorImpl.h"
 #include "RasterDataDescriptor.h"
 #include "RasterElement.h"
+#include "TransposeUtilities.h"
 
 #include <algorithm>
 #include <memory>
+#include <new>
+#include <vector>
 
-ConvertToBipPager::ConvertToBipPager(RasterElement* pRaster) :
+ConvertToBipPager::ConvertToBipPager(RasterElement* pRaster, ConvertedPageCache* pCache) :
    mpRaster(pRaster),
+   mpCache(pCache),
    mBytesPerElement(0)
 {
    if (mpRaster != NULL)
@@ -42,7 +48,7 @@ void ConvertToBipPager::releasePage(RasterPage* pPage)
 
 int ConvertToBipPager::getSupportedRequestVersion() const
 {
-   return 1;
+   return 2;
 }
 
 RasterPage *ConvertToBipPager::getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
@@ -88,44 +94,77 @@ RasterPage *ConvertToBipPager::getPage(DataRequest* pOriginalRequest, DimensionD
       return NULL;
    }
 
-   unsigned int cols = stopColumn.getActiveNumber() - startColumn.getActiveNumber() + 1;
+   unsigned int rowStride = pOriginalRequest->getRowStride();
+   unsigned int columnStride = pOriginalRequest->getColumnStride();
+   unsigned int bandStride = pOriginalRequest->getBandStride();
+   unsigned int cols = (stopColumn.getActiveNumber() - startColumn.getActiveNumber()) / columnStride + 1;
    unsigned int rows = std::min(pOriginalRequest->getConcurrentRows(),
-      stopRow.getActiveNumber() - startRow.getActiveNumber() + 1);
-   unsigned int bands = stopBand.getActiveNumber() - startBand.getActiveNumber() + 1;
-   std::auto_ptr<ConvertToBipPage> pPage(new ConvertToBipPage(rows, cols, bands, mBytesPerElement));
+      (stopRow.getActiveNumber() - startRow.getActiveNumber()) / rowStride + 1);
+   unsigned int bands = (stopBand.getActiveNumber() - startBand.getActiveNumber()) / bandStride + 1;
+   ConvertedPageCache::Key key(pOriginalRequest, startRow.getActiveNumber(), rows, startColumn.getActiveNumber(), cols,
+      startBand.getActiveNumber(), bands);
+   if (mpCache != NULL)
+   {
+      ConvertedPageCache::Block pCachedData = mpCache->find(key);
+      if (pCachedData.get() != NULL)
+      {
+         return new ConvertToBipPage(rows, cols, bands, pCachedData);
+      }
+   }
+
+   const size_t pageSize = static_cast<size_t>(rows) * cols * bands * mBytesPerElement;
+   ConvertedPageCache::Block pData(new (std::nothrow) unsigned char[pageSize]);
+   std::auto_ptr<ConvertToBipPage> pPage(new ConvertToBipPage(rows, cols, bands, pData));
    unsigned char* pDst = reinterpret_cast<unsigned char*>(pPage->getRawData());
    if (pDst == NULL)
    {
       return NULL;
    }
 
+   // Each BIP row is the transpose of the bands x columns matrix of source rows
+   const unsigned int threadCount = ConfigurationSettings::getSettingThreadCount();
+   const size_t dstRowSize = static_cast<size_t>(cols) * bands * mBytesPerElement;
    if (interleave == BSQ)
    {
-      for (unsigned int band = 0; iter <= stopIter; ++iter, ++band)
+      // Transpose a group of bands at a time to limit the number of source pages held at once
+      const unsigned int bandGroupSize = 32;
+      std::vector<const void*> srcRows;
+      for (unsigned int groupStart = 0; groupStart < bands; groupStart += bandGroupSize)
       {
-         FactoryResource<DataRequest> pRequest;
-         pRequest->setRows(startRow, stopRow, 1);
-         pRequest->setColumns(startColumn, stopColumn, cols);
-         pRequest->setBands(*iter, *iter, 1);
+         std::vector<DataAccessor> accessors;
+         for (unsigned int band = groupStart; band < bands && band < groupStart + bandGroupSize; ++band)
+         {
+            DimensionDescriptor bandDim = *(iter + band * bandStride);
+            FactoryResource<DataRequest> pRequest;
+            pRequest->setRows(startRow, stopRow, rows);
+            pRequest->setColumns(startColumn, stopColumn, cols);
+            pRequest->setBands(bandDim, bandDim, 1);
+            pRequest->setStrides(rowStride, columnStride, 1);
+            accessors.push_back(mpRaster->getDataAccessor(pRequest.release()));
+         }
 
-         DataAccessor da = mpRaster->getDataAccessor(pRequest.release());
+         srcRows.resize(accessors.size());
          for (unsigned int row = 0; row < rows; ++row)
          {
-            if (da.isValid() == false)
+            for (unsigned int band = 0; band < accessors.size(); ++band)
             {
-               return NULL;
+               DataAccessor& da = accessors[band];
+               if (da.isValid() == false)
+               {
+                  return NULL;
+               }
+
+               srcRows[band] = da->getRow();
             }
 
-            unsigned int cachePos = (row * cols * bands + band) * mBytesPerElement;
-            unsigned char* pSrc = reinterpret_cast<unsigned char*>(da->getRow());
-            for (unsigned int col = 0; col < cols; ++col)
+            TransposeUtilities::transpose(&srcRows[0], srcRows.size(), cols,
+               pDst + row * dstRowSize + groupStart * mBytesPerElement,
+               bands * mBytesPerElement, mBytesPerElement, threadCount);
+
+            for (unsigned int band = 0; band < accessors.size(); ++band)
             {
-               memcpy(pDst + cachePos, pSrc, mBytesPerElement);
-               cachePos += bands * mBytesPerElement;
-               pSrc += mBytesPerElement;
+               accessors[band]->nextRow();
             }
-
-            da->nextRow();
          }
       }
    }
@@ -133,9 +172,10 @@ RasterPage *ConvertToBipPager::getPage(DataRequest* pOriginalRequest, DimensionD
    {
       // Optimize for CachedPager subclasses by iterating row, band, column instead of band, row, column.
       FactoryResource<DataRequest> pRequest;
-      pRequest->setRows(startRow, stopRow, 1);
+      pRequest->setRows(startRow, stopRow, rows);
       pRequest->setColumns(startColumn, stopColumn, cols);
       pRequest->setBands(*iter, DimensionDescriptor());
+      pRequest->setStrides(rowStride, columnStride, bandStride);
 
       DataAccessor da = mpRaster->getDataAccessor(pRequest.release());
       for (unsigned int row = 0; row < rows; ++row)
@@ -145,22 +185,17 @@ RasterPage *ConvertToBipPager::getPage(DataRequest* pOriginalRequest, DimensionD
             return NULL;
          }
 
-         for (unsigned int band = 0; band < bands; ++band)
-         {
-            unsigned char* pSrc = reinterpret_cast<unsigned char*>(da->getRow()) +
-               (band * da->getConcurrentColumns() * mBytesPerElement);
-            unsigned int cachePos = (row * cols * bands + band) * mBytesPerElement;
-            for (unsigned int col = 0; col < cols; ++col)
-            {
-               memcpy(pDst + cachePos, pSrc, mBytesPerElement);
-               cachePos += bands * mBytesPerElement;
-               pSrc += mBytesPerElement;
-            }
-         }
+         TransposeUtilities::transpose(da->getRow(), da->getConcurrentColumns() * mBytesPerElement, bands, cols,
+            pDst + row * dstRowSize, bands * mBytesPerElement, mBytesPerElement, threadCount);
 
          da->nextRow();
       }
    }
 
+   if (mpCache != NULL)
+   {
+      mpCache->insert(key, pData, pageSize);
+   }
+
    return pPage.release();
 }
@@ -12,6 +12,7 @@
 
 #include "RasterPager.h"
 
+class ConvertedPageCache;
 class RasterElement;
 
 /**
@@ -20,7 +21,7 @@ class RasterElement;
 class ConvertToBipPager : public RasterPager
 {
 public:
-   ConvertToBipPager(RasterElement* pRaster);
+   ConvertToBipPager(RasterElement* pRaster, ConvertedPageCache* pCache = NULL);
 
    virtual ~ConvertToBipPager(void);
 
@@ -37,6 +38,7 @@ private:
    ConvertToBipPager& operator=(const ConvertToBipPager& rhs);
 
    RasterElement* const mpRaster;
+   ConvertedPageCache* const mpCache;
    unsigned int mBytesPerElement;
 };
 
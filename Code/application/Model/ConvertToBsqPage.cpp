@@ -9,8 +9,8 @@
 
 #include "ConvertToBsqPage.h"
 
-ConvertToBsqPage::ConvertToBsqPage(unsigned int rows, unsigned int columns, unsigned int bytesPerElement) :
-   mCache(rows * columns * bytesPerElement, true),
+ConvertToBsqPage::ConvertToBsqPage(unsigned int rows, unsigned int columns, ConvertedPageCache::Block pData) :
+   mpData(pData),
    mRows(rows),
    mColumns(columns)
 {
@@ -42,5 +42,5 @@ unsigned int ConvertToBsqPage::getInterlineBytes()
 
 void* ConvertToBsqPage::getRawData()
 {
-   return mCache.get();
+   return mpData.get();
 }
@@ -10,7 +10,7 @@
 #ifndef CONVERTTOBSQPAGE_H
 #define CONVERTTOBSQPAGE_H
 
-#include "ObjectResource.h"
+#include "ConvertedPageCache.h"
 #include "RasterPage.h"
 
 /**
@@ -20,7 +20,7 @@
 class ConvertToBsqPage : public RasterPage
 {
 public:
-   ConvertToBsqPage(unsigned int rows, unsigned int columns, unsigned int bytesPerElement);
+   ConvertToBsqPage(unsigned int rows, unsigned int columns, ConvertedPageCache::Block pData);
    virtual ~ConvertToBsqPage();
 
    // RasterPage methods
@@ -31,7 +31,7 @@ public:
    void* getRawData();
 
 private:
-   ArrayResource<unsigned char> mCache;
+   ConvertedPageCache::Block mpData;
 
    unsigned int mRows;
    unsigned int mColumns;
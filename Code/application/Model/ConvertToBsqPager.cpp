@@ -8,18 +8,22 @@
  */
 
 #include "AppVerify.h"
+#include "ConvertedPageCache.h"
 #include "ConvertToBsqPage.h"
 #include "ConvertToBsqPager.h"
 #include "DataAccessorImpl.h"
 #include "RasterDataDescriptor.h"
 #include "RasterElement.h"
+#include "TransposeUtilities.h"
 
 #include <limits>
 #include <memory>
+#include <new>
 #include <algorithm>
 
-ConvertToBsqPager::ConvertToBsqPager(RasterElement* pRaster) :
+ConvertToBsqPager::ConvertToBsqPager(RasterElement* pRaster, ConvertedPageCache* pCache) :
    mpRaster(pRaster),
+   mpCache(pCache),
    mBytesPerElement(0)
 {
    if (mpRaster != NULL)
@@ -43,7 +47,7 @@ void ConvertToBsqPager::releasePage(RasterPage* pPage)
 
 int ConvertToBsqPager::getSupportedRequestVersion() const
 {
-   return 1;
+   return 2;
 }
 
 RasterPage* ConvertToBsqPager::getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
@@ -60,8 +64,10 @@ RasterPage* ConvertToBsqPager::getPage(DataRequest* pOriginalRequest, DimensionD
    DimensionDescriptor stopColumn = pOriginalRequest->getStopColumn();
    DimensionDescriptor stopBand = pOriginalRequest->getStopBand();
 
+   unsigned int rowStride = pOriginalRequest->getRowStride();
+   unsigned int columnStride = pOriginalRequest->getColumnStride();
    unsigned int concurrentRows = std::min(pOriginalRequest->getConcurrentRows(),
-      stopRow.getActiveNumber() - startRow.getActiveNumber() + 1);
+      (stopRow.getActiveNumber() - startRow.getActiveNumber()) / rowStride + 1);
    unsigned int concurrentBands = pOriginalRequest->getConcurrentBands();
 
    VERIFY(requestedType == BSQ);
@@ -85,8 +91,21 @@ RasterPage* ConvertToBsqPager::getPage(DataRequest* pOriginalRequest, DimensionD
       return NULL;
    }
 
-   unsigned int cols = stopColumn.getActiveNumber() - startColumn.getActiveNumber() + 1;
-   std::auto_ptr<ConvertToBsqPage> pPage(new ConvertToBsqPage(concurrentRows, cols, mBytesPerElement));
+   unsigned int cols = (stopColumn.getActiveNumber() - startColumn.getActiveNumber()) / columnStride + 1;
+   ConvertedPageCache::Key key(pOriginalRequest, startRow.getActiveNumber(), concurrentRows,
+      startColumn.getActiveNumber(), cols, startBand.getActiveNumber(), 1);
+   if (mpCache != NULL)
+   {
+      ConvertedPageCache::Block pCachedData = mpCache->find(key);
+      if (pCachedData.get() != NULL)
+      {
+         return new ConvertToBsqPage(concurrentRows, cols, pCachedData);
+      }
+   }
+
+   const size_t pageSize = static_cast<size_t>(concurrentRows) * cols * mBytesPerElement;
+   ConvertedPageCache::Block pData(new (std::nothrow) unsigned char[pageSize]);
+   std::auto_ptr<ConvertToBsqPage> pPage(new ConvertToBsqPage(concurrentRows, cols, pData));
    unsigned char* pDst = reinterpret_cast<unsigned char*>(pPage->getRawData());
    if (pDst == NULL)
    {
@@ -94,27 +113,27 @@ RasterPage* ConvertToBsqPager::getPage(DataRequest* pOriginalRequest, DimensionD
    }
 
    FactoryResource<DataRequest> pRequest;
-   pRequest->setRows(startRow, stopRow);
+   pRequest->setRows(startRow, stopRow, concurrentRows);
    pRequest->setColumns(startColumn, stopColumn, cols);
    pRequest->setBands(startBand, startBand, 1);
+   pRequest->setStrides(rowStride, columnStride, 1);
    DataAccessor da = mpRaster->getDataAccessor(pRequest.release());
 
    if (interleave == BIP)
    {
+      // Gathering one band of a BIP row is a transpose of a single column of the columns x bands matrix
       for (unsigned int row = 0; row < concurrentRows; ++row)
       {
-         for (unsigned int col = 0; col < cols; ++col)
+         if (da.isValid() == false)
          {
-            if (da.isValid() == false)
-            {
-               return NULL;
-            }
-
-            memcpy(pDst, da->getColumn(), mBytesPerElement);
-            pDst += mBytesPerElement;
-            da->nextColumn();
+            return NULL;
          }
 
+         const size_t srcColumnSize = da->getRowSize() / da->getConcurrentColumns();
+         TransposeUtilities::transpose(da->getRow(), srcColumnSize, cols, 1,
+            pDst, cols * mBytesPerElement, mBytesPerElement);
+         pDst += mBytesPerElement * cols;
+
          da->nextRow();
       }
    }
@@ -133,5 +152,10 @@ RasterPage* ConvertToBsqPager::getPage(DataRequest* pOriginalRequest, DimensionD
       }
    }
 
+   if (mpCache != NULL)
+   {
+      mpCache->insert(key, pData, pageSize);
+   }
+
    return pPage.release();
 }
@@ -12,6 +12,7 @@
 
 #include "RasterPager.h"
 
+class ConvertedPageCache;
 class RasterElement;
 
 /**
@@ -20,7 +21,7 @@ class RasterElement;
 class ConvertToBsqPager : public RasterPager
 {
 public:
-   ConvertToBsqPager(RasterElement* pRaster);
+   ConvertToBsqPager(RasterElement* pRaster, ConvertedPageCache* pCache = NULL);
 
    virtual ~ConvertToBsqPager(void);
 
@@ -37,6 +38,7 @@ private:
    ConvertToBsqPager& operator=(const ConvertToBsqPager& rhs);
 
    RasterElement* const mpRaster;
+   ConvertedPageCache* const mpCache;
    unsigned int mBytesPerElement;
 };
 
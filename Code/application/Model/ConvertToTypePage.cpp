@@ -0,0 +1,59 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "ConvertToTypePage.h"
+
+ConvertToTypePage::ConvertToTypePage(unsigned int rows, unsigned int columns, unsigned int bands,
+                                     unsigned int bytesPerElement) :
+   mRows(rows),
+   mColumns(columns),
+   mBands(bands),
+   mRowSize(static_cast<size_t>(columns) * bands * bytesPerElement)
+{
+   mData.resize(mRowSize * rows);
+}
+
+ConvertToTypePage::~ConvertToTypePage()
+{
+}
+
+char* ConvertToTypePage::getRow(unsigned int row)
+{
+   return &mData[row * mRowSize];
+}
+
+unsigned int ConvertToTypePage::getNumBands()
+{
+   return mBands;
+}
+
+unsigned int ConvertToTypePage::getNumRows()
+{
+   return mRows;
+}
+
+unsigned int ConvertToTypePage::getNumColumns()
+{
+   return mColumns;
+}
+
+unsigned int ConvertToTypePage::getInterlineBytes()
+{
+   return 0;
+}
+
+void* ConvertToTypePage::getRawData()
+{
+   if (mData.empty())
+   {
+      return NULL;
+   }
+
+   return &mData.front();
+}
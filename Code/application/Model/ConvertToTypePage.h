@@ -0,0 +1,54 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef CONVERTTOTYPEPAGE_H
+#define CONVERTTOTYPEPAGE_H
+
+#include "RasterPage.h"
+
+#include <stddef.h>
+#include <vector>
+
+/**
+ * This class works with ConvertToTypePager
+ * to hold data converted to the data type of a DataRequest.
+ */
+class ConvertToTypePage : public RasterPage
+{
+public:
+   ConvertToTypePage(unsigned int rows, unsigned int columns, unsigned int bands, unsigned int bytesPerElement);
+   virtual ~ConvertToTypePage();
+
+   /**
+    * Returns the address of a row in the page.
+    *
+    * @param row
+    *        The row in the page.
+    *
+    * @return The address of the first element of the row.
+    */
+   char* getRow(unsigned int row);
+
+   // RasterPage methods
+   unsigned int getNumBands();
+   unsigned int getNumRows();
+   unsigned int getNumColumns();
+   unsigned int getInterlineBytes();
+   void* getRawData();
+
+private:
+   std::vector<char> mData;
+
+   unsigned int mRows;
+   unsigned int mColumns;
+   unsigned int mBands;
+   size_t mRowSize;
+};
+
+#endif
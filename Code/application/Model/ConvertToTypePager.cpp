@@ -0,0 +1,308 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "BadValues.h"
+#include "ConvertToTypePage.h"
+#include "ConvertToTypePager.h"
+#include "DataAccessorImpl.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterUtilities.h"
+#include "switchOnEncoding.h"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+namespace
+{
+   // Pages of whole rows are made about this large so that short rows are not converted one at a time
+   const size_t sDefaultPageSize = 1024 * 1024;
+
+   // Returns the number of returned elements from start through stop
+   unsigned int getSampleCount(unsigned int start, unsigned int stop, unsigned int stride)
+   {
+      if (start > stop)
+      {
+         return 0;
+      }
+
+      return (stop - start) / stride + 1;
+   }
+
+   // The layout of one returned row in the source DataAccessor
+   struct RowFormat
+   {
+      InterleaveFormatType mInterleave;
+      unsigned int mColumns;
+      unsigned int mBands;
+      size_t mColumnStep;
+      size_t mBandStep;
+      ComplexComponent mComponent;
+   };
+
+   template<typename Dst, typename Src>
+   inline Dst convertValue(const Src& value, ComplexComponent component)
+   {
+      return static_cast<Dst>(value);
+   }
+
+   template<typename Dst>
+   inline Dst convertValue(const IntegerComplex& value, ComplexComponent component)
+   {
+      return static_cast<Dst>(value[component]);
+   }
+
+   template<typename Dst>
+   inline Dst convertValue(const FloatComplex& value, ComplexComponent component)
+   {
+      return static_cast<Dst>(value[component]);
+   }
+
+   template<typename Dst, typename Src>
+   void convertElements(const Src* pSrc, size_t srcStep, Dst* pDst, size_t dstStep, unsigned int count,
+      ComplexComponent component)
+   {
+      if (srcStep == 1 && dstStep == 1)
+      {
+         // Keep the contiguous case as a plain indexed loop so that the compiler can vectorize it
+         for (unsigned int i = 0; i < count; ++i)
+         {
+            pDst[i] = convertValue<Dst>(pSrc[i], component);
+         }
+         return;
+      }
+
+      for (unsigned int i = 0; i < count; ++i, pSrc += srcStep, pDst += dstStep)
+      {
+         *pDst = convertValue<Dst>(*pSrc, component);
+      }
+   }
+
+   template<typename Dst, typename Src>
+   void convertRowTo(const Src* pSrc, const RowFormat& format, Dst* pDst)
+   {
+      const unsigned int columns = format.mColumns;
+      const unsigned int bands = format.mBands;
+      switch (format.mInterleave)
+      {
+      case BIP:
+         if (format.mBandStep == 1 && format.mColumnStep == bands)
+         {
+            convertElements(pSrc, 1, pDst, 1, columns * bands, format.mComponent);
+            break;
+         }
+         for (unsigned int band = 0; band < bands; ++band)
+         {
+            convertElements(pSrc + band * format.mBandStep, format.mColumnStep, pDst + band, bands, columns,
+               format.mComponent);
+         }
+         break;
+      case BIL:
+         if (format.mColumnStep == 1 && format.mBandStep == columns)
+         {
+            convertElements(pSrc, 1, pDst, 1, columns * bands, format.mComponent);
+            break;
+         }
+         for (unsigned int band = 0; band < bands; ++band)
+         {
+            convertElements(pSrc + band * format.mBandStep, format.mColumnStep, pDst + band * columns, 1, columns,
+               format.mComponent);
+         }
+         break;
+      case BSQ:
+         convertElements(pSrc, format.mColumnStep, pDst, 1, columns, format.mComponent);
+         break;
+      default:
+         break;
+      }
+   }
+
+   template<typename Src>
+   void convertRow(const Src* pSrc, const RowFormat& format, EncodingType dataType, char* pDst)
+   {
+      if (dataType == FLT4BYTES)
+      {
+         convertRowTo(pSrc, format, reinterpret_cast<float*>(pDst));
+      }
+      else if (dataType == FLT8BYTES)
+      {
+         convertRowTo(pSrc, format, reinterpret_cast<double*>(pDst));
+      }
+   }
+
+   template<typename T>
+   void replaceBadValues(T* pData, size_t count, EncodingType dataType, const BadValues* pBadValues)
+   {
+      const T nan = std::numeric_limits<T>::quiet_NaN();
+
+      // Test the values a chunk at a time with the compiled bad value criteria
+      const size_t chunkSize = 1024;
+      unsigned char mask[chunkSize];
+      for (size_t start = 0; start < count; start += chunkSize)
+      {
+         size_t chunk = std::min(count - start, chunkSize);
+         size_t badValueCount = 0;
+         VERIFYNRV(pBadValues->getValidityMask(pData + start, dataType, chunk, 1, mask, badValueCount));
+         if (badValueCount == 0)
+         {
+            continue;
+         }
+
+         for (size_t i = 0; i < chunk; ++i)
+         {
+            if (mask[i] == 0)
+            {
+               pData[start + i] = nan;
+            }
+         }
+      }
+   }
+}
+
+ConvertToTypePager::ConvertToTypePager(RasterElement* pRaster) :
+   mpRaster(pRaster)
+{
+}
+
+ConvertToTypePager::~ConvertToTypePager()
+{
+}
+
+void ConvertToTypePager::releasePage(RasterPage* pPage)
+{
+   // Check that pPage is the correct type before deleting it.
+   delete dynamic_cast<ConvertToTypePage*>(pPage);
+}
+
+int ConvertToTypePager::getSupportedRequestVersion() const
+{
+   return 3;
+}
+
+RasterPage* ConvertToTypePager::getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
+   DimensionDescriptor startColumn, DimensionDescriptor startBand)
+{
+   VERIFYRV(pOriginalRequest != NULL, NULL);
+   if (pOriginalRequest->getWritable())
+   {
+      return NULL;
+   }
+
+   VERIFYRV(mpRaster != NULL, NULL);
+   const RasterDataDescriptor* pDd = dynamic_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+   VERIFYRV(pDd != NULL, NULL);
+
+   EncodingType dataType = pOriginalRequest->getDataType();
+   VERIFYRV(dataType == FLT4BYTES || dataType == FLT8BYTES, NULL);
+   unsigned int bytesPerElement = RasterUtilities::bytesInEncoding(dataType);
+
+   InterleaveFormatType interleave = pOriginalRequest->getInterleaveFormat();
+   unsigned int rowStride = std::max(pOriginalRequest->getRowStride(), 1U);
+   unsigned int columnStride = std::max(pOriginalRequest->getColumnStride(), 1U);
+   unsigned int bandStride = std::max(pOriginalRequest->getBandStride(), 1U);
+
+   unsigned int requestColumns = getSampleCount(pOriginalRequest->getStartColumn().getActiveNumber(),
+      pOriginalRequest->getStopColumn().getActiveNumber(), columnStride);
+   unsigned int columns = std::min(pOriginalRequest->getConcurrentColumns(), getSampleCount(
+      startColumn.getActiveNumber(), pOriginalRequest->getStopColumn().getActiveNumber(), columnStride));
+   unsigned int bands = 1;
+   if (interleave != BSQ)
+   {
+      bands = std::min(pOriginalRequest->getConcurrentBands(), getSampleCount(startBand.getActiveNumber(),
+         pOriginalRequest->getStopBand().getActiveNumber(), bandStride));
+   }
+
+   unsigned int rows = pOriginalRequest->getConcurrentRows();
+   size_t rowSize = static_cast<size_t>(columns) * bands * bytesPerElement;
+   if (columns == requestColumns && rowSize > 0)
+   {
+      rows = std::max(rows, static_cast<unsigned int>(sDefaultPageSize / rowSize));
+   }
+   rows = std::min(rows, getSampleCount(startRow.getActiveNumber(),
+      pOriginalRequest->getStopRow().getActiveNumber(), rowStride));
+   if (rows == 0 || columns == 0 || bands == 0)
+   {
+      return NULL;
+   }
+
+   // Request the native data type covering only the rows, columns and bands of the page
+   unsigned int stopColumn = startColumn.getActiveNumber() + (columns - 1) * columnStride;
+   unsigned int stopBand = startBand.getActiveNumber() + (bands - 1) * bandStride;
+
+   FactoryResource<DataRequest> pRequest(pOriginalRequest->copy());
+   pRequest->setDataType(EncodingType());
+   pRequest->setRows(startRow, pOriginalRequest->getStopRow(), rows);
+   pRequest->setColumns(startColumn, pDd->getActiveColumn(stopColumn), columns);
+   pRequest->setBands(startBand, pDd->getActiveBand(stopBand), bands);
+
+   DataAccessor da = mpRaster->getDataAccessor(pRequest.release());
+   if (da.isValid() == false)
+   {
+      return NULL;
+   }
+
+   std::auto_ptr<ConvertToTypePage> pPage(new ConvertToTypePage(rows, columns, bands, bytesPerElement));
+   if (pPage->getRawData() == NULL)
+   {
+      return NULL;
+   }
+
+   EncodingType sourceType = pDd->getDataType();
+   unsigned int sourceBytesPerElement = pDd->getBytesPerElement();
+
+   RowFormat format;
+   format.mInterleave = interleave;
+   format.mColumns = columns;
+   format.mBands = bands;
+   format.mColumnStep = 1;
+   format.mBandStep = 0;
+   format.mComponent = pOriginalRequest->getComplexComponent();
+
+   for (unsigned int row = 0; row < rows; ++row)
+   {
+      da->toPixel(startRow.getActiveNumber() + row * rowStride, startColumn.getActiveNumber());
+      if (da.isValid() == false)
+      {
+         return NULL;
+      }
+
+      if (interleave == BIP)
+      {
+         format.mColumnStep = da->getRowSize() / da->getConcurrentColumns() / sourceBytesPerElement;
+         format.mBandStep = 1;
+      }
+      else if (interleave == BIL)
+      {
+         format.mBandStep = da->getConcurrentColumns();
+      }
+
+      switchOnComplexEncoding(sourceType, convertRow, da->getColumn(), format, dataType, pPage->getRow(row));
+   }
+
+   if (pOriginalRequest->getBadValuesAsNan())
+   {
+      const BadValues* pBadValues = pDd->getBadValues();
+      if (pBadValues != NULL && pBadValues->empty() == false)
+      {
+         size_t count = static_cast<size_t>(rows) * columns * bands;
+         if (dataType == FLT4BYTES)
+         {
+            replaceBadValues(reinterpret_cast<float*>(pPage->getRawData()), count, dataType, pBadValues);
+         }
+         else
+         {
+            replaceBadValues(reinterpret_cast<double*>(pPage->getRawData()), count, dataType, pBadValues);
+         }
+      }
+   }
+
+   return pPage.release();
+}
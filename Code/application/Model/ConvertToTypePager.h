@@ -0,0 +1,47 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef CONVERTTOTYPEPAGER_H
+#define CONVERTTOTYPEPAGER_H
+
+#include "RasterPager.h"
+
+class RasterElement;
+
+/**
+ * This class converts data to the data type of a DataRequest on the fly.
+ *
+ * Each page is read through a DataAccessor for the same request in the data
+ * type of the RasterElement, so interleave conversion and decimation are done
+ * by the usual pagers.  The returned rows are then converted in bulk, with the
+ * requested complex component and optional replacement of bad values with NaN.
+ */
+class ConvertToTypePager : public RasterPager
+{
+public:
+   ConvertToTypePager(RasterElement* pRaster);
+
+   virtual ~ConvertToTypePager();
+
+   void releasePage(RasterPage* pPage);
+
+   int getSupportedRequestVersion() const;
+
+   RasterPage* getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
+      DimensionDescriptor startColumn, DimensionDescriptor startBand);
+
+private:
+   ConvertToTypePager();
+
+   ConvertToTypePager& operator=(const ConvertToTypePager& rhs);
+
+   RasterElement* const mpRaster;
+};
+
+#endif
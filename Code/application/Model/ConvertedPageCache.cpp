@@ -0,0 +1,207 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "ConvertedPageCache.h"
+#include "DataRequest.h"
+#include "ModelServices.h"
+
+using namespace std;
+
+ConvertedPageCache::Key::Key(const DataRequest* pRequest, unsigned int startRow, unsigned int rows,
+   unsigned int startColumn, unsigned int columns, unsigned int startBand, unsigned int bands) :
+   mInterleave(pRequest->getInterleaveFormat()),
+   mStartRow(startRow),
+   mRows(rows),
+   mRowStride(pRequest->getRowStride()),
+   mStartColumn(startColumn),
+   mColumns(columns),
+   mColumnStride(pRequest->getColumnStride()),
+   mStartBand(startBand),
+   mBands(bands),
+   mBandStride(pRequest->getBandStride())
+{
+}
+
+bool ConvertedPageCache::Key::operator<(const Key& rhs) const
+{
+   if (mInterleave != rhs.mInterleave)
+   {
+      return mInterleave < rhs.mInterleave;
+   }
+   if (mStartRow != rhs.mStartRow)
+   {
+      return mStartRow < rhs.mStartRow;
+   }
+   if (mRows != rhs.mRows)
+   {
+      return mRows < rhs.mRows;
+   }
+   if (mRowStride != rhs.mRowStride)
+   {
+      return mRowStride < rhs.mRowStride;
+   }
+   if (mStartColumn != rhs.mStartColumn)
+   {
+      return mStartColumn < rhs.mStartColumn;
+   }
+   if (mColumns != rhs.mColumns)
+   {
+      return mColumns < rhs.mColumns;
+   }
+   if (mColumnStride != rhs.mColumnStride)
+   {
+      return mColumnStride < rhs.mColumnStride;
+   }
+   if (mStartBand != rhs.mStartBand)
+   {
+      return mStartBand < rhs.mStartBand;
+   }
+   if (mBands != rhs.mBands)
+   {
+      return mBands < rhs.mBands;
+   }
+   return mBandStride < rhs.mBandStride;
+}
+
+ConvertedPageCache::ConvertedPageCache() :
+   mpBudget(NULL),
+   mAccessTime(0),
+   mSize(0)
+{
+}
+
+ConvertedPageCache::~ConvertedPageCache()
+{
+   if (mpBudget != NULL)
+   {
+      mpBudget->removeConsumer(this);
+   }
+}
+
+void ConvertedPageCache::setElement(const DataElement* pElement)
+{
+   if (mpBudget == NULL)
+   {
+      mpBudget = Service<ModelServices>()->getMemoryBudget();
+      if (mpBudget != NULL)
+      {
+         mpBudget->addConsumer(this, pElement);
+      }
+   }
+}
+
+uint64_t ConvertedPageCache::getAccessTime()
+{
+   if (mpBudget != NULL)
+   {
+      return mpBudget->getAccessTime();
+   }
+   return ++mAccessTime;
+}
+
+ConvertedPageCache::Block ConvertedPageCache::find(const Key& key)
+{
+   mta::MutexLock lock(mMutex);
+
+   map<Key, EntryList::iterator>::iterator ppEntry = mIndex.find(key);
+   if (ppEntry == mIndex.end())
+   {
+      return Block();
+   }
+
+   mEntries.splice(mEntries.end(), mEntries, ppEntry->second);
+   ppEntry->second->mLastAccess = getAccessTime();
+   return ppEntry->second->mpData;
+}
+
+void ConvertedPageCache::insert(const Key& key, Block pData, size_t size)
+{
+   if (pData.get() == NULL)
+   {
+      return;
+   }
+
+   size_t maxSize = getSettingMaximumSize();
+   if (size > maxSize)
+   {
+      return;
+   }
+
+   {
+      mta::MutexLock lock(mMutex);
+
+      // Another thread may have converted the same page in the meantime
+      map<Key, EntryList::iterator>::iterator ppEntry = mIndex.find(key);
+      if (ppEntry != mIndex.end())
+      {
+         mSize -= ppEntry->second->mSize;
+         mEntries.erase(ppEntry->second);
+         mIndex.erase(ppEntry);
+      }
+
+      while (mEntries.empty() == false && mSize + size > maxSize)
+      {
+         mSize -= mEntries.front().mSize;
+         mIndex.erase(mEntries.front().mKey);
+         mEntries.pop_front();
+      }
+
+      Entry entry = { key, pData, size, getAccessTime() };
+      mEntries.push_back(entry);
+      mIndex.insert(make_pair(key, --mEntries.end()));
+      mSize += size;
+   }
+
+   // The budget locks the cache to release its pages
+   if (mpBudget != NULL)
+   {
+      mpBudget->update();
+   }
+}
+
+void ConvertedPageCache::clear()
+{
+   mta::MutexLock lock(mMutex);
+   mEntries.clear();
+   mIndex.clear();
+   mSize = 0;
+}
+
+int64_t ConvertedPageCache::getMemoryUsage() const
+{
+   mta::MutexLock lock(mMutex);
+   return static_cast<int64_t>(mSize);
+}
+
+bool ConvertedPageCache::getOldestAccess(uint64_t& accessTime) const
+{
+   mta::MutexLock lock(mMutex);
+   if (mEntries.empty())
+   {
+      return false;
+   }
+
+   accessTime = mEntries.front().mLastAccess;
+   return true;
+}
+
+int64_t ConvertedPageCache::releaseOldest()
+{
+   mta::MutexLock lock(mMutex);
+   if (mEntries.empty())
+   {
+      return 0;
+   }
+
+   int64_t size = static_cast<int64_t>(mEntries.front().mSize);
+   mSize -= mEntries.front().mSize;
+   mIndex.erase(mEntries.front().mKey);
+   mEntries.pop_front();
+   return size;
+}
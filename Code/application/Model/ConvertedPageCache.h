@@ -0,0 +1,139 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef CONVERTEDPAGECACHE_H
+#define CONVERTEDPAGECACHE_H
+
+#include "ConfigurationSettings.h"
+#include "DMutex.h"
+#include "MemoryBudget.h"
+#include "TypesFile.h"
+
+#include <boost/shared_array.hpp>
+#include <list>
+#include <map>
+
+/**
+ * Holds pages of data which have been converted to another interleave so that
+ * repeated requests for the same page do not repeat the conversion.
+ *
+ * The cache is shared by the ConvertToBipPager, ConvertToBilPager and
+ * ConvertToBsqPager of a RasterElement.  Pages are keyed by the interleave,
+ * strides and extents of the converted data.  The least recently used pages are
+ * discarded when the total size exceeds the MaximumSize setting, or when the
+ * MemoryBudget shared with the pagers of all elements is exceeded.  A page which
+ * is discarded while a RasterPage still refers to it is released when that
+ * RasterPage is destroyed.
+ *
+ * The owning RasterElement must clear() the cache whenever its data changes.
+ */
+class DataElement;
+class DataRequest;
+
+class ConvertedPageCache : public MemoryConsumer
+{
+public:
+   SETTING(MaximumSize, ConvertedPageCache, unsigned int, 64 * 1024 * 1024)
+
+   typedef boost::shared_array<unsigned char> Block;
+
+   /**
+    * The interleave, strides and extents of a converted page.  The extents are
+    * active numbers and counts of returned elements.
+    */
+   struct Key
+   {
+      Key(const DataRequest* pRequest, unsigned int startRow, unsigned int rows,
+         unsigned int startColumn, unsigned int columns, unsigned int startBand, unsigned int bands);
+
+      bool operator<(const Key& rhs) const;
+
+      InterleaveFormatType mInterleave;
+      unsigned int mStartRow;
+      unsigned int mRows;
+      unsigned int mRowStride;
+      unsigned int mStartColumn;
+      unsigned int mColumns;
+      unsigned int mColumnStride;
+      unsigned int mStartBand;
+      unsigned int mBands;
+      unsigned int mBandStride;
+   };
+
+   ConvertedPageCache();
+   ~ConvertedPageCache();
+
+   /**
+    * Registers the cache with the MemoryBudget.
+    *
+    * @param  pElement
+    *         The element whose converted pages are held by the cache.  This
+    *         is set when the first converter pager is created, since the
+    *         cache is created in the constructor of the RasterElementImp.
+    */
+   void setElement(const DataElement* pElement);
+
+   /**
+    * Finds a previously converted page.
+    *
+    * @param  key
+    *         The interleave and extents of the page.
+    *
+    * @return The converted data, or an empty Block if the page is not in the cache.
+    */
+   Block find(const Key& key);
+
+   /**
+    * Adds a converted page to the cache.
+    *
+    * @param  key
+    *         The interleave and extents of the page.
+    * @param  pData
+    *         The converted data.
+    * @param  size
+    *         The number of bytes in pData.
+    */
+   void insert(const Key& key, Block pData, size_t size);
+
+   /**
+    * Discards all of the converted pages.
+    */
+   void clear();
+
+   // MemoryConsumer
+   int64_t getMemoryUsage() const;
+   bool getOldestAccess(uint64_t& accessTime) const;
+   int64_t releaseOldest();
+
+private:
+   ConvertedPageCache(const ConvertedPageCache& rhs);
+   ConvertedPageCache& operator=(const ConvertedPageCache& rhs);
+
+   struct Entry
+   {
+      Key mKey;
+      Block mpData;
+      size_t mSize;
+      uint64_t mLastAccess;
+   };
+
+   // Ordered from least recently used to most recently used
+   typedef std::list<Entry> EntryList;
+
+   uint64_t getAccessTime();
+
+   mutable mta::DMutex mMutex;
+   MemoryBudget* mpBudget;
+   uint64_t mAccessTime;
+   EntryList mEntries;
+   std::map<Key, EntryList::iterator> mIndex;
+   size_t mSize;
+};
+
+#endif
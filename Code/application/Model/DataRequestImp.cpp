@@ -13,11 +13,18 @@
 #include "RasterDataDescriptor.h"
 #include "RasterFileDescriptor.h"
 
+#include <vector>
+
 DataRequestImp::DataRequestImp() :
    mInterleaveDefault(true),
    mConcurrentRows(0),
    mConcurrentColumns(0),
    mConcurrentBands(0),
+   mRowStride(0),
+   mColumnStride(0),
+   mBandStride(0),
+   mComponent(COMPLEX_MAGNITUDE),
+   mBadValuesAsNan(false),
    mbWritable(false)
 {
 }
@@ -38,6 +45,12 @@ DataRequestImp::DataRequestImp(const DataRequestImp& rhs) :
    mStartBand(rhs.mStartBand),
    mStopBand(rhs.mStopBand),
    mConcurrentBands(rhs.mConcurrentBands),
+   mRowStride(rhs.mRowStride),
+   mColumnStride(rhs.mColumnStride),
+   mBandStride(rhs.mBandStride),
+   mDataType(rhs.mDataType),
+   mComponent(rhs.mComponent),
+   mBadValuesAsNan(rhs.mBadValuesAsNan),
    mbWritable(rhs.mbWritable)
 {
 }
@@ -66,6 +79,14 @@ bool DataRequestImp::validate(const RasterDataDescriptor *pDescriptor) const
    DimensionDescriptor startBand = getStartBand();
    DimensionDescriptor stopBand = getStopBand();
    unsigned int concurrentBands = getConcurrentBands();
+   unsigned int rowStride = getRowStride();
+   unsigned int columnStride = getColumnStride();
+   unsigned int bandStride = getBandStride();
+
+   if (rowStride == 0 || columnStride == 0 || bandStride == 0)
+   {
+      return false;
+   }
 
    if (!startRow.isActiveNumberValid() || !stopRow.isActiveNumberValid() ||
       !startColumn.isActiveNumberValid() || !stopColumn.isActiveNumberValid() ||
@@ -84,9 +105,20 @@ bool DataRequestImp::validate(const RasterDataDescriptor *pDescriptor) const
       startBand.getActiveNumber() >= numBands ||
       startBand.getActiveNumber() > stopBand.getActiveNumber() ||
       stopBand.getActiveNumber() >= numBands ||
-      concurrentRows > stopRow.getActiveNumber()-startRow.getActiveNumber()+1 ||
-      concurrentColumns > stopColumn.getActiveNumber()-startColumn.getActiveNumber()+1 ||
-      concurrentBands > stopBand.getActiveNumber()-startBand.getActiveNumber()+1)
+      concurrentRows > (stopRow.getActiveNumber()-startRow.getActiveNumber())/rowStride+1 ||
+      concurrentColumns > (stopColumn.getActiveNumber()-startColumn.getActiveNumber())/columnStride+1 ||
+      concurrentBands > (stopBand.getActiveNumber()-startBand.getActiveNumber())/bandStride+1)
+   {
+      return false;
+   }
+
+   if (mDataType.isValid() && mDataType != FLT4BYTES && mDataType != FLT8BYTES)
+   {
+      return false;
+   }
+
+   // Decimated and converted pages are copies of the data, so writes to them would be lost
+   if (getWritable() && getRequestVersion(pDescriptor) > 1)
    {
       return false;
    }
@@ -103,6 +135,29 @@ bool DataRequestImp::validate(const RasterDataDescriptor *pDescriptor) const
    return true;
 }
 
+namespace
+{
+   // Returns the last element between start and stop which is a whole number of strides past start
+   DimensionDescriptor getLastSample(const std::vector<DimensionDescriptor>& elements, DimensionDescriptor start,
+      DimensionDescriptor stop, unsigned int stride)
+   {
+      if (stride <= 1 || !start.isActiveNumberValid() || !stop.isActiveNumberValid() ||
+         stop.getActiveNumber() < start.getActiveNumber())
+      {
+         return stop;
+      }
+
+      unsigned int last = start.getActiveNumber() +
+         (stop.getActiveNumber() - start.getActiveNumber()) / stride * stride;
+      if (last >= elements.size())
+      {
+         return stop;
+      }
+
+      return elements[last];
+   }
+}
+
 bool DataRequestImp::polish(const RasterDataDescriptor *pDescriptor)
 {
    if (pDescriptor == NULL)
@@ -118,6 +173,26 @@ bool DataRequestImp::polish(const RasterDataDescriptor *pDescriptor)
       mInterleave = nativeInterleave;
    }
 
+   // strides
+   if (mRowStride == 0)
+   {
+      mRowStride = 1;
+   }
+   if (mColumnStride == 0)
+   {
+      mColumnStride = 1;
+   }
+   if (mBandStride == 0 || mInterleave == BSQ)
+   {
+      mBandStride = 1;
+   }
+
+   // data type
+   if (mDataType.isValid() && mDataType == pDescriptor->getDataType() && mBadValuesAsNan == false)
+   {
+      mDataType = EncodingType();
+   }
+
    // rows
    if (!mStartRow.isValid())
    {
@@ -127,6 +202,7 @@ bool DataRequestImp::polish(const RasterDataDescriptor *pDescriptor)
    {
       mStopRow = pDescriptor->getActiveRow(pDescriptor->getRowCount()-1);
    }
+   mStopRow = getLastSample(pDescriptor->getRows(), mStartRow, mStopRow, mRowStride);
    if (mConcurrentRows == 0)
    {
       mConcurrentRows = 1;
@@ -141,9 +217,10 @@ bool DataRequestImp::polish(const RasterDataDescriptor *pDescriptor)
    {
       mStopColumn = pDescriptor->getActiveColumn(pDescriptor->getColumnCount()-1);
    }
+   mStopColumn = getLastSample(pDescriptor->getColumns(), mStartColumn, mStopColumn, mColumnStride);
    if (mConcurrentColumns == 0)
    {
-      mConcurrentColumns = mStopColumn.getActiveNumber() - mStartColumn.getActiveNumber() + 1;
+      mConcurrentColumns = (mStopColumn.getActiveNumber() - mStartColumn.getActiveNumber()) / mColumnStride + 1;
    }
 
    // bands
@@ -162,9 +239,10 @@ bool DataRequestImp::polish(const RasterDataDescriptor *pDescriptor)
          mStopBand = mStartBand;
       }
    }
+   mStopBand = getLastSample(pDescriptor->getBands(), mStartBand, mStopBand, mBandStride);
    if (mConcurrentBands == 0)
    {
-      mConcurrentBands = mStopBand.getActiveNumber() - mStartBand.getActiveNumber() + 1;
+      mConcurrentBands = (mStopBand.getActiveNumber() - mStartBand.getActiveNumber()) / mBandStride + 1;
    }
 
    return true;
@@ -172,6 +250,16 @@ bool DataRequestImp::polish(const RasterDataDescriptor *pDescriptor)
 
 int DataRequestImp::getRequestVersion(const RasterDataDescriptor *pDescriptor) const
 {
+   if (mDataType.isValid())
+   {
+      return 3;
+   }
+
+   if (mRowStride > 1 || mColumnStride > 1 || mBandStride > 1)
+   {
+      return 2;
+   }
+
    return 1;
 }
 
@@ -253,6 +341,50 @@ void DataRequestImp::setBands(DimensionDescriptor startBand, DimensionDescriptor
    mConcurrentBands = concurrentBands;
 }
 
+unsigned int DataRequestImp::getRowStride() const
+{
+   return mRowStride;
+}
+
+unsigned int DataRequestImp::getColumnStride() const
+{
+   return mColumnStride;
+}
+
+unsigned int DataRequestImp::getBandStride() const
+{
+   return mBandStride;
+}
+
+void DataRequestImp::setStrides(unsigned int rowStride, unsigned int columnStride, unsigned int bandStride)
+{
+   mRowStride = rowStride;
+   mColumnStride = columnStride;
+   mBandStride = bandStride;
+}
+
+EncodingType DataRequestImp::getDataType() const
+{
+   return mDataType;
+}
+
+ComplexComponent DataRequestImp::getComplexComponent() const
+{
+   return mComponent;
+}
+
+bool DataRequestImp::getBadValuesAsNan() const
+{
+   return mBadValuesAsNan;
+}
+
+void DataRequestImp::setDataType(EncodingType dataType, ComplexComponent component, bool badValuesAsNan)
+{
+   mDataType = dataType;
+   mComponent = component;
+   mBadValuesAsNan = badValuesAsNan;
+}
+
 bool DataRequestImp::getWritable() const
 {
    return mbWritable;
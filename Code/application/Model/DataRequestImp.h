@@ -46,6 +46,17 @@ public:
    unsigned int getConcurrentBands() const;
    void setBands(DimensionDescriptor startBand, DimensionDescriptor stopBand, unsigned int concurrentBands = 0);
 
+   unsigned int getRowStride() const;
+   unsigned int getColumnStride() const;
+   unsigned int getBandStride() const;
+   void setStrides(unsigned int rowStride, unsigned int columnStride, unsigned int bandStride);
+
+   EncodingType getDataType() const;
+   ComplexComponent getComplexComponent() const;
+   bool getBadValuesAsNan() const;
+   void setDataType(EncodingType dataType, ComplexComponent component = COMPLEX_MAGNITUDE,
+      bool badValuesAsNan = false);
+
    bool getWritable() const;
    void setWritable(bool writable);
 
@@ -65,6 +76,14 @@ private:
    DimensionDescriptor mStopBand;
    unsigned int mConcurrentBands;
 
+   unsigned int mRowStride;
+   unsigned int mColumnStride;
+   unsigned int mBandStride;
+
+   EncodingType mDataType;
+   ComplexComponent mComponent;
+   bool mBadValuesAsNan;
+
    bool mbWritable;
 
 };
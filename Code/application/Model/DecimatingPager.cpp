@@ -0,0 +1,105 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "DataAccessorImpl.h"
+#include "DecimatedPage.h"
+#include "DecimatingPager.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+
+#include <memory>
+
+DecimatingPager::DecimatingPager(RasterElement* pRaster) :
+   mpRaster(pRaster)
+{
+}
+
+DecimatingPager::~DecimatingPager()
+{
+}
+
+void DecimatingPager::releasePage(RasterPage* pPage)
+{
+   // Check that pPage is the correct type before deleting it.
+   delete dynamic_cast<DecimatedPage*>(pPage);
+}
+
+int DecimatingPager::getSupportedRequestVersion() const
+{
+   return 2;
+}
+
+RasterPage* DecimatingPager::getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
+   DimensionDescriptor startColumn, DimensionDescriptor startBand)
+{
+   VERIFYRV(pOriginalRequest != NULL, NULL);
+   if (pOriginalRequest->getWritable())
+   {
+      return NULL;
+   }
+
+   VERIFYRV(mpRaster != NULL, NULL);
+   const RasterDataDescriptor* pDd = dynamic_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+   VERIFYRV(pDd != NULL, NULL);
+
+   InterleaveFormatType interleave = pOriginalRequest->getInterleaveFormat();
+   VERIFYRV(interleave == pDd->getInterleaveFormat(), NULL);
+
+   unsigned int bytesPerElement = pDd->getBytesPerElement();
+   std::auto_ptr<DecimatedPage> pPage(new DecimatedPage(pOriginalRequest, startRow, startColumn, startBand,
+      0, bytesPerElement));
+   if (pPage->getNumRows() == 0 || pPage->getRawData() == NULL)
+   {
+      return NULL;
+   }
+
+   // Request full resolution data covering only the columns and bands of the page
+   unsigned int stopColumn = startColumn.getActiveNumber() +
+      (pPage->getNumColumns() - 1) * pOriginalRequest->getColumnStride();
+   unsigned int stopBand = startBand.getActiveNumber() +
+      (pPage->getNumBands() - 1) * pOriginalRequest->getBandStride();
+
+   FactoryResource<DataRequest> pRequest;
+   pRequest->setInterleaveFormat(interleave);
+   pRequest->setRows(startRow, pOriginalRequest->getStopRow(), 1);
+   pRequest->setColumns(startColumn, pDd->getActiveColumn(stopColumn));
+   pRequest->setBands(startBand, pDd->getActiveBand(stopBand));
+
+   DataAccessor da = mpRaster->getDataAccessor(pRequest.release());
+   if (da.isValid() == false)
+   {
+      return NULL;
+   }
+
+   for (unsigned int row = 0; row < pPage->getNumRows(); ++row)
+   {
+      da->toPixel(pPage->getSourceRow(row), startColumn.getActiveNumber());
+      if (da.isValid() == false)
+      {
+         return NULL;
+      }
+
+      size_t columnPitch = bytesPerElement;
+      size_t bandPitch = 0;
+      if (interleave == BIP)
+      {
+         columnPitch = da->getRowSize() / da->getConcurrentColumns();
+         bandPitch = bytesPerElement;
+      }
+      else if (interleave == BIL)
+      {
+         bandPitch = da->getConcurrentColumns() * bytesPerElement;
+      }
+
+      pPage->copyRow(row, da->getColumn(), columnPitch, bandPitch);
+   }
+
+   return pPage.release();
+}
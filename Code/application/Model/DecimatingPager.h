@@ -0,0 +1,47 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef DECIMATINGPAGER_H
+#define DECIMATINGPAGER_H
+
+#include "RasterPager.h"
+
+class RasterElement;
+
+/**
+ * This class decimates data on the fly for RasterPagers which do not support
+ * decimated requests.
+ *
+ * Each returned row is read from the RasterElement's own pager and copied into a
+ * DecimatedPage.  Pages of the source pager which contain only skipped rows are
+ * never requested.
+ */
+class DecimatingPager : public RasterPager
+{
+public:
+   DecimatingPager(RasterElement* pRaster);
+
+   virtual ~DecimatingPager();
+
+   void releasePage(RasterPage* pPage);
+
+   int getSupportedRequestVersion() const;
+
+   RasterPage* getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
+      DimensionDescriptor startColumn, DimensionDescriptor startBand);
+
+private:
+   DecimatingPager();
+
+   DecimatingPager& operator=(const DecimatingPager& rhs);
+
+   RasterElement* const mpRaster;
+};
+
+#endif
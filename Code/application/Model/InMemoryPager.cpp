@@ -10,6 +10,7 @@
 #include "AppVersion.h"
 #include "AppVerify.h"
 #include "DataRequest.h"
+#include "DecimatedPage.h"
 #include "InMemoryPage.h"
 #include "InMemoryPager.h"
 #include "ModelServices.h"
@@ -18,10 +19,14 @@
 #include "RasterDataDescriptor.h"
 #include "RasterElement.h"
 
+#include <memory>
+
 InMemoryPager::InMemoryPager() :
    mpRaster(NULL),
    mpData(NULL),
-   mbOwner(true)
+   mbOwner(true),
+   mDataSize(0),
+   mpBudget(NULL)
 {
    setName("In Memory Pager");
    setCopyright("Copyright (2006) by Ball Aerospace & Technologies Corp.");
@@ -35,6 +40,11 @@ InMemoryPager::InMemoryPager() :
 
 InMemoryPager::~InMemoryPager()
 {
+   if (mpBudget != NULL)
+   {
+      mpBudget->removeConsumer(this);
+   }
+
    if (mpData != NULL)
    {
       if (mbOwner)
@@ -72,6 +82,18 @@ bool InMemoryPager::execute(PlugInArgList* pInput, PlugInArgList* pOutput)
       mbOwner = *pOwner;
    }
 
+   const RasterDataDescriptor* pDescriptor = (mpRaster == NULL) ? NULL :
+      dynamic_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+   if (mbOwner && mpData != NULL && pDescriptor != NULL)
+   {
+      // Count the data toward the budget so that less memory is left for the caches of the other elements
+      mDataSize = static_cast<int64_t>(pDescriptor->getRowCount()) * pDescriptor->getColumnCount() *
+         pDescriptor->getBandCount() * pDescriptor->getBytesPerElement();
+      mpBudget = Service<ModelServices>()->getMemoryBudget();
+      mpBudget->addConsumer(this, mpRaster);
+      mpBudget->update();
+   }
+
    return true;
 }
 
@@ -106,6 +128,9 @@ RasterPage* InMemoryPager::getPage(DataRequest* pOriginalRequest, DimensionDescr
 
    char* pData = reinterpret_cast<char*>(mpData);
    char* pStart = NULL;
+   size_t rowSize = 0;
+   size_t columnPitch = 0;
+   size_t bandPitch = 0;
    switch (requestedType)
    {
    case BIP:
@@ -114,6 +139,9 @@ RasterPage* InMemoryPager::getPage(DataRequest* pOriginalRequest, DimensionDescr
          size_t middleSize = minorSize * numBands;
          size_t majorSize = middleSize * numColumns;
          pStart = &pData[rowNumber * majorSize + colNumber * middleSize + bandNumber * minorSize];
+         rowSize = majorSize;
+         columnPitch = middleSize;
+         bandPitch = minorSize;
       }
       break;
    case BSQ:
@@ -122,6 +150,9 @@ RasterPage* InMemoryPager::getPage(DataRequest* pOriginalRequest, DimensionDescr
          size_t middleSize = minorSize * numColumns;
          size_t majorSize = middleSize * numRows;
          pStart = &pData[bandNumber * majorSize + rowNumber * middleSize + colNumber * minorSize];
+         rowSize = middleSize;
+         columnPitch = minorSize;
+         bandPitch = majorSize;
       }
       break;
    case BIL:
@@ -130,6 +161,9 @@ RasterPage* InMemoryPager::getPage(DataRequest* pOriginalRequest, DimensionDescr
          size_t middleSize = minorSize * numColumns;
          size_t majorSize = middleSize * numBands;
          pStart = &pData[rowNumber * majorSize + bandNumber * middleSize + colNumber * minorSize];
+         rowSize = majorSize;
+         columnPitch = minorSize;
+         bandPitch = middleSize;
       }
       break;
    default:
@@ -138,6 +172,24 @@ RasterPage* InMemoryPager::getPage(DataRequest* pOriginalRequest, DimensionDescr
 
    VERIFYRV(pStart != NULL, NULL);
 
+   if (pOriginalRequest->getRequestVersion(pDescriptor) > 1)
+   {
+      // Copy only the sampled elements into a packed page
+      std::auto_ptr<DecimatedPage> pPage(new DecimatedPage(pOriginalRequest, startRow, startColumn, startBand,
+         0, bytesPerElement));
+      if (pPage->getNumRows() == 0)
+      {
+         return NULL;
+      }
+
+      for (unsigned int row = 0; row < pPage->getNumRows(); ++row)
+      {
+         pPage->copyRow(row, pStart + (pPage->getSourceRow(row) - rowNumber) * rowSize, columnPitch, bandPitch);
+      }
+
+      return pPage.release();
+   }
+
    return new InMemoryPage(pStart, numRows - rowNumber);
 }
 
@@ -148,11 +200,30 @@ void InMemoryPager::releasePage(RasterPage *pPage)
    {
       delete pMemPage;
    }
+   else
+   {
+      delete dynamic_cast<DecimatedPage*>(pPage);
+   }
 
    return;
 }
 
 int InMemoryPager::getSupportedRequestVersion() const
 {
-   return 1;
+   return 2;
+}
+
+int64_t InMemoryPager::getMemoryUsage() const
+{
+   return mDataSize;
+}
+
+bool InMemoryPager::getOldestAccess(uint64_t& accessTime) const
+{
+   return false;
+}
+
+int64_t InMemoryPager::releaseOldest()
+{
+   return 0;
 }
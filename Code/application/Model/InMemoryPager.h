@@ -10,11 +10,12 @@
 #ifndef INMEMORYPAGER_H
 #define INMEMORYPAGER_H
 
+#include "MemoryBudget.h"
 #include "RasterPagerShell.h"
 
 class RasterElement;
 
-class InMemoryPager : public RasterPagerShell
+class InMemoryPager : public RasterPagerShell, public MemoryConsumer
 {
 public:
    InMemoryPager();
@@ -29,10 +30,17 @@ public:
 
    int getSupportedRequestVersion() const;
 
+   // The data owned by the pager is accounted by the MemoryBudget but cannot be released
+   int64_t getMemoryUsage() const;
+   bool getOldestAccess(uint64_t& accessTime) const;
+   int64_t releaseOldest();
+
 private:
    RasterElement* mpRaster;
    void* mpData;
    bool mbOwner;
+   int64_t mDataSize;
+   MemoryBudget* mpBudget;
 };
 
 #endif
@@ -0,0 +1,337 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppConfig.h"
+#include "AppVerify.h"
+#include "MemoryArenaImp.h"
+
+#if defined(WIN_API)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#if !defined(MAP_ANONYMOUS)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+#include <limits>
+#include <new>
+#include <string.h>
+
+using namespace std;
+
+namespace
+{
+   // Smaller blocks are allocated from the heap
+   const size_t MIN_MAPPED_SIZE = 1024 * 1024;
+
+   // Mapped blocks are multiples of the size of a transparent huge page
+   const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+}
+
+MemoryArenaImp::MemoryArenaImp() :
+   mAllocatedBytes(0),
+   mCachedBytes(0)
+{
+}
+
+MemoryArenaImp::~MemoryArenaImp()
+{
+   releaseCache();
+}
+
+char* MemoryArenaImp::allocate(size_t size)
+{
+   if (size == 0)
+   {
+      return NULL;
+   }
+
+   Block block;
+   block.mSize = size;
+   block.mMappedSize = 0;
+
+   char* pBlock = NULL;
+   if (size < MIN_MAPPED_SIZE)
+   {
+      pBlock = new (nothrow) char[size];
+      if (pBlock == NULL)
+      {
+         return NULL;
+      }
+      memset(pBlock, 0, size);
+   }
+   else
+   {
+      block.mMappedSize = getClassSize(size);
+      if (block.mMappedSize == 0)
+      {
+         return NULL;
+      }
+
+      {
+         mta::MutexLock lock(mMutex);
+         map<size_t, vector<char*> >::iterator iter = mFreeBlocks.find(block.mMappedSize);
+         if (iter != mFreeBlocks.end() && iter->second.empty() == false)
+         {
+            pBlock = iter->second.back();
+            iter->second.pop_back();
+            mCachedBytes -= block.mMappedSize;
+         }
+      }
+
+      if (pBlock != NULL && !reuseBlock(pBlock, block.mMappedSize))
+      {
+         unmapBlock(pBlock, block.mMappedSize);
+         pBlock = NULL;
+      }
+
+      if (pBlock == NULL)
+      {
+         pBlock = mapBlock(block.mMappedSize);
+         if (pBlock == NULL)
+         {
+            // Return the cached address space and try again
+            releaseCache();
+            pBlock = mapBlock(block.mMappedSize);
+            if (pBlock == NULL)
+            {
+               return NULL;
+            }
+         }
+      }
+   }
+
+   mta::MutexLock lock(mMutex);
+   mBlocks[pBlock] = block;
+   mAllocatedBytes += size;
+   return pBlock;
+}
+
+void MemoryArenaImp::deallocate(char* pBlock)
+{
+   if (pBlock == NULL)
+   {
+      return;
+   }
+
+   Block block;
+   {
+      mta::MutexLock lock(mMutex);
+      map<char*, Block>::iterator iter = mBlocks.find(pBlock);
+      if (iter == mBlocks.end())
+      {
+         // The raw data of a raster element may still be allocated with new[] by the caller
+         block.mSize = 0;
+         block.mMappedSize = 0;
+      }
+      else
+      {
+         block = iter->second;
+         mBlocks.erase(iter);
+         mAllocatedBytes -= block.mSize;
+      }
+   }
+
+   if (block.mMappedSize == 0)
+   {
+      delete [] pBlock;
+      return;
+   }
+
+   // Keep the address space for reuse, but return the physical pages to the operating system
+   const int64_t cacheLimit = static_cast<int64_t>(MemoryArena::getSettingCacheSize()) * 1024 * 1024;
+   if (discardBlock(pBlock, block.mMappedSize))
+   {
+      mta::MutexLock lock(mMutex);
+      if (mCachedBytes + static_cast<int64_t>(block.mMappedSize) <= cacheLimit)
+      {
+         mFreeBlocks[block.mMappedSize].push_back(pBlock);
+         mCachedBytes += block.mMappedSize;
+         return;
+      }
+   }
+
+   unmapBlock(pBlock, block.mMappedSize);
+}
+
+int64_t MemoryArenaImp::getAllocatedBytes() const
+{
+   mta::MutexLock lock(mMutex);
+   return mAllocatedBytes;
+}
+
+int64_t MemoryArenaImp::getResidentBytes() const
+{
+   mta::MutexLock lock(mMutex);
+#if defined(WIN_API)
+   return mAllocatedBytes;
+#else
+   const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+   int64_t residentBytes = 0;
+   vector<unsigned char> pages;
+   for (map<char*, Block>::const_iterator iter = mBlocks.begin(); iter != mBlocks.end(); ++iter)
+   {
+      const Block& block = iter->second;
+      if (block.mMappedSize == 0)
+      {
+         residentBytes += block.mSize;
+         continue;
+      }
+
+      size_t numPages = (block.mSize + pageSize - 1) / pageSize;
+      pages.resize(numPages);
+#if defined(SOLARIS)
+      if (mincore(iter->first, block.mSize, reinterpret_cast<char*>(&pages[0])) != 0)
+#else
+      if (mincore(iter->first, block.mSize, &pages[0]) != 0)
+#endif
+      {
+         residentBytes += block.mSize;
+         continue;
+      }
+
+      for (size_t page = 0; page < numPages; ++page)
+      {
+         if ((pages[page] & 1) != 0)
+         {
+            residentBytes += pageSize;
+         }
+      }
+   }
+
+   return residentBytes;
+#endif
+}
+
+int64_t MemoryArenaImp::getCachedBytes() const
+{
+   mta::MutexLock lock(mMutex);
+   return mCachedBytes;
+}
+
+void MemoryArenaImp::releaseCache()
+{
+   map<size_t, vector<char*> > freeBlocks;
+   {
+      mta::MutexLock lock(mMutex);
+      freeBlocks.swap(mFreeBlocks);
+      mCachedBytes = 0;
+   }
+
+   for (map<size_t, vector<char*> >::iterator iter = freeBlocks.begin(); iter != freeBlocks.end(); ++iter)
+   {
+      for (vector<char*>::iterator blockIter = iter->second.begin(); blockIter != iter->second.end(); ++blockIter)
+      {
+         unmapBlock(*blockIter, iter->first);
+      }
+   }
+}
+
+size_t MemoryArenaImp::getClassSize(size_t size)
+{
+   // Round up to a number of huge pages with at most three significant bits, so that each class is at most
+   // a quarter larger than the previous one.  The unused end of a block is never touched, so it only costs
+   // address space.
+   if (size > numeric_limits<size_t>::max() / 2)
+   {
+      return 0;
+   }
+
+   size_t numPages = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE;
+   size_t step = 1;
+   while ((numPages / step) >= 8)
+   {
+      step *= 2;
+   }
+
+   return (numPages + step - 1) / step * step * HUGE_PAGE_SIZE;
+}
+
+char* MemoryArenaImp::mapBlock(size_t size)
+{
+#if defined(WIN_API)
+   // Committed pages are zero-filled when they are first touched
+   return reinterpret_cast<char*>(VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+#else
+   const bool hugePages = MemoryArena::getSettingHugePages();
+   const size_t alignment = hugePages ? HUGE_PAGE_SIZE : 0;
+   void* pAddress = mmap(NULL, size + alignment, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (pAddress == MAP_FAILED)
+   {
+      return NULL;
+   }
+
+   // Trim the mapping so that the block starts on a huge page boundary
+   char* pMapping = reinterpret_cast<char*>(pAddress);
+   char* pBlock = pMapping;
+   if (alignment > 0)
+   {
+      size_t head = (alignment - reinterpret_cast<size_t>(pMapping) % alignment) % alignment;
+      pBlock = pMapping + head;
+      if (head > 0)
+      {
+         munmap(pMapping, head);
+      }
+      munmap(pBlock + size, alignment - head);
+   }
+
+#if defined(MADV_HUGEPAGE)
+   if (hugePages)
+   {
+      madvise(pBlock, size, MADV_HUGEPAGE);
+   }
+#endif
+
+   return pBlock;
+#endif
+}
+
+void MemoryArenaImp::unmapBlock(char* pBlock, size_t size)
+{
+#if defined(WIN_API)
+   VirtualFree(pBlock, 0, MEM_RELEASE);
+#else
+   munmap(pBlock, size);
+#endif
+}
+
+bool MemoryArenaImp::discardBlock(char* pBlock, size_t size)
+{
+#if defined(WIN_API)
+   return VirtualFree(pBlock, size, MEM_DECOMMIT) != FALSE;
+#else
+   // Replace the pages with new anonymous pages, which are zero-filled when they are next touched
+   void* pAddress = mmap(pBlock, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+   if (pAddress == MAP_FAILED)
+   {
+      return false;
+   }
+
+#if defined(MADV_HUGEPAGE)
+   if (MemoryArena::getSettingHugePages())
+   {
+      madvise(pBlock, size, MADV_HUGEPAGE);
+   }
+#endif
+
+   return true;
+#endif
+}
+
+bool MemoryArenaImp::reuseBlock(char* pBlock, size_t size)
+{
+#if defined(WIN_API)
+   return VirtualAlloc(pBlock, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#else
+   // The pages were replaced when the block was freed
+   return true;
+#endif
+}
@@ -0,0 +1,55 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef MEMORYARENAIMP_H
+#define MEMORYARENAIMP_H
+
+#include "DMutex.h"
+#include "MemoryArena.h"
+
+#include <map>
+#include <vector>
+
+class MemoryArenaImp : public MemoryArena
+{
+public:
+   MemoryArenaImp();
+   ~MemoryArenaImp();
+
+   char* allocate(size_t size);
+   void deallocate(char* pBlock);
+   int64_t getAllocatedBytes() const;
+   int64_t getResidentBytes() const;
+   int64_t getCachedBytes() const;
+   void releaseCache();
+
+private:
+   MemoryArenaImp(const MemoryArenaImp& rhs);
+   MemoryArenaImp& operator=(const MemoryArenaImp& rhs);
+
+   struct Block
+   {
+      size_t mSize;           // The requested size
+      size_t mMappedSize;     // The size class of a mapped block, or 0 for a heap block
+   };
+
+   static size_t getClassSize(size_t size);
+   static char* mapBlock(size_t size);
+   static void unmapBlock(char* pBlock, size_t size);
+   static bool discardBlock(char* pBlock, size_t size);
+   static bool reuseBlock(char* pBlock, size_t size);
+
+   mutable mta::DMutex mMutex;
+   std::map<char*, Block> mBlocks;
+   std::map<size_t, std::vector<char*> > mFreeBlocks;
+   int64_t mAllocatedBytes;
+   int64_t mCachedBytes;
+};
+
+#endif
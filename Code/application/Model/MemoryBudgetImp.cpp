@@ -0,0 +1,188 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "MemoryBudgetImp.h"
+
+using namespace std;
+
+MemoryBudgetImp::MemoryBudgetImp() :
+   mAccessTime(0)
+{
+}
+
+MemoryBudgetImp::~MemoryBudgetImp()
+{
+}
+
+void MemoryBudgetImp::addConsumer(MemoryConsumer* pConsumer, const DataElement* pElement)
+{
+   VERIFYNRV(pConsumer != NULL);
+
+   mta::MutexLock lock(mMutex);
+   mConsumers[pConsumer] = pElement;
+}
+
+void MemoryBudgetImp::removeConsumer(MemoryConsumer* pConsumer)
+{
+   // Waits for an update() which is releasing memory from the consumer
+   mta::MutexLock lock(mMutex);
+   mConsumers.erase(pConsumer);
+}
+
+uint64_t MemoryBudgetImp::getAccessTime()
+{
+   // This is called while consumers hold their own locks, so it must not lock mMutex
+   return ++mAccessTime;
+}
+
+void MemoryBudgetImp::update()
+{
+   mta::MutexLock lock(mMutex);
+
+   int64_t limit = getLimit();
+   int64_t usage = 0;
+   for (map<MemoryConsumer*, const DataElement*>::const_iterator iter = mConsumers.begin();
+      iter != mConsumers.end(); ++iter)
+   {
+      usage += iter->first->getMemoryUsage();
+   }
+
+   while (usage > limit)
+   {
+      // Release the least recently used memory of the elements with the lowest priority
+      MemoryConsumer* pOldestConsumer = NULL;
+      PriorityType oldestPriority;
+      uint64_t oldestAccess = 0;
+      for (map<MemoryConsumer*, const DataElement*>::const_iterator iter = mConsumers.begin();
+         iter != mConsumers.end(); ++iter)
+      {
+         uint64_t accessTime = 0;
+         if (iter->first->getOldestAccess(accessTime) == false)
+         {
+            continue;
+         }
+
+         PriorityType priority = findPriority(iter->second);
+         if (pOldestConsumer == NULL || priority < oldestPriority ||
+            (priority == oldestPriority && accessTime < oldestAccess))
+         {
+            pOldestConsumer = iter->first;
+            oldestPriority = priority;
+            oldestAccess = accessTime;
+         }
+      }
+
+      if (pOldestConsumer == NULL)
+      {
+         break;
+      }
+
+      int64_t released = pOldestConsumer->releaseOldest();
+      if (released <= 0)
+      {
+         break;
+      }
+      usage -= released;
+   }
+}
+
+int64_t MemoryBudgetImp::getLimit() const
+{
+   return static_cast<int64_t>(getSettingCacheSize()) * 1024 * 1024;
+}
+
+int64_t MemoryBudgetImp::getUsage() const
+{
+   mta::MutexLock lock(mMutex);
+
+   int64_t usage = 0;
+   for (map<MemoryConsumer*, const DataElement*>::const_iterator iter = mConsumers.begin();
+      iter != mConsumers.end(); ++iter)
+   {
+      usage += iter->first->getMemoryUsage();
+   }
+   return usage;
+}
+
+int64_t MemoryBudgetImp::getUsage(const DataElement* pElement) const
+{
+   mta::MutexLock lock(mMutex);
+
+   int64_t usage = 0;
+   for (map<MemoryConsumer*, const DataElement*>::const_iterator iter = mConsumers.begin();
+      iter != mConsumers.end(); ++iter)
+   {
+      if (iter->second == pElement)
+      {
+         usage += iter->first->getMemoryUsage();
+      }
+   }
+   return usage;
+}
+
+void MemoryBudgetImp::setPriority(const DataElement* pElement, PriorityType priority, const void* pRequester)
+{
+   VERIFYNRV(pElement != NULL && priority.isValid());
+
+   {
+      mta::MutexLock lock(mMutex);
+      if (priority == PRIORITY_NORMAL)
+      {
+         map<const DataElement*, RequestMap>::iterator ppRequests = mPriorities.find(pElement);
+         if (ppRequests != mPriorities.end())
+         {
+            ppRequests->second.erase(pRequester);
+            if (ppRequests->second.empty())
+            {
+               mPriorities.erase(ppRequests);
+            }
+         }
+      }
+      else
+      {
+         mPriorities[pElement][pRequester] = priority;
+      }
+   }
+
+   // Lowering the priority of an element may make its memory the next to be released
+   update();
+}
+
+MemoryBudget::PriorityType MemoryBudgetImp::getPriority(const DataElement* pElement) const
+{
+   mta::MutexLock lock(mMutex);
+   return findPriority(pElement);
+}
+
+void MemoryBudgetImp::removeElement(const DataElement* pElement)
+{
+   mta::MutexLock lock(mMutex);
+   mPriorities.erase(pElement);
+}
+
+MemoryBudget::PriorityType MemoryBudgetImp::findPriority(const DataElement* pElement) const
+{
+   map<const DataElement*, RequestMap>::const_iterator ppRequests = mPriorities.find(pElement);
+   if (ppRequests == mPriorities.end())
+   {
+      return PRIORITY_NORMAL;
+   }
+
+   // A view displaying the element takes precedence over background processing of it
+   PriorityType priority = PRIORITY_BACKGROUND;
+   for (RequestMap::const_iterator iter = ppRequests->second.begin(); iter != ppRequests->second.end(); ++iter)
+   {
+      if (iter->second > priority)
+      {
+         priority = iter->second;
+      }
+   }
+   return priority;
+}
@@ -0,0 +1,56 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef MEMORYBUDGETIMP_H
+#define MEMORYBUDGETIMP_H
+
+#include "DMutex.h"
+#include "MemoryBudget.h"
+
+#include <boost/atomic.hpp>
+#include <map>
+
+class MemoryBudgetImp : public MemoryBudget
+{
+public:
+   MemoryBudgetImp();
+   ~MemoryBudgetImp();
+
+   void addConsumer(MemoryConsumer* pConsumer, const DataElement* pElement);
+   void removeConsumer(MemoryConsumer* pConsumer);
+   uint64_t getAccessTime();
+   void update();
+   int64_t getLimit() const;
+   int64_t getUsage() const;
+   int64_t getUsage(const DataElement* pElement) const;
+   void setPriority(const DataElement* pElement, PriorityType priority, const void* pRequester = NULL);
+   PriorityType getPriority(const DataElement* pElement) const;
+
+   /**
+    * Discards the priorities requested for an element which is being destroyed,
+    * so that they do not apply to a new element created at the same address.
+    */
+   void removeElement(const DataElement* pElement);
+
+private:
+   MemoryBudgetImp(const MemoryBudgetImp& rhs);
+   MemoryBudgetImp& operator=(const MemoryBudgetImp& rhs);
+
+   // Must be called with mMutex locked
+   PriorityType findPriority(const DataElement* pElement) const;
+
+   typedef std::map<const void*, PriorityType> RequestMap;
+
+   mutable mta::DMutex mMutex;
+   std::map<MemoryConsumer*, const DataElement*> mConsumers;
+   std::map<const DataElement*, RequestMap> mPriorities;
+   boost::atomic<uint64_t> mAccessTime;
+};
+
+#endif
@@ -36,6 +36,7 @@ MemoryMappedMatrix::MemoryMappedMatrix(const string& fileName, unsigned int head
                                        unsigned int rowNum, unsigned int columnNum, unsigned int bandNum,
                                        unsigned int interLineBytes, unsigned int interBandBytes, bool readOnly) :
    mFileName(fileName),
+   mpFileView(NULL),
    mInterleave(interleave),
    mBytesPerElement(bytesPerElement),
    mRowNum(rowNum),
@@ -109,6 +110,8 @@ MemoryMappedMatrix::MemoryMappedMatrix(const string& fileName, unsigned int head
 
 MemoryMappedMatrix::~MemoryMappedMatrix()
 {
+   delete mpFileView;
+
 #if defined(WIN_API)
    CloseHandle(mHandle);
    CloseHandle(mFileHandle);
@@ -131,3 +134,27 @@ void MemoryMappedMatrix::release(MemoryMappedMatrixView* pView)
 {
    mViews.erase(pView);
 }
+
+MemoryMappedMatrixView* MemoryMappedMatrix::getFileView(bool populate)
+{
+   if (mpFileView == NULL)
+   {
+      MemoryMappedMatrixView* pView = new MemoryMappedMatrixView(mHandle, mHeaderOffset, 0, mInterleave,
+         mBytesPerElement, mRowNum, mColumnNum, mBandNum, mInterLineBytes, mInterBandBytes, mReadOnly,
+         mGranularity, mFileSize);
+      if (pView->mapFile(populate) == NULL)
+      {
+         delete pView;
+         return NULL;
+      }
+
+      mpFileView = pView;
+   }
+
+   return mpFileView;
+}
+
+int64_t MemoryMappedMatrix::getFileSize() const
+{
+   return mFileSize;
+}
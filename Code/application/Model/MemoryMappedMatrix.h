@@ -40,6 +40,11 @@ public:
 
    void release(MemoryMappedMatrixView* pView);
 
+   // Returns a view of the entire file which is mapped the first time it is requested
+   // and remains mapped until the matrix is destroyed, or NULL if the file cannot be mapped
+   MemoryMappedMatrixView* getFileView(bool populate);
+   int64_t getFileSize() const;
+
 private:
    std::string mFileName;
 
@@ -55,6 +60,7 @@ private:
 #endif
 
    std::set<MemoryMappedMatrixView*> mViews;
+   MemoryMappedMatrixView* mpFileView;
 
    InterleaveFormatType mInterleave;
    unsigned int mBytesPerElement;
@@ -23,6 +23,7 @@
 #include "TypesFile.h"
 #include "MemoryMappedMatrixView.h"
 
+#include <algorithm>
 #include <string>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -120,6 +121,11 @@ unsigned char* MemoryMappedMatrixView::firstSegment()
 }
 
 unsigned char* MemoryMappedMatrixView::getSegment(unsigned int row, unsigned int column, unsigned int band)
+{
+   return getSegment(getOffset(row, column, band));
+}
+
+int64_t MemoryMappedMatrixView::getOffset(unsigned int row, unsigned int column, unsigned int band) const
 {
    int64_t start = 0;
 
@@ -145,7 +151,7 @@ unsigned char* MemoryMappedMatrixView::getSegment(unsigned int row, unsigned int
       start += mHeaderOffset;
    }
 
-   return getSegment(start);
+   return start;
 }
 
 unsigned char* MemoryMappedMatrixView::getSegment(int64_t address)
@@ -253,3 +259,77 @@ unsigned char *MemoryMappedMatrixView::getEndOfSegment() const
 {
    return (mpBlock == NULL) ? NULL : (mpBlock + mBlockSize);
 }
+
+unsigned char* MemoryMappedMatrixView::mapFile(bool populate)
+{
+   if (mpBlock != NULL)
+   {
+#if defined(WIN_API)
+      UnmapViewOfFile(mpBlock);
+#else
+      munmap(reinterpret_cast<char*>(mpBlock), mBlockSize);
+#endif
+      mpBlock = NULL;
+   }
+
+   mAddress = 0;
+   mAddressOffset = 0;
+   mBlockSize = static_cast<size_t>(mFileSize);
+   if (mBlockSize == 0 || static_cast<int64_t>(mBlockSize) != mFileSize)
+   {
+      return NULL;
+   }
+
+#if defined(WIN_API)
+   // Windows reads ahead for mapped views without being asked, so there is nothing to populate
+   mpBlock = static_cast<unsigned char*>(MapViewOfFile(mHandle, mAccessPermissions, 0, 0, 0));
+#else
+   int flags = MAP_SHARED;
+#if defined(MAP_POPULATE)
+   if (populate)
+   {
+      flags |= MAP_POPULATE;
+   }
+#endif
+   mpBlock = reinterpret_cast<unsigned char*>(mmap(static_cast<caddr_t>(0), mBlockSize,
+                  mAccessPermissions, flags, mHandle, 0));
+   if (mpBlock == reinterpret_cast<void*>(-1))
+   {
+      mpBlock = NULL;
+   }
+   else
+   {
+      // The advice covers the whole mapping and is not changed per page, which would split the mapping
+      madvise(reinterpret_cast<char*>(mpBlock), mBlockSize, MADV_SEQUENTIAL);
+   }
+#endif
+
+   return mpBlock;
+}
+
+unsigned char* MemoryMappedMatrixView::getPointer(unsigned int row, unsigned int column, unsigned int band) const
+{
+   int64_t offset = getOffset(row, column, band);
+   if (mpBlock == NULL || offset >= static_cast<int64_t>(mBlockSize))
+   {
+      return NULL;
+   }
+
+   return mpBlock + offset;
+}
+
+void MemoryMappedMatrixView::prefetch(const unsigned char* pAddress, size_t size) const
+{
+#if !defined(WIN_API)
+   if (mpBlock == NULL || pAddress < mpBlock || pAddress >= getEndOfSegment())
+   {
+      return;
+   }
+
+   // madvise() requires an address on a page boundary
+   size_t offset = static_cast<size_t>(pAddress - mpBlock);
+   size_t start = (offset / mGranularity) * mGranularity;
+   size = std::min(size + offset - start, mBlockSize - start);
+   madvise(reinterpret_cast<char*>(mpBlock + start), size, MADV_WILLNEED);
+#endif
+}
@@ -60,7 +60,17 @@ public:
 
    unsigned char *getEndOfSegment() const;
 
+   // Maps the entire file instead of a segment, after which getPointer() returns
+   // addresses in the mapping without mapping again.  The kernel is advised once
+   // that the mapping is read sequentially, since rows are mostly walked in order.
+   unsigned char* mapFile(bool populate);
+   unsigned char* getPointer(unsigned int row, unsigned int column, unsigned int band) const;
+   // Starts reading a range of the mapping which will be needed soon
+   void prefetch(const unsigned char* pAddress, size_t size) const;
+
 private:
+   int64_t getOffset(unsigned int row, unsigned int column, unsigned int band) const;
+
    bool mReadOnly;
    int mAccessPermissions;
 
@@ -10,6 +10,7 @@
 #include "AppVersion.h"
 #include "AppVerify.h"
 #include "DataRequest.h"
+#include "DecimatedPage.h"
 #include "DimensionDescriptor.h"
 #include "Endian.h"
 #include "EndianSwapPage.h"
@@ -25,15 +26,19 @@
 #include "RasterDataDescriptor.h"
 #include "RasterElement.h"
 #include "RasterFileDescriptor.h"
+#include "RasterUtilities.h"
+#include "switchOnEncoding.h"
 
 #include <algorithm>
+#include <memory>
 using namespace std;
 
 MemoryMappedPager::MemoryMappedPager() :
    mbUseDataDescriptor(true),
    mpDataDescriptor(NULL),
    mSwapEndian(false),
-   mWritable(false)
+   mWritable(false),
+   mWholeFile(false)
 {
    setName("MemoryMappedPager");
    setCopyright("Copyright (2005) by Ball Aerospace & Technologies Corp.");
@@ -278,6 +283,16 @@ bool MemoryMappedPager::execute(PlugInArgList* pInputArgList, PlugInArgList* pOu
    } 
    VERIFY(!mMatrices.empty());
 
+   // Map read-only data once so that pages do not need a mapping of their own, as long as
+   // the address space is large enough to hold the whole file
+   mWholeFile = (mWritable == false && sizeof(void*) >= 8 && MemoryMappedPager::getSettingWholeFileMapping());
+   for (vector<MemoryMappedMatrix*>::iterator iter = mMatrices.begin(); iter != mMatrices.end() && mWholeFile; ++iter)
+   {
+      MemoryMappedMatrix* pMatrix = *iter;
+      bool populate = (pMatrix->getFileSize() <= static_cast<int64_t>(MemoryMappedPager::getSettingPopulateSize()));
+      mWholeFile = (pMatrix->getFileView(populate) != NULL);
+   }
+
    return true;
 }
 
@@ -294,7 +309,8 @@ RasterPage* MemoryMappedPager::getPage(DataRequest* pOriginalRequest, DimensionD
       return NULL;
    }
 
-   mta::MutexLock mutex(mMutex);
+   // Whole-file mappings are not changed after execute(), so only segment mappings need the lock
+   auto_ptr<mta::MutexLock> pMutex(mWholeFile ? NULL : new mta::MutexLock(mMutex));
 
    InterleaveFormatType interleave;
    unsigned int numBands = 0;
@@ -398,15 +414,111 @@ RasterPage* MemoryMappedPager::getPage(DataRequest* pOriginalRequest, DimensionD
       pMatrix = mMatrices[bandIndex];
    }
    VERIFYRV(pMatrix != NULL, NULL);
-   pView = pMatrix->getView(segmentSize);
-   VERIFYRV(pView != NULL, NULL);
 
-   //ask the MemoryMappedMatrixView for a pointer starting
-   //at the given location
+   if (pOriginalRequest->getRequestVersion(mpDataDescriptor) > 1)
+   {
+      // Map and copy only the sampled rows so that the skipped rows are never read from disk
+      std::auto_ptr<DecimatedPage> pPage(new DecimatedPage(pOriginalRequest, startRow, startColumn, startBand,
+         0, bytesPerElement));
+      if (pPage->getNumRows() == 0)
+      {
+         return NULL;
+      }
+
+      size_t columnPitch = bytesPerElement;
+      size_t bandPitch = 0;
+      if (interleave == BIP)
+      {
+         columnPitch = static_cast<size_t>(numBands) * bytesPerElement;
+         bandPitch = bytesPerElement;
+      }
+      else if (interleave == BIL)
+      {
+         bandPitch = static_cast<size_t>(numColumns) * bytesPerElement;
+      }
+
+      unsigned int matrixBand = (mMatrices.size() > 1) ? 0 : bandIndex;
+      pView = mWholeFile ? pMatrix->getFileView(false) : pMatrix->getView(rowSize);
+      VERIFYRV(pView != NULL, NULL);
+      for (unsigned int row = 0; row < pPage->getNumRows(); ++row)
+      {
+         unsigned int sourceRow = pPage->getSourceRow(row) + offsetRow;
+         unsigned int sourceColumn = startColumn.getActiveNumber() + offsetCol;
+         unsigned char* pSrc = mWholeFile ? pView->getPointer(sourceRow, sourceColumn, matrixBand) :
+            pView->getSegment(sourceRow, sourceColumn, matrixBand);
+         if (pSrc == NULL)
+         {
+            if (mWholeFile == false)
+            {
+               pMatrix->release(pView);
+            }
+            return NULL;
+         }
+
+         pPage->copyRow(row, pSrc, columnPitch, bandPitch);
+      }
+      if (mWholeFile == false)
+      {
+         pMatrix->release(pView);
+      }
+
+      if (mSwapEndian)
+      {
+         EncodingType encoding = mpDataDescriptor->getDataType();
+         Endian endian;
+         switchOnComplexEncoding(encoding, endian.swapBuffer, pPage->getRawData(),
+            pPage->getNumRows() * pPage->getNumColumns() * pPage->getNumBands() * bytesPerElement /
+            RasterUtilities::bytesInEncoding(encoding));
+      }
+
+      return pPage.release();
+   }
+
    if (mMatrices.size() > 1)
    {
       bandIndex = 0;
    }
+
+   if (mWholeFile)
+   {
+      pView = pMatrix->getFileView(false);
+      VERIFYRV(pView != NULL, NULL);
+
+      unsigned char* pData = pView->getPointer(startRow.getActiveNumber() + offsetRow,
+         startColumn.getActiveNumber() + offsetCol, bandIndex);
+      if (pData == NULL)
+      {
+         return NULL;
+      }
+
+      // Start reading the next page of a row walk while this one is being processed
+      unsigned int stopRow = pOriginalRequest->getStopRow().getActiveNumber();
+      unsigned int nextRow = startRow.getActiveNumber() + concurrentRows;
+      if (nextRow <= stopRow)
+      {
+         pView->prefetch(pData + segmentSize, min(concurrentRows, stopRow - nextRow + 1) * rowSize);
+      }
+
+      if (mSwapEndian)
+      {
+         return new EndianSwapPage(pData, mpDataDescriptor->getDataType(), numRows, numColumns,
+            rowSize - interlineBytes, interlineBytes, pView->getEndOfSegment());
+      }
+
+      // The page is not leased since the mapping outlives it
+      MemoryMappedPage* pPage = new MemoryMappedPage;
+      pPage->setRawData(reinterpret_cast<char*>(pData));
+      pPage->setNumRows(numRows);
+      pPage->setNumColumns(numColumns);
+      pPage->setInterlineBytes(interlineBytes);
+      return pPage;
+   }
+
+   pView = pMatrix->getView(segmentSize);
+   VERIFYRV(pView != NULL, NULL);
+
+   //ask the MemoryMappedMatrixView for a pointer starting
+   //at the given location
    char* pRawCubePointer = reinterpret_cast<char*>(pView->getSegment(startRow.getActiveNumber() + offsetRow,
                                                    startColumn.getActiveNumber() + offsetCol, bandIndex));
    if (pRawCubePointer == NULL)
@@ -445,15 +557,25 @@ void MemoryMappedPager::releasePage(RasterPage* pPage)
 {
    VERIFYNRV(pPage != NULL);
 
-   //ensure only one thread enters this code at a time
-   mta::MutexLock mutex(mMutex);
-
-   if (mSwapEndian)
+   DecimatedPage* pDecimatedPage = dynamic_cast<DecimatedPage*>(pPage);
+   if (pDecimatedPage != NULL)
+   {
+      delete pDecimatedPage;
+   }
+   else if (mSwapEndian)
    {
       delete static_cast<EndianSwapPage*>(pPage);
    }
+   else if (mWholeFile)
+   {
+      // The page only points into the whole-file mapping
+      delete static_cast<MemoryMappedPage*>(pPage);
+   }
    else
    {
+      //ensure only one thread enters this code at a time
+      mta::MutexLock mutex(mMutex);
+
       MemoryMappedPage* pOurPage = static_cast<MemoryMappedPage*>(pPage);
 
       map<MemoryMappedPage*, MemoryMappedMatrix*>::iterator foundIter;
@@ -479,5 +601,5 @@ void MemoryMappedPager::releasePage(RasterPage* pPage)
 
 int MemoryMappedPager::getSupportedRequestVersion() const
 {
-   return 1;
+   return 2;
 }
@@ -12,6 +12,7 @@
 #ifndef MEMORYMAPPEDPAGER_H
 #define MEMORYMAPPEDPAGER_H
 
+#include "ConfigurationSettings.h"
 #include "RasterPagerShell.h"
 #include "DMutex.h"
 
@@ -22,9 +23,24 @@ class RasterDataDescriptor;
 class MemoryMappedPage;
 class MemoryMappedMatrix;
 
+/**
+ * Provides pages which point into a memory mapping of the file.
+ *
+ * Data which is read-only is mapped once in its entirety when the WholeFileMapping
+ * setting is enabled and the process has a 64-bit address space.  Each page is then
+ * a pointer into the mapping, so no mapping is created or locked for each page.
+ * The kernel is advised once that the mapping is read sequentially, and the next
+ * page of a row walk is prefetched while the current page is processed.  Files no
+ * larger than the PopulateSize setting are read into memory when they are mapped.
+ *
+ * Otherwise, a segment of the file is mapped for each page.
+ */
 class MemoryMappedPager : public RasterPagerShell
 {
 public:
+   SETTING(WholeFileMapping, MemoryMappedPager, bool, true)
+   SETTING(PopulateSize, MemoryMappedPager, unsigned int, 0)
+
    MemoryMappedPager();
    ~MemoryMappedPager();
 
@@ -56,6 +72,7 @@ private:
    mta::DMutex                           mMutex;
 
    bool mWritable;
+   bool mWholeFile;
 };
 
 #endif
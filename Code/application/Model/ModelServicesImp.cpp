@@ -775,6 +775,9 @@ bool ModelServicesImp::destroyElement(DataElement* pElement)
       {
          notify(SIGNAL_NAME(ModelServices, ElementDestroyed), boost::any(pElement));
          delete pElementImp;
+
+         // Do not apply the priorities of the element to a new element at the same address
+         mMemoryBudget.removeElement(pElement);
       }
    }
 
@@ -802,23 +805,22 @@ void ModelServicesImp::clear()
 
 char* ModelServicesImp::getMemoryBlock(size_t size)
 {
-   if (size == 0)
-   {
-      return NULL;
-   }
+   return mMemoryArena.allocate(size);
+}
 
-   char* pBlock = new (nothrow) char[size];
-   if (pBlock != NULL)
-   {
-      memset(pBlock, 0, size);
-   }
+void ModelServicesImp::deleteMemoryBlock(char* memory)
+{
+   mMemoryArena.deallocate(memory);
+}
 
-   return pBlock;
+MemoryArena* ModelServicesImp::getMemoryArena()
+{
+   return &mMemoryArena;
 }
 
-void ModelServicesImp::deleteMemoryBlock(char* memory)
+MemoryBudget* ModelServicesImp::getMemoryBudget()
 {
-   delete [] memory;
+   return &mMemoryBudget;
 }
 
 bool ModelServicesImp::isKindOfElement(const string& className, const string& elementName) const
@@ -13,6 +13,8 @@
 #include <xercesc/dom/DOM.hpp>
 
 #include "DataElement.h"
+#include "MemoryArenaImp.h"
+#include "MemoryBudgetImp.h"
 #include "ModelServices.h"
 #include "SettableSessionItemAdapter.h"
 #include "StringUtilities.h"
@@ -71,6 +73,8 @@ public:
 
    char* getMemoryBlock(size_t size);
    void deleteMemoryBlock(char* memory); 
+   MemoryArena* getMemoryArena();
+   MemoryBudget* getMemoryBudget();
 
    bool isKindOfElement(const std::string& className, const std::string& elementName) const;
    void getElementTypes(const std::string& className, std::vector<std::string>& classList) const;
@@ -151,6 +155,8 @@ private:
    static bool mDestroyed;
    std::vector<std::string> mElementTypes;
    std::multimap<Key, DataElement*> mElements;
+   MemoryArenaImp mMemoryArena;
+   MemoryBudgetImp mMemoryBudget;
 
    std::multimap<Key, DataElement*>::iterator findElement(const DataElement* pElement);
    std::multimap<Key, DataElement*>::iterator findElement(const Key& key, const std::string& type);
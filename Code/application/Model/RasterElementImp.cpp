@@ -10,10 +10,14 @@
 #include "AppConfig.h"
 #include "AppVerify.h"
 #include "BadValues.h"
+#include "CompressedMemoryPager.h"
 #include "ConfigurationSettings.h"
+#include "ConvertedPageCache.h"
 #include "ConvertToBilPager.h"
 #include "ConvertToBipPager.h"
 #include "ConvertToBsqPager.h"
+#include "ConvertToTypePager.h"
+#include "DecimatingPager.h"
 #include "DataAccessorImpl.h"
 #include "DataRequest.h"
 #include "DimensionDescriptor.h"
@@ -43,10 +47,12 @@
 #include "StatisticsImp.h"
 #include "xmlwriter.h"
 
+#include <algorithm>
 #include <fstream>
 #include <limits>
 #include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/tuple/tuple.hpp>
 using namespace std;
 XERCES_CPP_NAMESPACE_USE
 
@@ -160,6 +166,9 @@ RasterElementImp::RasterElementImp(const DataDescriptorImp& descriptor, const st
    mpBipConverterPager(NULL),
    mpBilConverterPager(NULL),
    mpBsqConverterPager(NULL),
+   mpDecimatingPager(NULL),
+   mpTypeConverterPager(NULL),
+   mpConvertedPageCache(new ConvertedPageCache),
    mCubePointerAccessor(NULL, NULL),
    mModified(false),
    mpGeoPlugin(NULL)
@@ -273,6 +282,14 @@ RasterElementImp::RasterElementImp(const DataDescriptorImp& descriptor, const st
 
 RasterElementImp::~RasterElementImp()
 {
+   // Destroy the statistics first to stop any statistics being refined in the background from reading the data
+   for (map<DimensionDescriptor, StatisticsImp*>::iterator iter = mStatistics.begin();
+      iter != mStatistics.end(); ++iter)
+   {
+      delete iter->second;
+   }
+   mStatistics.clear();
+
    if (mpTerrain.get() != NULL)
    {
       RasterElement* pTerrain = mpTerrain.get();
@@ -284,6 +301,9 @@ RasterElementImp::~RasterElementImp()
    delete mpBipConverterPager;
    delete mpBilConverterPager;
    delete mpBsqConverterPager;
+   delete mpDecimatingPager;
+   delete mpTypeConverterPager;
+   delete mpConvertedPageCache;
 
    Service<PlugInManagerServices> pPluginManager;
    if (mpPager != NULL)
@@ -300,12 +320,6 @@ RasterElementImp::~RasterElementImp()
    {
       pPluginManager->destroyPlugIn(dynamic_cast<PlugIn*>(mpGeoPlugin));
    }
-
-   for (map<DimensionDescriptor, StatisticsImp*>::iterator iter = mStatistics.begin();
-      iter != mStatistics.end(); ++iter)
-   {
-      delete iter->second;
-   }
 }
 
 double RasterElementImp::getPixelValue(DimensionDescriptor columnDim, DimensionDescriptor rowDim,
@@ -356,10 +370,63 @@ void RasterElementImp::updateData()
       }
    }
 
+   // Pages converted to another interleave no longer match the data
+   mpConvertedPageCache->clear();
+
    mModified = true;
    notify(SIGNAL_NAME(RasterElement, DataModified));
 }
 
+void RasterElementImp::updateDataRegion(DimensionDescriptor startRow, DimensionDescriptor stopRow,
+                                        DimensionDescriptor startColumn, DimensionDescriptor stopColumn,
+                                        const vector<DimensionDescriptor>& bands)
+{
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(getDataDescriptor());
+   VERIFYNRV(pDescriptor != NULL);
+
+   unsigned int rowCount = pDescriptor->getRowCount();
+   unsigned int columnCount = pDescriptor->getColumnCount();
+   VERIFYNRV(rowCount > 0 && columnCount > 0);
+
+   if (startRow.isActiveNumberValid() == false)
+   {
+      startRow = pDescriptor->getActiveRow(0);
+   }
+   if (stopRow.isActiveNumberValid() == false)
+   {
+      stopRow = pDescriptor->getActiveRow(rowCount - 1);
+   }
+   if (startColumn.isActiveNumberValid() == false)
+   {
+      startColumn = pDescriptor->getActiveColumn(0);
+   }
+   if (stopColumn.isActiveNumberValid() == false)
+   {
+      stopColumn = pDescriptor->getActiveColumn(columnCount - 1);
+   }
+   VERIFYNRV(startRow.getActiveNumber() <= stopRow.getActiveNumber() && stopRow.getActiveNumber() < rowCount);
+   VERIFYNRV(startColumn.getActiveNumber() <= stopColumn.getActiveNumber() &&
+      stopColumn.getActiveNumber() < columnCount);
+
+   // The statistics of the bands which have not changed are still valid
+   map<DimensionDescriptor, StatisticsImp*>::iterator iter;
+   for (iter = mStatistics.begin(); iter != mStatistics.end(); ++iter)
+   {
+      StatisticsImp* pStatistics = iter->second;
+      if (pStatistics != NULL && (bands.empty() || find(bands.begin(), bands.end(), iter->first) != bands.end()))
+      {
+         pStatistics->resetAll();
+      }
+   }
+
+   // Pages converted to another interleave no longer match the data
+   mpConvertedPageCache->clear();
+
+   mModified = true;
+   notify(SIGNAL_NAME(RasterElement, DataModified), boost::any(boost::make_tuple(startRow, stopRow, startColumn,
+      stopColumn, bands)));
+}
+
 uint64_t RasterElementImp::sanitizeData(double value)
 {
    uint64_t badValueCount = 0;
@@ -426,6 +493,17 @@ uint64_t RasterElementImp::sanitizeData(double value)
    return badValueCount;
 }
 
+bool RasterElementImp::isDataModified() const
+{
+   return mModified;
+}
+
+void RasterElementImp::statisticsRefined(Statistics* pStatistics) const
+{
+   const_cast<RasterElementImp*>(this)->notify(SIGNAL_NAME(RasterElement, StatisticsRefined),
+      boost::any(pStatistics));
+}
+
 void RasterElementImp::setTerrain(RasterElement* pTerrain)
 {
    if (pTerrain != mpTerrain.get())
@@ -559,11 +637,20 @@ RasterElement *RasterElementImp::createChip(DataElement *pParent, const string &
    return createChipInternal(pParent, name, selectedRows, selectedColumns, selectedBands);
 }
 
+RasterElement* RasterElementImp::createVirtualChip(DataElement* pParent, const string& appendName,
+                                                   const vector<DimensionDescriptor>& selectedRows,
+                                                   const vector<DimensionDescriptor>& selectedColumns,
+                                                   const vector<DimensionDescriptor>& selectedBands) const
+{
+   string name = appendToBasename(getName(), appendName);
+   return createChipInternal(pParent, name, selectedRows, selectedColumns, selectedBands, true, true);
+}
+
 RasterElement* RasterElementImp::createChipInternal(DataElement* pParent, const string& name,
                                                     const vector<DimensionDescriptor>& selectedRows,
                                                     const vector<DimensionDescriptor>& selectedColumns,
                                                     const vector<DimensionDescriptor>& selectedBands,
-                                                    bool copyRasterData) const
+                                                    bool copyRasterData, bool virtualChip) const
 {
    const RasterDataDescriptorImp* pDescriptor = dynamic_cast<const RasterDataDescriptorImp*>(getDataDescriptor());
    VERIFYRV(pDescriptor != NULL, NULL);
@@ -670,13 +757,18 @@ RasterElement* RasterElementImp::createChipInternal(DataElement* pParent, const
       pRasterChip->getDataDescriptor());
    VERIFYRV(pChipDescriptor != NULL, NULL);
 
-   pRasterChip->createDefaultPager();
+   // A virtual chip reads its data from this element, so it needs no pager of its own
+   bool virtualPager = virtualChip && createVirtualChipPager(pRasterChip.get());
+   if (virtualPager == false)
+   {
+      pRasterChip->createDefaultPager();
+   }
 
    bool abort = false;
    VERIFYRV(RasterUtilities::chipMetadata(pRasterChip->getMetadata(), *pSelectedRows, *pSelectedCols,
       *pSelectedBands), NULL);
 
-   if (copyRasterData)
+   if (copyRasterData && virtualPager == false)
    {
       VERIFYRV(copyDataToChip(pRasterChip.get(), *pSelectedRows, *pSelectedCols, *pSelectedBands, abort), NULL);
    }
@@ -1299,6 +1391,7 @@ bool RasterElementImp::setPager(RasterPager* pPager)
 
    //re-assign the pointers to hold onto the new plug-ins.
    mpPager = pPager;
+   mpConvertedPageCache->clear();
 
    return true;
 }
@@ -1308,6 +1401,14 @@ RasterPager* RasterElementImp::getPager() const
    return mpPager;
 }
 
+RasterPager* RasterElementImp::detachPager()
+{
+   RasterPager* pPager = mpPager;
+   mpPager = NULL;
+   mpConvertedPageCache->clear();
+   return pPager;
+}
+
 const string& RasterElementImp::getTemporaryFilename() const
 {
    return mTempFilename;
@@ -1560,15 +1661,15 @@ void RasterElementImp::incrementDataAccessor(DataAccessorImpl& da)
       da.mpRasterPager->releasePage(da.mpRasterPage);
    }
 
-   //update the DataAccessor properties
-   da.mAccessorRow += da.mCurrentRow;
+   //update the DataAccessor properties, the column is left alone
+   //so that a tile-walking accessor stays within its tile column
+   da.mAccessorRow += da.mCurrentRow * da.mRowStride;
    da.mCurrentRow = 0;
-   da.mAccessorColumn = da.mpRequest->getStartColumn().getActiveNumber();
    da.mAccessorBand = da.mpRequest->getStartBand().getActiveNumber();
 
    //get a new raster page loaded into memory,
    //the only thing different from the previous page that we requested
-   //should be the startRow.
+   //should be the startRow, or the startRow and startColumn for nextTile().
 
    //request the same number of concurrentRows, cols, and bands
    //that we originally requested in the getDataAccessor()
@@ -1614,7 +1715,7 @@ void RasterElementImp::incrementDataAccessor(DataAccessorImpl& da)
          da.mConcurrentRows = pPage->getNumRows();
          da.mConcurrentColumns = numBlockColumns;
          da.mConcurrentBands = numBlockBands;
-         da.updateDataSizes(pDescriptor->getBytesPerElement(), numBlockInterlineBytes);
+         da.updateDataSizes(da.mElementSize, numBlockInterlineBytes);
       }
    }
    else
@@ -1681,7 +1782,8 @@ DataAccessor RasterElementImp::getDataAccessor(DataRequest* pRequestIn)
    {
       if (mpBipConverterPager == NULL)
       {
-         mpBipConverterPager = new ConvertToBipPager(dynamic_cast<RasterElement*>(this));
+         mpConvertedPageCache->setElement(dynamic_cast<RasterElement*>(this));
+         mpBipConverterPager = new ConvertToBipPager(dynamic_cast<RasterElement*>(this), mpConvertedPageCache);
       }
       pPager = mpBipConverterPager;
    }
@@ -1689,7 +1791,8 @@ DataAccessor RasterElementImp::getDataAccessor(DataRequest* pRequestIn)
    {
       if (mpBsqConverterPager == NULL)
       {
-         mpBsqConverterPager = new ConvertToBsqPager(dynamic_cast<RasterElement*>(this));
+         mpConvertedPageCache->setElement(dynamic_cast<RasterElement*>(this));
+         mpBsqConverterPager = new ConvertToBsqPager(dynamic_cast<RasterElement*>(this), mpConvertedPageCache);
       }
       pPager = mpBsqConverterPager;
    }
@@ -1697,7 +1800,8 @@ DataAccessor RasterElementImp::getDataAccessor(DataRequest* pRequestIn)
    {
       if (mpBilConverterPager == NULL)
       {
-         mpBilConverterPager = new ConvertToBilPager(dynamic_cast<RasterElement*>(this));
+         mpConvertedPageCache->setElement(dynamic_cast<RasterElement*>(this));
+         mpBilConverterPager = new ConvertToBilPager(dynamic_cast<RasterElement*>(this), mpConvertedPageCache);
       }
       pPager = mpBilConverterPager;
    }
@@ -1711,9 +1815,41 @@ DataAccessor RasterElementImp::getDataAccessor(DataRequest* pRequestIn)
       return DataAccessor(NULL, NULL);
    }
 
-   if (pPager->getSupportedRequestVersion() < pRequest->getRequestVersion(pDescriptor))
+   int requestVersion = pRequest->getRequestVersion(pDescriptor);
+   if (pPager->getSupportedRequestVersion() < requestVersion)
    {
-      return DataAccessor(NULL, NULL);
+      if (requestVersion == 3)
+      {
+         // Convert the pages of an accessor in the native data type
+         if (mpTypeConverterPager == NULL)
+         {
+            mpTypeConverterPager = new ConvertToTypePager(dynamic_cast<RasterElement*>(this));
+         }
+         pPager = mpTypeConverterPager;
+      }
+      else if (pPager == mpPager && requestVersion == 2)
+      {
+         // Decimate the full pages of a pager which does not support strides
+         if (mpDecimatingPager == NULL)
+         {
+            mpDecimatingPager = new DecimatingPager(dynamic_cast<RasterElement*>(this));
+         }
+         pPager = mpDecimatingPager;
+      }
+      else
+      {
+         return DataAccessor(NULL, NULL);
+      }
+   }
+
+   EncodingType dataType = pRequest->getDataType();
+   if (dataType.isValid())
+   {
+      bytesPerElement = RasterUtilities::bytesInEncoding(dataType);
+   }
+   else
+   {
+      dataType = pDescriptor->getDataType();
    }
 
    //request that the data be mapped from the file on disk into memory.
@@ -1761,7 +1897,7 @@ DataAccessor RasterElementImp::getDataAccessor(DataRequest* pRequestIn)
          pImpl->mpRasterPage = pPage;
          pImpl->mpRasterPager = pPager;
 
-         switch (pDescriptor->getDataType())
+         switch (dataType)
          {
          case INT1SBYTE:
             pImpl->mConvertToDoubleFunc = convert_s1byte_to_double;
@@ -1939,6 +2075,56 @@ bool RasterElementImp::createInMemoryPager(void* pData, bool bOwner)
    return true;
 }
 
+bool RasterElementImp::createVirtualChipPager(RasterElement* pChip) const
+{
+   VERIFY(pChip != NULL);
+   if (mpPager == NULL)
+   {
+      return false;
+   }
+
+   ExecutableResource pPlugin("Virtual Chip Pager");
+   VERIFY(pPlugin->getPlugIn() != NULL);
+
+   RasterPager* pPager = dynamic_cast<RasterPager*>(pPlugin->getPlugIn());
+   VERIFY(pPager != NULL);
+
+   RasterElement* pSource = const_cast<RasterElement*>(dynamic_cast<const RasterElement*>(this));
+   VERIFY(pPlugin->getInArgList().setPlugInArgValue("Raster Element", pChip));
+   VERIFY(pPlugin->getInArgList().setPlugInArgValue("Source Element", pSource));
+   if (!pPlugin->execute())
+   {
+      return false;
+   }
+
+   VERIFY(pChip->setPager(pPager));
+
+   pPlugin->releasePlugIn();
+
+   return true;
+}
+
+bool RasterElementImp::createCompressedMemoryPager()
+{
+   ExecutableResource pPlugin("Compressed Memory Pager");
+   VERIFY(pPlugin->getPlugIn() != NULL);
+
+   RasterPager* pPager = dynamic_cast<RasterPager*>(pPlugin->getPlugIn());
+   VERIFY(pPager != NULL);
+
+   VERIFY(pPlugin->getInArgList().setPlugInArgValue("Raster Element", dynamic_cast<RasterElement*>(this)));
+   if (!pPlugin->execute())
+   {
+      return false;
+   }
+
+   VERIFY(setPager(pPager));
+
+   pPlugin->releasePlugIn();
+
+   return true;
+}
+
 bool RasterElementImp::createDefaultPager()
 {
    if (mpPager != NULL)
@@ -1958,6 +2144,11 @@ bool RasterElementImp::createDefaultPager()
          uint64_t numBands = pDescriptor->getBandCount();
          unsigned int bytesPerElement = pDescriptor->getBytesPerElement();
 
+         if (CompressedMemoryPager::getSettingEnabled())
+         {
+            return createCompressedMemoryPager();
+         }
+
          uint64_t dataSize = numRows * numColumns * numBands * bytesPerElement;
          if (dataSize <= numeric_limits<size_t>::max())
          {
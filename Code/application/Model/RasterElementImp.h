@@ -22,6 +22,8 @@
 #include <boost/any.hpp>
 #include <vector>
 
+class ConvertedPageCache;
+
 class RasterElementImp : public DataElementImp
 {
 public:
@@ -36,8 +38,17 @@ public:
 
    virtual void incrementDataAccessor(DataAccessorImpl &da);
    virtual void updateData();
+   virtual void updateDataRegion(DimensionDescriptor startRow, DimensionDescriptor stopRow,
+      DimensionDescriptor startColumn, DimensionDescriptor stopColumn,
+      const std::vector<DimensionDescriptor>& bands = std::vector<DimensionDescriptor>());
    virtual uint64_t sanitizeData(double value = 0.0);
 
+   // Returns true if the data or bad values have changed since the element was created
+   bool isDataModified() const;
+
+   // Notifies signalStatisticsRefined() for the statistics of a band which were refined in the background
+   void statisticsRefined(Statistics* pStatistics) const;
+
 
    void setTerrain(RasterElement* pTerrain);
    const RasterElement* getTerrain() const;
@@ -48,6 +59,9 @@ public:
       const std::vector<DimensionDescriptor>& selectedRows,
       const std::vector<DimensionDescriptor>& selectedColumns,
       const std::vector<DimensionDescriptor>& selectedBands = std::vector<DimensionDescriptor>()) const;
+   RasterElement* createVirtualChip(DataElement* pParent, const std::string& appendName,
+      const std::vector<DimensionDescriptor>& selectedRows, const std::vector<DimensionDescriptor>& selectedColumns,
+      const std::vector<DimensionDescriptor>& selectedBands = std::vector<DimensionDescriptor>()) const;
    DataElement *copy(const std::string &name, DataElement *pParent) const;
    virtual RasterElement* copyShallow(const std::string& name, DataElement* pParent) const;
 
@@ -57,6 +71,8 @@ public:
    bool createInMemoryPager(void* pData, bool bOwner = true);
    bool setPager(RasterPager* pPager);
    RasterPager* getPager() const;
+   // Gives the pager to the caller, who destroys it, so that pages which are still held can outlive the element
+   RasterPager* detachPager();
 
    const std::string& getTemporaryFilename() const;
    bool serialize(SessionItemSerializer& serializer) const;
@@ -102,7 +118,8 @@ protected:
       const std::vector<DimensionDescriptor>& selectedRows,
       const std::vector<DimensionDescriptor>& selectedColumns,
       const std::vector<DimensionDescriptor>& selectedBands = std::vector<DimensionDescriptor>(),
-      bool copyRasterData = true) const;
+      bool copyRasterData = true, bool virtualChip = false) const;
+   bool createVirtualChipPager(RasterElement* pChip) const;
 
    bool createMemoryMappedPager(bool bUseDataDescriptor);
 
@@ -175,6 +192,8 @@ protected:
 private:
    RasterElementImp(const RasterElementImp& rhs);
    RasterElementImp& operator=(const RasterElementImp& rhs);
+   bool createCompressedMemoryPager();
+
    SafePtr<RasterElement> mpTerrain;
    std::map<DimensionDescriptor, StatisticsImp*> mStatistics;
 
@@ -184,6 +203,9 @@ private:
    RasterPager* mpBipConverterPager;
    RasterPager* mpBilConverterPager;
    RasterPager* mpBsqConverterPager;
+   RasterPager* mpDecimatingPager;
+   RasterPager* mpTypeConverterPager;
+   ConvertedPageCache* mpConvertedPageCache;
 
    DataAccessor mCubePointerAccessor;
 
@@ -218,6 +240,12 @@ private:
    { \
       return impClass::updateData(); \
    } \
+   void updateDataRegion(DimensionDescriptor startRow, DimensionDescriptor stopRow, \
+      DimensionDescriptor startColumn, DimensionDescriptor stopColumn, \
+      const std::vector<DimensionDescriptor>& bands = std::vector<DimensionDescriptor>()) \
+   { \
+      return impClass::updateDataRegion(startRow, stopRow, startColumn, stopColumn, bands); \
+   } \
    virtual uint64_t sanitizeData(double value = 0.0) \
    { \
       return impClass::sanitizeData(value); \
@@ -246,6 +274,13 @@ private:
    { \
       return impClass::createChip(pParent, appendName, selectedRows, selectedColumns, selectedBands); \
    } \
+   RasterElement* createVirtualChip(DataElement* pParent, const std::string& appendName, \
+      const std::vector<DimensionDescriptor>& selectedRows, \
+      const std::vector<DimensionDescriptor>& selectedColumns, \
+      const std::vector<DimensionDescriptor>& selectedBands = std::vector<DimensionDescriptor>()) const \
+   { \
+      return impClass::createVirtualChip(pParent, appendName, selectedRows, selectedColumns, selectedBands); \
+   } \
    bool createTemporaryFile() \
    { \
       return impClass::createTemporaryFile(); \
@@ -0,0 +1,594 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppConfig.h"
+#include "AppVerify.h"
+#include "AppVersion.h"
+#include "DataRequest.h"
+#include "DimensionDescriptor.h"
+#include "Endian.h"
+#include "Filename.h"
+#include "ObjectResource.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterFileDescriptor.h"
+#include "RasterUtilities.h"
+#include "RawFilePager.h"
+#include "switchOnEncoding.h"
+
+#include <algorithm>
+#include <new>
+#include <string.h>
+
+#if defined(WIN_API)
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+   // Unbuffered reads must start on a sector boundary, into a buffer on a sector boundary,
+   // and be a whole number of sectors
+   const size_t sAlignment = 4096;
+
+   // Finds the row, column or band of the file for each active dimension
+   bool getFileIndices(const vector<DimensionDescriptor>& activeDims, const vector<DimensionDescriptor>& fileDims,
+      vector<unsigned int>& indices)
+   {
+      indices.clear();
+      if (activeDims.empty() || fileDims.empty())
+      {
+         return false;
+      }
+
+      unsigned int firstOnDiskNumber = fileDims.front().getOnDiskNumber();
+      for (vector<DimensionDescriptor>::const_iterator iter = activeDims.begin(); iter != activeDims.end(); ++iter)
+      {
+         if (iter->isOnDiskNumberValid() == false || iter->getOnDiskNumber() < firstOnDiskNumber)
+         {
+            return false;
+         }
+
+         unsigned int index = iter->getOnDiskNumber() - firstOnDiskNumber;
+         if (index >= fileDims.size() || (indices.empty() == false && index <= indices.back()))
+         {
+            return false;
+         }
+
+         indices.push_back(index);
+      }
+
+      return true;
+   }
+
+   bool isContiguous(const vector<unsigned int>& indices)
+   {
+      return indices.back() - indices.front() + 1 == indices.size();
+   }
+}
+
+/**
+ * A block of the file read with a single positioned read.
+ */
+class RawFilePager::BlockBuffer
+{
+public:
+   BlockBuffer(size_t capacity) :
+      mpStorage(new (nothrow) char[capacity + sAlignment], 0, true),
+      mpData(NULL),
+      mCapacity(capacity),
+      mStart(0),
+      mSize(0)
+   {
+      if (mpStorage.get() != NULL)
+      {
+         size_t address = reinterpret_cast<size_t>(mpStorage.get());
+         mpData = mpStorage.get() + (sAlignment - address % sAlignment) % sAlignment;
+      }
+   }
+
+   const char* getData() const
+   {
+      return mpData;
+   }
+
+   size_t getCapacity() const
+   {
+      return mCapacity;
+   }
+
+   int64_t getStart() const
+   {
+      return mStart;
+   }
+
+   size_t getSize() const
+   {
+      return mSize;
+   }
+
+   void clear()
+   {
+      mStart = 0;
+      mSize = 0;
+   }
+
+   bool contains(int64_t offset) const
+   {
+      return offset >= mStart && offset < mStart + static_cast<int64_t>(mSize);
+   }
+
+   bool read(HANDLE_TYPE handle, int64_t start, size_t size)
+   {
+      mStart = start;
+      mSize = 0;
+      if (mpData == NULL)
+      {
+         return false;
+      }
+
+      size = min(size, mCapacity);
+#if defined(WIN_API)
+      // A read at an explicit offset does not use the file pointer, so threads can read at the same time
+      OVERLAPPED overlapped;
+      memset(&overlapped, 0, sizeof(overlapped));
+      overlapped.Offset = static_cast<DWORD>(start & 0xFFFFFFFF);
+      overlapped.OffsetHigh = static_cast<DWORD>(start >> 32);
+
+      DWORD count = 0;
+      if (ReadFile(handle, mpData, static_cast<DWORD>(size), &count, &overlapped) == FALSE &&
+         GetLastError() != ERROR_HANDLE_EOF)
+      {
+         return false;
+      }
+      mSize = count;
+#else
+      while (mSize < size)
+      {
+         ssize_t count = pread(handle, mpData + mSize, size - mSize, static_cast<off_t>(start + mSize));
+         if (count < 0 && errno == EINTR)
+         {
+            continue;
+         }
+
+         if (count <= 0)
+         {
+            break;
+         }
+
+         mSize += static_cast<size_t>(count);
+      }
+#endif
+
+      return mSize > 0;
+   }
+
+private:
+   BlockBuffer(const BlockBuffer& rhs);
+   BlockBuffer& operator=(const BlockBuffer& rhs);
+
+   ArrayResource<char> mpStorage;
+   char* mpData;
+   size_t mCapacity;
+   int64_t mStart;
+   size_t mSize;
+};
+
+/**
+ * A block buffer of the pager which is used by a single fetch and is returned to the pager
+ * when the fetch is done.
+ */
+class RawFilePager::ReservedBlock
+{
+public:
+   ReservedBlock(RawFilePager& pager) :
+      mPager(pager),
+      mpBlock(NULL)
+   {
+      {
+         mta::MutexLock lock(mPager.mBlockMutex);
+         if (mPager.mFreeBlocks.empty() == false)
+         {
+            mpBlock = mPager.mFreeBlocks.back();
+            mPager.mFreeBlocks.pop_back();
+         }
+      }
+
+      if (mpBlock == NULL)
+      {
+         mpBlock = new BlockBuffer(mPager.mReadSize);
+      }
+      else
+      {
+         // The block may hold part of another band file
+         mpBlock->clear();
+      }
+   }
+
+   ~ReservedBlock()
+   {
+      if (mpBlock->getData() == NULL)
+      {
+         delete mpBlock;
+         return;
+      }
+
+      mta::MutexLock lock(mPager.mBlockMutex);
+      mPager.mFreeBlocks.push_back(mpBlock);
+   }
+
+   BlockBuffer& get()
+   {
+      return *mpBlock;
+   }
+
+private:
+   ReservedBlock(const ReservedBlock& rhs);
+   ReservedBlock& operator=(const ReservedBlock& rhs);
+
+   RawFilePager& mPager;
+   BlockBuffer* mpBlock;
+};
+
+RawFilePager::RawFilePager() :
+   mDirectIo(RawFilePager::getSettingDirectIo()),
+   mReadSize(max(static_cast<size_t>(RawFilePager::getSettingReadSize()), sAlignment)),
+   mSwapEndian(false),
+   mInterleave(BIP),
+   mFileRows(0),
+   mFileColumns(0),
+   mFileBands(0),
+   mHeaderBytes(0),
+   mInterlineBytes(0),
+   mInterbandBytes(0),
+   mContiguous(false)
+{
+   setName("Raw File Pager");
+   setCopyright(APP_COPYRIGHT);
+   setCreator("Ball Aerospace & Technologies Corp.");
+   setDescription("Provides access to on-disk raw data by reading blocks of the file");
+   setDescriptorId("{6F0A3A52-5C1E-4B8E-9D27-3B1C4E7A90D5}");
+   setVersion(APP_VERSION_NUMBER);
+   setProductionStatus(APP_IS_PRODUCTION_RELEASE);
+   setShortDescription("Reads on disk data");
+
+   mReadSize = (mReadSize + sAlignment - 1) / sAlignment * sAlignment;
+}
+
+RawFilePager::~RawFilePager()
+{
+   for (vector<BlockBuffer*>::iterator iter = mFreeBlocks.begin(); iter != mFreeBlocks.end(); ++iter)
+   {
+      delete *iter;
+   }
+
+   for (vector<HANDLE_TYPE>::iterator iter = mHandles.begin(); iter != mHandles.end(); ++iter)
+   {
+#if defined(WIN_API)
+      CloseHandle(*iter);
+#else
+      close(*iter);
+#endif
+   }
+}
+
+bool RawFilePager::openFile(const string& filename)
+{
+   VERIFY(mHandles.empty());
+
+   const RasterElement* pRaster = getRasterElement();
+   VERIFY(pRaster != NULL);
+
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(pRaster->getDataDescriptor());
+   VERIFY(pDescriptor != NULL);
+
+   const RasterFileDescriptor* pFileDescriptor =
+      dynamic_cast<const RasterFileDescriptor*>(pDescriptor->getFileDescriptor());
+   VERIFY(pFileDescriptor != NULL);
+
+   // Pages are provided in the interleave of the file
+   mInterleave = pFileDescriptor->getInterleaveFormat();
+   if (pDescriptor->getInterleaveFormat() != mInterleave)
+   {
+      return false;
+   }
+
+   mFileRows = pFileDescriptor->getRowCount();
+   mFileColumns = pFileDescriptor->getColumnCount();
+   mFileBands = pFileDescriptor->getBandCount();
+   mHeaderBytes = static_cast<int64_t>(pFileDescriptor->getHeaderBytes()) + pFileDescriptor->getPrelineBytes() +
+      pFileDescriptor->getPrebandBytes();
+   mInterlineBytes = static_cast<int64_t>(pFileDescriptor->getPostlineBytes()) + pFileDescriptor->getPrelineBytes();
+   mInterbandBytes = static_cast<int64_t>(pFileDescriptor->getPostbandBytes()) + pFileDescriptor->getPrebandBytes();
+   mSwapEndian = (pFileDescriptor->getEndian() != Endian::getSystemEndian() && getBytesPerBand() > 1);
+
+   if (getFileIndices(pDescriptor->getRows(), pFileDescriptor->getRows(), mRows) == false ||
+      getFileIndices(pDescriptor->getColumns(), pFileDescriptor->getColumns(), mColumns) == false ||
+      getFileIndices(pDescriptor->getBands(), pFileDescriptor->getBands(), mBands) == false)
+   {
+      return false;
+   }
+
+   switch (mInterleave)
+   {
+   case BIP:
+      mContiguous = isContiguous(mColumns) && mBands.size() == mFileBands;
+      break;
+   case BIL:
+      mContiguous = isContiguous(mColumns) && isContiguous(mBands) &&
+         (mColumns.size() == mFileColumns || mBands.size() == 1);
+      break;
+   case BSQ:
+      mContiguous = isContiguous(mColumns);
+      break;
+   default:
+      return false;
+   }
+
+   const vector<const Filename*>& bandFiles = pFileDescriptor->getBandFiles();
+   if (bandFiles.empty())
+   {
+      return openHandle(filename);
+   }
+
+   // Each band file holds a single band
+   if (mInterleave != BSQ || bandFiles.size() != mFileBands)
+   {
+      return false;
+   }
+
+   for (vector<const Filename*>::const_iterator iter = bandFiles.begin(); iter != bandFiles.end(); ++iter)
+   {
+      const Filename* pBandFile = *iter;
+      VERIFY(pBandFile != NULL);
+      if (openHandle(pBandFile->getFullPathAndName()) == false)
+      {
+         return false;
+      }
+   }
+
+   mFileBands = 1;
+   return true;
+}
+
+bool RawFilePager::openHandle(const string& filename)
+{
+#if defined(WIN_API)
+   DWORD flags = (mDirectIo ? FILE_FLAG_NO_BUFFERING : FILE_FLAG_RANDOM_ACCESS);
+   HANDLE handle = CreateFile(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, flags, NULL);
+   if (handle == INVALID_HANDLE_VALUE)
+   {
+      return false;
+   }
+#else
+   int flags = O_RDONLY;
+#if defined(O_DIRECT)
+   if (mDirectIo)
+   {
+      flags |= O_DIRECT;
+   }
+#endif
+
+   int handle = open(filename.c_str(), flags);
+   if (handle == -1 && flags != O_RDONLY)
+   {
+      // Not all file systems support direct I/O
+      handle = open(filename.c_str(), O_RDONLY);
+   }
+
+   if (handle == -1)
+   {
+      return false;
+   }
+#endif
+
+   mHandles.push_back(handle);
+   return true;
+}
+
+CachedPage::UnitPtr RawFilePager::fetchUnit(DataRequest* pOriginalRequest)
+{
+   VERIFYRV(pOriginalRequest != NULL && mHandles.empty() == false, CachedPage::UnitPtr());
+
+   unsigned int startRow = pOriginalRequest->getStartRow().getActiveNumber();
+   unsigned int stopRow = min(pOriginalRequest->getStopRow().getActiveNumber(),
+      static_cast<unsigned int>(mRows.size() - 1));
+   if (startRow > stopRow)
+   {
+      return CachedPage::UnitPtr();
+   }
+
+   unsigned int rowCount = min(pOriginalRequest->getConcurrentRows(), stopRow - startRow + 1);
+
+   // BSQ units hold a single band and the other units hold all of the bands
+   DimensionDescriptor unitBand = CachedPage::CacheUnit::ALL_BANDS;
+   unsigned int fileBand = 0;
+   size_t bandCount = mBands.size();
+   if (mInterleave == BSQ)
+   {
+      unitBand = pOriginalRequest->getStartBand();
+      VERIFYRV(unitBand.getActiveNumber() < mBands.size(), CachedPage::UnitPtr());
+      fileBand = mBands[unitBand.getActiveNumber()];
+      bandCount = 1;
+   }
+
+   HANDLE_TYPE handle = mHandles.front();
+   if (mHandles.size() > 1)
+   {
+      handle = mHandles[fileBand];
+      fileBand = 0;
+   }
+
+   const size_t bytesPerElement = getBytesPerBand();
+   const size_t rowSize = mColumns.size() * bandCount * bytesPerElement;
+   const size_t unitSize = rowCount * rowSize;
+
+   // The array is allocated here since ArrayResource sizes the arrays which it allocates with an int,
+   // and a unit of a wide file can be larger than 2 GB
+   ArrayResource<char> pData(new (nothrow) char[unitSize], 0, true);
+   if (pData.get() == NULL)
+   {
+      return CachedPage::UnitPtr();
+   }
+
+   // Blocks are read through the end of the last row so that the rows are read with as few reads as possible
+   int64_t start = 0;
+   int64_t stop = 0;
+   int64_t limit = 0;
+   getRowRange(mRows[startRow + rowCount - 1], fileBand, start, limit);
+
+   ReservedBlock block(*this);
+   vector<char> rowBuffer;
+   for (unsigned int row = 0; row < rowCount; ++row)
+   {
+      getRowRange(mRows[startRow + row], fileBand, start, stop);
+
+      char* pRow = pData.get() + row * rowSize;
+      if (mContiguous)
+      {
+         if (readRange(handle, start, stop, limit, pRow, block.get()) == false)
+         {
+            return CachedPage::UnitPtr();
+         }
+
+         continue;
+      }
+
+      rowBuffer.resize(static_cast<size_t>(stop - start));
+      if (readRange(handle, start, stop, limit, &rowBuffer.front(), block.get()) == false)
+      {
+         return CachedPage::UnitPtr();
+      }
+
+      // Copy the elements of the active columns and bands out of the row
+      const char* pSource = &rowBuffer.front();
+      for (size_t column = 0; column < mColumns.size(); ++column)
+      {
+         size_t sourceColumn = mColumns[column] - mColumns.front();
+         for (size_t band = 0; band < bandCount; ++band)
+         {
+            size_t sourceBand = mBands[band] - mBands.front();
+            size_t sourceOffset = sourceColumn;
+            size_t destinationOffset = column;
+            if (mInterleave == BIP)
+            {
+               sourceOffset = sourceColumn * mFileBands + sourceBand;
+               destinationOffset = column * bandCount + band;
+            }
+            else if (mInterleave == BIL)
+            {
+               sourceOffset = sourceBand * mFileColumns + sourceColumn;
+               destinationOffset = band * mColumns.size() + column;
+            }
+
+            memcpy(pRow + destinationOffset * bytesPerElement, pSource + sourceOffset * bytesPerElement,
+               bytesPerElement);
+         }
+      }
+   }
+
+   if (mSwapEndian)
+   {
+      const RasterDataDescriptor* pDescriptor =
+         dynamic_cast<const RasterDataDescriptor*>(getRasterElement()->getDataDescriptor());
+      VERIFYRV(pDescriptor != NULL, CachedPage::UnitPtr());
+
+      EncodingType encoding = pDescriptor->getDataType();
+      Endian endian;
+      switchOnComplexEncoding(encoding, endian.swapBuffer, pData.get(),
+         unitSize / RasterUtilities::bytesInEncoding(encoding));
+   }
+
+   return CachedPage::UnitPtr(new CachedPage::CacheUnit(pData.release(), pOriginalRequest->getStartRow(),
+      static_cast<int>(rowCount), unitSize, unitBand));
+}
+
+double RawFilePager::getChunkSize() const
+{
+   return static_cast<double>(mReadSize);
+}
+
+unsigned int RawFilePager::getMaxConcurrentFetches() const
+{
+   return RawFilePager::getSettingQueueDepth();
+}
+
+int64_t RawFilePager::getOffset(unsigned int row, unsigned int column, unsigned int band) const
+{
+   const int64_t bytesPerElement = getBytesPerBand();
+   int64_t offset = mHeaderBytes;
+   if (mInterleave == BIP)
+   {
+      offset += row * (mFileColumns * mFileBands * bytesPerElement + mInterlineBytes);
+      offset += (static_cast<int64_t>(column) * mFileBands + band) * bytesPerElement;
+   }
+   else if (mInterleave == BSQ)
+   {
+      int64_t rowSize = mFileColumns * bytesPerElement + mInterlineBytes;
+      offset += band * (rowSize * mFileRows + mInterbandBytes);
+      offset += row * rowSize;
+      offset += column * bytesPerElement;
+   }
+   else if (mInterleave == BIL)
+   {
+      offset += row * (mFileColumns * mFileBands * bytesPerElement + mInterlineBytes);
+      offset += (static_cast<int64_t>(band) * mFileColumns + column) * bytesPerElement;
+   }
+
+   return offset;
+}
+
+void RawFilePager::getRowRange(unsigned int row, unsigned int band, int64_t& start, int64_t& stop) const
+{
+   if (mInterleave == BSQ)
+   {
+      start = getOffset(row, mColumns.front(), band);
+      stop = getOffset(row, mColumns.back(), band);
+   }
+   else
+   {
+      start = getOffset(row, mColumns.front(), mBands.front());
+      stop = getOffset(row, mColumns.back(), mBands.back());
+   }
+
+   stop += getBytesPerBand();
+}
+
+bool RawFilePager::readRange(HANDLE_TYPE handle, int64_t start, int64_t stop, int64_t limit, char* pDestination,
+                             BlockBuffer& block) const
+{
+   limit = max(limit, stop);
+   while (start < stop)
+   {
+      if (block.contains(start) == false)
+      {
+         int64_t blockStart = start - start % sAlignment;
+         int64_t blockStop = (limit + sAlignment - 1) / sAlignment * sAlignment;
+         size_t size = static_cast<size_t>(min(blockStop - blockStart, static_cast<int64_t>(block.getCapacity())));
+         if (block.read(handle, blockStart, size) == false || block.contains(start) == false)
+         {
+            // The range is past the end of the file
+            return false;
+         }
+      }
+
+      size_t offset = static_cast<size_t>(start - block.getStart());
+      size_t count = static_cast<size_t>(min(static_cast<int64_t>(block.getSize() - offset), stop - start));
+      memcpy(pDestination, block.getData() + offset, count);
+      pDestination += count;
+      start += count;
+   }
+
+   return true;
+}
@@ -0,0 +1,93 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef RAWFILEPAGER_H
+#define RAWFILEPAGER_H
+
+#include "AppConfig.h"
+#include "CachedPager.h"
+#include "ConfigurationSettings.h"
+#include "DMutex.h"
+#include "TypesFile.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * Reads raw band-interleaved files with positioned reads instead of a memory mapping.
+ *
+ * Units of whole rows are read from the file with pread() in blocks of at most
+ * the ReadSize setting.  Each block starts on a 4 KB boundary, and the block
+ * buffers are reused by later fetches instead of being allocated for each
+ * unit.  Units are kept in the CachedPager cache, which is accounted by the
+ * MemoryBudget.  Up to QueueDepth units are read at the same time, so
+ * read-ahead and the threads of a multi-threaded algorithm keep several reads
+ * in flight.  When the DirectIo setting is enabled, the file is opened with
+ * O_DIRECT (FILE_FLAG_NO_BUFFERING on Windows).  Reads then bypass the page cache, which gives predictable
+ * throughput on very large files and network file systems.
+ *
+ * The pager supports the header, preline, postline, preband and postband bytes
+ * of a RasterFileDescriptor, band files for BSQ data, subsets and skip factors of
+ * the rows, columns and bands, and files of either endian.  It provides read-only
+ * access in the interleave of the file.
+ */
+class RawFilePager : public CachedPager
+{
+public:
+   SETTING(ReadSize, RawFilePager, unsigned int, 4 * 1024 * 1024)
+   SETTING(QueueDepth, RawFilePager, unsigned int, 4)
+   SETTING(DirectIo, RawFilePager, bool, false)
+
+   RawFilePager();
+   virtual ~RawFilePager();
+
+protected:
+   virtual double getChunkSize() const;
+   virtual unsigned int getMaxConcurrentFetches() const;
+
+private:
+   RawFilePager& operator=(const RawFilePager& rhs);
+
+   virtual bool openFile(const std::string& filename);
+   virtual CachedPage::UnitPtr fetchUnit(DataRequest* pOriginalRequest);
+
+   class BlockBuffer;
+   class ReservedBlock;
+
+   bool openHandle(const std::string& filename);
+   int64_t getOffset(unsigned int row, unsigned int column, unsigned int band) const;
+   void getRowRange(unsigned int row, unsigned int band, int64_t& start, int64_t& stop) const;
+   bool readRange(HANDLE_TYPE handle, int64_t start, int64_t stop, int64_t limit, char* pDestination,
+      BlockBuffer& block) const;
+
+   std::vector<HANDLE_TYPE> mHandles;     // The file, or one file for each band
+   bool mDirectIo;
+   size_t mReadSize;
+   bool mSwapEndian;
+
+   // The layout of the file
+   InterleaveFormatType mInterleave;
+   unsigned int mFileRows;
+   unsigned int mFileColumns;
+   unsigned int mFileBands;
+   int64_t mHeaderBytes;
+   int64_t mInterlineBytes;
+   int64_t mInterbandBytes;
+
+   // The rows, columns and bands of the file for each active row, column and band
+   std::vector<unsigned int> mRows;
+   std::vector<unsigned int> mColumns;
+   std::vector<unsigned int> mBands;
+   bool mContiguous;                      // The range read for a row is exactly the row of a unit
+
+   std::vector<BlockBuffer*> mFreeBlocks; // Block buffers which are not being used by a fetch
+   mta::DMutex mBlockMutex;
+};
+
+#endif
@@ -0,0 +1,324 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "BadValues.h"
+#include "FileResource.h"
+#include "Filename.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElementImp.h"
+#include "RasterFileDescriptor.h"
+#include "StatisticsCache.h"
+#include "StringUtilities.h"
+#include "xmlreader.h"
+#include "xmlwriter.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include <iterator>
+#include <sstream>
+
+XERCES_CPP_NAMESPACE_USE
+using namespace std;
+
+namespace
+{
+   // Entries of version 1 were written with 15 significant digits, which does not read back every double
+   const unsigned int ENTRY_VERSION = 2;
+
+   // Writes doubles with enough digits to read back the same values
+   string toExactString(const vector<double>& values)
+   {
+      stringstream buf;
+      buf.precision(17);
+      copy(values.begin(), values.end(), ostream_iterator<double>(buf, " "));
+      return buf.str();
+   }
+
+   string toExactString(double value)
+   {
+      return toExactString(vector<double>(1, value));
+   }
+
+   // 64-bit FNV-1a
+   uint64_t hashBytes(const void* pData, size_t size, uint64_t hash = 14695981039346656037ULL)
+   {
+      const unsigned char* pBytes = reinterpret_cast<const unsigned char*>(pData);
+      for (size_t i = 0; i < size; ++i)
+      {
+         hash ^= pBytes[i];
+         hash *= 1099511628211ULL;
+      }
+
+      return hash;
+   }
+
+   // The files of a subset are identified by the original numbers of the rows or columns which were imported
+   string getDimensionKey(const vector<DimensionDescriptor>& dimensions)
+   {
+      uint64_t hash = hashBytes(NULL, 0);
+      for (vector<DimensionDescriptor>::const_iterator iter = dimensions.begin(); iter != dimensions.end(); ++iter)
+      {
+         if (iter->isOriginalNumberValid() == false)
+         {
+            return string();
+         }
+
+         unsigned int originalNumber = iter->getOriginalNumber();
+         hash = hashBytes(&originalNumber, sizeof(originalNumber), hash);
+      }
+
+      stringstream key;
+      key << dimensions.size() << ":" << hex << hash;
+      return key.str();
+   }
+
+   bool appendFileKey(const string& filename, stringstream& key)
+   {
+      QFileInfo fileInfo(QString::fromStdString(filename));
+      if (filename.empty() || fileInfo.isFile() == false)
+      {
+         return false;
+      }
+
+      key << "file=" << fileInfo.absoluteFilePath().toStdString() << "\n";
+      key << "size=" << fileInfo.size() << "\n";
+      key << "modified=" << fileInfo.lastModified().toTime_t() << "\n";
+      return true;
+   }
+}
+
+string StatisticsCache::getKey(const RasterElementImp* pElement, DimensionDescriptor band,
+                               const BadValues* pBadValues, int resolution, ComplexComponent component)
+{
+   if (pElement == NULL || getSettingEnabled() == false || pElement->isDataModified() ||
+      band.isOriginalNumberValid() == false)
+   {
+      return string();
+   }
+
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(pElement->getDataDescriptor());
+   if (pDescriptor == NULL)
+   {
+      return string();
+   }
+
+   const RasterFileDescriptor* pFileDescriptor =
+      dynamic_cast<const RasterFileDescriptor*>(pDescriptor->getFileDescriptor());
+   if (pFileDescriptor == NULL)
+   {
+      return string();
+   }
+
+   stringstream key;
+   if (appendFileKey(pFileDescriptor->getFilename().getFullPathAndName(), key) == false)
+   {
+      return string();
+   }
+
+   const vector<const Filename*>& bandFiles = pFileDescriptor->getBandFiles();
+   for (vector<const Filename*>::const_iterator iter = bandFiles.begin(); iter != bandFiles.end(); ++iter)
+   {
+      if (*iter != NULL && appendFileKey((*iter)->getFullPathAndName(), key) == false)
+      {
+         return string();
+      }
+   }
+
+   const string rows = getDimensionKey(pDescriptor->getRows());
+   const string columns = getDimensionKey(pDescriptor->getColumns());
+   if (rows.empty() || columns.empty())
+   {
+      return string();
+   }
+
+   key << "dataset=" << pFileDescriptor->getDatasetLocation() << "\n";
+   key << "type=" << StringUtilities::toXmlString(pDescriptor->getDataType()) << "\n";
+
+   // The same file is interpreted differently when it is imported with a different layout
+   key << "interleave=" << StringUtilities::toXmlString(pFileDescriptor->getInterleaveFormat()) << "\n";
+   key << "bandCount=" << pFileDescriptor->getBandCount() << "\n";
+   key << "endian=" << StringUtilities::toXmlString(pFileDescriptor->getEndian()) << "\n";
+   key << "bitsPerElement=" << pFileDescriptor->getBitsPerElement() << "\n";
+   key << "headerBytes=" << pFileDescriptor->getHeaderBytes() << "\n";
+   key << "lineBytes=" << pFileDescriptor->getPrelineBytes() << " " << pFileDescriptor->getPostlineBytes() << "\n";
+   key << "bandBytes=" << pFileDescriptor->getPrebandBytes() << " " << pFileDescriptor->getPostbandBytes() << "\n";
+   key << "rows=" << rows << "\n";
+   key << "columns=" << columns << "\n";
+   key << "band=" << band.getOriginalNumber() << "\n";
+   key << "badValues=" << (pBadValues == NULL ? string() : pBadValues->getBadValuesString()) << "\n";
+   key << "resolution=" << resolution << "\n";
+   key << "component=" << StringUtilities::toXmlString(component);
+   return key.str();
+}
+
+bool StatisticsCache::load(const string& key, Entry& entry)
+{
+   const string entryPath = getEntryPath(key, false);
+   if (entryPath.empty() || QFile::exists(QString::fromStdString(entryPath)) == false)
+   {
+      return false;
+   }
+
+   XmlReader reader(NULL, false);
+   DOMDocument* pDocument = reader.parse(entryPath);
+   if (pDocument == NULL)
+   {
+      return false;
+   }
+
+   DOMElement* pRoot = pDocument->getDocumentElement();
+   if (pRoot == NULL ||
+      StringUtilities::fromXmlString<unsigned int>(A(pRoot->getAttribute(X("version")))) != ENTRY_VERSION)
+   {
+      return false;
+   }
+
+   bool keyMatches = false;
+   entry.mPercentiles.clear();
+   entry.mBinCenters.clear();
+   entry.mBinCounts.clear();
+   for (DOMNode* pNode = pRoot->getFirstChild(); pNode != NULL; pNode = pNode->getNextSibling())
+   {
+      if (XMLString::equals(pNode->getNodeName(), X("key")))
+      {
+         keyMatches = (key == A(pNode->getTextContent()));
+      }
+      else if (XMLString::equals(pNode->getNodeName(), X("percentiles")))
+      {
+         XmlReader::StrToVector<double, XmlReader::StringStreamAssigner<double> >(entry.mPercentiles,
+            pNode->getTextContent());
+      }
+      else if (XMLString::equals(pNode->getNodeName(), X("binCenters")))
+      {
+         XmlReader::StrToVector<double, XmlReader::StringStreamAssigner<double> >(entry.mBinCenters,
+            pNode->getTextContent());
+      }
+      else if (XMLString::equals(pNode->getNodeName(), X("binCounts")))
+      {
+         XmlReader::StrToVector<unsigned int, XmlReader::StringStreamAssigner<unsigned int> >(entry.mBinCounts,
+            pNode->getTextContent());
+      }
+   }
+
+   // An entry with a different key has the same hash, and is not the entry for this key
+   if (keyMatches == false || entry.mPercentiles.size() != 1001 || entry.mBinCenters.size() != 256 ||
+      entry.mBinCounts.size() != 256)
+   {
+      return false;
+   }
+
+   entry.mMinimum = StringUtilities::fromXmlString<double>(A(pRoot->getAttribute(X("minimum"))));
+   entry.mMaximum = StringUtilities::fromXmlString<double>(A(pRoot->getAttribute(X("maximum"))));
+   entry.mAverage = StringUtilities::fromXmlString<double>(A(pRoot->getAttribute(X("average"))));
+   entry.mStandardDeviation = StringUtilities::fromXmlString<double>(A(pRoot->getAttribute(X("stddev"))));
+   return true;
+}
+
+bool StatisticsCache::save(const string& key, const Entry& entry)
+{
+   if (entry.mPercentiles.size() != 1001 || entry.mBinCenters.size() != 256 || entry.mBinCounts.size() != 256)
+   {
+      return false;
+   }
+
+   const string entryPath = getEntryPath(key, true);
+   if (entryPath.empty())
+   {
+      return false;
+   }
+
+   XMLWriter xml("StatisticsCacheEntry");
+   xml.addAttr("version", ENTRY_VERSION);
+   xml.addAttr("minimum", toExactString(entry.mMinimum), NULL);
+   xml.addAttr("maximum", toExactString(entry.mMaximum), NULL);
+   xml.addAttr("average", toExactString(entry.mAverage), NULL);
+   xml.addAttr("stddev", toExactString(entry.mStandardDeviation), NULL);
+
+   xml.pushAddPoint(xml.addElement("key"));
+   xml.addText(key);
+   xml.popAddPoint();
+   xml.pushAddPoint(xml.addElement("percentiles"));
+   xml.addText(toExactString(entry.mPercentiles));
+   xml.popAddPoint();
+   xml.pushAddPoint(xml.addElement("binCenters"));
+   xml.addText(toExactString(entry.mBinCenters));
+   xml.popAddPoint();
+   xml.pushAddPoint(xml.addElement("binCounts"));
+   xml.addText(entry.mBinCounts);
+   xml.popAddPoint();
+
+   FileResource pFile(entryPath.c_str(), "wt");
+   if (pFile.get() == NULL)
+   {
+      return false;
+   }
+
+   xml.writeToFile(pFile.get());
+   if (ferror(pFile.get()))
+   {
+      pFile.setDeleteOnClose(true);
+      return false;
+   }
+
+   return true;
+}
+
+string StatisticsCache::getEntryPath(const string& key, bool create)
+{
+   const Filename* pCachePath = getSettingCachePath();
+   if (key.empty() || pCachePath == NULL || pCachePath->getFullPathAndName().empty())
+   {
+      return string();
+   }
+
+   QDir cacheDirectory(QString::fromStdString(pCachePath->getFullPathAndName()));
+   if (create)
+   {
+      if (cacheDirectory.exists() == false && cacheDirectory.mkpath(".") == false)
+      {
+         return string();
+      }
+
+      removeOldestEntries(cacheDirectory.absolutePath().toStdString());
+   }
+
+   qulonglong hash = hashBytes(key.c_str(), key.size());
+   QString entryName = QString("%1.xml").arg(hash, 16, 16, QChar('0'));
+   return QDir::toNativeSeparators(cacheDirectory.absoluteFilePath(entryName)).toStdString();
+}
+
+void StatisticsCache::removeOldestEntries(const string& cachePath)
+{
+   // Listing the cache is only worth doing once in each session
+   static bool sRemoved = false;
+   if (sRemoved)
+   {
+      return;
+   }
+   sRemoved = true;
+
+   const qint64 maximumSize = static_cast<qint64>(getSettingMaximumSize()) * 1024 * 1024;
+   QDir cacheDirectory(QString::fromStdString(cachePath));
+   QFileInfoList entries = cacheDirectory.entryInfoList(QStringList("*.xml"), QDir::Files, QDir::Time);
+
+   qint64 totalSize = 0;
+   for (QFileInfoList::const_iterator iter = entries.begin(); iter != entries.end(); ++iter)
+   {
+      totalSize += iter->size();
+      if (totalSize > maximumSize)
+      {
+         QFile::remove(iter->absoluteFilePath());
+      }
+   }
+}
@@ -0,0 +1,93 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef STATISTICSCACHE_H
+#define STATISTICSCACHE_H
+
+#include "ConfigurationSettings.h"
+#include "DimensionDescriptor.h"
+#include "TypesFile.h"
+
+#include <string>
+#include <vector>
+
+class BadValues;
+class Filename;
+class RasterElementImp;
+
+/**
+ * Stores the statistics of bands of imported files on disk, so that the
+ * statistics are not computed again when a file is opened again.
+ *
+ * Each entry holds the statistics of one complex component of one band, and is
+ * keyed by the filename, size and modification time of the file and its band
+ * files, the dataset within the file, the layout of the file, the rows, columns
+ * and band which were imported, the data type, the bad values and the statistics
+ * resolution.  An
+ * entry is stored as an XML file in the CachePath directory which is named for a
+ * hash of the key.  The full key is stored in the entry and compared when the
+ * entry is loaded, so an entry is never used for a file which has changed.
+ *
+ * Statistics are only cached for elements whose data has not been modified
+ * since it was imported.  When the total size of the entries exceeds the
+ * MaximumSize setting, the oldest entries are removed the first time that an
+ * entry is saved in each session.
+ */
+class StatisticsCache
+{
+public:
+   SETTING(Enabled, StatisticsCache, bool, true)
+   SETTING_PTR(CachePath, StatisticsCache, Filename)
+   SETTING(MaximumSize, StatisticsCache, unsigned int, 256)
+
+   /**
+    * The statistics of one complex component of a band.
+    */
+   struct Entry
+   {
+      double mMinimum;
+      double mMaximum;
+      double mAverage;
+      double mStandardDeviation;
+      std::vector<double> mPercentiles;      // 1001 values
+      std::vector<double> mBinCenters;       // 256 values
+      std::vector<unsigned int> mBinCounts;  // 256 values
+   };
+
+   /**
+    * Returns the key of the statistics of a band.
+    *
+    * @return The key, or an empty string if the statistics of the band cannot
+    *         be cached because caching is disabled, the element was not
+    *         imported from a file or its data has been modified.
+    */
+   static std::string getKey(const RasterElementImp* pElement, DimensionDescriptor band, const BadValues* pBadValues,
+      int resolution, ComplexComponent component);
+
+   /**
+    * Loads the statistics with the given key.
+    *
+    * @return True if the statistics were found in the cache, or false otherwise.
+    */
+   static bool load(const std::string& key, Entry& entry);
+
+   /**
+    * Saves statistics under the given key, replacing any statistics already
+    * saved under the same key.
+    *
+    * @return True if the statistics were saved, or false otherwise.
+    */
+   static bool save(const std::string& key, const Entry& entry);
+
+private:
+   static std::string getEntryPath(const std::string& key, bool create);
+   static void removeOldestEntries(const std::string& cachePath);
+};
+
+#endif
@@ -19,13 +19,17 @@
 #include "RasterElement.h"
 #include "RasterElementImp.h"
 #include "RasterDataDescriptor.h"
+#include "StatisticsCache.h"
 #include "StatisticsImp.h"
+#include "StatisticsRefiner.h"
 #include "switchOnEncoding.h"
 #include "UtilityServicesImp.h"
 #include "xmlreader.h"
 #include "XmlUtilities.h"
 #include "xmlwriter.h"
 
+#include <QtCore/QCoreApplication>
+
 #include <algorithm>
 #include <limits>
 #include <numeric>
@@ -37,7 +41,8 @@ StatisticsImp::StatisticsImp(const RasterElementImp* pRasterElement,
                              AoiElement* pAoi) :
    mpRasterElement(pRasterElement),
    mpAoi(pAoi),
-   mStatisticsResolution(Statistics::getSettingResolution())
+   mStatisticsResolution(Statistics::getSettingResolution()),
+   mpRefiner(NULL)
 {
    mBands.push_back(band);
 
@@ -51,14 +56,18 @@ StatisticsImp::StatisticsImp(const RasterElementImp* pRasterElement,
    mpRasterElement(pRasterElement),
    mBands(bands),
    mpAoi(pAoi),
-   mStatisticsResolution(Statistics::getSettingResolution())
+   mStatisticsResolution(Statistics::getSettingResolution()),
+   mpRefiner(NULL)
 {
    // no need to detach later since StatisticsImp owns mBadValues
    VERIFYNR(mBadValues.attach(SIGNAL_NAME(BadValues, Modified), Slot(this, &StatisticsImp::badValuesChanged)));
 }
 
 StatisticsImp::~StatisticsImp()
-{}
+{
+   // Stops the refinement before the element is destroyed
+   delete mpRefiner;
+}
 
 void StatisticsImp::setMin(double dMin)
 {
@@ -99,6 +108,17 @@ double StatisticsImp::getMin(ComplexComponent component)
    return mMinValues[component];
 }
 
+double StatisticsImp::getEstimatedMin(ComplexComponent component)
+{
+   const StatisticsCache::Entry* pEstimate = getEstimate(component);
+   if (pEstimate != NULL)
+   {
+      return pEstimate->mMinimum;
+   }
+
+   return getMin(component);
+}
+
 void StatisticsImp::setMax(double dMax)
 {
    setMax(dMax, COMPLEX_MAGNITUDE);
@@ -138,6 +158,17 @@ double StatisticsImp::getMax(ComplexComponent component)
    return mMaxValues[component];
 }
 
+double StatisticsImp::getEstimatedMax(ComplexComponent component)
+{
+   const StatisticsCache::Entry* pEstimate = getEstimate(component);
+   if (pEstimate != NULL)
+   {
+      return pEstimate->mMaximum;
+   }
+
+   return getMax(component);
+}
+
 void StatisticsImp::setAverage(double dAverage)
 {
    setAverage(dAverage, COMPLEX_MAGNITUDE);
@@ -177,6 +208,17 @@ double StatisticsImp::getAverage(ComplexComponent component)
    return mAverageValues[component];
 }
 
+double StatisticsImp::getEstimatedAverage(ComplexComponent component)
+{
+   const StatisticsCache::Entry* pEstimate = getEstimate(component);
+   if (pEstimate != NULL)
+   {
+      return pEstimate->mAverage;
+   }
+
+   return getAverage(component);
+}
+
 void StatisticsImp::setStandardDeviation(double dStdDev)
 {
    setStandardDeviation(dStdDev, COMPLEX_MAGNITUDE);
@@ -216,6 +258,17 @@ double StatisticsImp::getStandardDeviation(ComplexComponent component)
    return mStandardDeviationValues[component];
 }
 
+double StatisticsImp::getEstimatedStandardDeviation(ComplexComponent component)
+{
+   const StatisticsCache::Entry* pEstimate = getEstimate(component);
+   if (pEstimate != NULL)
+   {
+      return pEstimate->mStandardDeviation;
+   }
+
+   return getStandardDeviation(component);
+}
+
 void StatisticsImp::setPercentiles(const double* pPercentiles)
 {
    setPercentiles(pPercentiles, COMPLEX_MAGNITUDE);
@@ -262,6 +315,17 @@ const double* StatisticsImp::getPercentiles(ComplexComponent component)
    return &percentileValues[0];
 }
 
+const double* StatisticsImp::getEstimatedPercentiles(ComplexComponent component)
+{
+   const StatisticsCache::Entry* pEstimate = getEstimate(component);
+   if (pEstimate != NULL)
+   {
+      return &pEstimate->mPercentiles.front();
+   }
+
+   return getPercentiles(component);
+}
+
 void StatisticsImp::setHistogram(const double* pBinCenters, const unsigned int* pHistogramCounts)
 {
    setHistogram(pBinCenters, pHistogramCounts, COMPLEX_MAGNITUDE);
@@ -335,6 +399,20 @@ void StatisticsImp::getHistogram(const double*& pBinCenters, const unsigned int*
    pHistogramCounts = &histogramValues[0];
 }
 
+void StatisticsImp::getEstimatedHistogram(const double*& pBinCenters, const unsigned int*& pHistogramCounts,
+                                         ComplexComponent component)
+{
+   const StatisticsCache::Entry* pEstimate = getEstimate(component);
+   if (pEstimate != NULL)
+   {
+      pBinCenters = &pEstimate->mBinCenters.front();
+      pHistogramCounts = &pEstimate->mBinCounts.front();
+      return;
+   }
+
+   getHistogram(pBinCenters, pHistogramCounts, component);
+}
+
 void StatisticsImp::setStatisticsResolution(int resolution)
 {
    if (resolution < 0)
@@ -449,6 +527,11 @@ bool StatisticsImp::areStatisticsCalculated(ComplexComponent component) const
 
 void StatisticsImp::reset(ComplexComponent component)
 {
+   if (mEstimates.erase(component) > 0 && mpRefiner != NULL)
+   {
+      mpRefiner->cancel();
+   }
+
    mMinValues.erase(component);
    mMaxValues.erase(component);
    mAverageValues.erase(component);
@@ -460,6 +543,12 @@ void StatisticsImp::reset(ComplexComponent component)
 
 void StatisticsImp::resetAll()
 {
+   if (mpRefiner != NULL)
+   {
+      mpRefiner->cancel();
+   }
+
+   mEstimates.clear();
    mMinValues.clear();
    mMaxValues.clear();
    mAverageValues.clear();
@@ -669,6 +758,18 @@ bool StatisticsImp::fromXml(DOMNode* pDocument, unsigned int version)
 }
 
 void StatisticsImp::calculateStatistics(ComplexComponent component)
+{
+   // A caller which does not accept the estimate stops the refinement, so the displays of the estimate are
+   // updated once the exact statistics are computed
+   bool approximate = areStatisticsApproximate(component);
+   computeStatistics(component);
+   if (approximate && mpRasterElement != NULL)
+   {
+      mpRasterElement->statisticsRefined(this);
+   }
+}
+
+void StatisticsImp::computeStatistics(ComplexComponent component)
 {
    reset(component);
 
@@ -685,21 +786,18 @@ void StatisticsImp::calculateStatistics(ComplexComponent component)
    int colNum = pDescriptor->getColumnCount();
    VERIFYNRV(rowNum > 0 && colNum > 0);
 
-   if (mStatisticsResolution < 1)
+   mStatisticsResolution = getResolvedResolution(mStatisticsResolution, rowNum, colNum);
+   if (loadCachedStatistics(component, mStatisticsResolution))
    {
-      if (rowNum < colNum)
-      {
-         mStatisticsResolution = rowNum / 500;
-      }
-      else
-      {
-         mStatisticsResolution = colNum / 500;
-      }
+      return;
+   }
 
-      if (mStatisticsResolution < 1)
-      {
-         mStatisticsResolution = 1;
-      }
+   // The statistics of a band without an AOI are computed in a single pass, together with the other bands of the
+   // element which are read at the same time
+   if (mpAoi.get() == NULL && mBands.size() == 1 && mBands.front().isActiveNumberValid() &&
+      calculateBandStatistics(component, mStatisticsResolution))
+   {
+      return;
    }
 
    // Create a bitmask for all pixels based on the statistics resolution
@@ -717,11 +815,10 @@ void StatisticsImp::calculateStatistics(ComplexComponent component)
       pMask->setPixel(0, 0, false);
       pMask->setPixel(colNum - 1, rowNum - 1, false);
 
-      for (int i = 0; i < rowNum * colNum; i += mStatisticsResolution)
+      // Sample whole rows so that the rows which are not sampled are never read
+      for (int row = 0; row < rowNum; row += mStatisticsResolution)
       {
-         int col = i % colNum;
-         int row = (i - col) / colNum;
-         pMask->setPixel(col, row, true);
+         pMask->setRegion(0, row, colNum - 1, row, DRAW);
       }
    }
 
@@ -737,587 +834,670 @@ void StatisticsImp::calculateStatistics(ComplexComponent component)
 
    mta::StatusBarReporter barReporter("Computing statistics", "app", "CF884AA2-A1BF-468d-9609-795DE0F7B7A4");
 
-   std::vector<int> phaseWeights;
-   phaseWeights.push_back(20);
-   phaseWeights.push_back(80);
-   mta::MultiPhaseProgressReporter progressReporter(barReporter, phaseWeights);
-
+   // The histogram and percentiles are accumulated together with the other statistics in a single pass
    mta::MultiThreadedAlgorithm<StatisticsInput, StatisticsOutput, StatisticsThread> statisticsAlgorithm
-      (getNumRequiredThreads(pDescriptor->getRowCount()), statInput, statOutput, &progressReporter);
-   statisticsAlgorithm.run();
+      (getNumRequiredThreads(pDescriptor->getRowCount()), statInput, statOutput, &barReporter);
+   if (statisticsAlgorithm.run() == mta::SUCCESS)
+   {
+      setStatistics(statOutput.mStatistics, isIntegerComponent(pDescriptor->getDataType(), component), component);
+   }
+}
 
-   bool bInteger = true;
-   EncodingType encoding = pDescriptor->getDataType();
+int StatisticsImp::getResolvedResolution(int resolution, int rowCount, int columnCount)
+{
+   if (resolution < 1)
+   {
+      resolution = std::min(rowCount, columnCount) / 500;
+   }
+
+   return std::max(resolution, 1);
+}
+
+bool StatisticsImp::isIntegerComponent(EncodingType encoding, ComplexComponent component)
+{
    if ((encoding == FLT4BYTES) || (encoding == FLT8COMPLEX) || (encoding == FLT8BYTES) ||
       ((encoding == INT4SCOMPLEX) && (component == COMPLEX_MAGNITUDE)) ||
       ((encoding == INT4SCOMPLEX) && (component == COMPLEX_PHASE)))
    {
-      bInteger = false;
+      return false;
    }
 
-   progressReporter.setCurrentPhase(1);
-
-   if (statOutput.mMaxMinSet)
-   {
-      HistogramInput histInput(statInput, statOutput);
-      HistogramOutput histOutput(bInteger, statOutput.mMaximum, statOutput.mMinimum);
+   return true;
+}
 
-      mta::MultiThreadedAlgorithm<HistogramInput, HistogramOutput, HistogramThread> histogramAlgorithm
-         (getNumRequiredThreads(pDescriptor->getRowCount()), histInput, histOutput, &progressReporter);
+bool StatisticsImp::calculateBandStatistics(ComplexComponent component, int resolution)
+{
+   const RasterElement* pRaster = dynamic_cast<const RasterElement*>(mpRasterElement);
+   const RasterDataDescriptor* pDescriptor =
+      dynamic_cast<const RasterDataDescriptor*>(mpRasterElement->getDataDescriptor());
+   VERIFY(pRaster != NULL && pDescriptor != NULL);
 
-      if (histogramAlgorithm.run() == mta::SUCCESS)
+   // BIP and BIL data is read for every band at once, so compute the statistics of the other bands of the
+   // element which have not been computed with the same settings
+   std::vector<StatisticsImp*> statistics;
+   if (pDescriptor->getInterleaveFormat() != BSQ && mpRasterElement->getStatistics(mBands.front()) == this)
+   {
+      const std::vector<DimensionDescriptor>& bands = pDescriptor->getBands();
+      for (std::vector<DimensionDescriptor>::const_iterator iter = bands.begin(); iter != bands.end(); ++iter)
       {
-         setMin(statOutput.mMinimum, component);
-         setMax(statOutput.mMaximum, component);
-         setAverage(statOutput.mAverage, component);
-         setStandardDeviation(statOutput.mStandardDeviation, component);
-         setPercentiles(histOutput.getPercentiles(), component);
-         setHistogram(histOutput.getBinCenters(), histOutput.getBinCounts(), component);
+         StatisticsImp* pStatistics = dynamic_cast<StatisticsImp*>(mpRasterElement->getStatistics(*iter));
+         if (pStatistics == this)
+         {
+            statistics.push_back(this);
+         }
+         else if (pStatistics != NULL && pStatistics->mpAoi.get() == NULL && pStatistics->mBands.size() == 1 &&
+            pStatistics->mBands.front() == *iter && pStatistics->mBands.front().isActiveNumberValid() &&
+            pStatistics->areStatisticsCalculated(component) == false &&
+            pStatistics->areStatisticsApproximate(component) == false &&
+            getResolvedResolution(pStatistics->mStatisticsResolution, pDescriptor->getRowCount(),
+               pDescriptor->getColumnCount()) == resolution &&
+            pStatistics->loadCachedStatistics(component, resolution) == false)
+         {
+            statistics.push_back(pStatistics);
+         }
       }
    }
-   else
+
+   if (std::find(statistics.begin(), statistics.end(), this) == statistics.end())
+   {
+      statistics.assign(1, this);
+   }
+
+   std::vector<DimensionDescriptor> statisticsBands;
+   std::vector<const BadValues*> badValues;
+   for (std::vector<StatisticsImp*>::const_iterator iter = statistics.begin(); iter != statistics.end(); ++iter)
+   {
+      statisticsBands.push_back((*iter)->mBands.front());
+      badValues.push_back(&(*iter)->mBadValues);
+   }
+
+   unsigned int sampledRows = (pDescriptor->getRowCount() + resolution - 1) / resolution;
+   BandStatisticsInput input(pRaster, statisticsBands, badValues, component, resolution);
+   BandStatisticsOutput output;
+
+   mta::StatusBarReporter barReporter("Computing statistics", "app", "CF884AA2-A1BF-468d-9609-795DE0F7B7A4");
+   mta::MultiThreadedAlgorithm<BandStatisticsInput, BandStatisticsOutput, BandStatisticsThread>
+      statisticsAlgorithm(getNumRequiredThreads(sampledRows), input, output, &barReporter);
+   if (statisticsAlgorithm.run() != mta::SUCCESS || output.mStatistics.size() != statistics.size())
    {
-      setMin(0.0, component);
-      setMax(0.0, component);
-      setAverage(statOutput.mAverage, component);
-      setStandardDeviation(statOutput.mStandardDeviation, component);
-      std::vector<double> dzeroes(1001, 0.0); // setPercentiles needs 1001 contiguous values; setHistogram needs 256
-      std::vector<unsigned int> uizeroes(256, 0);
-      setPercentiles(&dzeroes.front(), component);
-      setHistogram(&dzeroes.front(), &uizeroes.front(), component);
+      return false;
    }
+
+   bool integer = isIntegerComponent(pDescriptor->getDataType(), component);
+   for (std::vector<StatisticsImp*>::size_type i = 0; i < statistics.size(); ++i)
+   {
+      statistics[i]->mStatisticsResolution = resolution;
+      statistics[i]->setStatistics(output.mStatistics[i], integer, component);
+   }
+
+   return true;
 }
 
-StatisticsThread::StatisticsThread(const StatisticsInput& input, int threadCount, int threadIndex,
-                                   ThreadReporter& reporter) :
-   AlgorithmThread(threadIndex, reporter),
-   mInput(input),
-   mRowRange(getThreadRange(threadCount, static_cast<const RasterDataDescriptor*>(
-                                 input.mpRasterElement->getDataDescriptor())->getRowCount())),
-   mMaxMinSet(false),
-   mMaximum(-std::numeric_limits<double>::max()),
-   mMinimum(std::numeric_limits<double>::max()),
-   mSum(0.0),
-   mSumSquared(0.0),
-   mCount(0)
-{}
+void StatisticsImp::setStatistics(const StatisticsAccumulator& statistics, bool isInteger,
+                                  ComplexComponent component)
+{
+   StatisticsCache::Entry entry;
+   getEntry(statistics, isInteger, entry);
+   setEntry(entry, component);
 
-void StatisticsThread::run()
+   if (statistics.getCount() > 0)
+   {
+      std::string key = getCacheKey(component, mStatisticsResolution);
+      if (key.empty() == false)
+      {
+         StatisticsCache::save(key, entry);
+      }
+   }
+}
+
+void StatisticsImp::getEntry(const StatisticsAccumulator& statistics, bool isInteger, StatisticsCache::Entry& entry)
 {
-   const RasterDataDescriptor* pDescriptor = static_cast<const RasterDataDescriptor*>(
-      mInput.mpRasterElement->getDataDescriptor());
-   VERIFYNRV(pDescriptor != NULL);
+   if (statistics.getCount() == 0)
+   {
+      entry.mMinimum = 0.0;
+      entry.mMaximum = 0.0;
+      entry.mAverage = 0.0;
+      entry.mStandardDeviation = 0.0;
+      entry.mPercentiles.assign(1001, 0.0);
+      entry.mBinCenters.assign(256, 0.0);
+      entry.mBinCounts.assign(256, 0);
+      return;
+   }
 
-   BitMaskIterator diter(mInput.mpAoi, 0, mRowRange.mFirst, pDescriptor->getColumnCount() - 1, mRowRange.mLast);
+   entry.mMinimum = statistics.getMinimum();
+   entry.mMaximum = statistics.getMaximum();
+   entry.mAverage = statistics.getAverage();
+   entry.mStandardDeviation = statistics.getStandardDeviation();
+   entry.mPercentiles.resize(1001);
+   entry.mBinCenters.resize(256);
+   entry.mBinCounts.resize(256);
+   statistics.getHistogram(isInteger, &entry.mBinCenters.front(), &entry.mBinCounts.front(),
+      &entry.mPercentiles.front());
+}
 
-   mMaxMinSet = false;
-   mSum = 0.0;
-   mSumSquared = 0.0;
-   mCount = 0;
+void StatisticsImp::setEntry(const StatisticsCache::Entry& entry, ComplexComponent component)
+{
+   setMin(entry.mMinimum, component);
+   setMax(entry.mMaximum, component);
+   setAverage(entry.mAverage, component);
+   setStandardDeviation(entry.mStandardDeviation, component);
+   setPercentiles(&entry.mPercentiles.front(), component);
+   setHistogram(&entry.mBinCenters.front(), &entry.mBinCounts.front(), component);
+}
 
-   EncodingType encoding = pDescriptor->getDataType();
-   ComplexComponent component = mInput.mComplexComponent;
+std::string StatisticsImp::getCacheKey(ComplexComponent component, int resolution) const
+{
+   if (mpAoi.get() != NULL || mBands.size() != 1)
+   {
+      return std::string();
+   }
 
-   int oldPercentDone = -1;
+   return StatisticsCache::getKey(mpRasterElement, mBands.front(), &mBadValues, resolution, component);
+}
 
-   bool hasBadValues = mInput.mpBadValues != NULL && mInput.mpBadValues->empty() == false;
-   bool hasSingleBadValueRange = false;
-   double badValueLower = 0.0;
-   double badValueUpper = 0.0;
-   if (hasBadValues)
+bool StatisticsImp::loadCachedStatistics(ComplexComponent component, int resolution)
+{
+   StatisticsCache::Entry entry;
+   if (StatisticsCache::load(getCacheKey(component, resolution), entry) == false)
    {
-      hasSingleBadValueRange = mInput.mpBadValues->getSingleBadValueRange(badValueLower, badValueUpper);
+      return false;
    }
 
-   bool isBip = pDescriptor->getInterleaveFormat() == BIP;
-   // Outer band loop not for BIP, will break if BIP
-   for (std::vector<DimensionDescriptor>::const_iterator bandIt = mInput.mBandsToCalculate.begin();
-        bandIt != mInput.mBandsToCalculate.end(); ++bandIt)
+   mStatisticsResolution = resolution;
+   setEntry(entry, component);
+   return true;
+}
+
+bool StatisticsImp::calculateProgressively(ComplexComponent component)
+{
+   if (areStatisticsApproximate(component))
    {
-      FactoryResource<DataRequest> pRequest;
-      pRequest->setRows(pDescriptor->getActiveRow(diter.getBoundingBoxStartRow()),
-                        pDescriptor->getActiveRow(diter.getBoundingBoxEndRow()), 0);
-      pRequest->setColumns(pDescriptor->getActiveColumn(diter.getBoundingBoxStartColumn()),
-                           pDescriptor->getActiveColumn(diter.getBoundingBoxEndColumn()), 0);
-      if (isBip)
-      {
-         // request native accessor for efficiency
-         pRequest->setBands(pDescriptor->getActiveBand(0),
-                            pDescriptor->getActiveBand(pDescriptor->getBandCount() - 1),
-                            pDescriptor->getBandCount());
-      }
-      else
-      {
-         pRequest->setBands(*bandIt, *bandIt, 1);
-      }
-      DataAccessor da(mInput.mpRasterElement->getDataAccessor(pRequest.release()));
-      if (!da.isValid())
-      {
-         return;
-      }
+      return true;
+   }
 
-      // Iterate the band over the AOI or all bands in the case of BIP
-//#pragma message(__FILE__ "(" STRING(__LINE__) ") : warning : This should be changed to for (; fiter != diter.end(); diter += mInput.mResolution)  if/when BitMaskIterator is modified to be an STL iterator (tclarke)")
-      while (diter != diter.end())
-      {
-         LocationType loc;
-         diter.getPixelLocation(loc);
-         int percentDone = mRowRange.computePercent(static_cast<int>(loc.mY));
-         if (percentDone >= oldPercentDone + 25)
-         {
-            oldPercentDone = percentDone;
-            getReporter().reportProgress(getThreadIndex(), percentDone);
-         }
+   if (areStatisticsCalculated(component) || mpRasterElement == NULL)
+   {
+      return false;
+   }
 
-         da->toPixel(static_cast<int>(loc.mY), static_cast<int>(loc.mX));
-         VERIFYNRV(da.isValid());
+   const RasterDataDescriptor* pDescriptor =
+      dynamic_cast<const RasterDataDescriptor*>(mpRasterElement->getDataDescriptor());
+   VERIFY(pDescriptor != NULL);
 
-         // Inner band loop for BIP, will break for other interleaves
-         for (std::vector<DimensionDescriptor>::const_iterator bipBandIt = mInput.mBandsToCalculate.begin();
-              bipBandIt != mInput.mBandsToCalculate.end(); ++bipBandIt)
-         {
-            double temp = ModelServices::getDataValue(encoding,
-               da->getColumn(), component, isBip ? bipBandIt->getActiveNumber() : 0);
+   int rowNum = pDescriptor->getRowCount();
+   int colNum = pDescriptor->getColumnCount();
+   VERIFY(rowNum > 0 && colNum > 0);
 
-            bool badValue = false;
-            if (hasBadValues)
-            {
-               if (hasSingleBadValueRange)
-               {
-                  badValue = temp > badValueLower && temp < badValueUpper;
-               }
-               else
-               {
-                  badValue = mInput.mpBadValues->isBadValue(temp);
-               }
-            }
+   mStatisticsResolution = getResolvedResolution(mStatisticsResolution, rowNum, colNum);
+   if (loadCachedStatistics(component, mStatisticsResolution))
+   {
+      return false;
+   }
 
-            if (!badValue)
-            {
-               if (!mMaxMinSet)
-               {
-                  mMinimum = mMaximum = temp;
-                  mMaxMinSet = true;
-               }
-               else
-               {
-                  if (temp < mMinimum)
-                  {
-                     mMinimum = temp;
-                  }
+   // The results of the refinement are delivered through the application event loop
+   std::vector<int> resolutions = getRefinementResolutions(mStatisticsResolution, rowNum);
+   if (Statistics::getSettingProgressive() == false || QCoreApplication::instance() == NULL ||
+      resolutions.size() < 2 || mpAoi.get() != NULL || mBands.size() != 1 ||
+      mBands.front().isActiveNumberValid() == false)
+   {
+      calculateStatistics(component);
+      return false;
+   }
 
-                  if (temp > mMaximum)
-                  {
-                     mMaximum = temp;
-                  }
-               }
+   // Only one component is refined at a time
+   while (mEstimates.empty() == false)
+   {
+      reset(mEstimates.begin()->first);
+   }
 
-               mSumSquared += temp*temp;
-               mSum += temp;
-               mCount++;
-               if (!isBip)
-               {
-                  // this inner band loop is only for BIP
-                  break;
-               }
-            }
-         }
+   if (mpRefiner == NULL)
+   {
+      mpRefiner = new StatisticsRefiner(*this);
+   }
 
-         diter.nextPixel();
-      }
-      if (isBip)
-      {
-         // this outer band loop is not for BIP
-         break;
-      }
+   StatisticsAccumulator estimate;
+   if (mpRefiner->start(dynamic_cast<const RasterElement*>(mpRasterElement), mBands.front(), &mBadValues,
+      component, resolutions, estimate) == false)
+   {
+      calculateStatistics(component);
+      return false;
    }
-}
 
-bool StatisticsThread::isMaxMinSet() const
-{
-   return mMaxMinSet;
+   // The estimate is kept apart from the statistics, so that only callers which accept it are given it
+   getEntry(estimate, isIntegerComponent(pDescriptor->getDataType(), component), mEstimates[component]);
+   return true;
 }
 
-double StatisticsThread::getMaximum() const
+bool StatisticsImp::areStatisticsApproximate(ComplexComponent component) const
 {
-   return mMaximum;
+   return mEstimates.find(component) != mEstimates.end();
 }
 
-double StatisticsThread::getMinimum() const
+const StatisticsCache::Entry* StatisticsImp::getEstimate(ComplexComponent component) const
 {
-   return mMinimum;
-}
+   std::map<ComplexComponent, StatisticsCache::Entry>::const_iterator iter = mEstimates.find(component);
+   if (iter == mEstimates.end())
+   {
+      return NULL;
+   }
 
-double StatisticsThread::getSum() const
-{
-   return mSum;
+   return &iter->second;
 }
 
-double StatisticsThread::getSumSquared() const
+void StatisticsImp::setRefinedStatistics(const StatisticsAccumulator* pStatistics, ComplexComponent component,
+                                         bool exact)
 {
-   return mSumSquared;
+   if (areStatisticsApproximate(component) == false || mpRasterElement == NULL)
+   {
+      return;
+   }
+
+   if (pStatistics == NULL)
+   {
+      // The statistics are computed again when they are next requested
+      reset(component);
+   }
+   else
+   {
+      const RasterDataDescriptor* pDescriptor =
+         dynamic_cast<const RasterDataDescriptor*>(mpRasterElement->getDataDescriptor());
+      VERIFYNRV(pDescriptor != NULL);
+
+      bool isInteger = isIntegerComponent(pDescriptor->getDataType(), component);
+      if (exact)
+      {
+         mEstimates.erase(component);
+         setStatistics(*pStatistics, isInteger, component);
+      }
+      else
+      {
+         getEntry(*pStatistics, isInteger, mEstimates[component]);
+      }
+   }
+
+   mpRasterElement->statisticsRefined(this);
 }
 
-unsigned int StatisticsThread::getCount() const
+std::vector<int> StatisticsImp::getRefinementResolutions(int resolution, int rowCount)
 {
-   return mCount;
-}
+   // The estimate reads ESTIMATE_ROWS rows, and each refinement reads about REFINEMENT_FACTOR times as many
+   // rows as the one before
+   const int ESTIMATE_ROWS = 32;
+   const int REFINEMENT_FACTOR = 4;
 
-StatisticsOutput::StatisticsOutput() :
-   mMaxMinSet(false),
-   mMaximum(-std::numeric_limits<double>::max()),
-   mMinimum(std::numeric_limits<double>::max()),
-   mAverage(0.0),
-   mStandardDeviation(0.0)
-{}
+   std::vector<int> resolutions(1, resolution);
+   int sampledRows = (rowCount + resolution - 1) / resolution;
+   if (sampledRows < ESTIMATE_ROWS * REFINEMENT_FACTOR)
+   {
+      return resolutions;
+   }
 
-bool StatisticsOutput::compileOverallResults(const std::vector<StatisticsThread*>& threads)
+   for (int rows = sampledRows / REFINEMENT_FACTOR; rows > ESTIMATE_ROWS; rows /= REFINEMENT_FACTOR)
+   {
+      resolutions.insert(resolutions.begin(), rowCount / rows);
+   }
+
+   resolutions.insert(resolutions.begin(), rowCount / ESTIMATE_ROWS);
+   return resolutions;
+}
+
+namespace
 {
-   mMaxMinSet = false;
-   mMaximum = -std::numeric_limits<double>::max();
-   mMinimum = std::numeric_limits<double>::max();
-   mAverage = 0.0;
-   mStandardDeviation = 0.0;
+   // The smallest number of sampled rows which a statistics thread claims at a time, which keeps the cost of
+   // creating an accessor for each chunk small
+   const int CHUNK_ROWS = 16;
 
-   if (threads.size() == 0)
+   template<typename T>
+   void accumulateSpan(T*, DataAccessor& da, unsigned int band, ComplexComponent component,
+      const BadValues* pBadValues, StatisticsAccumulator& statistics, size_t& count)
    {
-      return false;
+      DataSpan<T> span = da->getRowSpan<T>(band);
+      statistics.accumulate(span, pBadValues);
+      count = span.getCount();
    }
 
-   double totalSum = 0.0;
-   double totalSquaredSum = 0.0;
-   unsigned int pointCount = 0;
-
-   for (std::vector<StatisticsThread*>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
+   // The value of complex data depends on the component, so each value is tested separately
+   template<typename T>
+   void accumulateComplexSpan(DataAccessor& da, unsigned int band, ComplexComponent component,
+      const BadValues* pBadValues, StatisticsAccumulator& statistics, size_t& count)
    {
-      StatisticsThread* pThread = *iter;
-      if (pThread != NULL)
+      DataSpan<T> span = da->getRowSpan<T>(band);
+      bool hasBadValues = pBadValues != NULL && pBadValues->empty() == false;
+      for (size_t i = 0; i < span.getCount(); ++i)
       {
-         if (pThread->isMaxMinSet())
+         double value = ModelServices::getDataValue(span[i], component);
+         if (hasBadValues == false || pBadValues->isBadValue(value) == false)
          {
-            mMaxMinSet = true;
-            mMaximum = std::max(mMaximum, pThread->getMaximum());
-            mMinimum = std::min(mMinimum, pThread->getMinimum());
+            statistics.add(value);
          }
-         totalSum += pThread->getSum();
-         totalSquaredSum += pThread->getSumSquared();
-         pointCount += pThread->getCount();
       }
+
+      count = span.getCount();
    }
 
-   if (pointCount > 0)
+   void accumulateSpan(IntegerComplex*, DataAccessor& da, unsigned int band, ComplexComponent component,
+      const BadValues* pBadValues, StatisticsAccumulator& statistics, size_t& count)
    {
-      mAverage = totalSum / pointCount;
+      accumulateComplexSpan<IntegerComplex>(da, band, component, pBadValues, statistics, count);
    }
 
-   if (pointCount > 1)
+   void accumulateSpan(FloatComplex*, DataAccessor& da, unsigned int band, ComplexComponent component,
+      const BadValues* pBadValues, StatisticsAccumulator& statistics, size_t& count)
    {
-      // the fabs() on the next line prevents roundoff error from giving sqrt a negative
-      // when every pixel has the same value
-      double numerator = fabs(pointCount * totalSquaredSum - totalSum * totalSum);
-      mStandardDeviation = sqrt((numerator / pointCount) / (pointCount - 1));
+      accumulateComplexSpan<FloatComplex>(da, band, component, pBadValues, statistics, count);
    }
-
-   return true;
 }
 
-HistogramThread::HistogramThread(const HistogramInput& input,
-                                 int threadCount,
-                                 int threadIndex,
-                                 mta::ThreadReporter& reporter) :
+BandStatisticsThread::BandStatisticsThread(const BandStatisticsInput& input, int threadCount, int threadIndex,
+                                           ThreadReporter& reporter) :
    AlgorithmThread(threadIndex, reporter),
    mInput(input),
-   mCount(0),
-   mRowRange(getThreadRange(threadCount, static_cast<const RasterDataDescriptor*>(
-                                 input.mStatInput.mpRasterElement->getDataDescriptor())->getRowCount())),
-   mBinCounts(HISTOGRAM_SIZE)
+   mSampledRowCount((static_cast<const RasterDataDescriptor*>(input.mpRasterElement->getDataDescriptor())->getRowCount() +
+      input.mResolution - 1) / input.mResolution),
+   mPercentDone(-1)
 {}
 
-void HistogramThread::run()
+void BandStatisticsThread::run()
 {
-   double range = 1.0;
-   double toBin = 0.0;
-   
-   if (mInput.mStatistics.mMaximum != mInput.mStatistics.mMinimum)
-   {
-      range = mInput.mStatistics.mMaximum - mInput.mStatistics.mMinimum;
-      toBin = 0.999999999 * (HISTOGRAM_SIZE)/range;
-   }
-
-   std::vector<unsigned int>& binCounts = getBinCounts();
-
    const RasterDataDescriptor* pDescriptor = static_cast<const RasterDataDescriptor*>(
-      mInput.mStatInput.mpRasterElement->getDataDescriptor());
+      mInput.mpRasterElement->getDataDescriptor());
    VERIFYNRV(pDescriptor != NULL);
 
-   BitMaskIterator diter(mInput.mStatInput.mpAoi, 0, mRowRange.mFirst,
-      pDescriptor->getColumnCount() - 1, mRowRange.mLast);
+   mStatistics.assign(mInput.mBands.size(), StatisticsAccumulator(pDescriptor->getDataType()));
+   if (mInput.mBands.empty())
+   {
+      return;
+   }
 
-   bool isBip = pDescriptor->getInterleaveFormat() == BIP;
-   // Outer band loop not for BIP, will break if BIP
-   for (std::vector<DimensionDescriptor>::const_iterator bandIt = mInput.mStatInput.mBandsToCalculate.begin();
-      bandIt != mInput.mStatInput.mBandsToCalculate.end(); ++bandIt)
+   // The rows are claimed in chunks, so that a thread whose rows are read from the cache does not wait for a
+   // thread whose rows are read from the file
+   Range chunk;
+   while (getNextChunk(mSampledRowCount, chunk, CHUNK_ROWS))
    {
-      FactoryResource<DataRequest> pRequest;
-      pRequest->setRows(pDescriptor->getActiveRow(diter.getBoundingBoxStartRow()),
-         pDescriptor->getActiveRow(diter.getBoundingBoxEndRow()), 0);
-      pRequest->setColumns(pDescriptor->getActiveColumn(diter.getBoundingBoxStartColumn()),
-         pDescriptor->getActiveColumn(diter.getBoundingBoxEndColumn()), 0);
-      if (isBip)
+      if (pDescriptor->getInterleaveFormat() == BSQ)
       {
-         // request native accessor for efficiency
-         pRequest->setBands(pDescriptor->getActiveBand(0),
-                            pDescriptor->getActiveBand(pDescriptor->getBandCount() - 1),
-                            pDescriptor->getBandCount());
+         // Each band is stored separately, so each band is a separate pass
+         unsigned int passCount = static_cast<unsigned int>(mInput.mBands.size());
+         for (unsigned int pass = 0; pass < passCount; ++pass)
+         {
+            if (accumulateBands(chunk, pass, pass, pass, passCount) == false)
+            {
+               return;
+            }
+         }
       }
       else
       {
-         pRequest->setBands(*bandIt, *bandIt, 1);
-      }
-      DataAccessor da(mInput.mStatInput.mpRasterElement->getDataAccessor(pRequest.release()));
-      if (!da.isValid())
-      {
-         return;
+         // Every band of a row is read together in the native interleave
+         if (accumulateBands(chunk, 0, mInput.mBands.size() - 1, 0, 1) == false)
+         {
+            return;
+         }
       }
+   }
+}
 
-      EncodingType encoding = pDescriptor->getDataType();
-      ComplexComponent component = mInput.mStatInput.mComplexComponent;
+bool BandStatisticsThread::accumulateBands(const Range& chunk, size_t firstStatistic, size_t lastStatistic,
+                                           unsigned int pass, unsigned int passCount)
+{
+   const RasterDataDescriptor* pDescriptor = static_cast<const RasterDataDescriptor*>(
+      mInput.mpRasterElement->getDataDescriptor());
+   VERIFY(pDescriptor != NULL);
+
+   const unsigned int rowStride = static_cast<unsigned int>(mInput.mResolution);
+   const unsigned int startRow = chunk.mFirst * rowStride;
+   const unsigned int stopRow = chunk.mLast * rowStride;
+   const unsigned int columnCount = pDescriptor->getColumnCount();
+   const unsigned int firstBand = mInput.mBands[firstStatistic].getActiveNumber();
+   const unsigned int lastBand = mInput.mBands[lastStatistic].getActiveNumber();
+   const EncodingType encoding = pDescriptor->getDataType();
+
+   FactoryResource<DataRequest> pRequest;
+   pRequest->setRows(pDescriptor->getActiveRow(startRow), pDescriptor->getActiveRow(stopRow), 0);
+   pRequest->setStrides(rowStride, 1, 1);
+   pRequest->setColumns(pDescriptor->getActiveColumn(0), pDescriptor->getActiveColumn(columnCount - 1), 0);
+   pRequest->setBands(pDescriptor->getActiveBand(firstBand), pDescriptor->getActiveBand(lastBand),
+      lastBand - firstBand + 1);
+   DataAccessor da(mInput.mpRasterElement->getDataAccessor(pRequest.release()));
+   if (da.isValid() == false)
+   {
+      getReporter().reportError("Unable to access the data to compute statistics.");
+      return false;
+   }
 
-      bool hasBadValues = mInput.mStatInput.mpBadValues != NULL && mInput.mStatInput.mpBadValues->empty() == false;
-      bool hasSingleBadValueRange = false;
-      double badValueLower = 0.0;
-      double badValueUpper = 0.0;
-      if (hasBadValues)
+   const int chunkRows = chunk.mLast - chunk.mFirst + 1;
+   for (unsigned int row = startRow; row <= stopRow; row += rowStride)
+   {
+      if (mInput.mpCancellation != NULL && mInput.mpCancellation->isCancelled())
       {
-         hasSingleBadValueRange = mInput.mStatInput.mpBadValues->getSingleBadValueRange(badValueLower, badValueUpper);
+         return false;
       }
 
-      int oldPercentDone = -1;
-      // Iterate the band over the AOI or all bands in the case of BIP
-//#pragma message(__FILE__ "(" STRING(__LINE__) ") : warning : This should be changed to for (; fiter != diter.end(); diter += mInput.mResolution)  if/when BitMaskIterator is modified to be an STL iterator (tclarke)")
-      while (diter != diter.end())
+      // Each pass over the chunk counts for its share of the rows of the chunk
+      int sampledRow = static_cast<int>(row / rowStride) - chunk.mFirst;
+      int percentDone = computeChunkPercent(mSampledRowCount, chunk,
+         chunk.mFirst + static_cast<int>((pass * chunkRows + sampledRow) / passCount));
+      if (percentDone >= mPercentDone + 5)
       {
-         LocationType loc;
-         diter.getPixelLocation(loc);
-         int percentDone = mRowRange.computePercent(static_cast<int>(loc.mY));
-         if (percentDone >= oldPercentDone + 25)
-         {
-            oldPercentDone = percentDone;
-            getReporter().reportProgress(getThreadIndex(), percentDone);
-         }
+         mPercentDone = percentDone;
+         getReporter().reportProgress(getThreadIndex(), percentDone);
+      }
 
-         da->toPixel(static_cast<int>(loc.mY), static_cast<int>(loc.mX));
-         VERIFYNRV(da.isValid());
+      // A row may span several pages, so accumulate the columns of each page of the row in turn
+      unsigned int column = 0;
+      while (column < columnCount)
+      {
+         da->toPixel(static_cast<int>(row), static_cast<int>(column));
+         VERIFY(da.isValid());
 
-         // Inner band loop for BIP, will break for other interleaves
-         for (std::vector<DimensionDescriptor>::const_iterator bipBandIt = mInput.mStatInput.mBandsToCalculate.begin();
-              bipBandIt != mInput.mStatInput.mBandsToCalculate.end(); ++bipBandIt)
+         size_t count = 0;
+         for (size_t statistic = firstStatistic; statistic <= lastStatistic; ++statistic)
          {
-            double temp = ModelServices::getDataValue(encoding,
-               da->getColumn(), mInput.mStatInput.mComplexComponent,
-               isBip ? bipBandIt->getActiveNumber() : 0);
-
-            bool badValue = false;
-            if (hasBadValues)
-            {
-               if (hasSingleBadValueRange)
-               {
-                  badValue = temp > badValueLower && temp < badValueUpper;
-               }
-               else
-               {
-                  badValue = mInput.mStatInput.mpBadValues->isBadValue(temp);
-               }
-            }
-
-            if (!badValue)
-            {
-               int bin = static_cast<int>((temp-mInput.mStatistics.mMinimum) * toBin);
-               if (bin >= HISTOGRAM_SIZE)
-               {
-                  bin = HISTOGRAM_SIZE - 1;
-               }
-               else if (bin < 0)
-               {
-                  bin = 0;
-               }
-
-               binCounts[bin]++;
-               mCount++;
-            }
-            if (!isBip)
-            {
-               // this inner band loop is only for BIP
-               break;
-            }
+            unsigned int band = mInput.mBands[statistic].getActiveNumber() - firstBand;
+            switchOnComplexEncoding(encoding, accumulateSpan, NULL, da, band, mInput.mComplexComponent,
+               mInput.mBadValues[statistic], mStatistics[statistic], count);
          }
 
-         diter.nextPixel();
-      }
-      if (isBip)
-      {
-         // this outer band loop is not for BIP
-         break;
+         VERIFY(count > 0);
+         column += static_cast<unsigned int>(count);
       }
    }
+
+   return true;
 }
 
-std::vector<unsigned int>& HistogramThread::getBinCounts()
+const std::vector<StatisticsAccumulator>& BandStatisticsThread::getStatistics() const
 {
-   return mBinCounts;
+   return mStatistics;
 }
 
-bool HistogramOutput::compileOverallResults(const std::vector<HistogramThread*>& threads)
+bool BandStatisticsOutput::compileOverallResults(const std::vector<BandStatisticsThread*>& threads)
 {
-   std::vector<unsigned int> totalBinCounts(HISTOGRAM_SIZE);
+   mStatistics.clear();
+   for (std::vector<BandStatisticsThread*>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
+   {
+      const BandStatisticsThread* pThread = *iter;
+      VERIFY(pThread != NULL);
 
-   sumAllThreads(threads, totalBinCounts);
-   computeBinCenters();
-   computeResultHistogram(totalBinCounts);
-   computePercentiles(totalBinCounts);
+      const std::vector<StatisticsAccumulator>& statistics = pThread->getStatistics();
+      if (mStatistics.empty())
+      {
+         mStatistics = statistics;
+         continue;
+      }
 
-   return true;
-}
+      VERIFY(statistics.size() == mStatistics.size());
+      for (std::vector<StatisticsAccumulator>::size_type i = 0; i < statistics.size(); ++i)
+      {
+         mStatistics[i].merge(statistics[i]);
+      }
+   }
 
-const double* HistogramOutput::getBinCenters() const
-{
-   return mBinCenters;
+   return true;
 }
 
-const unsigned int* HistogramOutput::getBinCounts() const
-{
-   return mBinCounts;
-}
+StatisticsThread::StatisticsThread(const StatisticsInput& input, int threadCount, int threadIndex,
+                                   ThreadReporter& reporter) :
+   AlgorithmThread(threadIndex, reporter),
+   mInput(input),
+   mRowCount(static_cast<const RasterDataDescriptor*>(input.mpRasterElement->getDataDescriptor())->getRowCount()),
+   mPercentDone(-1)
+{}
 
-const double* HistogramOutput::getPercentiles() const
+void StatisticsThread::run()
 {
-   return mPercentiles;
-}
+   const RasterDataDescriptor* pDescriptor = static_cast<const RasterDataDescriptor*>(
+      mInput.mpRasterElement->getDataDescriptor());
+   VERIFYNRV(pDescriptor != NULL);
 
-void HistogramOutput::sumAllThreads(const std::vector<HistogramThread*>& threads,
-                                    std::vector<unsigned int>& totalBinCounts)
-{
-   memset(&totalBinCounts[0], 0, HISTOGRAM_SIZE * sizeof(unsigned int));
+   mStatistics = StatisticsAccumulator(pDescriptor->getDataType());
 
-   std::vector<HistogramThread*>::const_iterator iter;
-   for (iter = threads.begin(); iter != threads.end(); ++iter)
+   // The rows are claimed in chunks, so that a thread whose rows are masked out by the AOI goes on to the rows
+   // which would otherwise be left to the other threads
+   const int grainSize = CHUNK_ROWS * std::max(mInput.mResolution, 1);
+   Range chunk;
+   while (getNextChunk(mRowCount, chunk, grainSize))
    {
-      HistogramThread* pThread = NULL;
-      pThread = *iter;
-      if (pThread != NULL)
+      if (accumulateRows(chunk) == false)
       {
-         const std::vector<unsigned int>& threadBinCounts = pThread->getBinCounts();
-
-         transform(totalBinCounts.begin(), totalBinCounts.end(), 
-            threadBinCounts.begin(), totalBinCounts.begin(), std::plus<unsigned int>());
+         return;
       }
    }
 }
 
-void HistogramOutput::computeBinCenters()
+bool StatisticsThread::accumulateRows(const Range& chunk)
 {
-   double width = 0.0;
-   double range = mMaximum - mMinimum;
-   bool oneBin = false;
+   const RasterDataDescriptor* pDescriptor = static_cast<const RasterDataDescriptor*>(
+      mInput.mpRasterElement->getDataDescriptor());
+   VERIFY(pDescriptor != NULL);
 
-   if (range == 0.0)
+   BitMaskIterator diter(mInput.mpAoi, 0, chunk.mFirst, pDescriptor->getColumnCount() - 1, chunk.mLast);
+   if (diter.getCount() == 0)
    {
-      range = 1.0;
-      oneBin = true;
+      return true;
    }
 
-   if (mIsInteger)
-   {
-      double binCount = range + 0.5;
-      width = ceil(binCount / 256.0);
-   }
-   else
-   {
-      width = range / 256.0;
-   }
+   EncodingType encoding = pDescriptor->getDataType();
+   ComplexComponent component = mInput.mComplexComponent;
 
-   int bin;
-   for (bin = 0; bin < 256; ++bin)
+   bool hasBadValues = mInput.mpBadValues != NULL && mInput.mpBadValues->empty() == false;
+
+   bool isBip = pDescriptor->getInterleaveFormat() == BIP;
+   // Outer band loop not for BIP, will break if BIP
+   for (std::vector<DimensionDescriptor>::const_iterator bandIt = mInput.mBandsToCalculate.begin();
+        bandIt != mInput.mBandsToCalculate.end(); ++bandIt)
    {
-      if (mIsInteger)
+      // Only every mResolution'th row is in the mask, so skip reading the other rows
+      unsigned int rowStride = static_cast<unsigned int>(std::max(mInput.mResolution, 1));
+      int startRow = diter.getBoundingBoxStartRow();
+      startRow += (rowStride - startRow % rowStride) % rowStride;
+
+      FactoryResource<DataRequest> pRequest;
+      pRequest->setRows(pDescriptor->getActiveRow(startRow),
+                        pDescriptor->getActiveRow(diter.getBoundingBoxEndRow()), 0);
+      pRequest->setStrides(rowStride, 1, 1);
+      pRequest->setColumns(pDescriptor->getActiveColumn(diter.getBoundingBoxStartColumn()),
+                           pDescriptor->getActiveColumn(diter.getBoundingBoxEndColumn()), 0);
+      if (isBip)
       {
-         mBinCenters[bin] = mMinimum + bin * width + (width - 1.0) / 2.0;
+         // request native accessor for efficiency
+         pRequest->setBands(pDescriptor->getActiveBand(0),
+                            pDescriptor->getActiveBand(pDescriptor->getBandCount() - 1),
+                            pDescriptor->getBandCount());
       }
-      else if (oneBin)
+      else
       {
-         mBinCenters[bin] = mMinimum + bin * width;
+         pRequest->setBands(*bandIt, *bandIt, 1);
       }
-      else
+      DataAccessor da(mInput.mpRasterElement->getDataAccessor(pRequest.release()));
+      if (!da.isValid())
       {
-         mBinCenters[bin] = mMinimum + bin * width + width / 2.0;
+         return false;
       }
-   }
-}
 
-void HistogramOutput::computeResultHistogram(const std::vector<unsigned int>& totalHistogram)
-{
-   memset(mBinCounts, 0, 256 * sizeof(unsigned int));
+      // Iterate the band over the runs of selected pixels in each sampled row of the AOI, or all bands in the
+      // case of BIP, so that the pixels of the bounding box which are not selected are never tested or read
+      std::vector<std::pair<int, int> > spans;
+      for (int row = startRow; row <= diter.getBoundingBoxEndRow(); row += rowStride)
+      {
+         if (diter.getRowSpans(row, spans) == 0)
+         {
+            continue;
+         }
 
-   double overallRange = mMaximum - mMinimum;
-   double resultRange = mBinCenters[255] - mBinCenters[0];
+         // Each band of the chunk counts for its share of the rows of the chunk
+         int bandIndex = isBip ? 0 : static_cast<int>(bandIt - mInput.mBandsToCalculate.begin());
+         int bandCount = isBip ? 1 : static_cast<int>(mInput.mBandsToCalculate.size());
+         int percentDone = computeChunkPercent(mRowCount, chunk,
+            chunk.mFirst + (bandIndex * (chunk.mLast - chunk.mFirst + 1) + row - chunk.mFirst) / bandCount);
+         if (percentDone >= mPercentDone + 25)
+         {
+            mPercentDone = percentDone;
+            getReporter().reportProgress(getThreadIndex(), percentDone);
+         }
 
-   if (mIsInteger == false)
-   {
-      resultRange += overallRange / 256.0;
-   }
+         for (std::vector<std::pair<int, int> >::const_iterator span = spans.begin(); span != spans.end(); ++span)
+         {
+            da->toPixel(row, span->first);
+            for (int column = span->first; column < span->second; ++column)
+            {
+               VERIFY(da.isValid());
 
-   double binConversion = (256.0 / resultRange) * (overallRange / HISTOGRAM_SIZE);
+               // Inner band loop for BIP, will break for other interleaves
+               for (std::vector<DimensionDescriptor>::const_iterator bipBandIt = mInput.mBandsToCalculate.begin();
+                    bipBandIt != mInput.mBandsToCalculate.end(); ++bipBandIt)
+               {
+                  double temp = ModelServices::getDataValue(encoding,
+                     da->getColumn(), component, isBip ? bipBandIt->getActiveNumber() : 0);
+                  if (!hasBadValues || !mInput.mpBadValues->isBadValue(temp))
+                  {
+                     mStatistics.add(temp);
+                  }
 
-   int sourceBin = 0;
-   int destBin = 0;
+                  if (!isBip)
+                  {
+                     // this inner band loop is only for BIP
+                     break;
+                  }
+               }
 
-   // If the RasterElement contains any data with a value of NaN (Not a Number), Opticks
-   // will crash when the following lines of code are executed. The RasterElement's
-   // sanitizeData method must be called prior to calling this method to prevent the
-   // crash.
-   for (sourceBin = 0; sourceBin < HISTOGRAM_SIZE; ++sourceBin)
-   {
-      destBin = static_cast<int>(sourceBin * binConversion);
-      mBinCounts[destBin] += totalHistogram[sourceBin];
+               da->nextColumn();
+            }
+         }
+      }
+      if (isBip)
+      {
+         // this outer band loop is not for BIP
+         break;
+      }
    }
+
+   return true;
 }
 
-void HistogramOutput::computePercentiles(const std::vector<unsigned int>& totalHistogram)
+const StatisticsAccumulator& StatisticsThread::getStatistics() const
 {
-   int bin;
-   int pointCount = std::accumulate(totalHistogram.begin(), totalHistogram.end(), 0);
+   return mStatistics;
+}
 
-   double range = mMaximum - mMinimum;
-   int percentile;
-   int count = 0;
-   bin = -1;
-   int prevPercentile = 0;
-   bool hit = false;
-   mPercentiles[0] = mMinimum;
-   for (percentile = 1; percentile < 1001; ++percentile)
+bool StatisticsOutput::compileOverallResults(const std::vector<StatisticsThread*>& threads)
+{
+   mStatistics = StatisticsAccumulator();
+   if (threads.size() == 0)
    {
-      hit = false;
-      int cutoff = static_cast<int>(0.001 * percentile * pointCount);
-      while (count < cutoff && bin < HISTOGRAM_SIZE - 1)
-      {
-         bin++;
-         count += totalHistogram[bin];
-         hit = true;
-      }
-      mPercentiles[percentile] = range * bin / HISTOGRAM_SIZE + mMinimum;
-      if (hit == true)
-      {
-         int j;
-         for (j = prevPercentile + 1; j < percentile; ++j) // linearly interpolate over gaps
-         {
-            mPercentiles[j] = mPercentiles[prevPercentile] + 
-               (mPercentiles[percentile] - mPercentiles[prevPercentile]) *
-               (j - prevPercentile) / (percentile - prevPercentile);
-         }
+      return false;
+   }
 
-         prevPercentile = percentile;
+   for (std::vector<StatisticsThread*>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
+   {
+      StatisticsThread* pThread = *iter;
+      if (pThread != NULL)
+      {
+         mStatistics.merge(pThread->getStatistics());
       }
    }
+
+   return true;
 }
 
 void StatisticsImp::badValuesChanged(Subject& subject, const std::string& signal, const boost::any& value)
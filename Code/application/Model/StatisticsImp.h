@@ -15,10 +15,13 @@
 #include "BitMask.h"
 #include "ComplexData.h"
 #include "DimensionDescriptor.h"
+#include "DMutex.h"
 #include "MultiThreadedAlgorithm.h"
 #include "ObjectResource.h"
 #include "SafePtr.h"
 #include "Statistics.h"
+#include "StatisticsAccumulator.h"
+#include "StatisticsCache.h"
 
 #include <boost/any.hpp>
 #include <map>
@@ -26,6 +29,7 @@
 
 class RasterElement;
 class RasterElementImp;
+class StatisticsRefiner;
 
 class StatisticsImp : public Statistics
 {
@@ -40,32 +44,39 @@ public:
    void setMin(double dMin, ComplexComponent component);
    double getMin();
    double getMin(ComplexComponent component);
+   double getEstimatedMin(ComplexComponent component);
 
    void setMax(double dMax);
    void setMax(double dMax, ComplexComponent component);
    double getMax();
    double getMax(ComplexComponent component);
+   double getEstimatedMax(ComplexComponent component);
 
    void setAverage(double dAverage);
    void setAverage(double dAverage, ComplexComponent component);
    double getAverage();
    double getAverage(ComplexComponent component);
+   double getEstimatedAverage(ComplexComponent component);
 
    void setStandardDeviation(double dStdDev);
    void setStandardDeviation(double dStdDev, ComplexComponent component);
    double getStandardDeviation();
    double getStandardDeviation(ComplexComponent component);
+   double getEstimatedStandardDeviation(ComplexComponent component);
 
    void setPercentiles(const double* pPercentiles);
    void setPercentiles(const double* pPercentiles, ComplexComponent component);
    const double* getPercentiles();
    const double* getPercentiles(ComplexComponent component);
+   const double* getEstimatedPercentiles(ComplexComponent component);
 
    void setHistogram(const double* pBinCenters, const unsigned int* pHistogramCounts);
    void setHistogram(const double* pBinCenters, const unsigned int* pHistogramCounts, ComplexComponent component);
    void getHistogram(const double*& pBinCenters, const unsigned int*& pHistogramCounts);
    void getHistogram(const double*& pBinCenters, const unsigned int*& pHistogramCounts,
       ComplexComponent component);
+   void getEstimatedHistogram(const double*& pBinCenters, const unsigned int*& pHistogramCounts,
+      ComplexComponent component);
 
    void setStatisticsResolution(int resolution);
    int getStatisticsResolution() const;
@@ -80,6 +91,13 @@ public:
    void reset(ComplexComponent component);
    void resetAll();
 
+   bool calculateProgressively(ComplexComponent component);
+   bool areStatisticsApproximate(ComplexComponent component) const;
+
+   // Sets the statistics computed by the StatisticsRefiner and notifies RasterElement::signalStatisticsRefined().
+   // The statistics are NULL if they could not be refined, in which case the estimate is discarded.
+   void setRefinedStatistics(const StatisticsAccumulator* pStatistics, ComplexComponent component, bool exact);
+
    bool toXml(XMLWriter* pXml) const;
    bool fromXml(DOMNode* pDocument, unsigned int version);
 
@@ -91,6 +109,30 @@ private:
    StatisticsImp(const StatisticsImp& rhs);
    StatisticsImp& operator=(const StatisticsImp& rhs);
 
+   static int getResolvedResolution(int resolution, int rowCount, int columnCount);
+   static bool isIntegerComponent(EncodingType encoding, ComplexComponent component);
+
+   void computeStatistics(ComplexComponent component);
+
+   // Computes the statistics of this band, and of the other bands of the element which are read with it,
+   // in a single pass over the data
+   bool calculateBandStatistics(ComplexComponent component, int resolution);
+   void setStatistics(const StatisticsAccumulator& statistics, bool isInteger, ComplexComponent component);
+   static void getEntry(const StatisticsAccumulator& statistics, bool isInteger, StatisticsCache::Entry& entry);
+   void setEntry(const StatisticsCache::Entry& entry, ComplexComponent component);
+
+   // Returns the estimate of a component which is being refined, or NULL if it is not being refined
+   const StatisticsCache::Entry* getEstimate(ComplexComponent component) const;
+
+   // The statistics of a band without an AOI are kept in the StatisticsCache for the next time that its file is
+   // opened
+   std::string getCacheKey(ComplexComponent component, int resolution) const;
+   bool loadCachedStatistics(ComplexComponent component, int resolution);
+
+   // The resolutions at which the statistics are refined, from the resolution of the first estimate to the
+   // given resolution, or a single resolution if the data is too small to be worth estimating
+   static std::vector<int> getRefinementResolutions(int resolution, int rowCount);
+
    // NOTE: this has to be a RasterElementImp instead of RasterElement as it is populated
    // in the RasterElementImp constructor. At that point, a dynamic_cast to RasterElement
    // is not possible.
@@ -108,6 +150,40 @@ private:
 
    int mStatisticsResolution;
    BadValuesAdapter mBadValues;
+
+   std::map<ComplexComponent, StatisticsCache::Entry> mEstimates;    // Estimated by calculateProgressively()
+   StatisticsRefiner* mpRefiner;
+};
+
+/**
+ * Stops a calculation which is running on other threads.
+ */
+class StatisticsCancellation
+{
+public:
+   StatisticsCancellation() :
+      mCancelled(false)
+   {
+   }
+
+   void setCancelled(bool cancelled)
+   {
+      mta::MutexLock lock(mMutex);
+      mCancelled = cancelled;
+   }
+
+   bool isCancelled() const
+   {
+      mta::MutexLock lock(mMutex);
+      return mCancelled;
+   }
+
+private:
+   StatisticsCancellation(const StatisticsCancellation& rhs);
+   StatisticsCancellation& operator=(const StatisticsCancellation& rhs);
+
+   mutable mta::DMutex mMutex;
+   bool mCancelled;
 };
 
 class StatisticsInput
@@ -141,13 +217,7 @@ class StatisticsThread;
 class StatisticsOutput
 {
 public:
-   StatisticsOutput();
-
-   bool mMaxMinSet;
-   double mMaximum;
-   double mMinimum;
-   double mAverage;
-   double mStandardDeviation;
+   StatisticsAccumulator mStatistics;
    bool compileOverallResults(const std::vector<StatisticsThread*>& threads);
 };
 
@@ -159,84 +229,79 @@ public:
 
    virtual void run();
 
-   bool isMaxMinSet() const;
-   double getMaximum() const;
-   double getMinimum() const;
-   double getSum() const;
-   double getSumSquared() const;
-   unsigned int getCount() const;
+   const StatisticsAccumulator& getStatistics() const;
 
 private:
    StatisticsThread& operator=(const StatisticsThread& rhs);
 
+   // Reads the rows of a chunk which are selected in the AOI
+   bool accumulateRows(const Range& chunk);
+
    const StatisticsInput& mInput;
 
-   Range mRowRange;
-   bool mMaxMinSet;
-   double mMaximum;
-   double mMinimum;
-   double mSum;
-   double mSumSquared;
-   unsigned int mCount;
+   int mRowCount;
+   int mPercentDone;
+   StatisticsAccumulator mStatistics;
 };
 
-class HistogramInput
+class BandStatisticsInput
 {
 public:
-   HistogramInput(const StatisticsInput& statInput, const StatisticsOutput& statOutput) :
-      mStatInput(statInput), mStatistics(statOutput) {}
-   StatisticsInput mStatInput;
-   StatisticsOutput mStatistics;
+   BandStatisticsInput(const RasterElement* pRaster, const std::vector<DimensionDescriptor>& bands,
+                       const std::vector<const BadValues*>& badValues, ComplexComponent component,
+                       int resolution, const StatisticsCancellation* pCancellation = NULL) :
+      mpRasterElement(pRaster),
+      mBands(bands),
+      mBadValues(badValues),
+      mComplexComponent(component),
+      mResolution(resolution),
+      mpCancellation(pCancellation)
+   {
+   }
+
+   const RasterElement* mpRasterElement;
+   const std::vector<DimensionDescriptor>& mBands;       // Sorted by active number
+   const std::vector<const BadValues*>& mBadValues;      // The bad values of each band
+   ComplexComponent mComplexComponent;
+   int mResolution;
+   const StatisticsCancellation* mpCancellation;         // Checked before each row is read; may be NULL
 
 private:
-   HistogramInput& operator=(const HistogramInput& rhs);
+   BandStatisticsInput& operator=(const BandStatisticsInput& rhs);
 };
 
-class HistogramThread;
-const int HISTOGRAM_SIZE = 128 * 1024;
-class HistogramOutput
+class BandStatisticsThread;
+class BandStatisticsOutput
 {
 public:
-   HistogramOutput(bool isInteger, double maximum, double minimum) : 
-      mIsInteger(isInteger), mMaximum(maximum), mMinimum(minimum) {}
-
-   bool compileOverallResults(const std::vector<HistogramThread*>& threads);
-   const double* getBinCenters() const;
-   const unsigned int* getBinCounts() const;
-   const double* getPercentiles() const;
+   bool compileOverallResults(const std::vector<BandStatisticsThread*>& threads);
 
-private:
-   void sumAllThreads(const std::vector<HistogramThread*>& threads, std::vector<unsigned int>& totalBinCounts);
-   void computeBinCenters();
-   void computeResultHistogram(const std::vector<unsigned int>& totalHistogram);
-   void computePercentiles(const std::vector<unsigned int>& totalHistogram);
-
-   double mBinCenters[256];
-   unsigned int mBinCounts[256];
-   double mPercentiles[1001];
-   bool mIsInteger;
-   double mMaximum;
-   double mMinimum;
+   std::vector<StatisticsAccumulator> mStatistics;
 };
 
-class HistogramThread : public mta::AlgorithmThread
+class BandStatisticsThread : public mta::AlgorithmThread
 {
 public:
-   HistogramThread(const HistogramInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter);
-   virtual ~HistogramThread() {};
+   BandStatisticsThread(const BandStatisticsInput& input, int threadCount, int threadIndex,
+      mta::ThreadReporter& reporter);
+   virtual ~BandStatisticsThread() {};
 
    virtual void run();
 
-   std::vector<unsigned int>& getBinCounts();
+   const std::vector<StatisticsAccumulator>& getStatistics() const;
 
 private:
-   HistogramThread& operator=(const HistogramThread& rhs);
+   BandStatisticsThread& operator=(const BandStatisticsThread& rhs);
+
+   // Reads the rows of a chunk for the bands of the given statistics, which are read together
+   bool accumulateBands(const Range& chunk, size_t firstStatistic, size_t lastStatistic, unsigned int pass,
+      unsigned int passCount);
 
-   const HistogramInput& mInput;
-   unsigned int mCount;
+   const BandStatisticsInput& mInput;
 
-   Range mRowRange;
-   std::vector<unsigned int> mBinCounts;
+   int mSampledRowCount;                           // The sampled rows are mResolution rows apart
+   int mPercentDone;
+   std::vector<StatisticsAccumulator> mStatistics;
 };
 
 #endif
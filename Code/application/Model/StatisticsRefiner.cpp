@@ -0,0 +1,186 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "MultiThreadedAlgorithm.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "StatisticsRefiner.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QEvent>
+
+using namespace std;
+
+namespace
+{
+   const QEvent::Type REFINED_EVENT = QEvent::User;
+}
+
+StatisticsRefiner::StatisticsRefiner(StatisticsImp& statistics) :
+   mStatistics(statistics),
+   mThread(static_cast<void*>(this), reinterpret_cast<void*>(StatisticsRefiner::threadFunction)),
+   mLaunched(false),
+   mpRaster(NULL),
+   mComponent(COMPLEX_MAGNITUDE),
+   mHasResult(false),
+   mFailed(false),
+   mExact(false)
+{
+}
+
+StatisticsRefiner::~StatisticsRefiner()
+{
+   cancel();
+}
+
+bool StatisticsRefiner::start(const RasterElement* pRaster, DimensionDescriptor band, const BadValues* pBadValues,
+                              ComplexComponent component, const vector<int>& resolutions,
+                              StatisticsAccumulator& estimate)
+{
+   cancel();
+   VERIFY(pRaster != NULL && resolutions.empty() == false);
+
+   mpRaster = pRaster;
+   mBand = band;
+   mBadValues.clear();
+   if (pBadValues != NULL)
+   {
+      mBadValues.setBadValues(pBadValues);
+   }
+   mComponent = component;
+   mResolutions = resolutions;
+   mCancellation.setCancelled(false);
+
+   if (accumulate(mResolutions.front(), estimate, false) == false)
+   {
+      return false;
+   }
+
+   if (mResolutions.size() > 1)
+   {
+      mLaunched = mThread.ThreadLaunch();
+      return mLaunched;
+   }
+
+   return true;
+}
+
+void StatisticsRefiner::cancel()
+{
+   mCancellation.setCancelled(true);
+   if (mLaunched)
+   {
+      mThread.ThreadWait();
+      mLaunched = false;
+   }
+
+   // Any event which has already been posted finds no result
+   mta::MutexLock lock(mMutex);
+   mHasResult = false;
+   mFailed = false;
+   mResult = StatisticsAccumulator();
+}
+
+void StatisticsRefiner::customEvent(QEvent* pEvent)
+{
+   if (pEvent == NULL || pEvent->type() != REFINED_EVENT)
+   {
+      return;
+   }
+
+   StatisticsAccumulator result;
+   bool failed = false;
+   bool exact = false;
+   {
+      mta::MutexLock lock(mMutex);
+      if (mHasResult == false && mFailed == false)
+      {
+         return;
+      }
+
+      result = mResult;
+      failed = mFailed;
+      exact = mExact;
+      mHasResult = false;
+      mFailed = false;
+   }
+
+   if (exact || failed)
+   {
+      // The thread has finished, so it does not need to be waited for when the refinement is cancelled
+      mThread.ThreadWait();
+      mLaunched = false;
+   }
+
+   mStatistics.setRefinedStatistics(failed ? NULL : &result, mComponent, exact);
+}
+
+void StatisticsRefiner::threadFunction(StatisticsRefiner* pRefiner)
+{
+   pRefiner->run();
+}
+
+void StatisticsRefiner::run()
+{
+   for (vector<int>::size_type i = 1; i < mResolutions.size(); ++i)
+   {
+      StatisticsAccumulator statistics;
+      bool success = accumulate(mResolutions[i], statistics, true);
+      if (mCancellation.isCancelled())
+      {
+         return;
+      }
+
+      {
+         mta::MutexLock lock(mMutex);
+         if (success)
+         {
+            mResult = statistics;
+            mHasResult = true;
+            mExact = (i + 1 == mResolutions.size());
+         }
+         else
+         {
+            mFailed = true;
+         }
+      }
+
+      QCoreApplication::postEvent(this, new QEvent(REFINED_EVENT));
+      if (success == false)
+      {
+         return;
+      }
+   }
+}
+
+bool StatisticsRefiner::accumulate(int resolution, StatisticsAccumulator& statistics, bool background) const
+{
+   const RasterDataDescriptor* pDescriptor =
+      dynamic_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+   VERIFY(pDescriptor != NULL && resolution > 0);
+
+   vector<DimensionDescriptor> bands(1, mBand);
+   vector<const BadValues*> badValues(1, &mBadValues);
+   BandStatisticsInput input(mpRaster, bands, badValues, mComponent, resolution, &mCancellation);
+   BandStatisticsOutput output;
+
+   // Progress is not reported, since the refinement does not hold up the user
+   unsigned int sampledRows = (pDescriptor->getRowCount() + resolution - 1) / resolution;
+   mta::MultiThreadedAlgorithm<BandStatisticsInput, BandStatisticsOutput, BandStatisticsThread>
+      statisticsAlgorithm(mta::getNumRequiredThreads(sampledRows), input, output, NULL);
+   statisticsAlgorithm.setBackground(background);
+   if (statisticsAlgorithm.run() != mta::SUCCESS || output.mStatistics.size() != 1)
+   {
+      return false;
+   }
+
+   statistics = output.mStatistics.front();
+   return true;
+}
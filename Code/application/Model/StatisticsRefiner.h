@@ -0,0 +1,112 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef STATISTICSREFINER_H
+#define STATISTICSREFINER_H
+
+#include "BadValuesAdapter.h"
+#include "bthread.h"
+#include "DimensionDescriptor.h"
+#include "DMutex.h"
+#include "StatisticsAccumulator.h"
+#include "StatisticsImp.h"
+#include "TypesFile.h"
+
+#include <QtCore/QObject>
+
+#include <vector>
+
+class QEvent;
+class RasterElement;
+
+/**
+ * Computes the statistics of a band at successively finer resolutions.
+ *
+ * start() computes the statistics at the first, coarsest resolution before it
+ * returns, and then computes them at each of the remaining resolutions on a
+ * background thread.  Each result is posted to the main thread, where it is
+ * set in the StatisticsImp with StatisticsImp::setRefinedStatistics().  Only
+ * the most recent result is kept, so results which arrive faster than the
+ * main thread handles them are skipped.
+ *
+ * The background thread reads the data with a BandStatisticsThread for each
+ * resolution, which stops at the next row when the refinement is cancelled.
+ * cancel() waits for the thread to stop, so the refiner is idle whenever the
+ * statistics are reset and when it is destroyed.
+ */
+class StatisticsRefiner : public QObject
+{
+public:
+   StatisticsRefiner(StatisticsImp& statistics);
+   ~StatisticsRefiner();
+
+   /**
+    * Computes the statistics at the first resolution and starts computing
+    * them at the remaining resolutions in the background.
+    *
+    * Any refinement in progress is cancelled first.
+    *
+    * @param pRaster
+    *        The element whose data is read.
+    * @param band
+    *        The band for which to compute the statistics.
+    * @param pBadValues
+    *        The bad values to ignore, which are copied.
+    * @param component
+    *        The complex component for which to compute the statistics.
+    * @param resolutions
+    *        The resolutions at which to compute the statistics, from the
+    *        coarsest to the statistics resolution.
+    * @param estimate
+    *        Returns the statistics at the first resolution.
+    *
+    * @return True if the estimate was computed and the remaining resolutions
+    *         are being computed in the background, or false otherwise.
+    */
+   bool start(const RasterElement* pRaster, DimensionDescriptor band, const BadValues* pBadValues,
+      ComplexComponent component, const std::vector<int>& resolutions, StatisticsAccumulator& estimate);
+
+   /**
+    * Stops the refinement and discards any result which has not been set.
+    */
+   void cancel();
+
+protected:
+   void customEvent(QEvent* pEvent);
+
+private:
+   StatisticsRefiner(const StatisticsRefiner& rhs);
+   StatisticsRefiner& operator=(const StatisticsRefiner& rhs);
+
+   static void threadFunction(StatisticsRefiner* pRefiner);
+   void run();
+   bool accumulate(int resolution, StatisticsAccumulator& statistics, bool background) const;
+
+   StatisticsImp& mStatistics;
+   BThread mThread;
+   bool mLaunched;
+
+   // Set in the main thread before the thread is launched
+   const RasterElement* mpRaster;
+   DimensionDescriptor mBand;
+   BadValuesAdapter mBadValues;
+   ComplexComponent mComponent;
+   std::vector<int> mResolutions;
+
+   StatisticsCancellation mCancellation;
+
+   // The result which has not yet been set, which is guarded by mMutex
+   mta::DMutex mMutex;
+   bool mHasResult;
+   bool mFailed;
+   bool mExact;
+   StatisticsAccumulator mResult;
+};
+
+#endif
@@ -0,0 +1,304 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppConfig.h"
+#include "TileCodec.h"
+#include "TypesFile.h"
+
+#include <string.h>
+
+using namespace std;
+
+namespace
+{
+   // The first byte of a compressed tile
+   const char STORED = 0;
+   const char LZ = 1;
+
+   const size_t MIN_MATCH = 4;
+   const size_t LAST_LITERALS = 5;       // The last bytes of a block are always literals
+   const size_t MAX_OFFSET = 65535;
+   const unsigned int HASH_BITS = 14;
+
+   inline uint32_t read32(const unsigned char* pData)
+   {
+      uint32_t value;
+      memcpy(&value, pData, sizeof(value));
+      return value;
+   }
+
+   inline size_t hash(uint32_t sequence)
+   {
+      return static_cast<uint32_t>(sequence * 2654435761U) >> (32 - HASH_BITS);
+   }
+
+   void writeLength(vector<unsigned char>& destination, size_t length)
+   {
+      for (; length >= 255; length -= 255)
+      {
+         destination.push_back(255);
+      }
+      destination.push_back(static_cast<unsigned char>(length));
+   }
+
+   // Appends literals followed by a match, or only literals if matchLength is 0
+   void writeSequence(vector<unsigned char>& destination, const unsigned char* pLiterals, size_t literalLength,
+      size_t offset, size_t matchLength)
+   {
+      size_t matchCode = (matchLength == 0) ? 0 : matchLength - MIN_MATCH;
+      unsigned char token = static_cast<unsigned char>(((literalLength < 15 ? literalLength : 15) << 4) |
+         (matchCode < 15 ? matchCode : 15));
+      destination.push_back(token);
+      if (literalLength >= 15)
+      {
+         writeLength(destination, literalLength - 15);
+      }
+      destination.insert(destination.end(), pLiterals, pLiterals + literalLength);
+
+      if (matchLength != 0)
+      {
+         destination.push_back(static_cast<unsigned char>(offset & 0xff));
+         destination.push_back(static_cast<unsigned char>(offset >> 8));
+         if (matchCode >= 15)
+         {
+            writeLength(destination, matchCode - 15);
+         }
+      }
+   }
+
+   void compressBlock(const unsigned char* pSource, size_t size, vector<unsigned char>& destination)
+   {
+      vector<size_t> table(static_cast<size_t>(1) << HASH_BITS, static_cast<size_t>(-1));
+      const size_t end = (size > LAST_LITERALS) ? size - LAST_LITERALS : 0;
+
+      size_t anchor = 0;
+      size_t position = 0;
+      while (position + MIN_MATCH <= end)
+      {
+         uint32_t sequence = read32(pSource + position);
+         size_t& entry = table[hash(sequence)];
+         size_t candidate = entry;
+         entry = position;
+
+         if (candidate != static_cast<size_t>(-1) && position - candidate <= MAX_OFFSET &&
+            read32(pSource + candidate) == sequence)
+         {
+            size_t length = MIN_MATCH;
+            while (position + length < end && pSource[candidate + length] == pSource[position + length])
+            {
+               ++length;
+            }
+
+            writeSequence(destination, pSource + anchor, position - anchor, position - candidate, length);
+            position += length;
+            anchor = position;
+         }
+         else
+         {
+            ++position;
+         }
+      }
+
+      writeSequence(destination, pSource + anchor, size - anchor, 0, 0);
+   }
+
+   bool readLength(const unsigned char*& pSource, const unsigned char* pEnd, size_t& length)
+   {
+      unsigned char value = 255;
+      while (value == 255)
+      {
+         if (pSource == pEnd)
+         {
+            return false;
+         }
+         value = *pSource++;
+         length += value;
+      }
+      return true;
+   }
+
+   bool decompressBlock(const unsigned char* pSource, size_t sourceSize, unsigned char* pDestination, size_t size)
+   {
+      const unsigned char* pEnd = pSource + sourceSize;
+      unsigned char* pOutput = pDestination;
+      unsigned char* pOutputEnd = pDestination + size;
+      while (pSource < pEnd)
+      {
+         unsigned char token = *pSource++;
+
+         size_t literalLength = token >> 4;
+         if (literalLength == 15 && !readLength(pSource, pEnd, literalLength))
+         {
+            return false;
+         }
+         if (literalLength > static_cast<size_t>(pEnd - pSource) ||
+            literalLength > static_cast<size_t>(pOutputEnd - pOutput))
+         {
+            return false;
+         }
+         memcpy(pOutput, pSource, literalLength);
+         pSource += literalLength;
+         pOutput += literalLength;
+
+         // The last sequence has no match
+         if (pSource == pEnd)
+         {
+            break;
+         }
+
+         if (pEnd - pSource < 2)
+         {
+            return false;
+         }
+         size_t offset = pSource[0] | (static_cast<size_t>(pSource[1]) << 8);
+         pSource += 2;
+
+         size_t matchLength = token & 0x0f;
+         if (matchLength == 15 && !readLength(pSource, pEnd, matchLength))
+         {
+            return false;
+         }
+         matchLength += MIN_MATCH;
+         if (offset == 0 || offset > static_cast<size_t>(pOutput - pDestination) ||
+            matchLength > static_cast<size_t>(pOutputEnd - pOutput))
+         {
+            return false;
+         }
+
+         // The match may overlap the bytes it produces, so copy one byte at a time
+         const unsigned char* pMatch = pOutput - offset;
+         for (size_t i = 0; i < matchLength; ++i)
+         {
+            *pOutput++ = *pMatch++;
+         }
+      }
+
+      return pOutput == pOutputEnd;
+   }
+
+   // Groups byte i of each element into plane i
+   void shuffle(const unsigned char* pSource, size_t size, unsigned int elementSize, unsigned char* pDestination)
+   {
+      size_t count = size / elementSize;
+      for (unsigned int plane = 0; plane < elementSize; ++plane)
+      {
+         const unsigned char* pInput = pSource + plane;
+         unsigned char* pOutput = pDestination + plane * count;
+         for (size_t i = 0; i < count; ++i, pInput += elementSize)
+         {
+            pOutput[i] = *pInput;
+         }
+      }
+
+      size_t remainder = count * elementSize;
+      memcpy(pDestination + remainder, pSource + remainder, size - remainder);
+   }
+
+   void unshuffle(const unsigned char* pSource, size_t size, unsigned int elementSize, unsigned char* pDestination)
+   {
+      size_t count = size / elementSize;
+      for (unsigned int plane = 0; plane < elementSize; ++plane)
+      {
+         const unsigned char* pInput = pSource + plane * count;
+         unsigned char* pOutput = pDestination + plane;
+         for (size_t i = 0; i < count; ++i, pOutput += elementSize)
+         {
+            *pOutput = pInput[i];
+         }
+      }
+
+      size_t remainder = count * elementSize;
+      memcpy(pDestination + remainder, pSource + remainder, size - remainder);
+   }
+}
+
+namespace TileCodec
+{
+   void compress(const char* pSource, size_t size, unsigned int elementSize, vector<char>& destination)
+   {
+      destination.clear();
+
+      const unsigned char* pData = reinterpret_cast<const unsigned char*>(pSource);
+      size_t zeros = 0;
+      while (zeros < size && pData[zeros] == 0)
+      {
+         ++zeros;
+      }
+      if (zeros == size)
+      {
+         return;
+      }
+
+      vector<unsigned char> shuffled;
+      if (elementSize > 1)
+      {
+         shuffled.resize(size);
+         shuffle(pData, size, elementSize, &shuffled[0]);
+         pData = &shuffled[0];
+      }
+
+      vector<unsigned char> compressed;
+      compressed.reserve(size / 2 + 16);
+      compressed.push_back(LZ);
+      compressBlock(pData, size, compressed);
+      if (compressed.size() <= size)
+      {
+         destination.assign(compressed.begin(), compressed.end());
+      }
+      else
+      {
+         destination.reserve(size + 1);
+         destination.push_back(STORED);
+         destination.insert(destination.end(), pSource, pSource + size);
+      }
+   }
+
+   bool decompress(const vector<char>& source, char* pDestination, size_t size, unsigned int elementSize)
+   {
+      if (source.empty())
+      {
+         memset(pDestination, 0, size);
+         return true;
+      }
+
+      const unsigned char* pSource = reinterpret_cast<const unsigned char*>(&source[0]) + 1;
+      size_t sourceSize = source.size() - 1;
+      unsigned char* pOutput = reinterpret_cast<unsigned char*>(pDestination);
+      if (source[0] == STORED)
+      {
+         if (sourceSize != size)
+         {
+            return false;
+         }
+         memcpy(pOutput, pSource, size);
+         return true;
+      }
+
+      if (source[0] != LZ)
+      {
+         return false;
+      }
+
+      if (elementSize <= 1)
+      {
+         return decompressBlock(pSource, sourceSize, pOutput, size);
+      }
+
+      vector<unsigned char> shuffled(size);
+      if (size > 0 && !decompressBlock(pSource, sourceSize, &shuffled[0], size))
+      {
+         return false;
+      }
+      if (size > 0)
+      {
+         unshuffle(&shuffled[0], size, elementSize, pOutput);
+      }
+      return true;
+   }
+}
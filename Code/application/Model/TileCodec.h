@@ -0,0 +1,61 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef TILECODEC_H
+#define TILECODEC_H
+
+#include <stddef.h>
+#include <vector>
+
+/**
+ * A fast lossless codec for tiles of raster data.
+ *
+ * The bytes of each element are first grouped into planes, so that the high
+ * order bytes of neighboring elements, which are usually equal, are next to
+ * each other.  The planes are then compressed with a byte-oriented LZ77 coder
+ * in the format of LZ4 blocks, which decodes at memory bandwidth.  Tiles which
+ * do not compress are stored as is, and tiles of zeros are stored as an empty
+ * buffer.
+ */
+namespace TileCodec
+{
+   /**
+    * Compresses a tile.
+    *
+    * @param   pSource
+    *          The data of the tile.
+    * @param   size
+    *          The number of bytes in the tile.
+    * @param   elementSize
+    *          The number of bytes in each element of the tile.
+    * @param   destination
+    *          Replaced with the compressed tile.  This is empty if all of the
+    *          bytes of the tile are zero.
+    */
+   void compress(const char* pSource, size_t size, unsigned int elementSize, std::vector<char>& destination);
+
+   /**
+    * Decompresses a tile.
+    *
+    * @param   source
+    *          The tile returned by compress().
+    * @param   pDestination
+    *          Filled with the data of the tile.
+    * @param   size
+    *          The number of bytes in the tile.
+    * @param   elementSize
+    *          The number of bytes in each element of the tile.
+    *
+    * @return  True if the tile was decompressed, false if \em source is not a
+    *          compressed tile of \em size bytes.
+    */
+   bool decompress(const std::vector<char>& source, char* pDestination, size_t size, unsigned int elementSize);
+}
+
+#endif
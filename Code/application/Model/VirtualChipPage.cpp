@@ -0,0 +1,67 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "VirtualChipPage.h"
+
+VirtualChipPage::VirtualChipPage(void* pData, unsigned int numRows, unsigned int numColumns, unsigned int numBands,
+                                 unsigned int interlineBytes) :
+   mpData(pData),
+   mNumRows(numRows),
+   mNumColumns(numColumns),
+   mNumBands(numBands),
+   mInterlineBytes(interlineBytes),
+   mpSourcePage(NULL),
+   mpSourceRequest(NULL)
+{
+}
+
+VirtualChipPage::~VirtualChipPage()
+{
+}
+
+void* VirtualChipPage::getRawData()
+{
+   return mpData;
+}
+
+unsigned int VirtualChipPage::getNumRows()
+{
+   return mNumRows;
+}
+
+unsigned int VirtualChipPage::getNumColumns()
+{
+   return mNumColumns;
+}
+
+unsigned int VirtualChipPage::getNumBands()
+{
+   return mNumBands;
+}
+
+unsigned int VirtualChipPage::getInterlineBytes()
+{
+   return mInterlineBytes;
+}
+
+void VirtualChipPage::setSourcePage(RasterPage* pPage, DataRequest* pRequest)
+{
+   mpSourcePage = pPage;
+   mpSourceRequest = FactoryResource<DataRequest>(pRequest);
+}
+
+RasterPage* VirtualChipPage::getSourcePage() const
+{
+   return mpSourcePage;
+}
+
+std::vector<char>& VirtualChipPage::getBuffer()
+{
+   return mBuffer;
+}
@@ -0,0 +1,54 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef VIRTUALCHIPPAGE_H
+#define VIRTUALCHIPPAGE_H
+
+#include "DataRequest.h"
+#include "ObjectResource.h"
+#include "RasterPage.h"
+
+#include <vector>
+
+/**
+ * A page of a virtual chip.
+ *
+ * The page either points into a page of the source element, which it holds
+ * until it is released, or into data gathered from the source element or
+ * held by the pager.
+ */
+class VirtualChipPage : public RasterPage
+{
+public:
+   VirtualChipPage(void* pData, unsigned int numRows, unsigned int numColumns, unsigned int numBands,
+      unsigned int interlineBytes);
+   ~VirtualChipPage();
+
+   void* getRawData();
+   unsigned int getNumRows();
+   unsigned int getNumColumns();
+   unsigned int getNumBands();
+   unsigned int getInterlineBytes();
+
+   void setSourcePage(RasterPage* pPage, DataRequest* pRequest);
+   RasterPage* getSourcePage() const;
+   std::vector<char>& getBuffer();
+
+private:
+   void* mpData;
+   unsigned int mNumRows;
+   unsigned int mNumColumns;
+   unsigned int mNumBands;
+   unsigned int mInterlineBytes;
+   RasterPage* mpSourcePage;
+   FactoryResource<DataRequest> mpSourceRequest;
+   std::vector<char> mBuffer;
+};
+
+#endif
@@ -0,0 +1,577 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVersion.h"
+#include "AppVerify.h"
+#include "DataRequest.h"
+#include "DimensionDescriptor.h"
+#include "ModelServices.h"
+#include "ObjectResource.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterElementImp.h"
+#include "RasterPager.h"
+#include "Slot.h"
+#include "VirtualChipPage.h"
+#include "VirtualChipPager.h"
+
+#include <algorithm>
+#include <limits>
+#include <string.h>
+
+using namespace std;
+
+namespace
+{
+   // The maximum size of a page gathered from the source element
+   const size_t MAX_GATHER_SIZE = 1024 * 1024;
+
+   template<typename T>
+   bool mapDimensions(const vector<DimensionDescriptor>& dimensions, const T& findSource, vector<unsigned int>& indices)
+   {
+      indices.clear();
+      indices.reserve(dimensions.size());
+      for (vector<DimensionDescriptor>::const_iterator iter = dimensions.begin(); iter != dimensions.end(); ++iter)
+      {
+         DimensionDescriptor source = findSource(iter->getOriginalNumber());
+         if (source.isActiveNumberValid() == false ||
+            (indices.empty() == false && source.getActiveNumber() <= indices.back()))
+         {
+            return false;
+         }
+         indices.push_back(source.getActiveNumber());
+      }
+      return indices.empty() == false;
+   }
+
+   bool isConsecutive(const vector<unsigned int>& indices)
+   {
+      return indices.back() - indices.front() + 1 == indices.size();
+   }
+}
+
+VirtualChipPager::VirtualChipPager() :
+   mpRaster(NULL),
+   mpSource(NULL),
+   mpBudget(NULL),
+   mBytesPerElement(0),
+   mContiguous(false),
+   mpData(NULL),
+   mDataSize(0),
+   mSourceReaders(0),
+   mSourcePages(0),
+   mpSourcePager(NULL)
+{
+   setName("Virtual Chip Pager");
+   setCopyright(APP_COPYRIGHT);
+   setCreator("Ball Aerospace & Technologies Corp.");
+   setDescription("Provides access to a chip through the pager of its source element");
+   setDescriptorId("{3F6A0C2D-92B4-4E57-8C1E-6D4B7A95E210}");
+   setVersion(APP_VERSION_NUMBER);
+   setProductionStatus(APP_IS_PRODUCTION_RELEASE);
+   setShortDescription("Provides a chip without copying its data");
+}
+
+VirtualChipPager::~VirtualChipPager()
+{
+   if (mpSource != NULL)
+   {
+      mpSource->detach(SIGNAL_NAME(Subject, Deleted), Slot(this, &VirtualChipPager::sourceDeleted));
+   }
+
+   if (mpBudget != NULL)
+   {
+      mpBudget->removeConsumer(this);
+   }
+
+   if (mpData != NULL)
+   {
+      Service<ModelServices>()->deleteMemoryBlock(mpData);
+   }
+
+   if (mpSourcePager != NULL)
+   {
+      Service<PlugInManagerServices>()->destroyPlugIn(dynamic_cast<PlugIn*>(mpSourcePager));
+   }
+}
+
+bool VirtualChipPager::getInputSpecification(PlugInArgList*& pArgList)
+{
+   Service<PlugInManagerServices> pPlugInMgr;
+
+   pArgList = pPlugInMgr->getPlugInArgList();
+   VERIFY(pArgList != NULL);
+
+   VERIFY(pArgList->addArg<RasterElement>("Raster Element"));
+   VERIFY(pArgList->addArg<RasterElement>("Source Element"));
+
+   return true;
+}
+
+bool VirtualChipPager::execute(PlugInArgList* pInput, PlugInArgList* pOutput)
+{
+   VERIFY(mpRaster == NULL && mpSource == NULL);
+   VERIFY(pInput != NULL);
+
+   RasterElement* pRaster = pInput->getPlugInArgValue<RasterElement>("Raster Element");
+   RasterElement* pSource = pInput->getPlugInArgValue<RasterElement>("Source Element");
+   VERIFY(pRaster != NULL && pSource != NULL && pSource->getPager() != NULL);
+
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(pRaster->getDataDescriptor());
+   const RasterDataDescriptor* pSourceDescriptor =
+      dynamic_cast<const RasterDataDescriptor*>(pSource->getDataDescriptor());
+   VERIFY(pDescriptor != NULL && pSourceDescriptor != NULL);
+   VERIFY(pDescriptor->getInterleaveFormat() == pSourceDescriptor->getInterleaveFormat());
+   VERIFY(pDescriptor->getBytesPerElement() == pSourceDescriptor->getBytesPerElement());
+
+   // The chip keeps the original numbers of the source, which locate its rows, columns and bands in the source
+   if (!mapDimensions(pDescriptor->getRows(),
+         bind1st(mem_fun(&RasterDataDescriptor::getOriginalRow), pSourceDescriptor), mRows) ||
+      !mapDimensions(pDescriptor->getColumns(),
+         bind1st(mem_fun(&RasterDataDescriptor::getOriginalColumn), pSourceDescriptor), mColumns) ||
+      !mapDimensions(pDescriptor->getBands(),
+         bind1st(mem_fun(&RasterDataDescriptor::getOriginalBand), pSourceDescriptor), mBands))
+   {
+      return false;
+   }
+
+   mRowRuns.resize(mRows.size());
+   mRowRuns.back() = 1;
+   for (size_t row = mRows.size() - 1; row > 0; --row)
+   {
+      mRowRuns[row - 1] = (mRows[row] == mRows[row - 1] + 1) ? mRowRuns[row] + 1 : 1;
+   }
+
+   mInterleave = pDescriptor->getInterleaveFormat();
+   mBytesPerElement = pDescriptor->getBytesPerElement();
+   mContiguous = isConsecutive(mColumns) && (mInterleave == BSQ || isConsecutive(mBands));
+
+   mpRaster = pRaster;
+   mpSource = pSource;
+   mpSource->attach(SIGNAL_NAME(Subject, Deleted), Slot(this, &VirtualChipPager::sourceDeleted));
+
+   mpBudget = Service<ModelServices>()->getMemoryBudget();
+   mpBudget->addConsumer(this, mpRaster);
+
+   return true;
+}
+
+RasterPage* VirtualChipPager::getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
+                                      DimensionDescriptor startColumn, DimensionDescriptor startBand)
+{
+   VERIFYRV(mpRaster != NULL, NULL);
+   VERIFYRV(pOriginalRequest != NULL, NULL);
+
+   if (pOriginalRequest->getInterleaveFormat() != mInterleave)
+   {
+      return NULL;
+   }
+
+   unsigned int numRows = mRows.size();
+   unsigned int numColumns = mColumns.size();
+   unsigned int numBands = mBands.size();
+
+   unsigned int rowNumber = startRow.getActiveNumber();
+   unsigned int colNumber = startColumn.getActiveNumber();
+   unsigned int bandNumber = startBand.getActiveNumber();
+   if (rowNumber >= numRows || colNumber >= numColumns || bandNumber >= numBands)
+   {
+      return NULL;
+   }
+
+   // The offsets of the column and band in a page of whole rows of the chip
+   size_t columnOffset = 0;
+   size_t bandOffset = 0;
+   switch (mInterleave)
+   {
+   case BIP:
+      columnOffset = static_cast<size_t>(colNumber) * numBands * mBytesPerElement;
+      bandOffset = static_cast<size_t>(bandNumber) * mBytesPerElement;
+      break;
+   case BSQ:
+      columnOffset = static_cast<size_t>(colNumber) * mBytesPerElement;
+      break;
+   case BIL:
+      columnOffset = static_cast<size_t>(colNumber) * mBytesPerElement;
+      bandOffset = static_cast<size_t>(bandNumber) * numColumns * mBytesPerElement;
+      break;
+   default:
+      return NULL;
+   }
+
+   size_t rowSize = static_cast<size_t>(numColumns) * mBytesPerElement * (mInterleave == BSQ ? 1 : numBands);
+   RasterPage* pPage = NULL;
+   bool materialized = false;
+   {
+      mta::MutexLock lock(mMutex);
+      if (mpData == NULL && pOriginalRequest->getWritable())
+      {
+         // Copy the chip before it is modified
+         if (!materialize())
+         {
+            return NULL;
+         }
+         materialized = true;
+      }
+
+      if (mpData != NULL)
+      {
+         size_t offset = static_cast<size_t>(rowNumber) * rowSize;
+         if (mInterleave == BSQ)
+         {
+            offset += static_cast<size_t>(bandNumber) * numRows * rowSize;
+         }
+
+         pPage = new VirtualChipPage(mpData + offset + columnOffset + bandOffset, numRows - rowNumber, 0, 0, 0);
+      }
+      else if (mpSource == NULL)
+      {
+         return NULL;
+      }
+      else
+      {
+         // The source is not deleted until the page has been read from it, but several threads can read it
+         ++mSourceReaders;
+      }
+   }
+
+   if (pPage != NULL)
+   {
+      if (materialized)
+      {
+         mpBudget->update();
+      }
+      return pPage;
+   }
+
+   pPage = readSource(rowNumber, colNumber, bandNumber, columnOffset, bandOffset, rowSize);
+
+   mta::MutexLock lock(mMutex);
+   VirtualChipPage* pChipPage = dynamic_cast<VirtualChipPage*>(pPage);
+   if (pChipPage != NULL && pChipPage->getSourcePage() != NULL)
+   {
+      ++mSourcePages;
+   }
+
+   if (--mSourceReaders == 0)
+   {
+      mSourceSignal.ThreadSignalActivate();
+   }
+
+   return pPage;
+}
+
+RasterPage* VirtualChipPager::readSource(unsigned int rowNumber, unsigned int colNumber, unsigned int bandNumber,
+                                         size_t columnOffset, size_t bandOffset, size_t rowSize) const
+{
+   unsigned int sourceBand = (mInterleave == BSQ) ? bandNumber : 0;
+   if (mContiguous)
+   {
+      // Return the page of the source, starting at the requested column and band
+      DataRequest* pRequest = NULL;
+      RasterPage* pSourcePage = getSourcePage(rowNumber, sourceBand, pRequest);
+      FactoryResource<DataRequest> pSourceRequest(pRequest);
+      if (pSourcePage == NULL)
+      {
+         return NULL;
+      }
+
+      size_t rowPitch = 0;
+      size_t columnPitch = 0;
+      size_t bandPitch = 0;
+      getSourceGeometry(pSourcePage, rowPitch, columnPitch, bandPitch);
+
+      const RasterDataDescriptor* pSourceDescriptor =
+         dynamic_cast<const RasterDataDescriptor*>(mpSource->getDataDescriptor());
+      unsigned int pageColumns = pSourcePage->getNumColumns();
+      unsigned int pageBands = pSourcePage->getNumBands();
+      char* pData = reinterpret_cast<char*>(pSourcePage->getRawData()) +
+         (mColumns[colNumber] - mColumns.front()) * columnPitch + (mBands[bandNumber] - mBands.front()) * bandPitch;
+
+      VirtualChipPage* pSourceChipPage = new VirtualChipPage(pData,
+         min(mRowRuns[rowNumber], pSourcePage->getNumRows()),
+         pageColumns == 0 ? pSourceDescriptor->getColumnCount() : pageColumns,
+         pageBands == 0 ? pSourceDescriptor->getBandCount() : pageBands, pSourcePage->getInterlineBytes());
+      pSourceChipPage->setSourcePage(pSourcePage, pSourceRequest.release());
+      return pSourceChipPage;
+   }
+
+   // Gather the selected columns and bands of whole rows into a page of the chip
+   unsigned int numRows = mRows.size();
+   unsigned int maxRows = static_cast<unsigned int>(max(MAX_GATHER_SIZE / rowSize, static_cast<size_t>(1)));
+   maxRows = min(maxRows, numRows - rowNumber);
+
+   vector<char> buffer(maxRows * rowSize);
+   unsigned int pageRows = gatherRows(rowNumber, sourceBand, maxRows, &buffer[0]);
+   if (pageRows == 0)
+   {
+      return NULL;
+   }
+
+   VirtualChipPage* pGatheredPage = new VirtualChipPage(&buffer[0] + columnOffset + bandOffset, pageRows,
+      mColumns.size(), mBands.size(), 0);
+   pGatheredPage->getBuffer().swap(buffer);
+   return pGatheredPage;
+}
+
+void VirtualChipPager::releasePage(RasterPage* pPage)
+{
+   VirtualChipPage* pChipPage = dynamic_cast<VirtualChipPage*>(pPage);
+   if (pChipPage == NULL)
+   {
+      return;
+   }
+
+   RasterPage* pSourcePage = pChipPage->getSourcePage();
+   if (pSourcePage != NULL)
+   {
+      mta::MutexLock lock(mMutex);
+      RasterPager* pSourcePager = (mpSource != NULL) ? mpSource->getPager() : mpSourcePager;
+      if (pSourcePager != NULL)
+      {
+         pSourcePager->releasePage(pSourcePage);
+      }
+
+      // The pager of a deleted source is destroyed with the last of its pages
+      if (--mSourcePages == 0 && mpSourcePager != NULL)
+      {
+         Service<PlugInManagerServices>()->destroyPlugIn(dynamic_cast<PlugIn*>(mpSourcePager));
+         mpSourcePager = NULL;
+      }
+   }
+
+   delete pChipPage;
+}
+
+int VirtualChipPager::getSupportedRequestVersion() const
+{
+   // Decimated requests are handled by the DecimatingPager of the element
+   return 1;
+}
+
+int64_t VirtualChipPager::getMemoryUsage() const
+{
+   mta::MutexLock lock(mMutex);
+   return mDataSize;
+}
+
+bool VirtualChipPager::getOldestAccess(uint64_t& accessTime) const
+{
+   return false;
+}
+
+int64_t VirtualChipPager::releaseOldest()
+{
+   return 0;
+}
+
+void VirtualChipPager::sourceDeleted(Subject& subject, const string& signal, const boost::any& value)
+{
+   {
+      mta::MutexLock lock(mMutex);
+      while (mSourceReaders > 0)
+      {
+         mSourceSignal.ThreadSignalWait(&mMutex);
+      }
+
+      bool copied = (mpData != NULL || materialize());
+
+      // The pages of the source which are still held point into memory of its pager
+      if (mSourcePages > 0)
+      {
+         RasterElementImp* pSource = dynamic_cast<RasterElementImp*>(mpSource);
+         if (pSource != NULL)
+         {
+            mpSourcePager = pSource->detachPager();
+         }
+      }
+
+      mpSource = NULL;
+      VERIFYNRV_MSG(copied, "The chip could not be copied before its source element was deleted");
+   }
+
+   mpBudget->update();
+}
+
+bool VirtualChipPager::materialize()
+{
+   VERIFY(mpData == NULL && mpSource != NULL);
+
+   unsigned int numRows = mRows.size();
+   unsigned int numBands = (mInterleave == BSQ) ? mBands.size() : 1;
+   size_t rowSize = mColumns.size() * mBytesPerElement * (mInterleave == BSQ ? 1 : mBands.size());
+
+   uint64_t dataSize = static_cast<uint64_t>(rowSize) * numRows * numBands;
+   if (dataSize > numeric_limits<size_t>::max())
+   {
+      return false;
+   }
+
+   Service<ModelServices> pModel;
+   char* pData = pModel->getMemoryBlock(static_cast<size_t>(dataSize));
+   if (pData == NULL)
+   {
+      return false;
+   }
+
+   for (unsigned int band = 0; band < numBands; ++band)
+   {
+      for (unsigned int row = 0; row < numRows;)
+      {
+         char* pDestination = pData + (static_cast<size_t>(band) * numRows + row) * rowSize;
+         unsigned int copiedRows = gatherRows(row, band, numRows - row, pDestination);
+         if (copiedRows == 0)
+         {
+            pModel->deleteMemoryBlock(pData);
+            return false;
+         }
+         row += copiedRows;
+      }
+   }
+
+   mpData = pData;
+   mDataSize = static_cast<int64_t>(dataSize);
+   return true;
+}
+
+RasterPage* VirtualChipPager::getSourcePage(unsigned int row, unsigned int band, DataRequest*& pRequest) const
+{
+   pRequest = NULL;
+
+   RasterPager* pPager = mpSource->getPager();
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(mpSource->getDataDescriptor());
+   VERIFYRV(pPager != NULL && pDescriptor != NULL, NULL);
+
+   unsigned int startRow = mRows[row];
+   unsigned int stopRow = startRow + mRowRuns[row] - 1;
+   unsigned int startBand = (mInterleave == BSQ) ? mBands[band] : mBands.front();
+   unsigned int stopBand = (mInterleave == BSQ) ? startBand : mBands.back();
+
+   FactoryResource<DataRequest> pSourceRequest;
+   pSourceRequest->setInterleaveFormat(mInterleave);
+   pSourceRequest->setRows(pDescriptor->getActiveRow(startRow), pDescriptor->getActiveRow(stopRow),
+      stopRow - startRow + 1);
+   pSourceRequest->setColumns(pDescriptor->getActiveColumn(mColumns.front()),
+      pDescriptor->getActiveColumn(mColumns.back()), mColumns.back() - mColumns.front() + 1);
+   pSourceRequest->setBands(pDescriptor->getActiveBand(startBand), pDescriptor->getActiveBand(stopBand),
+      stopBand - startBand + 1);
+   VERIFYRV(pSourceRequest->polish(pDescriptor), NULL);
+
+   RasterPage* pPage = pPager->getPage(pSourceRequest.get(), pSourceRequest->getStartRow(),
+      pSourceRequest->getStartColumn(), pSourceRequest->getStartBand());
+   if (pPage != NULL && pPage->getRawData() == NULL)
+   {
+      pPager->releasePage(pPage);
+      pPage = NULL;
+   }
+
+   if (pPage != NULL)
+   {
+      pRequest = pSourceRequest.release();
+   }
+   return pPage;
+}
+
+unsigned int VirtualChipPager::gatherRows(unsigned int row, unsigned int band, unsigned int maxRows,
+                                          char* pDestination) const
+{
+   DataRequest* pRequest = NULL;
+   RasterPage* pPage = getSourcePage(row, band, pRequest);
+   FactoryResource<DataRequest> pSourceRequest(pRequest);
+   if (pPage == NULL)
+   {
+      return 0;
+   }
+
+   size_t rowPitch = 0;
+   size_t columnPitch = 0;
+   size_t bandPitch = 0;
+   getSourceGeometry(pPage, rowPitch, columnPitch, bandPitch);
+
+   const unsigned int firstColumn = mColumns.front();
+   const unsigned int firstBand = (mInterleave == BSQ) ? mBands[band] : mBands.front();
+   const size_t numColumns = mColumns.size();
+   const size_t numBands = (mInterleave == BSQ) ? 1 : mBands.size();
+   const unsigned int numRows = min(min(mRowRuns[row], pPage->getNumRows()), maxRows);
+
+   const char* pSource = reinterpret_cast<const char*>(pPage->getRawData());
+   char* pOutput = pDestination;
+   for (unsigned int pageRow = 0; pageRow < numRows; ++pageRow, pSource += rowPitch)
+   {
+      if (mInterleave == BIL)
+      {
+         for (size_t bandIndex = 0; bandIndex < numBands; ++bandIndex)
+         {
+            const char* pBand = pSource + (mBands[bandIndex] - firstBand) * bandPitch;
+            for (size_t column = 0; column < numColumns; ++column, pOutput += mBytesPerElement)
+            {
+               memcpy(pOutput, pBand + (mColumns[column] - firstColumn) * columnPitch, mBytesPerElement);
+            }
+         }
+      }
+      else
+      {
+         // BSQ pages hold a single band, so the band offset is always 0
+         for (size_t column = 0; column < numColumns; ++column)
+         {
+            const char* pColumn = pSource + (mColumns[column] - firstColumn) * columnPitch;
+            for (size_t bandIndex = 0; bandIndex < numBands; ++bandIndex, pOutput += mBytesPerElement)
+            {
+               memcpy(pOutput, pColumn + (mBands[mInterleave == BSQ ? band : bandIndex] - firstBand) * bandPitch,
+                  mBytesPerElement);
+            }
+         }
+      }
+   }
+
+   mpSource->getPager()->releasePage(pPage);
+   return numRows;
+}
+
+void VirtualChipPager::getSourceGeometry(RasterPage* pPage, size_t& rowPitch, size_t& columnPitch,
+                                         size_t& bandPitch) const
+{
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(mpSource->getDataDescriptor());
+   VERIFYNRV(pDescriptor != NULL);
+
+   size_t numColumns = pPage->getNumColumns();
+   if (numColumns == 0)
+   {
+      numColumns = pDescriptor->getColumnCount();
+   }
+
+   size_t numBands = pPage->getNumBands();
+   if (numBands == 0)
+   {
+      numBands = pDescriptor->getBandCount();
+   }
+
+   switch (mInterleave)
+   {
+   case BIP:
+      columnPitch = numBands * mBytesPerElement;
+      bandPitch = mBytesPerElement;
+      rowPitch = numColumns * columnPitch;
+      break;
+   case BIL:
+      columnPitch = mBytesPerElement;
+      bandPitch = numColumns * mBytesPerElement;
+      rowPitch = numBands * bandPitch;
+      break;
+   default:
+      columnPitch = mBytesPerElement;
+      bandPitch = 0;
+      rowPitch = numColumns * mBytesPerElement;
+      break;
+   }
+
+   rowPitch += pPage->getInterlineBytes();
+}
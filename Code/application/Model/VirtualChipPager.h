@@ -0,0 +1,95 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef VIRTUALCHIPPAGER_H
+#define VIRTUALCHIPPAGER_H
+
+#include "DMutex.h"
+#include "MemoryBudget.h"
+#include "RasterPagerShell.h"
+#include "TypesFile.h"
+
+#include <boost/any.hpp>
+#include <string>
+#include <vector>
+
+class RasterElement;
+class Subject;
+
+/**
+ * Provides the data of a chip from the pager of its source element.
+ *
+ * The active rows, columns and bands of the chip are mapped onto the active
+ * rows, columns and bands of the source element, and each page of the chip is
+ * read from a page of the source element.  When the columns of the chip are
+ * consecutive in the source, and its bands are also consecutive for BIP and BIL
+ * data, the page of the source is returned without copying.  Otherwise the
+ * selected columns and bands are gathered into a page of the chip.  The chip
+ * uses no memory of its own, and reflects later changes to the source element.
+ *
+ * The first writable request, or the deletion of the source element, copies
+ * the chip into memory, after which the pager behaves like the In Memory Pager.
+ * The source element is not deleted while a page is being read from it, and
+ * the pager of a deleted source element is kept until the pages of the source
+ * which are held by pages of the chip have been released.
+ */
+class VirtualChipPager : public RasterPagerShell, public MemoryConsumer
+{
+public:
+   VirtualChipPager();
+   ~VirtualChipPager();
+
+   bool getInputSpecification(PlugInArgList*& pArgList);
+   bool execute(PlugInArgList* pInput, PlugInArgList* pOutput);
+
+   RasterPage* getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow, DimensionDescriptor startColumn,
+      DimensionDescriptor startBand);
+   void releasePage(RasterPage* pPage);
+
+   int getSupportedRequestVersion() const;
+
+   // Only the data copied into memory is accounted by the MemoryBudget, and it cannot be released
+   int64_t getMemoryUsage() const;
+   bool getOldestAccess(uint64_t& accessTime) const;
+   int64_t releaseOldest();
+
+private:
+   void sourceDeleted(Subject& subject, const std::string& signal, const boost::any& value);
+
+   // Must be called with mMutex locked
+   bool materialize();
+
+   RasterPage* readSource(unsigned int row, unsigned int column, unsigned int band, size_t columnOffset,
+      size_t bandOffset, size_t rowSize) const;
+   RasterPage* getSourcePage(unsigned int row, unsigned int band, DataRequest*& pRequest) const;
+   unsigned int gatherRows(unsigned int row, unsigned int band, unsigned int maxRows, char* pDestination) const;
+   void getSourceGeometry(RasterPage* pPage, size_t& rowPitch, size_t& columnPitch, size_t& bandPitch) const;
+
+   RasterElement* mpRaster;
+   RasterElement* mpSource;
+   MemoryBudget* mpBudget;
+
+   InterleaveFormatType mInterleave;
+   unsigned int mBytesPerElement;
+   std::vector<unsigned int> mRows;          // The active row of the source for each row of the chip
+   std::vector<unsigned int> mRowRuns;       // The number of consecutive source rows from each row of the chip
+   std::vector<unsigned int> mColumns;
+   std::vector<unsigned int> mBands;
+   bool mContiguous;                         // Pages of the source can be returned without copying
+
+   mutable mta::DMutex mMutex;
+   char* mpData;                             // The copy of the chip, or NULL while the chip is virtual
+   int64_t mDataSize;
+   unsigned int mSourceReaders;              // Threads which are reading the source
+   mta::DThreadSignal mSourceSignal;         // Signaled when the last thread has read the source
+   unsigned int mSourcePages;                // Pages of the source which are held by pages of the chip
+   RasterPager* mpSourcePager;               // The pager of the deleted source, while its pages are held
+};
+
+#endif
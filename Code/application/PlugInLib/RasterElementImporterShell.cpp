@@ -9,7 +9,13 @@
 
 #include "AppConfig.h"
 #include "AppVerify.h"
+#include "BadValues.h"
+#include "CachedPager.h"
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
 #include "DimensionDescriptor.h"
+#include "Filename.h"
 #include "FileResource.h"
 #include "GcpLayer.h"
 #include "GcpList.h"
@@ -18,6 +24,7 @@
 #include "LatLonLayer.h"
 #include "LayerList.h"
 #include "MessageLogResource.h"
+#include "MultiThreadedAlgorithm.h"
 #include "ObjectResource.h"
 #include "PlugInArg.h"
 #include "PlugInArgList.h"
@@ -28,14 +35,19 @@
 #include "RasterElementImporterShell.h"
 #include "RasterFileDescriptor.h"
 #include "RasterLayer.h"
+#include "RasterPager.h"
 #include "RasterUtilities.h"
 #include "SessionManager.h"
 #include "SpatialDataView.h"
 #include "SpatialDataWindow.h"
+#include "Statistics.h"
+#include "StatisticsAccumulator.h"
 #include "StringUtilities.h"
+#include "switchOnEncoding.h"
 #include "Undo.h"
 
 #include <limits>
+#include <string.h>
 using namespace std;
 
 namespace
@@ -57,6 +69,360 @@ namespace
 
       return selectedDims;
    }
+
+   // The layout of one row of the imported data, in elements
+   struct RowLayout
+   {
+      size_t mColumns;
+      size_t mBands;
+      ptrdiff_t mColumnStride;
+      ptrdiff_t mBandStride;
+   };
+
+   template<typename T>
+   void sanitizeAndAccumulate(T* pRow, const RowLayout& layout, double value, uint64_t& badValueCount,
+      StatisticsAccumulator* pStatistics, const BadValues* const* pBadValues)
+   {
+      for (size_t band = 0; band < layout.mBands; ++band)
+      {
+         DataSpan<T> span(pRow + band * layout.mBandStride, layout.mColumns, layout.mColumnStride);
+         for (size_t column = 0; column < layout.mColumns; ++column)
+         {
+            if (RasterUtilities::isBad(span[column]))
+            {
+               span[column] = static_cast<T>(value);
+               ++badValueCount;
+            }
+         }
+
+         if (pStatistics != NULL)
+         {
+            pStatistics[band].accumulate(span, pBadValues[band]);
+         }
+      }
+   }
+
+   class ImportInput
+   {
+   public:
+      ImportInput(const RasterElement* pSource, RasterElement* pChip, const vector<DimensionDescriptor>& selectedRows,
+         const vector<DimensionDescriptor>& selectedColumns, const vector<DimensionDescriptor>& selectedBands,
+         bool sanitize, double sanitizeValue, bool computeStatistics, const vector<const BadValues*>& badValues,
+         const bool& aborted) :
+         mpSource(pSource),
+         mpChip(pChip),
+         mSelectedRows(selectedRows),
+         mSelectedColumns(selectedColumns),
+         mSelectedBands(selectedBands),
+         mSanitize(sanitize),
+         mSanitizeValue(sanitizeValue),
+         mComputeStatistics(computeStatistics),
+         mBadValues(badValues),
+         mAborted(aborted)
+      {
+      }
+
+      const RasterElement* mpSource;
+      RasterElement* mpChip;
+      const vector<DimensionDescriptor>& mSelectedRows;
+      const vector<DimensionDescriptor>& mSelectedColumns;
+      const vector<DimensionDescriptor>& mSelectedBands;
+      bool mSanitize;                               // Statistics are only computed for sanitized data
+      double mSanitizeValue;
+      bool mComputeStatistics;
+      const vector<const BadValues*>& mBadValues;   // The bad values of the statistics of each band
+      const bool& mAborted;
+
+   private:
+      ImportInput& operator=(const ImportInput& rhs);
+   };
+
+   class ImportThread : public mta::AlgorithmThread
+   {
+   public:
+      ImportThread(const ImportInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter) :
+         AlgorithmThread(threadIndex, reporter),
+         mInput(input),
+         mRowRange(getThreadRange(threadCount, static_cast<int>(input.mSelectedRows.size()))),
+         mComplete(false),
+         mBadValueCount(0)
+      {
+      }
+
+      void run()
+      {
+         const RasterDataDescriptor* pChipDescriptor = dynamic_cast<const RasterDataDescriptor*>(
+            mInput.mpChip->getDataDescriptor());
+         if (pChipDescriptor == NULL)
+         {
+            getReporter().reportError("Could not get the RasterDataDescriptor of the imported data");
+            return;
+         }
+
+         if (mInput.mComputeStatistics)
+         {
+            mStatistics.assign(mInput.mSelectedBands.size(), StatisticsAccumulator(pChipDescriptor->getDataType()));
+         }
+
+         if (pChipDescriptor->getInterleaveFormat() == BSQ)
+         {
+            for (unsigned int band = 0; band < mInput.mSelectedBands.size(); ++band)
+            {
+               if (copyRows(pChipDescriptor, band) == false)
+               {
+                  return;
+               }
+            }
+         }
+         else if (copyRows(pChipDescriptor, 0) == false)
+         {
+            return;
+         }
+
+         mComplete = true;
+      }
+
+      bool isComplete() const
+      {
+         return mComplete;
+      }
+
+      uint64_t getBadValueCount() const
+      {
+         return mBadValueCount;
+      }
+
+      const vector<StatisticsAccumulator>& getStatistics() const
+      {
+         return mStatistics;
+      }
+
+   private:
+      ImportThread& operator=(const ImportThread& rhs);
+
+      // Copies the rows of the thread, for a single band of BSQ data or for all bands otherwise
+      bool copyRows(const RasterDataDescriptor* pChipDescriptor, unsigned int bandIndex)
+      {
+         const vector<DimensionDescriptor>& rows = mInput.mSelectedRows;
+         const vector<DimensionDescriptor>& columns = mInput.mSelectedColumns;
+         const vector<DimensionDescriptor>& bands = mInput.mSelectedBands;
+
+         const InterleaveFormatType interleave = pChipDescriptor->getInterleaveFormat();
+         const EncodingType dataType = pChipDescriptor->getDataType();
+         const size_t bytesPerElement = pChipDescriptor->getBytesPerElement();
+         const bool isBsq = (interleave == BSQ);
+
+         FactoryResource<DataRequest> pSrcRequest;
+         pSrcRequest->setInterleaveFormat(interleave);
+         pSrcRequest->setRows(rows[mRowRange.mFirst], rows[mRowRange.mLast]);
+         pSrcRequest->setColumns(columns.front(), columns.back());
+         if (isBsq)
+         {
+            pSrcRequest->setBands(bands[bandIndex], bands[bandIndex]);
+         }
+         DataAccessor srcDa = mInput.mpSource->getDataAccessor(pSrcRequest.release());
+
+         FactoryResource<DataRequest> pChipRequest;
+         pChipRequest->setWritable(true);
+         pChipRequest->setInterleaveFormat(interleave);
+         pChipRequest->setRows(pChipDescriptor->getActiveRow(mRowRange.mFirst),
+            pChipDescriptor->getActiveRow(mRowRange.mLast));
+         if (isBsq)
+         {
+            DimensionDescriptor band = pChipDescriptor->getActiveBand(bandIndex);
+            pChipRequest->setBands(band, band);
+         }
+         DataAccessor chipDa = mInput.mpChip->getDataAccessor(pChipRequest.release());
+
+         if (srcDa.isValid() == false || chipDa.isValid() == false)
+         {
+            getReporter().reportError("Could not access the data to import");
+            return false;
+         }
+
+         // Offsets of the selected columns and bands in a row of the source
+         const unsigned int startColumn = columns.front().getActiveNumber();
+         vector<size_t> columnOffsets(columns.size());
+         for (size_t column = 0; column < columns.size(); ++column)
+         {
+            columnOffsets[column] = columns[column].getActiveNumber() - startColumn;
+         }
+
+         const size_t numBands = isBsq ? 1 : bands.size();
+         vector<size_t> bandOffsets(numBands, 0);
+         if (isBsq == false)
+         {
+            for (size_t band = 0; band < numBands; ++band)
+            {
+               bandOffsets[band] = bands[band].getActiveNumber();
+            }
+         }
+
+         const bool contiguousColumns = (columnOffsets.back() + 1 == columns.size());
+         const bool allBands = isBsq || (bandOffsets.back() + 1 == numBands);
+
+         const vector<StatisticsAccumulator>::size_type firstStatistic = isBsq ? bandIndex : 0;
+         StatisticsAccumulator* pStatistics = mStatistics.empty() ? NULL : &mStatistics[firstStatistic];
+         const BadValues* const* pBadValues = mInput.mBadValues.empty() ? NULL : &mInput.mBadValues[firstStatistic];
+
+         const int numRows = mRowRange.mLast - mRowRange.mFirst + 1;
+         const int totalRows = numRows * (isBsq ? static_cast<int>(bands.size()) : 1);
+         const int rowsDone = numRows * (isBsq ? static_cast<int>(bandIndex) : 0);
+         int oldPercentDone = -1;
+
+         for (int row = mRowRange.mFirst; row <= mRowRange.mLast; ++row)
+         {
+            if (mInput.mAborted)
+            {
+               return false;
+            }
+
+            int percentDone = ((rowsDone + row - mRowRange.mFirst) * 100) / totalRows;
+            if (percentDone > oldPercentDone)
+            {
+               oldPercentDone = percentDone;
+               getReporter().reportProgress(getThreadIndex(), percentDone);
+            }
+
+            srcDa->toPixel(rows[row].getActiveNumber(), startColumn);
+            if (srcDa.isValid() == false || chipDa.isValid() == false)
+            {
+               getReporter().reportError("Could not access the data to import");
+               return false;
+            }
+
+            const char* pSrc = reinterpret_cast<const char*>(srcDa->getColumn());
+            char* pChip = reinterpret_cast<char*>(chipDa->getRow());
+            const size_t srcColumnPitch = srcDa->getColumnPitch();
+            const size_t srcBandPitch = srcDa->getBandPitch();
+            const size_t chipColumnPitch = chipDa->getColumnPitch();
+            const size_t chipBandPitch = chipDa->getBandPitch();
+
+            if (interleave == BIP)
+            {
+               if (allBands && contiguousColumns && srcColumnPitch == chipColumnPitch &&
+                  chipColumnPitch == numBands * bytesPerElement)
+               {
+                  memcpy(pChip, pSrc, columns.size() * chipColumnPitch);
+               }
+               else
+               {
+                  for (size_t column = 0; column < columns.size(); ++column)
+                  {
+                     const char* pSrcPixel = pSrc + columnOffsets[column] * srcColumnPitch;
+                     char* pChipPixel = pChip + column * chipColumnPitch;
+                     if (allBands)
+                     {
+                        memcpy(pChipPixel, pSrcPixel, numBands * bytesPerElement);
+                        continue;
+                     }
+
+                     for (size_t band = 0; band < numBands; ++band)
+                     {
+                        memcpy(pChipPixel + band * chipBandPitch, pSrcPixel + bandOffsets[band] * srcBandPitch,
+                           bytesPerElement);
+                     }
+                  }
+               }
+            }
+            else
+            {
+               for (size_t band = 0; band < numBands; ++band)
+               {
+                  const char* pSrcLine = pSrc + bandOffsets[band] * srcBandPitch;
+                  char* pChipLine = pChip + band * chipBandPitch;
+                  if (contiguousColumns)
+                  {
+                     memcpy(pChipLine, pSrcLine, columns.size() * bytesPerElement);
+                     continue;
+                  }
+
+                  for (size_t column = 0; column < columns.size(); ++column)
+                  {
+                     memcpy(pChipLine + column * bytesPerElement, pSrcLine + columnOffsets[column] * srcColumnPitch,
+                        bytesPerElement);
+                  }
+               }
+            }
+
+            if (mInput.mSanitize == false)
+            {
+               chipDa->nextRow();
+               continue;
+            }
+
+            // Sanitize the row and add it to the statistics while it is in the cache
+            if (dataType == FLT8COMPLEX)
+            {
+               for (size_t band = 0; band < numBands; ++band)
+               {
+                  for (size_t column = 0; column < columns.size(); ++column)
+                  {
+                     mBadValueCount += RasterUtilities::sanitizeData(pChip + column * chipColumnPitch +
+                        band * chipBandPitch, 1, dataType, mInput.mSanitizeValue);
+                  }
+               }
+            }
+            else
+            {
+               RowLayout layout;
+               layout.mColumns = columns.size();
+               layout.mBands = numBands;
+               layout.mColumnStride = static_cast<ptrdiff_t>(chipColumnPitch / bytesPerElement);
+               layout.mBandStride = static_cast<ptrdiff_t>(chipBandPitch / bytesPerElement);
+               switchOnEncoding(dataType, sanitizeAndAccumulate, pChip, layout, mInput.mSanitizeValue,
+                  mBadValueCount, pStatistics, pBadValues);
+            }
+
+            chipDa->nextRow();
+         }
+
+         return true;
+      }
+
+      const ImportInput& mInput;
+      Range mRowRange;
+      bool mComplete;
+      uint64_t mBadValueCount;
+      vector<StatisticsAccumulator> mStatistics;
+   };
+
+   class ImportOutput
+   {
+   public:
+      ImportOutput() :
+         mBadValueCount(0)
+      {
+      }
+
+      bool compileOverallResults(const vector<ImportThread*>& threads)
+      {
+         mBadValueCount = 0;
+         mStatistics.clear();
+         for (vector<ImportThread*>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
+         {
+            const ImportThread* pThread = *iter;
+            if (pThread == NULL || pThread->isComplete() == false)
+            {
+               return false;
+            }
+
+            mBadValueCount += pThread->getBadValueCount();
+
+            const vector<StatisticsAccumulator>& statistics = pThread->getStatistics();
+            mStatistics.resize(statistics.size());
+            for (vector<StatisticsAccumulator>::size_type band = 0; band < statistics.size(); ++band)
+            {
+               mStatistics[band].merge(statistics[band]);
+            }
+         }
+
+         return true;
+      }
+
+      uint64_t mBadValueCount;
+      vector<StatisticsAccumulator> mStatistics;
+   };
 }
 
 RasterElementImporterShell::RasterElementImporterShell() :
@@ -611,13 +977,13 @@ bool RasterElementImporterShell::performImport() const
          return checkAbortOrError("Could not create pager for source RasterElement", pStep.get());
       }
 
-      if (copyData(pSourceRaster.get()) == false)
+      double value = 0.0;
+      uint64_t badValueCount = 0;
+      if (importData(pSourceRaster.get(), value, badValueCount) == false)
       {
          return checkAbortOrError("Could not copy data from source RasterElement", pStep.get());
       }
 
-      double value = 0.0;
-      uint64_t badValueCount = mpRasterElement->sanitizeData(value);
       if (badValueCount != 0)
       {
          if (mpProgress != NULL)
@@ -1046,19 +1412,53 @@ bool RasterElementImporterShell::createRasterPager(RasterElement* pRaster) const
          return false;
       }
    }
+
+   if (RasterElementImporterShell::getSettingUseRawFilePager())
+   {
+      FactoryResource<Filename> pFilename;
+      pFilename->setFullPathAndName(srcFile);
+
+      ExecutableResource pPagerPlugIn("Raw File Pager", string(), mpProgress);
+      pPagerPlugIn->getInArgList().setPlugInArgValue(CachedPager::PagedElementArg(), pRaster);
+      pPagerPlugIn->getInArgList().setPlugInArgValue(CachedPager::PagedFilenameArg(), pFilename.get());
+
+      RasterPager* pPager = dynamic_cast<RasterPager*>(pPagerPlugIn->getPlugIn());
+      if (pPager != NULL && pPagerPlugIn->execute())
+      {
+         pRaster->setPager(pPager);
+         pPagerPlugIn->releasePlugIn();
+         mUsingMemoryMappedPager = false;
+         return true;
+      }
+   }
+
    mUsingMemoryMappedPager = pRaster->createMemoryMappedPager();
    return mUsingMemoryMappedPager;
 }
 
 bool RasterElementImporterShell::copyData(const RasterElement* pSrcElement) const
 {
+   uint64_t badValueCount = 0;
+   return importRows(pSrcElement, false, 0.0, badValueCount);
+}
+
+bool RasterElementImporterShell::importData(const RasterElement* pSrcElement, double sanitizeValue,
+                                            uint64_t& badValueCount) const
+{
+   return importRows(pSrcElement, true, sanitizeValue, badValueCount);
+}
+
+bool RasterElementImporterShell::importRows(const RasterElement* pSrcElement, bool sanitize, double sanitizeValue,
+                                            uint64_t& badValueCount) const
+{
+   badValueCount = 0;
    VERIFY(pSrcElement != NULL && mpRasterElement != NULL);
 
    const RasterDataDescriptor* pSrcDescriptor = dynamic_cast<const RasterDataDescriptor*>(
       pSrcElement->getDataDescriptor());
    RasterDataDescriptor* pChipDescriptor = dynamic_cast<RasterDataDescriptor*>(
       mpRasterElement->getDataDescriptor());
-   VERIFY(pSrcDescriptor != NULL && mpRasterElement != NULL);
+   VERIFY(pSrcDescriptor != NULL && pChipDescriptor != NULL);
 
    vector<DimensionDescriptor> selectedRows = getSelectedDims(pSrcDescriptor->getRows(),
       pChipDescriptor->getRows());
@@ -1066,18 +1466,60 @@ bool RasterElementImporterShell::copyData(const RasterElement* pSrcElement) cons
       pChipDescriptor->getColumns());
    vector<DimensionDescriptor> selectedBands = getSelectedDims(pSrcDescriptor->getBands(),
       pChipDescriptor->getBands());
-
-   bool success = true;
+   VERIFY(selectedRows.empty() == false && selectedColumns.empty() == false && selectedBands.empty() == false);
 
    Service<SessionManager> pSessionManager;
    if (pSessionManager->isSessionLoading() == false)
    {
-      success = RasterUtilities::chipMetadata(mpRasterElement->getMetadata(), selectedRows, selectedColumns,
-         selectedBands);
+      if (RasterUtilities::chipMetadata(mpRasterElement->getMetadata(), selectedRows, selectedColumns,
+         selectedBands) == false)
+      {
+         return false;
+      }
    }
 
-   success = success && pSrcElement->copyDataToChip(mpRasterElement, selectedRows, 
-      selectedColumns, selectedBands, mAborted, mpProgress);
+   // Statistics are computed for the value of non-complex data
+   const EncodingType dataType = pChipDescriptor->getDataType();
+   const bool computeStatistics = sanitize && RasterElementImporterShell::getSettingComputeImportStatistics() &&
+      dataType != INT4SCOMPLEX && dataType != FLT8COMPLEX;
 
-   return success;
+   const vector<DimensionDescriptor>& chipBands = pChipDescriptor->getBands();
+   vector<const BadValues*> badValues;
+   if (computeStatistics)
+   {
+      for (vector<DimensionDescriptor>::const_iterator iter = chipBands.begin(); iter != chipBands.end(); ++iter)
+      {
+         const Statistics* pStatistics = mpRasterElement->getStatistics(*iter);
+         badValues.push_back(pStatistics == NULL ? NULL : pStatistics->getBadValues());
+      }
+   }
+
+   ImportInput input(pSrcElement, mpRasterElement, selectedRows, selectedColumns, selectedBands, sanitize,
+      sanitizeValue, computeStatistics, badValues, mAborted);
+   ImportOutput output;
+   mta::ProgressObjectReporter reporter("Copying data", mpProgress);
+   mta::MultiThreadedAlgorithm<ImportInput, ImportOutput, ImportThread> importAlgorithm(
+      mta::getNumRequiredThreads(static_cast<unsigned int>(selectedRows.size())), input, output, &reporter);
+   if (importAlgorithm.run() != mta::SUCCESS)
+   {
+      return false;
+   }
+
+   badValueCount = output.mBadValueCount;
+   if (badValueCount != 0)
+   {
+      mpRasterElement->updateData();
+   }
+
+   // Set the statistics after updateData(), which resets them
+   if (computeStatistics && output.mStatistics.size() == chipBands.size())
+   {
+      const bool isInteger = (dataType != FLT4BYTES && dataType != FLT8BYTES);
+      for (vector<DimensionDescriptor>::size_type band = 0; band < chipBands.size(); ++band)
+      {
+         output.mStatistics[band].setStatistics(mpRasterElement->getStatistics(chipBands[band]), isInteger);
+      }
+   }
+
+   return true;
 }
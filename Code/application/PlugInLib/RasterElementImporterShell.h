@@ -10,6 +10,7 @@
 #ifndef RASTERELEMENTIMPORTERSHELL_H
 #define RASTERELEMENTIMPORTERSHELL_H
 
+#include "ConfigurationSettings.h"
 #include "DesktopServices.h"
 #include "ImporterShell.h"
 #include "ModelServices.h"
@@ -66,6 +67,9 @@ class Step;
 class RasterElementImporterShell : public ImporterShell
 {
 public:
+   SETTING(UseRawFilePager, RasterElementImporterShell, bool, false)
+   SETTING(ComputeImportStatistics, RasterElementImporterShell, bool, true)
+
    /**
     *  Creates a raster element importer plug-in.
     *
@@ -106,6 +110,9 @@ public:
     *           location is ProcessingLocation::ON_DISK_READ_ONLY or by
     *           creating a separate RasterElement and RasterPager and copying
     *           the data into the original RasterElement in the input arg list.
+    *           The data is copied by importData(), which also sanitizes it and,
+    *           if the ComputeImportStatistics setting is enabled, computes the
+    *           statistics of each band in the same pass.
     *           A RasterElement arg needs to be present in the input arg list
     *           for the method to complete successfully.
     */
@@ -393,6 +400,12 @@ protected:
     *  Overriding this method will allow the importer to get all
     *  of the copy and conversion capabilities provided by the default execute().
     *
+    *  The default implementation memory maps the file.  If the UseRawFilePager
+    *  setting is enabled, the file is instead read in blocks by the
+    *  "Raw File Pager" plug-in, which does not depend on page faults and can
+    *  bypass the system file cache.  Memory mapping is used if the file cannot
+    *  be read by that pager.
+    *
     *  @param pRaster
     *         The RasterElement to create the RasterPager for.
     *
@@ -403,6 +416,9 @@ protected:
    /**
     *  Copy data from the source element to the imported one.
     *
+    *  The data is copied as it is by the same threads as importData(), but
+    *  NaNs are not replaced and statistics are not computed.
+    *
     *  @param pSrcElement
     *         The source element to copy from.  The active rows, columns,
     *         and bands should be a superset of those being imported.
@@ -411,6 +427,32 @@ protected:
     */
    bool copyData(const RasterElement* pSrcElement) const;
 
+   /**
+    *  Copy, sanitize and compute the statistics of the imported data.
+    *
+    *  This does the work of copyData() and RasterElement::sanitizeData() in a
+    *  single pass over the data, and is used by the default execute().  The
+    *  rows are divided among several threads, and each thread reads a row
+    *  from the source element, writes it to the imported element, replaces
+    *  floating point NaNs in the row and adds the row to the statistics of
+    *  its bands.  If the ComputeImportStatistics
+    *  setting is enabled, the statistics of each band of the imported element
+    *  are set when the copy is complete, so the data is not read again when
+    *  the statistics are first displayed.  Statistics are not computed for
+    *  complex data.
+    *
+    *  @param pSrcElement
+    *         The source element to copy from.  The active rows, columns,
+    *         and bands should be a superset of those being imported.
+    *  @param sanitizeValue
+    *         The value which replaces floating point NaNs.
+    *  @param badValueCount
+    *         Returns the number of values which were replaced.
+    *
+    *  @return True if the copy was successful, false otherwise.
+    */
+   bool importData(const RasterElement* pSrcElement, double sanitizeValue, uint64_t& badValueCount) const;
+
    Service<DesktopServices> mpDesktop;
    Service<ModelServices> mpModel;
    Service<PlugInManagerServices> mpPlugInManager;
@@ -419,6 +461,10 @@ protected:
 private:
    bool checkAbortOrError(std::string message, Step* pStep, bool checkForError = true) const;
 
+   // Copies the data for copyData() and importData(), sanitizing it and computing its statistics if requested
+   bool importRows(const RasterElement* pSrcElement, bool sanitize, double sanitizeValue,
+      uint64_t& badValueCount) const;
+
    mutable bool mUsingMemoryMappedPager;
    Progress* mpProgress;
    RasterElement* mpRasterElement;
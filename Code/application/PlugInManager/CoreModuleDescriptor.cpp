@@ -9,6 +9,7 @@
 
 #include "AppVersion.h"
 #include "AppVerify.h"
+#include "CompressedMemoryPager.h"
 #include "CopyrightInformation.h"
 #include "CoreModuleDescriptor.h"
 #include "InMemoryPager.h"
@@ -71,6 +72,8 @@
 #include "PropertiesTiePointLayer.h"
 #include "PropertiesView.h"
 #include "PropertiesWavelengths.h"
+#include "RawFilePager.h"
+#include "VirtualChipPager.h"
 
 #include <string>
 #include <vector>
@@ -101,11 +104,14 @@ void CoreModuleDescriptor::unload()
 
 GENERATE_FACTORY(OpticksCore);
 
+REGISTER_PLUGIN_BASIC(OpticksCore, CompressedMemoryPager);
 REGISTER_PLUGIN_BASIC(OpticksCore, CopyrightInformation);
 REGISTER_PLUGIN_BASIC(OpticksCore, InMemoryPager);
 REGISTER_PLUGIN_BASIC(OpticksCore, MemoryMappedPager);
 REGISTER_PLUGIN_BASIC(OpticksCore, PointCloudInMemoryPager);
 REGISTER_PLUGIN_BASIC(OpticksCore, PointCloudMemoryMappedPager);
+REGISTER_PLUGIN_BASIC(OpticksCore, RawFilePager);
+REGISTER_PLUGIN_BASIC(OpticksCore, VirtualChipPager);
 REGISTER_PLUGIN(OpticksCore, OptionsAnimation, OptionQWidgetWrapper<OptionsAnimation>());
 REGISTER_PLUGIN(OpticksCore, OptionsAnnotationLayer, OptionQWidgetWrapper<OptionsAnnotationLayer>());
 REGISTER_PLUGIN(OpticksCore, OptionsAoiLayer, OptionQWidgetWrapper<OptionsAoiLayer>());
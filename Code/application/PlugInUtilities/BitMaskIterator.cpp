@@ -277,19 +277,31 @@ inline void BitMaskIterator::computeCount()
       mPixelCount = getNumRows() * getNumColumns();
       return;
    }
-   mPixelCount = mCurrentPixelCount;
-   unsigned int saveCurrentPixelCount = mCurrentPixelCount;
-   int savePixelX = mCurrentPixelX;
-   int savePixelY = mCurrentPixelY;
-   nextPixel();
-   while ((*this) != end())
+
+   // Count the runs of selected pixels instead of visiting each pixel
+   mPixelCount = 0;
+   vector<pair<int, int> > spans;
+   for (int row = mY1; row <= mY2; ++row)
    {
-      ++mPixelCount;
-      nextPixel();
+      mPixelCount += getRowSpans(row, spans);
+   }
+}
+
+int BitMaskIterator::getRowSpans(int row, vector<pair<int, int> >& spans) const
+{
+   spans.clear();
+   if (row < mY1 || row > mY2 || mX1 > mX2)
+   {
+      return 0;
    }
-   mCurrentPixelX = savePixelX;
-   mCurrentPixelY = savePixelY;
-   mCurrentPixelCount = saveCurrentPixelCount;
+
+   if (mpBitMask == NULL)
+   {
+      spans.push_back(make_pair(mX1, mX2 + 1));
+      return mX2 - mX1 + 1;
+   }
+
+   return mpBitMask->getRowSpans(row, mX1, mX2, spans);
 }
 
 void BitMaskIterator::getBoundingBox(int& x1, int& y1, int& x2, int& y2) const
@@ -8,9 +8,11 @@
  */
 
 #include "AppVerify.h"
+#include "bthread.h"
 #include "CachedPager.h"
 #include "DataDescriptor.h"
 #include "DataRequest.h"
+#include "DecimatedPage.h"
 #include "DMutex.h"
 #include "Filename.h"
 #include "ModelServices.h"
@@ -20,19 +22,178 @@
 #include "PlugInManagerServices.h"
 #include "RasterDataDescriptor.h"
 #include "RasterElement.h"
+#include "Slot.h"
 
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <map>
 using namespace std;
 
+/**
+ * A unit being fetched by one thread which other threads requesting the
+ * same unit wait for.
+ */
+struct CachedPager::Fetch
+{
+   Fetch() :
+      mDone(false)
+   {
+   }
+
+   bool mDone;
+   CachedPage::UnitPtr mpUnit;
+   mta::DThreadSignal mDoneSignal;
+};
+
+/**
+ * Reads units into the cache on a background thread.
+ *
+ * The thread runs until stop() is called by the pager as it is destroyed,
+ * which discards the queued units and waits for any unit being read.
+ */
+class CachedPager::ReadAhead
+{
+public:
+   ReadAhead(CachedPager& pager) :
+      mPager(pager),
+      mThread(static_cast<void*>(this), reinterpret_cast<void*>(ReadAhead::threadFunction)),
+      mLaunched(false),
+      mStop(false)
+   {
+   }
+
+   ~ReadAhead()
+   {
+      stop();
+   }
+
+   /**
+    * Discards the queued units and waits for any unit being read.  No more
+    * units are read after this returns.
+    */
+   void stop()
+   {
+      bool launched = false;
+      {
+         mta::MutexLock lock(mMutex);
+         mStop = true;
+         mQueue.clear();
+         mWorkSignal.ThreadSignalActivate();
+         launched = mLaunched;
+         mLaunched = false;
+      }
+
+      if (launched)
+      {
+         mThread.ThreadWait();
+      }
+   }
+
+   struct Item
+   {
+      InterleaveFormatType mFormat;
+      unsigned int mStartRow;
+      DimensionDescriptor mStartBand;
+      DimensionDescriptor mStopBand;
+
+      bool operator==(const Item& rhs) const
+      {
+         return mFormat == rhs.mFormat && mStartRow == rhs.mStartRow &&
+            mStartBand == rhs.mStartBand && mStopBand == rhs.mStopBand;
+      }
+   };
+
+   /**
+    * Records an access to a unit.
+    *
+    * @return True if read-ahead should be scheduled after this unit.
+    */
+   bool advance(unsigned int bandKey, unsigned int unitStartRow, bool newWalk)
+   {
+      mta::MutexLock lock(mMutex);
+      map<unsigned int, unsigned int>::iterator pLastUnit = mLastUnits.find(bandKey);
+      bool advancing = newWalk || (pLastUnit != mLastUnits.end() && unitStartRow > pLastUnit->second);
+      mLastUnits[bandKey] = unitStartRow;
+      return advancing;
+   }
+
+   void schedule(const Item& item)
+   {
+      mta::MutexLock lock(mMutex);
+      if (mStop || find(mQueue.begin(), mQueue.end(), item) != mQueue.end())
+      {
+         return;
+      }
+
+      mQueue.push_back(item);
+      if (!mLaunched)
+      {
+         mLaunched = mThread.ThreadLaunch();
+      }
+      mWorkSignal.ThreadSignalActivate();
+   }
+
+   static void threadFunction(ReadAhead* pReadAhead)
+   {
+      pReadAhead->run();
+   }
+
+private:
+   ReadAhead& operator=(const ReadAhead& rhs);
+
+   void run()
+   {
+      mMutex.MutexLock();
+      for (;;)
+      {
+         while (mQueue.empty() && !mStop)
+         {
+            mWorkSignal.ThreadSignalWait(&mMutex);
+         }
+         if (mStop)
+         {
+            break;
+         }
+
+         Item item = mQueue.front();
+         mQueue.pop_front();
+         mMutex.MutexUnlock();
+
+         mPager.readAhead(item.mFormat, item.mStartRow, item.mStartBand, item.mStopBand);
+
+         mMutex.MutexLock();
+      }
+      mMutex.MutexUnlock();
+   }
+
+   CachedPager& mPager;
+   BThread mThread;
+   mta::DMutex mMutex;
+   mta::DThreadSignal mWorkSignal;
+   deque<Item> mQueue;
+   map<unsigned int, unsigned int> mLastUnits;
+   bool mLaunched;
+   bool mStop;
+};
+
 CachedPager::CachedPager() :
-   mCache(10 * 1024 * 1024),
+   mCache(0),
    mpMutex(new mta::DMutex),
    mpDescriptor(NULL),
    mpRaster(NULL),
    mBytesPerBand(0),
    mColumnCount(0),
    mBandCount(0),
-   mRowCount(0)
+   mRowCount(0),
+   mActiveFetches(0),
+   mpFetchSlotSignal(new mta::DThreadSignal),
+   mReadAheadDepth(0),
+   mReadAheadSize(0)
 {
+   mpReadAhead.reset(new ReadAhead(*this));
+   Service<PlugInManagerServices>()->attach(SIGNAL_NAME(PlugInManagerServices, PlugInDestroyed),
+      Slot(this, &CachedPager::pagerDestroyed));
 }
 
 CachedPager::CachedPager(const int64_t cacheSize) :
@@ -43,12 +204,24 @@ CachedPager::CachedPager(const int64_t cacheSize) :
    mBytesPerBand(0),
    mColumnCount(0),
    mBandCount(0),
-   mRowCount(0)
+   mRowCount(0),
+   mActiveFetches(0),
+   mpFetchSlotSignal(new mta::DThreadSignal),
+   mReadAheadDepth(0),
+   mReadAheadSize(0)
 {
+   mpReadAhead.reset(new ReadAhead(*this));
+   Service<PlugInManagerServices>()->attach(SIGNAL_NAME(PlugInManagerServices, PlugInDestroyed),
+      Slot(this, &CachedPager::pagerDestroyed));
 }
 
 CachedPager::~CachedPager()
 {
+   Service<PlugInManagerServices>()->detach(SIGNAL_NAME(PlugInManagerServices, PlugInDestroyed),
+      Slot(this, &CachedPager::pagerDestroyed));
+
+   // The read-ahead was already stopped if the pager was destroyed with PlugInManagerServices
+   stopReadAhead();
 }
 
 bool CachedPager::getInputSpecification(PlugInArgList *&pArgList)
@@ -107,7 +280,9 @@ bool CachedPager::parseInputArgs(PlugInArgList *pInputArgList)
    }
    mFilename = pFilename->getFullPathAndName();
 
-   mCache.initialize(mBytesPerBand, mColumnCount, mBandCount);
+   mCache.initialize(mBytesPerBand, mColumnCount, mBandCount, getChunkSize());
+   mCache.setMemoryBudget(Service<ModelServices>()->getMemoryBudget(), mpRaster);
+   setReadAhead(CachedPager::getSettingReadAheadDepth(), CachedPager::getSettingReadAheadSize());
 
    return true;
 }
@@ -128,63 +303,305 @@ RasterPage* CachedPager::getPage(DataRequest *pOriginalRequest,
 
    VERIFYRV(pOriginalRequest != NULL, NULL);
 
-   mta::MutexLock lock(*mpMutex);
-
-
    InterleaveFormatType requestedFormat = pOriginalRequest->getInterleaveFormat();
-   DimensionDescriptor stopRow = pOriginalRequest->getStopRow();
    DimensionDescriptor stopBand = pOriginalRequest->getStopBand();
-   unsigned int concurrentBands = pOriginalRequest->getConcurrentBands();
 
    if (requestedFormat != mpDescriptor->getInterleaveFormat())
    {
       return NULL;
    }
 
-   CachedPage::UnitPtr pUnit = mCache.getUnit(pOriginalRequest, startRow, startBand);
+   // A decimated page is copied from the single unit containing its start row,
+   // so units which only contain skipped rows are never fetched
+   bool decimated = (pOriginalRequest->getRequestVersion(mpDescriptor) > 1);
+   DataRequest* pUnitRequest = pOriginalRequest;
+   FactoryResource<DataRequest> pDecimatedUnitRequest;
+   if (decimated)
+   {
+      pDecimatedUnitRequest->setInterleaveFormat(requestedFormat);
+      pDecimatedUnitRequest->setRows(startRow, startRow, 1);
+      pUnitRequest = pDecimatedUnitRequest.get();
+   }
 
-   DimensionDescriptor cacheStartBand = startBand;
-   DimensionDescriptor cacheStopBand = stopBand;
+   // The cache is thread-safe, so hits do not need to wait for another thread's fetch to complete
+   CachedPage::UnitPtr pUnit = mCache.getUnit(pUnitRequest, startRow, startBand);
    if (pUnit.get() == NULL) // cache miss
    {
-      if (requestedFormat != BSQ)
+      pUnit = getAlignedUnit(pUnitRequest, startRow, startBand, stopBand);
+   }
+
+   RasterPage* pPage = NULL;
+   if (decimated)
+   {
+      pPage = createDecimatedPage(pOriginalRequest, pUnit, startRow, startColumn, startBand);
+   }
+   else
+   {
+      pPage = mCache.createPage(pUnit, requestedFormat, startRow, startColumn, startBand);
+   }
+
+   if (pPage != NULL)
+   {
+      scheduleReadAhead(pOriginalRequest, pUnit, startRow, startBand, stopBand);
+   }
+
+   return pPage;
+}
+
+void CachedPager::scheduleReadAhead(DataRequest* pOriginalRequest, CachedPage::UnitPtr pUnit,
+   DimensionDescriptor startRow, DimensionDescriptor startBand, DimensionDescriptor stopBand)
+{
+   if (mReadAheadDepth == 0 || pUnit->getConcurrentRows() == 0)
+   {
+      return;
+   }
+
+   InterleaveFormatType requestedFormat = pOriginalRequest->getInterleaveFormat();
+   unsigned int unitStartRow = pUnit->getStartRow().getActiveNumber();
+   unsigned int nextUnitStartRow = unitStartRow + pUnit->getConcurrentRows();
+   unsigned int stopRow = pOriginalRequest->getStopRow().getActiveNumber();
+   if (nextUnitStartRow > stopRow)
+   {
+      return;
+   }
+
+   // Read ahead for new accessors which will walk past the end of this unit and
+   // for accessors moving forward from one unit to the next
+   bool newWalk = (startRow.getActiveNumber() == pOriginalRequest->getStartRow().getActiveNumber());
+   unsigned int bandKey = (requestedFormat == BSQ) ? startBand.getActiveNumber() : mBandCount;
+   if (mpReadAhead->advance(bandKey, unitStartRow, newWalk) == false)
+   {
+      return;
+   }
+
+   unsigned int rowsPerUnit = mCache.getRowsPerUnit(requestedFormat);
+   int64_t unitSize = static_cast<int64_t>(pUnit->getSize() / pUnit->getConcurrentRows()) * rowsPerUnit;
+   int64_t maxBytes = std::min(mReadAheadSize, mCache.getMaxCacheSize() / 2);
+   unsigned int depth = mReadAheadDepth;
+   if (unitSize > 0)
+   {
+      depth = static_cast<unsigned int>(std::min(static_cast<int64_t>(depth), maxBytes / unitSize));
+   }
+
+   // Only read the units containing rows which the request will return
+   unsigned int requestStartRow = pOriginalRequest->getStartRow().getActiveNumber();
+   unsigned int rowStride = std::max(pOriginalRequest->getRowStride(), 1U);
+
+   ReadAhead::Item item;
+   item.mFormat = requestedFormat;
+   item.mStartBand = startBand;
+   item.mStopBand = stopBand;
+   item.mStartRow = nextUnitStartRow;
+   for (unsigned int i = 0; i < depth; ++i)
+   {
+      item.mStartRow = requestStartRow + (item.mStartRow - requestStartRow + rowStride - 1) / rowStride * rowStride;
+      if (item.mStartRow > stopRow)
       {
-         cacheStartBand = DimensionDescriptor();
-         cacheStopBand = DimensionDescriptor();
-         concurrentBands = mBandCount;
+         break;
       }
 
-      // get a bunch more rows if you can to prevent a cache miss
-      unsigned int concurrentRows = std::max(pOriginalRequest->getConcurrentRows(),
-         static_cast<unsigned int>(getChunkSize() / (concurrentBands * mColumnCount * mBytesPerBand)));
-      concurrentRows = std::min(concurrentRows, stopRow.getActiveNumber() - startRow.getActiveNumber() + 1);
+      mpReadAhead->schedule(item);
+      item.mStartRow += rowsPerUnit - item.mStartRow % rowsPerUnit;
+   }
+}
+
+void CachedPager::readAhead(InterleaveFormatType requestedFormat, unsigned int startRow,
+   DimensionDescriptor startBand, DimensionDescriptor stopBand)
+{
+   DimensionDescriptor row = mpDescriptor->getActiveRow(startRow);
 
-      FactoryResource<DataRequest> pNewRequest;
-      pNewRequest->setInterleaveFormat(requestedFormat);
-      pNewRequest->setRows(startRow, stopRow, concurrentRows);
-      // Get full columns
-      pNewRequest->setBands(cacheStartBand, cacheStopBand);
+   FactoryResource<DataRequest> pRequest;
+   pRequest->setInterleaveFormat(requestedFormat);
+   pRequest->setRows(row, row, 1);
+
+   getAlignedUnit(pRequest.get(), row, startBand, stopBand);
+}
+
+CachedPage::UnitPtr CachedPager::getAlignedUnit(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
+   DimensionDescriptor startBand, DimensionDescriptor stopBand)
+{
+   InterleaveFormatType requestedFormat = pOriginalRequest->getInterleaveFormat();
+   unsigned int rowsPerUnit = mCache.getRowsPerUnit(requestedFormat);
+   unsigned int row = startRow.getActiveNumber();
+   FetchMap::key_type key(row - row % rowsPerUnit,
+      (requestedFormat == BSQ) ? startBand.getActiveNumber() : numeric_limits<unsigned int>::max());
 
-      pNewRequest->polish(mpDescriptor);
-      if (pNewRequest->validate(mpDescriptor) == true)
+   boost::shared_ptr<Fetch> pFetch(new Fetch);
+   {
+      mta::MutexLock lock(*mpMutex);
+      for (;;)
       {
-         pUnit = fetchUnit(pNewRequest.get());
+         // Another thread may have fetched the unit while this thread was waiting for the lock
+         CachedPage::UnitPtr pUnit = mCache.getUnit(pOriginalRequest, startRow, startBand, false);
+         if (pUnit.get() != NULL)
+         {
+            return pUnit;
+         }
+
+         FetchMap::iterator ppFetch = mFetches.find(key);
+         if (ppFetch == mFetches.end())
+         {
+            break;
+         }
+
+         // Wait for the other thread's fetch instead of decoding the same unit again
+         boost::shared_ptr<Fetch> pOtherFetch = ppFetch->second;
+         while (pOtherFetch->mDone == false)
+         {
+            pOtherFetch->mDoneSignal.ThreadSignalWait(mpMutex.get());
+         }
+
+         // The signal only wakes one thread, so pass it on to the next thread waiting for the same fetch
+         pOtherFetch->mDoneSignal.ThreadSignalActivate();
+         if (pOtherFetch->mpUnit.get() == NULL)
+         {
+            return CachedPage::UnitPtr();
+         }
+
+         // Look in the cache again since the fetched unit may not contain all of the requested rows
       }
+
+      mFetches[key] = pFetch;
+      while (mActiveFetches >= std::max(getMaxConcurrentFetches(), 1U))
+      {
+         mpFetchSlotSignal->ThreadSignalWait(mpMutex.get());
+      }
+      ++mActiveFetches;
    }
 
-   return mCache.createPage(pUnit, requestedFormat, startRow, startColumn, startBand);
+   // Fetch without the lock so that other units can be fetched and cache hits are not blocked
+   CachedPage::UnitPtr pUnit = fetchAlignedUnit(pOriginalRequest, startRow, startBand, stopBand);
+
+   // Add the unit before removing the fetch so that waiting threads find it in the cache
+   mCache.addUnit(pUnit);
+
+   mta::MutexLock lock(*mpMutex);
+   --mActiveFetches;
+   mpFetchSlotSignal->ThreadSignalActivate();
+
+   mFetches.erase(key);
+   pFetch->mpUnit = pUnit;
+   pFetch->mDone = true;
+   pFetch->mDoneSignal.ThreadSignalActivate();
+
+   return pUnit;
+}
+
+CachedPage::UnitPtr CachedPager::fetchAlignedUnit(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
+   DimensionDescriptor startBand, DimensionDescriptor stopBand)
+{
+   InterleaveFormatType requestedFormat = pOriginalRequest->getInterleaveFormat();
+   DimensionDescriptor cacheStartBand = startBand;
+   DimensionDescriptor cacheStopBand = stopBand;
+   if (requestedFormat != BSQ)
+   {
+      cacheStartBand = DimensionDescriptor();
+      cacheStopBand = DimensionDescriptor();
+   }
+
+   // Units start on a unit boundary so that the cache can find them with a single lookup, and
+   // contain whole units so that as many subsequent requests as possible will be cache hits
+   unsigned int rowsPerUnit = mCache.getRowsPerUnit(requestedFormat);
+   unsigned int row = startRow.getActiveNumber();
+   unsigned int unitStartRow = row - row % rowsPerUnit;
+   unsigned int concurrentRows = row - unitStartRow + pOriginalRequest->getConcurrentRows();
+   concurrentRows = ((concurrentRows + rowsPerUnit - 1) / rowsPerUnit) * rowsPerUnit;
+   concurrentRows = std::min(concurrentRows, static_cast<unsigned int>(mRowCount) - unitStartRow);
+
+   FactoryResource<DataRequest> pNewRequest;
+   pNewRequest->setInterleaveFormat(requestedFormat);
+   pNewRequest->setRows(mpDescriptor->getActiveRow(unitStartRow),
+      mpDescriptor->getActiveRow(mRowCount - 1), concurrentRows);
+   // Get full columns
+   pNewRequest->setBands(cacheStartBand, cacheStopBand);
+
+   pNewRequest->polish(mpDescriptor);
+   if (pNewRequest->validate(mpDescriptor) == false)
+   {
+      return CachedPage::UnitPtr();
+   }
+
+   return fetchUnit(pNewRequest.get());
+}
+
+RasterPage* CachedPager::createDecimatedPage(DataRequest* pOriginalRequest, CachedPage::UnitPtr pUnit,
+   DimensionDescriptor startRow, DimensionDescriptor startColumn, DimensionDescriptor startBand)
+{
+   if (pUnit.get() == NULL)
+   {
+      return NULL;
+   }
+
+   mCache.addUnit(pUnit);
+
+   InterleaveFormatType requestedFormat = pOriginalRequest->getInterleaveFormat();
+   size_t columnPitch = mBytesPerBand;
+   size_t bandPitch = 0;
+   size_t rowSize = static_cast<size_t>(mColumnCount) * mBytesPerBand;
+   size_t offset = static_cast<size_t>(startColumn.getActiveNumber()) * mBytesPerBand;
+   if (requestedFormat == BIP)
+   {
+      columnPitch *= mBandCount;
+      bandPitch = mBytesPerBand;
+      rowSize *= mBandCount;
+      offset = (static_cast<size_t>(startColumn.getActiveNumber()) * mBandCount + startBand.getActiveNumber()) *
+         mBytesPerBand;
+   }
+   else if (requestedFormat == BIL)
+   {
+      bandPitch = rowSize;
+      rowSize *= mBandCount;
+      offset += startBand.getActiveNumber() * bandPitch;
+   }
+   rowSize += pUnit->getInterlineBytes();
+
+   // The page holds the returned rows which are in this unit
+   unsigned int unitStartRow = pUnit->getStartRow().getActiveNumber();
+   unsigned int row = startRow.getActiveNumber();
+   unsigned int unitStopRow = unitStartRow + pUnit->getConcurrentRows() - 1;
+   if (row < unitStartRow || row > unitStopRow)
+   {
+      return NULL;
+   }
+
+   unsigned int rowStride = std::max(pOriginalRequest->getRowStride(), 1U);
+   std::auto_ptr<DecimatedPage> pPage(new DecimatedPage(pOriginalRequest, startRow, startColumn, startBand,
+      (unitStopRow - row) / rowStride + 1, mBytesPerBand));
+   if (pPage->getNumRows() == 0)
+   {
+      return NULL;
+   }
+
+   const char* pUnitData = pUnit->getRawData();
+   for (unsigned int pageRow = 0; pageRow < pPage->getNumRows(); ++pageRow)
+   {
+      pPage->copyRow(pageRow, pUnitData + (pPage->getSourceRow(pageRow) - unitStartRow) * rowSize + offset,
+         columnPitch, bandPitch);
+   }
+
+   return pPage.release();
 }
 
 void CachedPager::releasePage(RasterPage *pPage)
 {
-   mta::MutexLock lock(*mpMutex);
+   // Units are reference counted, so releasing a page does not modify the cache
+   CachedPage* pCachedPage = dynamic_cast<CachedPage*>(pPage);
+   if (pCachedPage != NULL)
+   {
+      delete pCachedPage;
+      return;
+   }
 
-   delete dynamic_cast<CachedPage*>(pPage);
+   DecimatedPage* pDecimatedPage = dynamic_cast<DecimatedPage*>(pPage);
+   if (pDecimatedPage != NULL)
+   {
+      delete pDecimatedPage;
+   }
 }
 
 int CachedPager::getSupportedRequestVersion() const
 {
-   return 1;
+   return 2;
 }
 
 const int CachedPager::getBytesPerBand() const
@@ -217,7 +634,37 @@ double CachedPager::getChunkSize() const
    return 1 * 1024 * 1024;
 }
 
+unsigned int CachedPager::getMaxConcurrentFetches() const
+{
+   return 1;
+}
+
 void CachedPager::resize(int64_t newSize)
 {
    mCache.resize(newSize);
 }
+
+const PageCache& CachedPager::getCache() const
+{
+   return mCache;
+}
+
+void CachedPager::setReadAhead(unsigned int depth, int64_t maxBytes)
+{
+   mReadAheadDepth = depth;
+   mReadAheadSize = maxBytes;
+}
+
+void CachedPager::stopReadAhead()
+{
+   mpReadAhead->stop();
+}
+
+void CachedPager::pagerDestroyed(Subject& subject, const string& signal, const boost::any& value)
+{
+   // Read-ahead calls fetchUnit(), so it is stopped before the destructor of the subclass runs
+   if (boost::any_cast<PlugIn*>(value) == dynamic_cast<PlugIn*>(this))
+   {
+      stopReadAhead();
+   }
+}
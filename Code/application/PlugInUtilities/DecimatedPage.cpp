@@ -0,0 +1,202 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "DataRequest.h"
+#include "DecimatedPage.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace
+{
+   // Pages of whole rows are made about this large so that short rows are not paged one at a time
+   const size_t sDefaultPageSize = 1024 * 1024;
+
+   // Returns the number of returned elements from start through stop
+   unsigned int getSampleCount(unsigned int start, unsigned int stop, unsigned int stride)
+   {
+      if (start > stop)
+      {
+         return 0;
+      }
+
+      return (stop - start) / stride + 1;
+   }
+
+   template<size_t Size>
+   void copyElements(const char* pSrc, size_t srcPitch, char* pDst, size_t dstPitch, unsigned int count)
+   {
+      for (unsigned int i = 0; i < count; ++i, pSrc += srcPitch, pDst += dstPitch)
+      {
+         memcpy(pDst, pSrc, Size);
+      }
+   }
+
+   void copyElements(const char* pSrc, size_t srcPitch, char* pDst, size_t dstPitch, unsigned int count,
+      unsigned int elementSize)
+   {
+      if (srcPitch == elementSize && dstPitch == elementSize)
+      {
+         memcpy(pDst, pSrc, count * elementSize);
+         return;
+      }
+
+      switch (elementSize)
+      {
+      case 1:
+         copyElements<1>(pSrc, srcPitch, pDst, dstPitch, count);
+         break;
+      case 2:
+         copyElements<2>(pSrc, srcPitch, pDst, dstPitch, count);
+         break;
+      case 4:
+         copyElements<4>(pSrc, srcPitch, pDst, dstPitch, count);
+         break;
+      case 8:
+         copyElements<8>(pSrc, srcPitch, pDst, dstPitch, count);
+         break;
+      case 16:
+         copyElements<16>(pSrc, srcPitch, pDst, dstPitch, count);
+         break;
+      default:
+         for (unsigned int i = 0; i < count; ++i, pSrc += srcPitch, pDst += dstPitch)
+         {
+            memcpy(pDst, pSrc, elementSize);
+         }
+         break;
+      }
+   }
+}
+
+DecimatedPage::DecimatedPage(const DataRequest* pRequest, DimensionDescriptor startRow,
+                             DimensionDescriptor startColumn, DimensionDescriptor startBand,
+                             unsigned int maxRows, unsigned int bytesPerElement) :
+   mInterleave(pRequest->getInterleaveFormat()),
+   mStartRow(startRow.getActiveNumber()),
+   mRowStride(std::max(pRequest->getRowStride(), 1U)),
+   mColumnStride(std::max(pRequest->getColumnStride(), 1U)),
+   mBandStride(std::max(pRequest->getBandStride(), 1U)),
+   mRows(0),
+   mColumns(0),
+   mBands(1),
+   mBytesPerElement(bytesPerElement)
+{
+   unsigned int stopColumn = pRequest->getStopColumn().getActiveNumber();
+   mColumns = std::min(pRequest->getConcurrentColumns(),
+      getSampleCount(startColumn.getActiveNumber(), stopColumn, mColumnStride));
+   if (mInterleave != BSQ)
+   {
+      mBands = std::min(pRequest->getConcurrentBands(), getSampleCount(startBand.getActiveNumber(),
+         pRequest->getStopBand().getActiveNumber(), mBandStride));
+   }
+
+   unsigned int rows = maxRows;
+   if (rows == 0)
+   {
+      rows = pRequest->getConcurrentRows();
+      unsigned int requestColumns = getSampleCount(pRequest->getStartColumn().getActiveNumber(), stopColumn,
+         mColumnStride);
+      size_t rowSize = static_cast<size_t>(mColumns) * mBands * mBytesPerElement;
+      if (mColumns == requestColumns && rowSize > 0)
+      {
+         rows = std::max(rows, static_cast<unsigned int>(sDefaultPageSize / rowSize));
+      }
+   }
+
+   mRows = std::min(rows, getSampleCount(mStartRow, pRequest->getStopRow().getActiveNumber(), mRowStride));
+   mData.resize(static_cast<size_t>(mRows) * mColumns * mBands * mBytesPerElement);
+}
+
+DecimatedPage::~DecimatedPage()
+{
+}
+
+unsigned int DecimatedPage::getSourceRow(unsigned int row) const
+{
+   return mStartRow + row * mRowStride;
+}
+
+void DecimatedPage::copyRow(unsigned int row, const void* pSrc, size_t columnPitch, size_t bandPitch)
+{
+   if (row >= mRows || pSrc == NULL)
+   {
+      return;
+   }
+
+   const size_t rowSize = static_cast<size_t>(mColumns) * mBands * mBytesPerElement;
+   const char* pSrcRow = reinterpret_cast<const char*>(pSrc);
+   char* pDstRow = &mData[row * rowSize];
+   const size_t srcColumnPitch = columnPitch * mColumnStride;
+   const size_t srcBandPitch = bandPitch * mBandStride;
+
+   switch (mInterleave)
+   {
+   case BIP:
+      // Copy along the longer dimension to keep the inner loop long
+      if (mBands <= mColumns)
+      {
+         for (unsigned int band = 0; band < mBands; ++band)
+         {
+            copyElements(pSrcRow + band * srcBandPitch, srcColumnPitch, pDstRow + band * mBytesPerElement,
+               mBands * mBytesPerElement, mColumns, mBytesPerElement);
+         }
+      }
+      else
+      {
+         for (unsigned int column = 0; column < mColumns; ++column)
+         {
+            copyElements(pSrcRow + column * srcColumnPitch, srcBandPitch,
+               pDstRow + column * mBands * mBytesPerElement, mBytesPerElement, mBands, mBytesPerElement);
+         }
+      }
+      break;
+   case BIL:
+      for (unsigned int band = 0; band < mBands; ++band)
+      {
+         copyElements(pSrcRow + band * srcBandPitch, srcColumnPitch,
+            pDstRow + band * mColumns * mBytesPerElement, mBytesPerElement, mColumns, mBytesPerElement);
+      }
+      break;
+   case BSQ:
+      copyElements(pSrcRow, srcColumnPitch, pDstRow, mBytesPerElement, mColumns, mBytesPerElement);
+      break;
+   default:
+      break;
+   }
+}
+
+void* DecimatedPage::getRawData()
+{
+   if (mData.empty())
+   {
+      return NULL;
+   }
+
+   return &mData.front();
+}
+
+unsigned int DecimatedPage::getNumRows()
+{
+   return mRows;
+}
+
+unsigned int DecimatedPage::getNumColumns()
+{
+   return mColumns;
+}
+
+unsigned int DecimatedPage::getNumBands()
+{
+   return mBands;
+}
+
+unsigned int DecimatedPage::getInterlineBytes()
+{
+   return 0;
+}
@@ -12,6 +12,9 @@
 
 #include "LocationType.h"
 
+#include <utility>
+#include <vector>
+
 class BitMask;
 class RasterElement;
 
@@ -439,6 +442,47 @@ public:
     */
    int getPixelColumnLocation() const;
 
+   /**
+    * Gets the runs of selected pixels in a row of the iterator's bounding box.
+    *
+    * Each run is a pair of the first column in the run and the column after
+    * the last column in the run, so that the run covers the columns
+    * [first, second).  The runs are ordered from left to right.  Iterating
+    * over the runs of each row from getBoundingBoxStartRow() to
+    * getBoundingBoxEndRow() visits the same pixels as iterating with
+    * nextPixel(), but does not test each pixel of the bounding box, so the
+    * time taken depends on the number of selected pixels rather than the area
+    * of the bounding box.
+    *
+    * @code
+    * BitMaskIterator iter(pBitMask, pRasterElement);
+    * std::vector<std::pair<int, int> > spans;
+    * for (int row = iter.getBoundingBoxStartRow(); row <= iter.getBoundingBoxEndRow(); ++row)
+    * {
+    *    iter.getRowSpans(row, spans);
+    *    for (std::vector<std::pair<int, int> >::const_iterator span = spans.begin(); span != spans.end(); ++span)
+    *    {
+    *       for (int column = span->first; column < span->second; ++column)
+    *       {
+    *          // Process the selected pixel at (column, row)
+    *       }
+    *    }
+    * }
+    * @endcode
+    *
+    * @param   row
+    *          The zero-based row number of the pixels.
+    * @param   spans
+    *          Populated with the runs of selected pixels in the row.  This is
+    *          empty if the row is outside the iterator's bounding box or none
+    *          of its pixels are selected.
+    *
+    * @return  Returns the number of selected pixels in the row.
+    *
+    * @see     getPixel(int,int) const
+    */
+   int getRowSpans(int row, std::vector<std::pair<int, int> >& spans) const;
+
 private:
    BitMaskIterator(BitMaskIterator, bool);
    bool getPixel() const;
@@ -13,17 +13,24 @@
 #include <string>
 
 #include "CachedPage.h"
+#include "ConfigurationSettings.h"
 #include "PageCache.h"
 #include "RasterPagerShell.h"
 #include "RasterPage.h"
 
+#include <boost/any.hpp>
+#include <boost/shared_ptr.hpp>
+#include <map>
 #include <memory>
+#include <utility>
 
 class RasterDataDescriptor;
 class RasterElement;
+class Subject;
 namespace mta
 {
    class DMutex;
+   class DThreadSignal;
 }
 
 /**
@@ -35,10 +42,27 @@ namespace mta
  *  to function with 2 threads, each reading odd and even rows).
  *  developers would take this class and extend it to support their 
  *  algorithm specific code.
+ *
+ *  When a data accessor walks forward through the rows, the following
+ *  units are read into the cache on a background thread while the current
+ *  unit is being processed.  The number of units read ahead and the maximum
+ *  number of bytes used for them can be changed with the ReadAheadDepth and
+ *  ReadAheadSize settings or with setReadAhead().  The read-ahead is stopped
+ *  when PlugInManagerServices::destroyPlugIn() is about to destroy the pager,
+ *  so subclasses do not need to stop it.
+ *
+ *  Units are fetched without holding a lock, so threads which miss the cache
+ *  on different units can fetch them at the same time, up to
+ *  getMaxConcurrentFetches().  A thread which needs a unit that is already
+ *  being fetched by another thread, including the read-ahead thread, waits
+ *  for that fetch instead of fetching the unit again.
  */
 class CachedPager : public RasterPagerShell
 {
 public:
+   SETTING(ReadAheadDepth, CachedPager, unsigned int, 2)
+   SETTING(ReadAheadSize, CachedPager, unsigned int, 8 * 1024 * 1024)
+
    /**
     * The name to use for the raster element argument.
     *
@@ -66,7 +90,8 @@ public:
    /**
     * Creates a CachedPager PlugIn.
     *
-    * Sets cache size to 10 MB. Sets writable flag to false.
+    * The cache has no size of its own and is limited by the MemoryBudget
+    * shared with the other pagers. Sets writable flag to false.
     *
     * Subclasses need to override private pure virtual methods to
     * open the file and get a block from that file.
@@ -76,7 +101,8 @@ public:
    /**
     * Creates a CachedPager PlugIn.
     *
-    * Sets cache size to cacheSize bytes. Sets writable flag to false.
+    * Sets cache size to cacheSize bytes, which limits the cache in addition
+    * to the MemoryBudget shared with the other pagers. Sets writable flag to false.
     *
     * Subclasses need to override private pure virtual methods to
     * open the file and get a block from that file.
@@ -225,7 +251,7 @@ public:
     *  via the getPage() method.
     *
     *  NOTE: This method will check to ensure that the RasterPage is a CachedPage
-    *        prior to removal and deletion.
+    *        or a DecimatedPage prior to removal and deletion.
     *
     *  This method should only release those
     *  RasterPage* that were returned by the getPage() method of the same
@@ -255,6 +281,10 @@ public:
     * If any higher-version fields are changed from the defaults, the core will
     * assume that the RasterPager is unable to handle them, and the request will not be fulfilled.
     *
+    * CachedPager supports version 2.  A page for a decimated request is copied
+    * from the unit containing its start row, so units which contain only
+    * skipped rows are never fetched.
+    *
     * @return The highest request version supported.
     *
     * @see DataRequest::getRequestVersion()
@@ -267,6 +297,30 @@ public:
     *         The new cache size in bytes.
     */
    void resize(int64_t newSize);
+
+   /**
+    *  Access the cache used by this pager.
+    *
+    *  This can be used to query the cache hit, miss, and eviction counts.
+    *
+    *  @return The cache used by this pager.
+    */
+   const PageCache& getCache() const;
+
+   /**
+    *  Set the amount of sequential read-ahead performed by this pager.
+    *
+    *  The defaults are taken from the ReadAheadDepth and ReadAheadSize settings
+    *  when the pager is executed.
+    *
+    *  @param depth
+    *         The maximum number of units to read ahead of the unit being
+    *         accessed.  Set to 0 to disable read-ahead.
+    *  @param maxBytes
+    *         The maximum number of bytes to read ahead.  Read-ahead will also
+    *         never use more than half of the cache.
+    */
+   void setReadAhead(unsigned int depth, int64_t maxBytes);
    
 protected:
    /**
@@ -318,6 +372,20 @@ protected:
     */
    virtual double getChunkSize() const;
 
+   /**
+    *  Returns the number of units which may be fetched at the same time.
+    *
+    *  Subclasses whose fetchUnit() can safely be called from several threads
+    *  at once, such as those which decode each unit with its own decoder,
+    *  should return a larger value so that multi-threaded algorithms are not
+    *  serialized on decoding.
+    *
+    *  @return  The maximum number of concurrent calls to fetchUnit().  The
+    *           default implementation returns 1, so fetchUnit() is never
+    *           called by more than one thread at a time.
+    */
+   virtual unsigned int getMaxConcurrentFetches() const;
+
 private:
    CachedPager& operator=(const CachedPager& rhs);
 
@@ -331,6 +399,35 @@ private:
    int mBandCount;
    int mRowCount;
 
+   CachedPage::UnitPtr getAlignedUnit(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
+      DimensionDescriptor startBand, DimensionDescriptor stopBand);
+   CachedPage::UnitPtr fetchAlignedUnit(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
+      DimensionDescriptor startBand, DimensionDescriptor stopBand);
+
+   // Units being fetched, keyed by the start row and band of the unit
+   struct Fetch;
+   typedef std::map<std::pair<unsigned int, unsigned int>, boost::shared_ptr<Fetch> > FetchMap;
+   FetchMap mFetches;
+   unsigned int mActiveFetches;
+   std::auto_ptr<mta::DThreadSignal> mpFetchSlotSignal;
+   RasterPage* createDecimatedPage(DataRequest* pOriginalRequest, CachedPage::UnitPtr pUnit,
+      DimensionDescriptor startRow, DimensionDescriptor startColumn, DimensionDescriptor startBand);
+
+   class ReadAhead;
+   friend class ReadAhead;
+   std::auto_ptr<ReadAhead> mpReadAhead;
+   unsigned int mReadAheadDepth;
+   int64_t mReadAheadSize;
+
+   // Read-ahead calls fetchUnit() on a background thread, so it is stopped when PlugInManagerServices is about to
+   // destroy the pager, before the destructor of the subclass runs
+   void pagerDestroyed(Subject& subject, const std::string& signal, const boost::any& value);
+   void stopReadAhead();
+   void scheduleReadAhead(DataRequest* pOriginalRequest, CachedPage::UnitPtr pUnit,
+      DimensionDescriptor startRow, DimensionDescriptor startBand, DimensionDescriptor stopBand);
+   void readAhead(InterleaveFormatType requestedFormat, unsigned int startRow,
+      DimensionDescriptor startBand, DimensionDescriptor stopBand);
+
    /**
     *  This method should be implemented to open the file and store a file handle to be
     *  closed upon destruction.
@@ -0,0 +1,143 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef DECIMATEDPAGE_H
+#define DECIMATEDPAGE_H
+
+#include "DimensionDescriptor.h"
+#include "RasterPage.h"
+#include "TypesFile.h"
+
+#include <stddef.h>
+#include <vector>
+
+class DataRequest;
+
+/**
+ * A RasterPage holding the rows, columns and bands of a decimated DataRequest.
+ *
+ * RasterPagers which support DataRequest version 2 create a DecimatedPage for
+ * requests with strides, and fill it one returned row at a time from their
+ * native data with copyRow().  The returned elements are packed together in
+ * the requested interleave with no interline bytes.
+ *
+ * @see DataRequest::setStrides()
+ */
+class DecimatedPage : public RasterPage
+{
+public:
+   /**
+    * Creates a page for part of a decimated request.
+    *
+    * The page contains the requested columns and bands from \p startColumn and
+    * \p startBand, limited by the concurrent columns and bands of the request.
+    *
+    * @param pRequest
+    *        The polished request.
+    * @param startRow
+    *        The first row of the page.  This must be a row returned by the request.
+    * @param startColumn
+    *        The first column of the page.
+    * @param startBand
+    *        The first band of the page.
+    * @param maxRows
+    *        The maximum number of returned rows in the page.  The page is also
+    *        limited to the stop row of the request.  If this is 0, the page
+    *        contains the concurrent rows of the request, or as many rows as
+    *        fill about a megabyte if the page contains whole rows of the request.
+    * @param bytesPerElement
+    *        The number of bytes in each data element.
+    */
+   DecimatedPage(const DataRequest* pRequest, DimensionDescriptor startRow, DimensionDescriptor startColumn,
+      DimensionDescriptor startBand, unsigned int maxRows, unsigned int bytesPerElement);
+
+   /**
+    * Destroys the page and its data.
+    */
+   ~DecimatedPage();
+
+   /**
+    * Returns the source row of a row in the page.
+    *
+    * @param row
+    *        The row in the page.
+    *
+    * @return The active number of the row in the RasterElement.
+    */
+   unsigned int getSourceRow(unsigned int row) const;
+
+   /**
+    * Copies the returned elements of a source row into the page.
+    *
+    * @param row
+    *        The row in the page to fill.
+    * @param pSrc
+    *        The address of the element at the first column and first band of
+    *        the page in the source row given by getSourceRow().
+    * @param columnPitch
+    *        The number of bytes from one column to the next in the source row.
+    * @param bandPitch
+    *        The number of bytes from one band to the next in the source row.
+    *        This is ignored for BSQ pages.
+    */
+   void copyRow(unsigned int row, const void* pSrc, size_t columnPitch, size_t bandPitch);
+
+   /**
+    * Returns the page data.
+    *
+    * @return The page data, or \c NULL if the page is empty.
+    */
+   void* getRawData();
+
+   /**
+    * Returns the number of rows in the page.
+    *
+    * @return The number of returned rows in the page, which is 0 if the start
+    *         row is after the stop row of the request.
+    */
+   unsigned int getNumRows();
+
+   /**
+    * Returns the number of columns in the page.
+    *
+    * @return The number of returned columns in each row.
+    */
+   unsigned int getNumColumns();
+
+   /**
+    * Returns the number of bands in the page.
+    *
+    * @return The number of returned bands in each row.
+    */
+   unsigned int getNumBands();
+
+   /**
+    * Returns the number of interline bytes in the page.
+    *
+    * @return Returns 0.
+    */
+   unsigned int getInterlineBytes();
+
+private:
+   DecimatedPage(const DecimatedPage& rhs);
+   DecimatedPage& operator=(const DecimatedPage& rhs);
+
+   InterleaveFormatType mInterleave;
+   unsigned int mStartRow;
+   unsigned int mRowStride;
+   unsigned int mColumnStride;
+   unsigned int mBandStride;
+   unsigned int mRows;
+   unsigned int mColumns;
+   unsigned int mBands;
+   unsigned int mBytesPerElement;
+   std::vector<char> mData;
+};
+
+#endif
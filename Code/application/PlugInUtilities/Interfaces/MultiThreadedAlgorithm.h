@@ -19,6 +19,9 @@
 #include "DMutex.h"
 #include "EnumWrapper.h"
 #include "MessageLogResource.h"
+#include "ThreadPool.h"
+
+#include <boost/atomic.hpp>
 
 #include <numeric>
 #include <algorithm>
@@ -66,6 +69,184 @@ public:
    virtual void run() = 0;
 };
 
+/**
+ * Work which is run by the application's thread pool.
+ *
+ * A task is a future for the work done by run().  submit() queues the task on
+ * the ThreadPool returned by UtilityServices::getThreadPool(), and wait()
+ * returns once run() has finished.  Subclasses return their results in member
+ * data, which may be read after wait() has returned.
+ *
+ * When wait() is called from a worker of the pool, the worker runs other
+ * queued tasks until the task has finished instead of blocking.  Tasks may
+ * therefore submit and wait for tasks of their own, such as a task for each
+ * band within a task for each file, without every worker ending up blocked.
+ * A task must not wait while holding a lock which a queued task may need.
+ *
+ * @code
+ * class SumTask : public mta::Task
+ * {
+ * public:
+ *    SumTask(const std::vector<double>& values) : mValues(values), mSum(0.0) {}
+ *    double getSum() const { return mSum; }
+ *
+ * protected:
+ *    void run() { mSum = std::accumulate(mValues.begin(), mValues.end(), 0.0); }
+ *
+ * private:
+ *    const std::vector<double>& mValues;
+ *    double mSum;
+ * };
+ *
+ * SumTask task(values);
+ * task.submit();
+ * // ... do other work ...
+ * task.wait();
+ * double sum = task.getSum();
+ * @endcode
+ */
+class Task : public ThreadPoolTask
+{
+public:
+   /**
+    * Creates a task which has not been submitted.
+    */
+   Task();
+
+   /**
+    * Destructor.
+    *
+    * A task which has been submitted must not be destroyed until wait() has
+    * returned.
+    */
+   virtual ~Task();
+
+   /**
+    * Queues the task to be run by the thread pool.
+    *
+    * The task may be submitted again once wait() has returned.  If the
+    * thread pool is not available, the task is run before this method
+    * returns.
+    */
+   void submit();
+
+   /**
+    * Queues the task to be run by the thread pool when no other tasks are
+    * queued.
+    *
+    * This should be used for work which does not hold up the user.  If the
+    * thread pool is not available, the task is run before this method
+    * returns.
+    *
+    * @see ThreadPool::submitBackground()
+    */
+   void submitBackground();
+
+   /**
+    * Waits for the task to finish.
+    *
+    * Only one thread may wait for a task.
+    */
+   void wait();
+
+   /**
+    * Queries whether the task has finished.
+    *
+    * @return True if run() has returned since the task was last submitted,
+    *         false otherwise.
+    */
+   bool isFinished() const;
+
+protected:
+   /**
+    * Does the work of the task.
+    *
+    * This method is called in a worker of the thread pool, or in a thread
+    * which is waiting for another task.
+    */
+   virtual void run() = 0;
+
+private:
+   Task(const Task& rhs);
+   Task& operator=(const Task& rhs);
+
+   void submit(bool background);
+   void execute();
+
+   mutable DMutex mMutex;
+   DThreadSignal mFinishedSignal;
+   bool mFinished;
+};
+
+/**
+ * Hands out chunks of the items processed by the threads of an algorithm.
+ *
+ * Each MultiThreadedAlgorithm has a scheduler, which is shared by its threads
+ * and used by AlgorithmThread::getNextChunk().
+ */
+class ChunkScheduler
+{
+public:
+   /**
+    * Creates a scheduler whose next chunk starts at the first item.
+    *
+    * @param threadCount
+    *        The number of threads which claim chunks.
+    */
+   explicit ChunkScheduler(int threadCount);
+
+   /**
+    * Starts handing out chunks from the first item again.
+    */
+   void reset();
+
+   /**
+    * Claims the next chunk of items.
+    *
+    * @param dataSize
+    *        The total number of items, which must be the same for each call.
+    * @param grainSize
+    *        The smallest number of items in a chunk.  Only the last chunk may
+    *        be smaller.
+    * @param guided
+    *        If true, each chunk holds a share of the remaining items so that
+    *        the chunks shrink towards the end of the data, but holds at least
+    *        \em grainSize items.  If false, each chunk holds \em grainSize
+    *        items.
+    * @param first
+    *        Returns the first item of the chunk.
+    * @param last
+    *        Returns the last item of the chunk.
+    *
+    * @return True if a chunk was claimed, or false if every item has already
+    *         been claimed.
+    */
+   bool claim(int dataSize, int grainSize, bool guided, int& first, int& last);
+
+   /**
+    * Counts items whose processing has finished.
+    *
+    * @param count
+    *        The number of items which were processed.
+    */
+   void complete(int count);
+
+   /**
+    * Returns the number of items whose processing has finished.
+    *
+    * @return The number of items passed to complete().
+    */
+   int getCompleted() const;
+
+private:
+   ChunkScheduler(const ChunkScheduler& rhs);
+   ChunkScheduler& operator=(const ChunkScheduler& rhs);
+
+   const int mThreadCount;
+   boost::atomic<int> mNext;
+   boost::atomic<int> mCompleted;
+};
+
 /**
  * Report progress and errors from a thread.
  */
@@ -259,7 +440,7 @@ private:
 };
 
 // this pragma shushes a compiler warning regarding the initialization
-// of the mThreadHandle with 'this'
+// of the mThreadHandle and mTask with 'this'
 #if defined(WIN_API)
 #pragma warning (push)
 #pragma warning (disable: 4355)
@@ -283,7 +464,13 @@ public:
       mpAlgorithmMutex(NULL),
       mReporter(reporter), 
       mThreadHandle(static_cast<void*>(this),  reinterpret_cast<void*>(AlgorithmThread::threadFunction)), 
-      mThreadIndex(threadIndex) {}
+      mThreadIndex(threadIndex),
+      mTask(*this),
+      mPooled(false),
+      mpChunkScheduler(NULL),
+      mChunkSize(0),
+      mChunkClaimed(false),
+      mBackground(false) {}
 
    /**
     * Destructor.
@@ -300,7 +487,13 @@ public:
       mpAlgorithmMutex(thread.mpAlgorithmMutex),
       mReporter(thread.mReporter), 
       mThreadHandle(static_cast<void*>(this),  reinterpret_cast<void*>(AlgorithmThread::threadFunction)),
-      mThreadIndex(thread.mThreadIndex) {}
+      mThreadIndex(thread.mThreadIndex),
+      mTask(*this),
+      mPooled(false),
+      mpChunkScheduler(thread.mpChunkScheduler),
+      mChunkSize(0),
+      mChunkClaimed(false),
+      mBackground(thread.mBackground) {}
 
    /**
     * The function executed by the underlying threading system.
@@ -318,6 +511,11 @@ public:
    /**
     * Launch the thread.
     *
+    * The thread runs as a task of the application's thread pool, so that no
+    * thread is created.  When the algorithm is run from a worker of the pool,
+    * which cannot run other tasks while it waits for the reports of its
+    * threads, a new thread is created instead.
+    *
     * @return False if there was an error.
     */
    bool launch();
@@ -347,6 +545,28 @@ public:
     */
    void setAlgorithmMutex(DMutex* pMutex);
 
+   /**
+    * Set the scheduler which hands out chunks to the threads in an algorithm
+    * cluster.
+    *
+    * This should be the same object for all threads in the algorithm cluster.
+    *
+    * @param pScheduler
+    *        The scheduler used by getNextChunk().
+    */
+   void setChunkScheduler(ChunkScheduler* pScheduler);
+
+   /**
+    * Set whether the thread runs as a background task of the thread pool.
+    *
+    * Background tasks only run on workers which have no other work, so they
+    * do not hold up algorithms which the user is waiting for.
+    *
+    * @param background
+    *        \c true to submit the thread with ThreadPool::submitBackground().
+    */
+   void setBackground(bool background);
+
    /**
     * Wait to begin thread execution.
     *
@@ -404,6 +624,57 @@ protected:
     */
    Range getThreadRange(int threadCount, int dataSize) const;
 
+   /**
+    * Claim the next chunk of the items to process.
+    *
+    * Instead of processing the range from getThreadRange(), which divides the
+    * items evenly between the threads before they start, a thread may claim
+    * chunks of the items until this method returns false.  A thread which
+    * finishes its chunks quickly, because its items were masked out, cached
+    * or otherwise cheap, then goes on to claim chunks which would have been
+    * left to slower threads, so the threads finish at nearly the same time.
+    *
+    * A thread must keep claiming chunks until this method returns false or
+    * the thread stops, since a chunk is counted as processed by
+    * computeChunkPercent() when the next chunk is claimed.
+    *
+    * @param dataSize
+    *        The total number of items which need to be processed by all of
+    *        the threads in the algorithm cluster.
+    * @param chunk
+    *        Returns the range of items to process.
+    * @param grainSize
+    *        The smallest number of items in a chunk, which should be large
+    *        enough that claiming a chunk and setting up to process it take
+    *        little time compared with processing its items.
+    * @param guided
+    *        If true, each chunk holds half of the remaining items divided by
+    *        the number of threads, but at least \em grainSize items, so that
+    *        the chunks are large at first and shrink towards the end of the
+    *        data.  If false, each chunk holds \em grainSize items.
+    *
+    * @return True if a chunk was claimed, or false if there are no more
+    *         items to process.
+    */
+   bool getNextChunk(int dataSize, Range& chunk, int grainSize = 1, bool guided = true);
+
+   /**
+    * Calculate the progress of the threads in an algorithm cluster which
+    * process chunks from getNextChunk().
+    *
+    * Since the threads share the items, the progress of each thread is the
+    * progress of all of the threads.
+    *
+    * @param dataSize
+    *        The total number of items, as passed to getNextChunk().
+    * @param chunk
+    *        The chunk which this thread is processing.
+    * @param index
+    *        The item of the chunk which this thread is processing.
+    * @return The percentage of the items which have been processed.
+    */
+   int computeChunkPercent(int dataSize, const Range& chunk, int index) const;
+
    /**
     * Get the id of this thread.
     *
@@ -419,10 +690,34 @@ protected:
    ThreadReporter& getReporter() const;
 
 private:
+   class PoolTask : public Task
+   {
+   public:
+      PoolTask(AlgorithmThread& thread) :
+         mThread(thread) {}
+
+   protected:
+      void run()
+      {
+         AlgorithmThread::threadFunction(&mThread);
+      }
+
+   private:
+      PoolTask& operator=(const PoolTask& rhs);
+
+      AlgorithmThread& mThread;
+   };
+
    DMutex* mpAlgorithmMutex;
    ThreadReporter& mReporter;
    BThread mThreadHandle;
    int mThreadIndex;
+   PoolTask mTask;
+   bool mPooled;
+   ChunkScheduler* mpChunkScheduler;
+   int mChunkSize;
+   bool mChunkClaimed;
+   bool mBackground;
 };
 
 #if defined(WIN_API)
@@ -452,6 +747,24 @@ private:
  *    // put per-thread information into member data here
  * };
  * @endcode
+ *
+ * When the cost of the items varies, such as rows which are partly masked out
+ * or which are cached, the thread can claim chunks of the items instead of
+ * processing the range from getThreadRange().
+ * @code
+ * void MyAlgorithmThread::run()
+ * {
+ *    Range chunk;
+ *    while (getNextChunk(mRowCount, chunk, 16))
+ *    {
+ *       for (int row = chunk.mFirst; row <= chunk.mLast; ++row)
+ *       {
+ *          getReporter().reportProgress(getThreadIndex(), computeChunkPercent(mRowCount, chunk, row));
+ *          // process the row
+ *       }
+ *    }
+ * }
+ * @endcode
  */
 
 /**
@@ -631,6 +944,10 @@ private:
 
 /**
  * An algorithm which distributes work between multiply threads. (SIMD)
+ *
+ * The threads run as tasks of the application's thread pool, so running an
+ * algorithm does not create any threads unless it is run from a worker of the
+ * pool.
  */
 template<class AlgInput, class AlgOutput, class AlgThread>
 class MultiThreadedAlgorithm
@@ -673,6 +990,27 @@ public:
       return mErrorText;
    }
 
+   /**
+    * Set whether the threads run as background tasks of the thread pool.
+    *
+    * This must be called before run().
+    *
+    * @param background
+    *        \c true if nobody waits for the result of the algorithm.
+    *
+    * @see AlgorithmThread::setBackground()
+    */
+   void setBackground(bool background)
+   {
+      for (typename std::vector<AlgThread*>::iterator iter = mThreads.begin(); iter != mThreads.end(); ++iter)
+      {
+         if (*iter != NULL)
+         {
+            (*iter)->setBackground(background);
+         }
+      }
+   }
+
 private:
    MultiThreadedAlgorithm& operator=(const MultiThreadedAlgorithm& rhs);
 
@@ -693,6 +1031,7 @@ private:
    DThreadSignal mSignalA;
    DMutex mMutexB;
    DThreadSignal mSignalB;
+   ChunkScheduler mChunkScheduler;
    std::string mErrorText;
 };
 
@@ -703,7 +1042,8 @@ MultiThreadedAlgorithm<AlgInput, AlgOutput, AlgThread>::MultiThreadedAlgorithm(i
    mInput(algInput),
    mOutput(algOutput),
    mpThreadReporter(NULL),
-   mpProgressReporter(pReporter)
+   mpProgressReporter(pReporter),
+   mChunkScheduler(threadCount)
 {
    mpThreadReporter = new MultiThreadReporter(threadCount, &mCurrentStatus, mMutexA, mSignalA, mMutexB, mSignalB);
    createThreads(threadCount);
@@ -737,6 +1077,7 @@ Result MultiThreadedAlgorithm<AlgInput, AlgOutput, AlgThread>::createThreads(int
       if (pThread != NULL)
       {
          pThread->setAlgorithmMutex(&mMutexA);
+         pThread->setChunkScheduler(&mChunkScheduler);
          mThreads.push_back(pThread);
       }
    }
@@ -750,6 +1091,7 @@ Result MultiThreadedAlgorithm<AlgInput, AlgOutput, AlgThread>::startAllThreads()
 
    mMutexA.MutexLock();
    mMutexB.MutexLock();
+   mChunkScheduler.reset();
 
    for (iter = mThreads.begin(); iter != mThreads.end(); ++iter)
    {
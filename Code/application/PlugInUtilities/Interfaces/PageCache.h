@@ -11,15 +11,19 @@
 #define PAGECACHE_H
 
 #include <list>
+#include <vector>
 
+#include <boost/atomic.hpp>
 #include <boost/shared_array.hpp>
 #include <boost/shared_ptr.hpp>
 #include "CachedPage.h"
 #include "DimensionDescriptor.h"
 #include "LocationType.h"
+#include "MemoryBudget.h"
 
 #include "TypesFile.h"
 
+class DataElement;
 class DataRequest;
 
 /**
@@ -29,6 +33,20 @@ class DataRequest;
  * For example, a multi-threaded algorithm could get a DataAccessor to odd
  * and even rows. These two threads would be able to share the same page.
  *
+ * Units are expected to start on a row which is a multiple of getRowsPerUnit(),
+ * which allows each unit to be found with a single hash lookup keyed on its
+ * start row and band.  The units are spread across a number of independently
+ * locked shards so that threads hitting different units do not contend with
+ * each other.  The byte limit and least-recently-used ordering are enforced
+ * across all of the shards.
+ *
+ * Once setMemoryBudget() is called, the cache is also a MemoryConsumer of the
+ * process-wide MemoryBudget, which releases its least recently used units
+ * when the memory held by all of the caches exceeds the budget.  A cache with
+ * no maximum size of its own is then limited only by the budget.  The budget
+ * is updated each time the cache grows by 1/64 of the budget limit, rather
+ * than for every unit added.
+ *
  * When clearing units from the cache, it simply removed the oldest units
  * from the cache.  It is possible that a CachedPage still holds a reference
  * to the released unit.  Since the units are consistently referred to with
@@ -36,14 +54,15 @@ class DataRequest;
  * is destroyed.  This does, however, allow duplicate units -- one that the cache
  * knows about, and one that a lingering CachedPage references.
  */
-class PageCache
+class PageCache : public MemoryConsumer
 {
 public:
    /**
     * Creates a thread-safe LRU PageCache.
     *
     * @param  maxCacheSize
-    *         The maximum size of the cache in bytes.
+    *         The maximum size of the cache in bytes.  If this is 0, the cache
+    *         has no maximum size of its own and is limited by the MemoryBudget.
     */
    PageCache(const int64_t maxCacheSize = 20000000);
 
@@ -57,13 +76,19 @@ public:
     *
     * See RasterPager::getPage() for details on the parameters.
     *
+    * @param  recordStatistics
+    *         If \c true, the lookup is counted in getHitCount() or getMissCount().
+    *         Callers which repeat a lookup after acquiring a lock should pass
+    *         \c false for the repeated lookup.
+    *
     * @return A CacheUnit object containing the startRow, startColumn, and startBand,
     *         and containing and least concurrentRows number of rows, concurrentColumns number
     *         of columns, and concurrentBands number of bands.
     */
    CachedPage::UnitPtr getUnit(DataRequest *pOriginalRequest,
-      DimensionDescriptor startRow, 
-      DimensionDescriptor startBand);
+      DimensionDescriptor startRow,
+      DimensionDescriptor startBand,
+      bool recordStatistics = true);
 
    /**
     * An STL list of PagePtr.
@@ -86,12 +111,45 @@ public:
     *         The number of columns in file on disk.
     * @param  bandCount
     *         The number of bands in the file on disk.
+    * @param  chunkSize
+    *         The approximate number of bytes which will be read into a single unit.
+    *         This is used to compute getRowsPerUnit().
+    */
+   void initialize(int bytesPerBand, int columnCount, int bandCount, double chunkSize = 1024 * 1024);
+
+   /**
+    * Registers the cache with a memory budget.
+    *
+    * The units in the cache then count toward the budget, and are released by
+    * the budget when the memory held by all of its consumers exceeds its limit.
+    *
+    * @param  pBudget
+    *         The budget, usually from ModelServices::getMemoryBudget().  If this
+    *         is NULL, the cache is removed from its current budget.
+    * @param  pElement
+    *         The element whose data is held by the cache.
     */
-   void initialize(int bytesPerBand, int columnCount, int bandCount);
+   void setMemoryBudget(MemoryBudget* pBudget, const DataElement* pElement);
+
+   /**
+    * Get the row granularity of units in this cache.
+    *
+    * Units should start on a row which is a multiple of this value and should
+    * contain a multiple of this many rows, unless the unit ends on the last row.
+    *
+    * @param  requestedFormat
+    *         The interleave of the units.  BSQ units contain a single band, and
+    *         so contain more rows per unit than BIP or BIL units.
+    *
+    * @return The number of rows in a unit.  This will always be at least 1.
+    */
+   unsigned int getRowsPerUnit(InterleaveFormatType requestedFormat) const;
 
    /**
     * Create a CachedPage for the given cache unit.
     *
+    * If the unit is not already in the cache, it is added to the cache.
+    *
     * @param  pUnit
     *         The unit to create the page for.
     * @param  requestedFormat
@@ -109,6 +167,18 @@ public:
    CachedPage *createPage(CachedPage::UnitPtr pUnit, InterleaveFormatType requestedFormat,
       DimensionDescriptor startRow, DimensionDescriptor startColumn, DimensionDescriptor startBand);
 
+   /**
+    * Add a unit to the cache without creating a page for it.
+    *
+    * This is used to populate the cache ahead of a request for the unit.
+    * If a different unit starting on the same row and band is already in the
+    * cache, it is replaced.
+    *
+    * @param  pUnit
+    *         The unit to add.  If this is NULL, the cache is not changed.
+    */
+   void addUnit(CachedPage::UnitPtr pUnit);
+
    /**
     *  Resize the cache.
     *  @param newSize
@@ -116,19 +186,70 @@ public:
     */
    void resize(int64_t newSize);
 
+   /**
+    * Get the maximum number of bytes which the cache will hold.
+    *
+    * @return The maximum size of the cache in bytes.  If the cache has no
+    *         maximum size of its own, this is the limit of its MemoryBudget.
+    */
+   int64_t getMaxCacheSize() const;
+
+   /**
+    * Get the number of bytes currently held by the cache.
+    *
+    * @return The sum of the sizes of all units in the cache.
+    */
+   int64_t getCacheSize() const;
+
+   /**
+    * Get the number of lookups which found a unit in the cache.
+    *
+    * @return The number of cache hits since initialize() was called.
+    */
+   uint64_t getHitCount() const;
+
+   /**
+    * Get the number of lookups which did not find a unit in the cache.
+    *
+    * @return The number of cache misses since initialize() was called.
+    */
+   uint64_t getMissCount() const;
+
+   /**
+    * Get the number of units which have been removed to stay under the cache size.
+    *
+    * @return The number of evicted units since initialize() was called.
+    */
+   uint64_t getEvictionCount() const;
+
+   // MemoryConsumer
+   int64_t getMemoryUsage() const;
+   bool getOldestAccess(uint64_t& accessTime) const;
+   int64_t releaseOldest();
+
 protected:
    int64_t mMaxCacheSize;
-   UnitList mUnits;
-   std::string mFilename;
-   int64_t mCacheSize;
    int mBytesPerBand;
    int mColumnCount;
    int mBandCount;
+   unsigned int mRowsPerUnit;
+   unsigned int mRowsPerBandUnit;
 
    void enforceCacheSize();
 
 private:
    PageCache& operator=(const PageCache& rhs);
+
+   class Shard;
+   Shard& getShard(unsigned int startRow, unsigned int band) const;
+   Shard* findOldestShard(int64_t& cacheSize, uint64_t& oldestAccess) const;
+   int64_t evictOldest(Shard& shard);
+   uint64_t getAccessTime() const;
+   void updateBudget(int64_t addedSize);
+
+   std::vector<boost::shared_ptr<Shard> > mShards;
+   MemoryBudget* mpBudget;
+   boost::atomic<int64_t> mUnbudgetedSize;   // Bytes added since the budget was last updated
 };
 
 #endif
@@ -0,0 +1,203 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef QUANTILESKETCH_H
+#define QUANTILESKETCH_H
+
+#include "Serializable.h"
+#include "TypesFile.h"
+
+#include <limits>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * Estimates the quantiles of a stream of values in a single pass.
+ *
+ * The sketch is a KLL sketch: values are kept in a stack of levels, where each
+ * value at level h stands for 2^h of the original values.  When the levels
+ * hold more values than their capacities, the values of the lowest full level
+ * are sorted and every other one is promoted to the next level.  The error in
+ * the rank of a quantile is a small fraction of the number of values, about 1%
+ * for the default size, and the sketch never holds more than about three times
+ * as many values as its size.
+ *
+ * Sketches of separate parts of the data, such as the rows processed by
+ * different threads, the tiles of an image or different files, can be combined
+ * with merge() and give the same accuracy as a sketch of all of the data.  The
+ * state of a sketch can be saved and restored with toXml() and fromXml().
+ *
+ * For 8 and 16 bit integer data, the number of times each value occurs is
+ * counted instead, so that the quantiles and histogram are exact.  If a value
+ * which is not a small integer is added to such a sketch, the counts are
+ * converted to levels without losing any values.
+ *
+ * Values which are NaN or infinite are ignored.
+ */
+class QuantileSketch : public Serializable
+{
+public:
+   /**
+    * Creates an empty sketch.
+    *
+    * @param type
+    *        The data type of the values.  The values of 8 and 16 bit integer
+    *        types are counted exactly.
+    * @param size
+    *        The capacity of the top level, which sets the accuracy of the
+    *        sketch.  The rank error is roughly 1.7 / \em size.
+    */
+   explicit QuantileSketch(EncodingType type = EncodingType(), unsigned int size = 200);
+
+   /**
+    * Adds a value.
+    *
+    * @param value
+    *        The value to add.
+    */
+   void add(double value)
+   {
+      // NaN and infinite values are the only values for which this is false
+      if (!(value - value == 0.0))
+      {
+         return;
+      }
+
+      ++mCount;
+      if (value < mMinimum)
+      {
+         mMinimum = value;
+      }
+      if (value > mMaximum)
+      {
+         mMaximum = value;
+      }
+
+      if (mExact)
+      {
+         double index = value - mFirstValue;
+         if (index >= 0.0 && index < static_cast<double>(mCounts.size()) && static_cast<double>(
+            static_cast<int64_t>(value)) == value)
+         {
+            ++mCounts[static_cast<size_t>(index)];
+         }
+         else
+         {
+            addCount(value);
+         }
+
+         return;
+      }
+
+      mLevels.front().push_back(value);
+      if (++mItemCount > mCapacity)
+      {
+         compress();
+      }
+   }
+
+   /**
+    * Adds the values counted by another sketch.
+    *
+    * @param other
+    *        The sketch to add.
+    */
+   void merge(const QuantileSketch& other);
+
+   /**
+    * Returns the number of values which have been added.
+    *
+    * @return The number of values.
+    */
+   uint64_t getCount() const;
+
+   /**
+    * Returns the smallest value.
+    *
+    * @return The smallest value, or 0 if no values have been added.
+    */
+   double getMinimum() const;
+
+   /**
+    * Returns the largest value.
+    *
+    * @return The largest value, or 0 if no values have been added.
+    */
+   double getMaximum() const;
+
+   /**
+    * Queries whether the values are counted exactly.
+    *
+    * @return True if the sketch holds the number of times each value occurs.
+    */
+   bool isExact() const;
+
+   /**
+    * Returns the exact counts of the values.
+    *
+    * @param firstValue
+    *        Returns the value counted by the first element of \em counts.
+    * @param counts
+    *        Returns the number of times each consecutive integer occurs.
+    *
+    * @return True if the counts were returned, or false if the sketch is not
+    *         exact.
+    */
+   bool getCounts(double& firstValue, std::vector<unsigned int>& counts) const;
+
+   /**
+    * Estimates a quantile.
+    *
+    * @param fraction
+    *        The fraction of the values from 0 to 1.
+    *
+    * @return The smallest value which is at least the given fraction of the
+    *         values, or 0 if no values have been added.
+    */
+   double getQuantile(double fraction) const;
+
+   /**
+    * Estimates the percentiles in the form used by Statistics.
+    *
+    * @param pPercentiles
+    *        Returns the 1001 values at each tenth of a percent, from the
+    *        minimum to the maximum.
+    */
+   void getPercentiles(double* pPercentiles) const;
+
+   bool toXml(XMLWriter* pXml) const;
+   bool fromXml(DOMNode* pDocument, unsigned int version);
+
+private:
+   // The largest number of consecutive integers which are counted exactly, the range of 16 bit data
+   static const size_t MAX_COUNTS = 65536;
+
+   void addCount(double value);
+   void convertCounts();
+   void addWeighted(double value, uint64_t weight);
+   void compress();
+   void updateCapacity();
+   void getWeightedValues(std::vector<std::pair<double, uint64_t> >& values) const;
+
+   unsigned int mSize;
+   uint64_t mCount;
+   double mMinimum;
+   double mMaximum;
+
+   bool mExact;
+   double mFirstValue;                          // The value counted by mCounts[0]
+   std::vector<unsigned int> mCounts;
+
+   std::vector<std::vector<double> > mLevels;   // Each value at level h has a weight of 2^h
+   size_t mItemCount;                           // The number of values in the levels
+   size_t mCapacity;                            // The number of values the levels can hold before compressing
+   bool mOddCompaction;                         // Alternates which half of a level is promoted
+};
+
+#endif
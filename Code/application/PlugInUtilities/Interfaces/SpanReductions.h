@@ -0,0 +1,331 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef SPANREDUCTIONS_H
+#define SPANREDUCTIONS_H
+
+#include "DataBlock.h"
+
+#include <limits>
+#include <stddef.h>
+
+/**
+ * Reductions over the typed spans of a DataBlock.
+ *
+ * Each function works on the elements of a DataSpan, usually one band of one
+ * row from DataAccessorImpl::getRowSpan() or DataBlock::getRowSpan().  The
+ * loops keep several independent partial results so that they are not limited
+ * by the latency of a single accumulator.  Contiguous spans of \c float and
+ * \c double, which are returned by a DataRequest with a data type, are reduced
+ * with SSE2 where it is available.
+ *
+ * Elements which are NaN, such as bad values returned by a DataRequest with
+ * DataRequest::getBadValuesAsNan(), are ignored.  Sums are accumulated in
+ * \c double.
+ */
+namespace SpanReductions
+{
+   /**
+    * The sums and extremes of a set of elements.
+    *
+    * Moments can be accumulated over many spans, such as all of the rows of a
+    * band, and then combined with merge().
+    */
+   struct Moments
+   {
+      Moments() :
+         mCount(0),
+         mSum(0.0),
+         mSumSquares(0.0),
+         mMinimum(std::numeric_limits<double>::infinity()),
+         mMaximum(-std::numeric_limits<double>::infinity())
+      {
+      }
+
+      /**
+       * Adds the elements counted by another Moments.
+       *
+       * @param   other
+       *          The moments to add.
+       */
+      void merge(const Moments& other)
+      {
+         mCount += other.mCount;
+         mSum += other.mSum;
+         mSumSquares += other.mSumSquares;
+         if (other.mMinimum < mMinimum)
+         {
+            mMinimum = other.mMinimum;
+         }
+         if (other.mMaximum > mMaximum)
+         {
+            mMaximum = other.mMaximum;
+         }
+      }
+
+      size_t mCount;       // Number of elements which are not NaN
+      double mSum;
+      double mSumSquares;
+      double mMinimum;     // Infinity if no elements have been counted
+      double mMaximum;     // Negative infinity if no elements have been counted
+   };
+
+   /**
+    * Returns the smallest element of a span.
+    *
+    * @param   span
+    *          The elements.
+    *
+    * @return  The smallest element, or infinity if the span has no elements
+    *          which are not NaN.
+    */
+   double minimum(const DataSpan<float>& span);
+   double minimum(const DataSpan<double>& span);
+
+   /**
+    * Returns the largest element of a span.
+    *
+    * @param   span
+    *          The elements.
+    *
+    * @return  The largest element, or negative infinity if the span has no
+    *          elements which are not NaN.
+    */
+   double maximum(const DataSpan<float>& span);
+   double maximum(const DataSpan<double>& span);
+
+   /**
+    * Returns the sum of the elements of a span.
+    *
+    * @param   span
+    *          The elements.
+    *
+    * @return  The sum of the elements.
+    */
+   double sum(const DataSpan<float>& span);
+   double sum(const DataSpan<double>& span);
+
+   /**
+    * Returns the sum of the squares of the elements of a span.
+    *
+    * @param   span
+    *          The elements.
+    *
+    * @return  The sum of the squares of the elements.
+    */
+   double sumOfSquares(const DataSpan<float>& span);
+   double sumOfSquares(const DataSpan<double>& span);
+
+   /**
+    * Returns the dot product of two spans.
+    *
+    * Products which are NaN because either element is NaN are ignored.
+    *
+    * @param   lhs
+    *          The first elements.
+    * @param   rhs
+    *          The second elements.
+    *
+    * @return  The sum of the products of the corresponding elements, up to the
+    *          length of the shorter span.
+    */
+   double dot(const DataSpan<float>& lhs, const DataSpan<float>& rhs);
+   double dot(const DataSpan<double>& lhs, const DataSpan<double>& rhs);
+
+   /**
+    * Adds the elements of a span to a set of moments.
+    *
+    * This finds the count, sum, sum of squares, minimum and maximum of the
+    * elements in a single pass.
+    *
+    * @param   span
+    *          The elements.
+    * @param   moments
+    *          The moments to update.
+    */
+   void accumulate(const DataSpan<float>& span, Moments& moments);
+   void accumulate(const DataSpan<double>& span, Moments& moments);
+
+   // Generic versions for the other element types and for strided spans
+
+   template<typename T>
+   inline bool isValid(T value)
+   {
+      // NaN is the only value which is not equal to itself
+      return value == value;
+   }
+
+   template<typename T>
+   double minimum(const DataSpan<T>& span)
+   {
+      double values[4] = { std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(),
+         std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity() };
+      const size_t count = span.getCount();
+      size_t i = 0;
+      for (; i + 4 <= count; i += 4)
+      {
+         for (size_t lane = 0; lane < 4; ++lane)
+         {
+            double value = static_cast<double>(span[i + lane]);
+            if (value < values[lane])
+            {
+               values[lane] = value;
+            }
+         }
+      }
+      for (; i < count; ++i)
+      {
+         double value = static_cast<double>(span[i]);
+         if (value < values[0])
+         {
+            values[0] = value;
+         }
+      }
+
+      double result = values[0];
+      for (size_t lane = 1; lane < 4; ++lane)
+      {
+         if (values[lane] < result)
+         {
+            result = values[lane];
+         }
+      }
+      return result;
+   }
+
+   template<typename T>
+   double maximum(const DataSpan<T>& span)
+   {
+      double values[4] = { -std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(),
+         -std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity() };
+      const size_t count = span.getCount();
+      size_t i = 0;
+      for (; i + 4 <= count; i += 4)
+      {
+         for (size_t lane = 0; lane < 4; ++lane)
+         {
+            double value = static_cast<double>(span[i + lane]);
+            if (value > values[lane])
+            {
+               values[lane] = value;
+            }
+         }
+      }
+      for (; i < count; ++i)
+      {
+         double value = static_cast<double>(span[i]);
+         if (value > values[0])
+         {
+            values[0] = value;
+         }
+      }
+
+      double result = values[0];
+      for (size_t lane = 1; lane < 4; ++lane)
+      {
+         if (values[lane] > result)
+         {
+            result = values[lane];
+         }
+      }
+      return result;
+   }
+
+   template<typename T>
+   double sum(const DataSpan<T>& span)
+   {
+      double sums[4] = { 0.0, 0.0, 0.0, 0.0 };
+      const size_t count = span.getCount();
+      size_t i = 0;
+      for (; i + 4 <= count; i += 4)
+      {
+         for (size_t lane = 0; lane < 4; ++lane)
+         {
+            double value = static_cast<double>(span[i + lane]);
+            sums[lane] += isValid(value) ? value : 0.0;
+         }
+      }
+      for (; i < count; ++i)
+      {
+         double value = static_cast<double>(span[i]);
+         sums[0] += isValid(value) ? value : 0.0;
+      }
+      return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+   }
+
+   template<typename T>
+   double sumOfSquares(const DataSpan<T>& span)
+   {
+      double sums[4] = { 0.0, 0.0, 0.0, 0.0 };
+      const size_t count = span.getCount();
+      size_t i = 0;
+      for (; i + 4 <= count; i += 4)
+      {
+         for (size_t lane = 0; lane < 4; ++lane)
+         {
+            double value = static_cast<double>(span[i + lane]);
+            sums[lane] += isValid(value) ? value * value : 0.0;
+         }
+      }
+      for (; i < count; ++i)
+      {
+         double value = static_cast<double>(span[i]);
+         sums[0] += isValid(value) ? value * value : 0.0;
+      }
+      return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+   }
+
+   template<typename T>
+   double dot(const DataSpan<T>& lhs, const DataSpan<T>& rhs)
+   {
+      double sums[4] = { 0.0, 0.0, 0.0, 0.0 };
+      const size_t count = lhs.getCount() < rhs.getCount() ? lhs.getCount() : rhs.getCount();
+      size_t i = 0;
+      for (; i + 4 <= count; i += 4)
+      {
+         for (size_t lane = 0; lane < 4; ++lane)
+         {
+            double product = static_cast<double>(lhs[i + lane]) * static_cast<double>(rhs[i + lane]);
+            sums[lane] += isValid(product) ? product : 0.0;
+         }
+      }
+      for (; i < count; ++i)
+      {
+         double product = static_cast<double>(lhs[i]) * static_cast<double>(rhs[i]);
+         sums[0] += isValid(product) ? product : 0.0;
+      }
+      return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+   }
+
+   template<typename T>
+   void accumulate(const DataSpan<T>& span, Moments& moments)
+   {
+      const size_t count = span.getCount();
+      for (size_t i = 0; i < count; ++i)
+      {
+         double value = static_cast<double>(span[i]);
+         if (isValid(value))
+         {
+            ++moments.mCount;
+            moments.mSum += value;
+            moments.mSumSquares += value * value;
+            if (value < moments.mMinimum)
+            {
+               moments.mMinimum = value;
+            }
+            if (value > moments.mMaximum)
+            {
+               moments.mMaximum = value;
+            }
+         }
+      }
+   }
+}
+
+#endif
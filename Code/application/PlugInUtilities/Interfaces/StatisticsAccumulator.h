@@ -0,0 +1,273 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef STATISTICSACCUMULATOR_H
+#define STATISTICSACCUMULATOR_H
+
+#include "BadValues.h"
+#include "DataBlock.h"
+#include "QuantileSketch.h"
+#include "TypesFile.h"
+
+#include <stddef.h>
+#include <vector>
+
+class Statistics;
+
+/**
+ * Accumulates the statistics of a band in a single pass over its data.
+ *
+ * Unlike the calculation in Statistics, which needs a first pass to find the
+ * minimum and maximum before a second pass can build the histogram, values
+ * are added to a histogram whose bins are powers of two wide and aligned to
+ * zero.  When a value falls outside of the bins, the bins are merged in pairs
+ * until the range of the data fits.  The histogram therefore always has a
+ * resolution of at least 1/2048 of the range of the data, and the histogram
+ * of integer data with a small range is exact.  The percentiles are estimated
+ * with a QuantileSketch, so that they do not depend on how the values are
+ * distributed within the bins, and are exact for 8 and 16 bit integer data.
+ *
+ * Accumulators for different parts of a band, such as the rows processed by
+ * different threads, can be combined with merge().  When all of the data has
+ * been added, setStatistics() computes the minimum, maximum, average, standard
+ * deviation, percentiles and histogram and stores them in a Statistics object,
+ * so that they are not computed again when they are first requested.
+ *
+ * Values which are NaN or infinite are ignored.
+ */
+class StatisticsAccumulator
+{
+public:
+   /**
+    * Creates an empty accumulator.
+    *
+    * @param type
+    *        The data type of the values, which allows the percentiles of 8 and
+    *        16 bit integer data to be computed exactly.
+    */
+   explicit StatisticsAccumulator(EncodingType type = EncodingType());
+
+   /**
+    * Adds a value.
+    *
+    * @param value
+    *        The value to add.
+    */
+   void add(double value)
+   {
+      // NaN and infinite values are the only values for which this is false
+      if (!(value - value == 0.0))
+      {
+         return;
+      }
+
+      ++mCount;
+      mSum += value;
+      mSumSquares += value * value;
+      if (value < mMinimum)
+      {
+         mMinimum = value;
+      }
+      if (value > mMaximum)
+      {
+         mMaximum = value;
+      }
+
+      mQuantiles.add(value);
+
+      double position = value * mScale - mFirstBin;
+      if (position >= 0.0 && position < static_cast<double>(BIN_COUNT))
+      {
+         ++mBins[static_cast<size_t>(position)];
+      }
+      else
+      {
+         addToHistogram(value);
+      }
+   }
+
+   /**
+    * Adds the values of a span which are not bad values.
+    *
+    * @param span
+    *        The values to add.
+    * @param pBadValues
+    *        The bad values to ignore.  This may be \c NULL.
+    */
+   template<typename T>
+   void accumulate(const DataSpan<T>& span, const BadValues* pBadValues = NULL)
+   {
+      const size_t count = span.getCount();
+      if (pBadValues == NULL || pBadValues->empty())
+      {
+         for (size_t i = 0; i < count; ++i)
+         {
+            add(static_cast<double>(span[i]));
+         }
+         return;
+      }
+
+      // Test the values a chunk at a time with the compiled bad value criteria
+      const size_t chunkSize = 1024;
+      unsigned char mask[chunkSize];
+      for (size_t start = 0; start < count; start += chunkSize)
+      {
+         const size_t chunk = (count - start < chunkSize) ? count - start : chunkSize;
+         size_t badValueCount = 0;
+         if (pBadValues->getValidityMask(&span[start], getEncoding(span.getData()), chunk, span.getStride(), mask,
+            badValueCount) == false)
+         {
+            for (size_t i = start; i < start + chunk; ++i)
+            {
+               double value = static_cast<double>(span[i]);
+               if (!pBadValues->isBadValue(value))
+               {
+                  add(value);
+               }
+            }
+            continue;
+         }
+
+         for (size_t i = 0; i < chunk; ++i)
+         {
+            if (mask[i] != 0)
+            {
+               add(static_cast<double>(span[start + i]));
+            }
+         }
+      }
+   }
+
+   /**
+    * Adds the values counted by another accumulator.
+    *
+    * @param other
+    *        The accumulator to add.
+    */
+   void merge(const StatisticsAccumulator& other);
+
+   /**
+    * Returns the number of values which have been added.
+    *
+    * @return The number of values.
+    */
+   uint64_t getCount() const;
+
+   /**
+    * Returns the smallest value.
+    *
+    * @return The smallest value, or 0 if no values have been added.
+    */
+   double getMinimum() const;
+
+   /**
+    * Returns the largest value.
+    *
+    * @return The largest value, or 0 if no values have been added.
+    */
+   double getMaximum() const;
+
+   /**
+    * Returns the average of the values.
+    *
+    * @return The average, or 0 if no values have been added.
+    */
+   double getAverage() const;
+
+   /**
+    * Returns the sample standard deviation of the values.
+    *
+    * @return The standard deviation, or 0 if fewer than two values have been
+    *         added.
+    */
+   double getStandardDeviation() const;
+
+   /**
+    * Computes the histogram and percentiles in the form used by Statistics.
+    *
+    * The bins match those of Statistics::getHistogram(): 256 bins from the
+    * minimum to the maximum, which are a whole number of values wide for
+    * integer data.  The histogram of 8 and 16 bit integer data is computed
+    * from the exact counts of getQuantiles(), from which the percentiles are
+    * also computed.
+    *
+    * @param isInteger
+    *        True if the values are from integer data.
+    * @param pBinCenters
+    *        Returns the centers of the 256 bins.
+    * @param pBinCounts
+    *        Returns the number of values in each of the 256 bins.
+    * @param pPercentiles
+    *        Returns the 1001 values at each tenth of a percent.
+    */
+   void getHistogram(bool isInteger, double* pBinCenters, unsigned int* pBinCounts, double* pPercentiles) const;
+
+   /**
+    * Returns the sketch from which the percentiles are computed.
+    *
+    * @return The quantile sketch of the values.
+    */
+   const QuantileSketch& getQuantiles() const;
+
+   /**
+    * Stores the statistics in a Statistics object.
+    *
+    * The statistics are stored for the default complex component, which is
+    * the value of non-complex data.
+    *
+    * @param pStatistics
+    *        The statistics to set.
+    * @param isInteger
+    *        True if the values are from integer data.
+    *
+    * @return True if the statistics were set, false if \em pStatistics is
+    *         \c NULL.
+    */
+   bool setStatistics(Statistics* pStatistics, bool isInteger) const;
+
+private:
+   static const int BIN_COUNT = 4096;
+
+   // The data type of the values tested by BadValues::getValidityMask(), which does not support other types
+   template<typename T>
+   static EncodingType getEncoding(const T*)
+   {
+      return EncodingType();
+   }
+   static EncodingType getEncoding(const char*) { return INT1SBYTE; }
+   static EncodingType getEncoding(const signed char*) { return INT1SBYTE; }
+   static EncodingType getEncoding(const unsigned char*) { return INT1UBYTE; }
+   static EncodingType getEncoding(const short*) { return INT2SBYTES; }
+   static EncodingType getEncoding(const unsigned short*) { return INT2UBYTES; }
+   static EncodingType getEncoding(const int*) { return INT4SBYTES; }
+   static EncodingType getEncoding(const unsigned int*) { return INT4UBYTES; }
+   static EncodingType getEncoding(const float*) { return FLT4BYTES; }
+   static EncodingType getEncoding(const double*) { return FLT8BYTES; }
+
+   void addToHistogram(double value);
+   void rebin(int exponent, int64_t firstBin);
+   bool moveBin(int bin, int shift, int64_t firstBin);
+   int getRequiredExponent(double minimum, double maximum, int exponent) const;
+
+   uint64_t mCount;
+   double mSum;
+   double mSumSquares;
+   double mMinimum;
+   double mMaximum;
+
+   int mExponent;                      // The bins are 2^mExponent wide
+   int64_t mFirst;                     // The index of the first bin from zero
+   double mScale;                      // 2^-mExponent
+   double mFirstBin;                   // mFirst as a double
+   std::vector<unsigned int> mBins;
+
+   QuantileSketch mQuantiles;
+};
+
+#endif
@@ -0,0 +1,98 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef TRANSPOSEUTILITIES_H
+#define TRANSPOSEUTILITIES_H
+
+#include <stddef.h>
+
+/**
+ * Functions to rearrange blocks of raster data elements between interleaves.
+ *
+ * Converting a row of data between interleaves is a transpose of a small
+ * matrix.  For example, a BIL row is a matrix of bands by columns and the
+ * corresponding BIP row is a matrix of columns by bands.  These functions
+ * transpose such matrices in cache-sized blocks using copies specialized for
+ * elements of 1, 2, 4, 8 and 16 bytes.  Where SSE2 is available, 2, 4 and 8
+ * byte elements are transposed in registers.
+ */
+namespace TransposeUtilities
+{
+   /**
+    * Transposes a matrix of data elements.
+    *
+    * Element \em j of source row \em i is copied to element \em i of
+    * destination row \em j.  The elements within each source row and within
+    * each destination row must be contiguous.  No alignment is required.
+    *
+    * @param   ppSrcRows
+    *          The address of the first element of each of the source rows.
+    *          This must contain \em rows entries.
+    * @param   rows
+    *          The number of source rows, which is the number of elements in
+    *          each destination row.
+    * @param   columns
+    *          The number of elements in each source row, which is the number
+    *          of destination rows.
+    * @param   pDst
+    *          The address of the first element of the first destination row.
+    *          This must not overlap the source.
+    * @param   dstRowStride
+    *          The number of bytes from the start of one destination row to the
+    *          start of the next.
+    * @param   elementSize
+    *          The number of bytes in a data element.
+    * @param   threadCount
+    *          The maximum number of threads which may be used.  Large matrices
+    *          are split by destination rows across this many threads.
+    */
+   void transpose(const void* const* ppSrcRows, size_t rows, size_t columns,
+      void* pDst, size_t dstRowStride, unsigned int elementSize, unsigned int threadCount = 1);
+
+   /**
+    * Transposes a matrix of data elements with evenly spaced source rows.
+    *
+    * @param   pSrc
+    *          The address of the first element of the first source row.
+    * @param   srcRowStride
+    *          The number of bytes from the start of one source row to the
+    *          start of the next.
+    * @param   rows
+    *          The number of source rows.
+    * @param   columns
+    *          The number of elements in each source row.
+    * @param   pDst
+    *          The address of the first element of the first destination row.
+    * @param   dstRowStride
+    *          The number of bytes from the start of one destination row to the
+    *          start of the next.
+    * @param   elementSize
+    *          The number of bytes in a data element.
+    * @param   threadCount
+    *          The maximum number of threads which may be used.
+    *
+    * @see     transpose(const void* const*, size_t, size_t, void*, size_t, unsigned int, unsigned int)
+    */
+   void transpose(const void* pSrc, size_t srcRowStride, size_t rows, size_t columns,
+      void* pDst, size_t dstRowStride, unsigned int elementSize, unsigned int threadCount = 1);
+
+   /**
+    * Transposes a matrix of data elements one element at a time.
+    *
+    * This produces the same result as transpose() by copying each element
+    * with a separate memcpy().  It is provided as a reference for testing and
+    * timing the blocked transpose.
+    *
+    * @see     transpose(const void* const*, size_t, size_t, void*, size_t, unsigned int, unsigned int)
+    */
+   void transposePerElement(const void* const* ppSrcRows, size_t rows, size_t columns,
+      void* pDst, size_t dstRowStride, unsigned int elementSize);
+}
+
+#endif
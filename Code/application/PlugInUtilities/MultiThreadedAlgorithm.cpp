@@ -11,6 +11,7 @@
 #include "MessageLogMgrImp.h"
 #include "Progress.h"
 #include "Units.h"
+#include "UtilityServices.h"
 
 using namespace mta;
 
@@ -34,6 +35,138 @@ unsigned int mta::getNumRequiredThreads(unsigned int dataSize)
    return threadCount;
 }
 
+//------------ Task ---------------//
+
+Task::Task() :
+   mFinished(true)
+{
+}
+
+Task::~Task()
+{
+}
+
+void Task::submit()
+{
+   submit(false);
+}
+
+void Task::submitBackground()
+{
+   submit(true);
+}
+
+void Task::submit(bool background)
+{
+   {
+      MutexLock lock(mMutex);
+      mFinished = false;
+   }
+
+   ThreadPool* pPool = Service<UtilityServices>()->getThreadPool();
+   if (pPool == NULL)
+   {
+      execute();
+      return;
+   }
+
+   if (background)
+   {
+      pPool->submitBackground(this);
+   }
+   else
+   {
+      pPool->submit(this);
+   }
+}
+
+void Task::wait()
+{
+   // A worker runs other tasks while it waits, and only blocks once no tasks are queued, at which point this
+   // task is already running in another thread
+   ThreadPool* pPool = Service<UtilityServices>()->getThreadPool();
+   if (pPool != NULL && pPool->isWorkerThread())
+   {
+      while (isFinished() == false && pPool->runPendingTask())
+      {
+      }
+   }
+
+   MutexLock lock(mMutex);
+   while (mFinished == false)
+   {
+      mFinishedSignal.ThreadSignalWait(&mMutex);
+   }
+}
+
+bool Task::isFinished() const
+{
+   MutexLock lock(mMutex);
+   return mFinished;
+}
+
+void Task::execute()
+{
+   run();
+
+   MutexLock lock(mMutex);
+   mFinished = true;
+   mFinishedSignal.ThreadSignalActivate();
+}
+
+//------------ ChunkScheduler ---------------//
+
+ChunkScheduler::ChunkScheduler(int threadCount) :
+   mThreadCount(std::max(threadCount, 1)),
+   mNext(0),
+   mCompleted(0)
+{
+}
+
+void ChunkScheduler::reset()
+{
+   mNext = 0;
+   mCompleted = 0;
+}
+
+bool ChunkScheduler::claim(int dataSize, int grainSize, bool guided, int& first, int& last)
+{
+   grainSize = std::max(grainSize, 1);
+
+   int next = mNext.load();
+   int count = 0;
+   do
+   {
+      if (next >= dataSize)
+      {
+         return false;
+      }
+
+      int remaining = dataSize - next;
+      count = grainSize;
+      if (guided)
+      {
+         count = std::max(count, remaining / (2 * mThreadCount));
+      }
+      count = std::min(count, remaining);
+   }
+   while (mNext.compare_exchange_weak(next, next + count) == false);
+
+   first = next;
+   last = next + count - 1;
+   return true;
+}
+
+void ChunkScheduler::complete(int count)
+{
+   mCompleted += count;
+}
+
+int ChunkScheduler::getCompleted() const
+{
+   return mCompleted.load();
+}
+
 //------------ MultiThreadReporter ---------------//
 
 /*
@@ -270,12 +403,35 @@ void AlgorithmThread::threadFunction(AlgorithmThread *pThreadData)
 
 bool AlgorithmThread::launch()
 {
+   // The thread which runs an algorithm blocks until its threads report, so an algorithm which is run from a
+   // worker of the pool must not wait for other workers, which may all be running such algorithms
+   ThreadPool* pPool = Service<UtilityServices>()->getThreadPool();
+   mPooled = (pPool != NULL && pPool->isWorkerThread() == false);
+   if (mPooled)
+   {
+      if (mBackground)
+      {
+         mTask.submitBackground();
+      }
+      else
+      {
+         mTask.submit();
+      }
+      return true;
+   }
+
    mThreadHandle.ThreadLaunch();
    return true;
 }
 
 bool AlgorithmThread::wait()
 {
+   if (mPooled)
+   {
+      mTask.wait();
+      return true;
+   }
+
    mThreadHandle.ThreadWait();
    return true;
 }
@@ -309,6 +465,50 @@ AlgorithmThread::Range AlgorithmThread::getThreadRange(int threadCount, int data
    return range;
 }
 
+bool AlgorithmThread::getNextChunk(int dataSize, Range& chunk, int grainSize, bool guided)
+{
+   // The previous chunk has been processed
+   if (mpChunkScheduler != NULL && mChunkSize > 0)
+   {
+      mpChunkScheduler->complete(mChunkSize);
+   }
+   mChunkSize = 0;
+
+   if (mpChunkScheduler == NULL)
+   {
+      // A thread which is not run by a MultiThreadedAlgorithm processes all of the items in one chunk
+      if (mChunkClaimed || dataSize <= 0)
+      {
+         return false;
+      }
+
+      mChunkClaimed = true;
+      chunk.mFirst = 0;
+      chunk.mLast = dataSize - 1;
+      return true;
+   }
+
+   if (mpChunkScheduler->claim(dataSize, grainSize, guided, chunk.mFirst, chunk.mLast) == false)
+   {
+      return false;
+   }
+
+   mChunkSize = chunk.mLast - chunk.mFirst + 1;
+   return true;
+}
+
+int AlgorithmThread::computeChunkPercent(int dataSize, const Range& chunk, int index) const
+{
+   if (dataSize <= 0)
+   {
+      return 100;
+   }
+
+   int completed = (mpChunkScheduler == NULL ? 0 : mpChunkScheduler->getCompleted());
+   int percent = static_cast<int>(100.0 * (completed + index - chunk.mFirst) / dataSize);
+   return std::min(std::max(percent, 0), 100);
+}
+
 int AlgorithmThread::getThreadIndex() const
 {
    return mThreadIndex;
@@ -329,6 +529,16 @@ void AlgorithmThread::setAlgorithmMutex(DMutex *pMutex)
    mpAlgorithmMutex = pMutex;
 }
 
+void AlgorithmThread::setChunkScheduler(ChunkScheduler* pScheduler)
+{
+   mpChunkScheduler = pScheduler;
+}
+
+void AlgorithmThread::setBackground(bool background)
+{
+   mBackground = background;
+}
+
 void AlgorithmThread::waitForAlgorithmLoop()
 {
    if (mpAlgorithmMutex != NULL)
@@ -9,28 +9,118 @@
 
 #include "AppVerify.h"
 #include "DataRequest.h"
+#include "DMutex.h"
 #include "PageCache.h"
 #include "TypesFile.h"
 
 #include <algorithm>
-#include <boost/bind.hpp>
-#include <sstream>
+#include <limits>
+#include <utility>
+#include <boost/atomic.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
 using namespace std;
 
+namespace
+{
+   // Must be a power of two
+   const unsigned int sShardCount = 16;
+
+   const unsigned int sAllBandsKey = numeric_limits<unsigned int>::max();
+
+   // The fraction of the budget limit which a cache grows by before it updates the budget
+   const int64_t sBudgetUpdateFraction = 64;
+
+   // Provides the least-recently-used ordering across all shards of a cache without a MemoryBudget
+   boost::atomic<uint64_t> sAccessCounter(0);
+
+   // startRow, band
+   typedef pair<unsigned int, unsigned int> UnitKey;
+
+   UnitKey makeKey(unsigned int startRow, DimensionDescriptor band)
+   {
+      return UnitKey(startRow, band.isActiveNumberValid() ? band.getActiveNumber() : sAllBandsKey);
+   }
+}
+
+class PageCache::Shard
+{
+public:
+   Shard() :
+      mSize(0),
+      mHits(0),
+      mMisses(0),
+      mEvictions(0)
+   {
+   }
+
+   struct Entry
+   {
+      Entry(UnitKey key, CachedPage::UnitPtr pUnit, uint64_t accessTime) :
+         mKey(key),
+         mpUnit(pUnit),
+         mLastAccess(accessTime)
+      {
+      }
+
+      UnitKey mKey;
+      CachedPage::UnitPtr mpUnit;
+      uint64_t mLastAccess;
+   };
+
+   // Ordered from least recently used to most recently used
+   typedef list<Entry> EntryList;
+   typedef boost::unordered_map<UnitKey, EntryList::iterator> Index;
+
+   void touch(EntryList::iterator entry, uint64_t accessTime)
+   {
+      entry->mLastAccess = accessTime;
+      mEntries.splice(mEntries.end(), mEntries, entry);
+   }
+
+   void erase(EntryList::iterator entry)
+   {
+      mSize -= entry->mpUnit->getSize();
+      mIndex.erase(entry->mKey);
+      mEntries.erase(entry);
+   }
+
+   mta::DMutex mMutex;
+   EntryList mEntries;
+   Index mIndex;
+   int64_t mSize;
+   uint64_t mHits;
+   uint64_t mMisses;
+   uint64_t mEvictions;
+};
+
 PageCache::PageCache(const int64_t maxCacheSize) :
    mMaxCacheSize(maxCacheSize),
-   mCacheSize(0)
+   mpBudget(NULL),
+   mUnbudgetedSize(0)
 {
+   for (unsigned int i = 0; i < sShardCount; ++i)
+   {
+      mShards.push_back(boost::shared_ptr<Shard>(new Shard));
+   }
    initialize(0, 0, 0);
 }
 
 PageCache::~PageCache()
 {
+   setMemoryBudget(NULL, NULL);
+}
+
+PageCache::Shard& PageCache::getShard(unsigned int startRow, unsigned int band) const
+{
+   size_t hash = boost::hash<UnitKey>()(UnitKey(startRow, band));
+   return *mShards[hash & (sShardCount - 1)];
 }
 
 CachedPage::UnitPtr PageCache::getUnit(DataRequest *pOriginalRequest,
-   DimensionDescriptor startRow, 
-   DimensionDescriptor startBand)
+   DimensionDescriptor startRow,
+   DimensionDescriptor startBand,
+   bool recordStatistics)
 {
    CachedPage::UnitPtr pUnit;
 
@@ -44,16 +134,28 @@ CachedPage::UnitPtr PageCache::getUnit(DataRequest *pOriginalRequest,
    {
       band = startBand;
    }
-   UnitList ::iterator ppMatchingUnit = find_if (mUnits.begin(), mUnits.end(), 
-      boost::bind(&CachedPage::CacheUnit::matches, _1, startRow, concurrentRows, band));
 
-   if (ppMatchingUnit != mUnits.end()) // cache hit
-   {
-      pUnit = (*ppMatchingUnit);
+   // The only unit which can contain startRow is the one starting at the preceding unit boundary
+   unsigned int row = startRow.getActiveNumber();
+   UnitKey key = makeKey(row - row % getRowsPerUnit(requestedFormat), band);
 
-      // Remove from the list -- it will be re-added to the end in createPage()
-      mUnits.erase(ppMatchingUnit);
-      mCacheSize -= pUnit->getSize();
+   Shard& shard = getShard(key.first, key.second);
+   mta::MutexLock lock(shard.mMutex);
+
+   Shard::Index::iterator ppMatchingEntry = shard.mIndex.find(key);
+   if (ppMatchingEntry != shard.mIndex.end() &&
+      ppMatchingEntry->second->mpUnit->matches(startRow, concurrentRows, band)) // cache hit
+   {
+      pUnit = ppMatchingEntry->second->mpUnit;
+      shard.touch(ppMatchingEntry->second, getAccessTime());
+      if (recordStatistics)
+      {
+         ++shard.mHits;
+      }
+   }
+   else if (recordStatistics)
+   {
+      ++shard.mMisses;
    }
 
    return pUnit;
@@ -67,9 +169,7 @@ CachedPage *PageCache::createPage(CachedPage::UnitPtr pUnit, InterleaveFormatTyp
       return NULL;
    }
 
-   mUnits.push_back(pUnit);
-   mCacheSize += pUnit->getSize();
-   enforceCacheSize();
+   addUnit(pUnit);
 
    int columnOffset = mColumnCount*(startRow.getActiveNumber()-pUnit->getStartRow().getActiveNumber());
    unsigned int offset = 0;
@@ -98,13 +198,158 @@ CachedPage *PageCache::createPage(CachedPage::UnitPtr pUnit, InterleaveFormatTyp
    return new CachedPage(pUnit, offset, startRow);
 }
 
+void PageCache::addUnit(CachedPage::UnitPtr pUnit)
+{
+   if (pUnit.get() == NULL)
+   {
+      return;
+   }
+
+   UnitKey key = makeKey(pUnit->getStartRow().getActiveNumber(), pUnit->getBand());
+   bool added = false;
+   {
+      Shard& shard = getShard(key.first, key.second);
+      mta::MutexLock lock(shard.mMutex);
+
+      Shard::Index::iterator ppEntry = shard.mIndex.find(key);
+      if (ppEntry == shard.mIndex.end() || ppEntry->second->mpUnit != pUnit)
+      {
+         // Replace any smaller unit which started on the same row
+         if (ppEntry != shard.mIndex.end())
+         {
+            shard.erase(ppEntry->second);
+         }
+
+         shard.mEntries.push_back(Shard::Entry(key, pUnit, getAccessTime()));
+         shard.mIndex[key] = --shard.mEntries.end();
+         shard.mSize += pUnit->getSize();
+         added = true;
+      }
+   }
+
+   // Pages created from a unit which is already in the cache do not change its size
+   if (added)
+   {
+      enforceCacheSize();
+      updateBudget(pUnit->getSize());
+   }
+}
+
+PageCache::Shard* PageCache::findOldestShard(int64_t& cacheSize, uint64_t& oldestAccess) const
+{
+   // The globally least recently used unit is the oldest unit in one of the shards
+   cacheSize = 0;
+   oldestAccess = numeric_limits<uint64_t>::max();
+   Shard* pOldestShard = NULL;
+   for (vector<boost::shared_ptr<Shard> >::const_iterator iter = mShards.begin(); iter != mShards.end(); ++iter)
+   {
+      Shard& shard = **iter;
+      mta::MutexLock lock(shard.mMutex);
+      cacheSize += shard.mSize;
+      if (!shard.mEntries.empty() && shard.mEntries.front().mLastAccess < oldestAccess)
+      {
+         oldestAccess = shard.mEntries.front().mLastAccess;
+         pOldestShard = &shard;
+      }
+   }
+   return pOldestShard;
+}
+
+int64_t PageCache::evictOldest(Shard& shard)
+{
+   mta::MutexLock lock(shard.mMutex);
+   if (shard.mEntries.empty())
+   {
+      return 0;
+   }
+
+   int64_t size = shard.mEntries.front().mpUnit->getSize();
+   shard.erase(shard.mEntries.begin());
+   ++shard.mEvictions;
+   return size;
+}
+
+uint64_t PageCache::getAccessTime() const
+{
+   // Access times from the budget can be compared with those of the other caches in the budget
+   if (mpBudget != NULL)
+   {
+      return mpBudget->getAccessTime();
+   }
+   return ++sAccessCounter;
+}
+
 void PageCache::enforceCacheSize()
 {
-   while (mCacheSize > mMaxCacheSize && !mUnits.empty())
+   while (mMaxCacheSize > 0)
+   {
+      int64_t cacheSize = 0;
+      uint64_t oldestAccess = 0;
+      Shard* pOldestShard = findOldestShard(cacheSize, oldestAccess);
+      if (cacheSize <= mMaxCacheSize || pOldestShard == NULL)
+      {
+         break;
+      }
+
+      evictOldest(*pOldestShard);
+   }
+}
+
+void PageCache::updateBudget(int64_t addedSize)
+{
+   if (mpBudget == NULL)
+   {
+      return;
+   }
+
+   // Updating the budget walks every consumer and locks its shards, so it is only done once the cache has grown
+   // by a fraction of the limit instead of for every unit which is fetched
+   int64_t unbudgetedSize = (mUnbudgetedSize += addedSize);
+   if (unbudgetedSize < mpBudget->getLimit() / sBudgetUpdateFraction)
+   {
+      return;
+   }
+
+   mUnbudgetedSize -= unbudgetedSize;
+   mpBudget->update();
+}
+
+void PageCache::setMemoryBudget(MemoryBudget* pBudget, const DataElement* pElement)
+{
+   if (mpBudget != NULL)
    {
-      mCacheSize -= mUnits.front()->getSize();
-      mUnits.pop_front();
+      mpBudget->removeConsumer(this);
    }
+
+   mpBudget = pBudget;
+   mUnbudgetedSize = 0;
+   if (mpBudget != NULL)
+   {
+      mpBudget->addConsumer(this, pElement);
+   }
+}
+
+int64_t PageCache::getMemoryUsage() const
+{
+   return getCacheSize();
+}
+
+bool PageCache::getOldestAccess(uint64_t& accessTime) const
+{
+   int64_t cacheSize = 0;
+   return findOldestShard(cacheSize, accessTime) != NULL;
+}
+
+int64_t PageCache::releaseOldest()
+{
+   int64_t cacheSize = 0;
+   uint64_t oldestAccess = 0;
+   Shard* pOldestShard = findOldestShard(cacheSize, oldestAccess);
+   if (pOldestShard == NULL)
+   {
+      return 0;
+   }
+   return evictOldest(*pOldestShard);
 }
 
 void PageCache::resize(int64_t newSize)
@@ -113,9 +358,95 @@ void PageCache::resize(int64_t newSize)
    enforceCacheSize();
 }
 
-void PageCache::initialize(int bytesPerBand, int columnCount, int bandCount)
+void PageCache::initialize(int bytesPerBand, int columnCount, int bandCount, double chunkSize)
 {
    mBytesPerBand = bytesPerBand;
    mColumnCount = columnCount;
    mBandCount = bandCount;
+
+   double bandRowSize = static_cast<double>(mColumnCount) * mBytesPerBand;
+   mRowsPerBandUnit = 1;
+   mRowsPerUnit = 1;
+   if (bandRowSize > 0.0)
+   {
+      mRowsPerBandUnit = max(1u, static_cast<unsigned int>(chunkSize / bandRowSize));
+      if (mBandCount > 0)
+      {
+         mRowsPerUnit = max(1u, static_cast<unsigned int>(chunkSize / (bandRowSize * mBandCount)));
+      }
+   }
+
+   for (vector<boost::shared_ptr<Shard> >::iterator iter = mShards.begin(); iter != mShards.end(); ++iter)
+   {
+      Shard& shard = **iter;
+      mta::MutexLock lock(shard.mMutex);
+      shard.mEntries.clear();
+      shard.mIndex.clear();
+      shard.mSize = 0;
+      shard.mHits = 0;
+      shard.mMisses = 0;
+      shard.mEvictions = 0;
+   }
+}
+
+unsigned int PageCache::getRowsPerUnit(InterleaveFormatType requestedFormat) const
+{
+   return (requestedFormat == BSQ) ? mRowsPerBandUnit : mRowsPerUnit;
+}
+
+int64_t PageCache::getMaxCacheSize() const
+{
+   if (mMaxCacheSize <= 0)
+   {
+      if (mpBudget != NULL)
+      {
+         return mpBudget->getLimit();
+      }
+      return numeric_limits<int64_t>::max();
+   }
+   return mMaxCacheSize;
+}
+
+int64_t PageCache::getCacheSize() const
+{
+   int64_t cacheSize = 0;
+   for (vector<boost::shared_ptr<Shard> >::const_iterator iter = mShards.begin(); iter != mShards.end(); ++iter)
+   {
+      mta::MutexLock lock((*iter)->mMutex);
+      cacheSize += (*iter)->mSize;
+   }
+   return cacheSize;
+}
+
+uint64_t PageCache::getHitCount() const
+{
+   uint64_t count = 0;
+   for (vector<boost::shared_ptr<Shard> >::const_iterator iter = mShards.begin(); iter != mShards.end(); ++iter)
+   {
+      mta::MutexLock lock((*iter)->mMutex);
+      count += (*iter)->mHits;
+   }
+   return count;
+}
+
+uint64_t PageCache::getMissCount() const
+{
+   uint64_t count = 0;
+   for (vector<boost::shared_ptr<Shard> >::const_iterator iter = mShards.begin(); iter != mShards.end(); ++iter)
+   {
+      mta::MutexLock lock((*iter)->mMutex);
+      count += (*iter)->mMisses;
+   }
+   return count;
+}
+
+uint64_t PageCache::getEvictionCount() const
+{
+   uint64_t count = 0;
+   for (vector<boost::shared_ptr<Shard> >::const_iterator iter = mShards.begin(); iter != mShards.end(); ++iter)
+   {
+      mta::MutexLock lock((*iter)->mMutex);
+      count += (*iter)->mEvictions;
+   }
+   return count;
 }
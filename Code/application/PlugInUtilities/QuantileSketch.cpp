@@ -0,0 +1,498 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "QuantileSketch.h"
+#include "StringUtilities.h"
+#include "xmlreader.h"
+#include "xmlwriter.h"
+
+#include <algorithm>
+#include <iterator>
+#include <math.h>
+#include <sstream>
+
+XERCES_CPP_NAMESPACE_USE
+using namespace std;
+
+namespace
+{
+   // Writes doubles with enough digits to read back the same values
+   string toExactString(const vector<double>& values)
+   {
+      stringstream buf;
+      buf.precision(17);
+      copy(values.begin(), values.end(), ostream_iterator<double>(buf, " "));
+      return buf.str();
+   }
+
+   string toExactString(double value)
+   {
+      return toExactString(vector<double>(1, value));
+   }
+
+   double fromExactString(const XMLCh* pValue)
+   {
+      vector<double> values;
+      XmlReader::StrToVector<double, XmlReader::StringStreamAssigner<double> >(values, pValue);
+      return values.size() == 1 ? values.front() : 0.0;
+   }
+}
+
+QuantileSketch::QuantileSketch(EncodingType type, unsigned int size) :
+   mSize(max(size, 8U)),
+   mCount(0),
+   mMinimum(numeric_limits<double>::max()),
+   mMaximum(-numeric_limits<double>::max()),
+   mExact(type == INT1SBYTE || type == INT1UBYTE || type == INT2SBYTES || type == INT2UBYTES),
+   mFirstValue(0.0),
+   mLevels(1),
+   mItemCount(0),
+   mCapacity(0),
+   mOddCompaction(false)
+{
+   updateCapacity();
+}
+
+void QuantileSketch::merge(const QuantileSketch& other)
+{
+   if (other.mCount == 0)
+   {
+      return;
+   }
+
+   mCount += other.mCount;
+   mMinimum = min(mMinimum, other.mMinimum);
+   mMaximum = max(mMaximum, other.mMaximum);
+
+   if (other.mExact)
+   {
+      for (size_t i = 0; i < other.mCounts.size(); ++i)
+      {
+         unsigned int count = other.mCounts[i];
+         if (count == 0)
+         {
+            continue;
+         }
+
+         double value = other.mFirstValue + static_cast<double>(i);
+         if (mExact)
+         {
+            addCount(value);
+            if (mExact)
+            {
+               // addCount() counted the value once
+               mCounts[static_cast<size_t>(value - mFirstValue)] += count - 1;
+               continue;
+            }
+
+            // The value was added to the levels when the counts were converted
+            --count;
+         }
+
+         addWeighted(value, count);
+      }
+   }
+   else
+   {
+      convertCounts();
+      if (mLevels.size() < other.mLevels.size())
+      {
+         mLevels.resize(other.mLevels.size());
+      }
+
+      for (size_t level = 0; level < other.mLevels.size(); ++level)
+      {
+         const vector<double>& values = other.mLevels[level];
+         mLevels[level].insert(mLevels[level].end(), values.begin(), values.end());
+         mItemCount += values.size();
+      }
+   }
+
+   if (mExact == false)
+   {
+      updateCapacity();
+      while (mItemCount > mCapacity)
+      {
+         compress();
+      }
+   }
+}
+
+uint64_t QuantileSketch::getCount() const
+{
+   return mCount;
+}
+
+double QuantileSketch::getMinimum() const
+{
+   return mCount > 0 ? mMinimum : 0.0;
+}
+
+double QuantileSketch::getMaximum() const
+{
+   return mCount > 0 ? mMaximum : 0.0;
+}
+
+bool QuantileSketch::isExact() const
+{
+   return mExact;
+}
+
+bool QuantileSketch::getCounts(double& firstValue, vector<unsigned int>& counts) const
+{
+   if (mExact == false)
+   {
+      return false;
+   }
+
+   firstValue = mFirstValue;
+   counts = mCounts;
+   return true;
+}
+
+double QuantileSketch::getQuantile(double fraction) const
+{
+   if (mCount == 0)
+   {
+      return 0.0;
+   }
+   if (!(fraction > 0.0))
+   {
+      return mMinimum;
+   }
+   if (fraction >= 1.0)
+   {
+      return mMaximum;
+   }
+
+   vector<pair<double, uint64_t> > values;
+   getWeightedValues(values);
+
+   const double target = fraction * static_cast<double>(mCount);
+   uint64_t cumulative = 0;
+   for (vector<pair<double, uint64_t> >::const_iterator iter = values.begin(); iter != values.end(); ++iter)
+   {
+      cumulative += iter->second;
+      if (static_cast<double>(cumulative) >= target)
+      {
+         return min(max(iter->first, mMinimum), mMaximum);
+      }
+   }
+
+   return mMaximum;
+}
+
+void QuantileSketch::getPercentiles(double* pPercentiles) const
+{
+   VERIFYNRV(pPercentiles != NULL);
+   if (mCount == 0)
+   {
+      fill(pPercentiles, pPercentiles + 1001, 0.0);
+      return;
+   }
+
+   vector<pair<double, uint64_t> > values;
+   getWeightedValues(values);
+
+   pPercentiles[0] = mMinimum;
+   uint64_t cumulative = 0;
+   vector<pair<double, uint64_t> >::const_iterator iter = values.begin();
+   for (int percentile = 1; percentile < 1000; ++percentile)
+   {
+      const double target = 0.001 * percentile * static_cast<double>(mCount);
+      while (iter != values.end() && static_cast<double>(cumulative + iter->second) < target)
+      {
+         cumulative += iter->second;
+         ++iter;
+      }
+
+      pPercentiles[percentile] = (iter == values.end()) ? mMaximum : min(max(iter->first, mMinimum), mMaximum);
+   }
+   pPercentiles[1000] = mMaximum;
+}
+
+bool QuantileSketch::toXml(XMLWriter* pXml) const
+{
+   if (pXml == NULL)
+   {
+      return false;
+   }
+
+   pXml->addAttr("size", mSize);
+   pXml->addAttr("count", mCount);
+   if (mCount > 0)
+   {
+      pXml->addAttr("minimum", toExactString(mMinimum), NULL);
+      pXml->addAttr("maximum", toExactString(mMaximum), NULL);
+   }
+
+   pXml->addAttr("exact", mExact);
+   if (mExact)
+   {
+      pXml->addAttr("firstValue", toExactString(mFirstValue), NULL);
+      pXml->pushAddPoint(pXml->addElement("counts"));
+      pXml->addText(mCounts);
+      pXml->popAddPoint();
+   }
+   else
+   {
+      for (vector<vector<double> >::const_iterator iter = mLevels.begin(); iter != mLevels.end(); ++iter)
+      {
+         pXml->pushAddPoint(pXml->addElement("level"));
+         pXml->addText(toExactString(*iter));
+         pXml->popAddPoint();
+      }
+   }
+
+   return true;
+}
+
+bool QuantileSketch::fromXml(DOMNode* pDocument, unsigned int version)
+{
+   if (pDocument == NULL)
+   {
+      return false;
+   }
+
+   DOMElement* pElement = static_cast<DOMElement*>(pDocument);
+   mSize = max(StringUtilities::fromXmlString<unsigned int>(A(pElement->getAttribute(X("size")))), 8U);
+   mCount = StringUtilities::fromXmlString<uint64_t>(A(pElement->getAttribute(X("count"))));
+   mMinimum = numeric_limits<double>::max();
+   mMaximum = -numeric_limits<double>::max();
+   if (mCount > 0)
+   {
+      mMinimum = fromExactString(pElement->getAttribute(X("minimum")));
+      mMaximum = fromExactString(pElement->getAttribute(X("maximum")));
+   }
+
+   mExact = StringUtilities::fromXmlString<bool>(A(pElement->getAttribute(X("exact"))));
+   mFirstValue = 0.0;
+   if (mExact)
+   {
+      mFirstValue = fromExactString(pElement->getAttribute(X("firstValue")));
+   }
+
+   mCounts.clear();
+   mLevels.clear();
+   mItemCount = 0;
+   mOddCompaction = false;
+
+   uint64_t weight = 0;
+   for (DOMNode* pNode = pDocument->getFirstChild(); pNode != NULL; pNode = pNode->getNextSibling())
+   {
+      if (XMLString::equals(pNode->getNodeName(), X("counts")))
+      {
+         XmlReader::StrToVector<unsigned int, XmlReader::StringStreamAssigner<unsigned int> >(mCounts,
+            pNode->getTextContent());
+         for (vector<unsigned int>::const_iterator iter = mCounts.begin(); iter != mCounts.end(); ++iter)
+         {
+            weight += *iter;
+         }
+      }
+      else if (XMLString::equals(pNode->getNodeName(), X("level")))
+      {
+         mLevels.push_back(vector<double>());
+         XmlReader::StrToVector<double, XmlReader::StringStreamAssigner<double> >(mLevels.back(),
+            pNode->getTextContent());
+         mItemCount += mLevels.back().size();
+         weight += static_cast<uint64_t>(mLevels.back().size()) << (mLevels.size() - 1);
+      }
+   }
+
+   if (mLevels.empty())
+   {
+      mLevels.resize(1);
+   }
+   updateCapacity();
+
+   // The values must account for every value which was added
+   return weight == mCount;
+}
+
+void QuantileSketch::addCount(double value)
+{
+   if (static_cast<double>(static_cast<int64_t>(max(min(value, 1e18), -1e18))) != value)
+   {
+      convertCounts();
+      addWeighted(value, 1);
+      return;
+   }
+
+   if (mCounts.empty())
+   {
+      mFirstValue = value;
+      mCounts.resize(1, 0);
+   }
+
+   // Grow the counts toward the value, leaving room for the range to keep growing in that direction
+   double lastValue = mFirstValue + static_cast<double>(mCounts.size()) - 1.0;
+   double first = min(mFirstValue, value);
+   double last = max(lastValue, value);
+   if (last - first + 1.0 > static_cast<double>(MAX_COUNTS))
+   {
+      convertCounts();
+      addWeighted(value, 1);
+      return;
+   }
+
+   const double slack = min(static_cast<double>(mCounts.size()),
+      static_cast<double>(MAX_COUNTS) - (last - first + 1.0));
+   if (value < mFirstValue)
+   {
+      first -= slack;
+   }
+   else if (value > lastValue)
+   {
+      last += slack;
+   }
+
+   if (first < mFirstValue || last > lastValue)
+   {
+      vector<unsigned int> counts(static_cast<size_t>(last - first + 1.0), 0);
+      copy(mCounts.begin(), mCounts.end(), counts.begin() + static_cast<size_t>(mFirstValue - first));
+      mCounts.swap(counts);
+      mFirstValue = first;
+   }
+
+   ++mCounts[static_cast<size_t>(value - mFirstValue)];
+}
+
+void QuantileSketch::convertCounts()
+{
+   if (mExact == false)
+   {
+      return;
+   }
+
+   mExact = false;
+   for (size_t i = 0; i < mCounts.size(); ++i)
+   {
+      if (mCounts[i] != 0)
+      {
+         addWeighted(mFirstValue + static_cast<double>(i), mCounts[i]);
+      }
+   }
+
+   mCounts.clear();
+   vector<unsigned int>(mCounts).swap(mCounts);
+
+   updateCapacity();
+   while (mItemCount > mCapacity)
+   {
+      compress();
+   }
+}
+
+void QuantileSketch::addWeighted(double value, uint64_t weight)
+{
+   // Each set bit of the weight is one value at the level of that bit
+   for (size_t level = 0; weight != 0; ++level, weight >>= 1)
+   {
+      if ((weight & 1) != 0)
+      {
+         if (level >= mLevels.size())
+         {
+            mLevels.resize(level + 1);
+         }
+
+         mLevels[level].push_back(value);
+         ++mItemCount;
+      }
+   }
+}
+
+void QuantileSketch::compress()
+{
+   const size_t height = mLevels.size();
+   for (size_t level = 0; level < height; ++level)
+   {
+      vector<double>& values = mLevels[level];
+      const double capacity = ceil(mSize * pow(2.0 / 3.0, static_cast<double>(height - 1 - level)));
+      if (values.size() < max(capacity, 2.0))
+      {
+         continue;
+      }
+
+      if (level + 1 == height)
+      {
+         mLevels.push_back(vector<double>());
+      }
+
+      // Promote every other value of the sorted level, keeping one value at this level if the count is odd
+      vector<double>& higherValues = mLevels[level + 1];
+      sort(mLevels[level].begin(), mLevels[level].end());
+      vector<double>& sortedValues = mLevels[level];
+
+      const size_t pairs = sortedValues.size() / 2;
+      const size_t offset = mOddCompaction ? 1 : 0;
+      mOddCompaction = !mOddCompaction;
+      for (size_t i = 0; i < pairs; ++i)
+      {
+         higherValues.push_back(sortedValues[2 * i + offset]);
+      }
+
+      if (sortedValues.size() % 2 != 0)
+      {
+         sortedValues.front() = sortedValues.back();
+         sortedValues.resize(1);
+      }
+      else
+      {
+         sortedValues.clear();
+      }
+
+      mItemCount -= pairs;
+      updateCapacity();
+      return;
+   }
+
+   // Every level is within its capacity, so add a level to increase the capacity of the levels below it
+   mLevels.push_back(vector<double>());
+   updateCapacity();
+}
+
+void QuantileSketch::updateCapacity()
+{
+   const size_t height = mLevels.size();
+   mCapacity = 0;
+   for (size_t level = 0; level < height; ++level)
+   {
+      double capacity = ceil(mSize * pow(2.0 / 3.0, static_cast<double>(height - 1 - level)));
+      mCapacity += static_cast<size_t>(max(capacity, 2.0));
+   }
+}
+
+void QuantileSketch::getWeightedValues(vector<pair<double, uint64_t> >& values) const
+{
+   values.clear();
+   if (mExact)
+   {
+      for (size_t i = 0; i < mCounts.size(); ++i)
+      {
+         if (mCounts[i] != 0)
+         {
+            values.push_back(make_pair(mFirstValue + static_cast<double>(i), static_cast<uint64_t>(mCounts[i])));
+         }
+      }
+      return;
+   }
+
+   values.reserve(mItemCount);
+   for (size_t level = 0; level < mLevels.size(); ++level)
+   {
+      const uint64_t weight = static_cast<uint64_t>(1) << level;
+      for (vector<double>::const_iterator iter = mLevels[level].begin(); iter != mLevels[level].end(); ++iter)
+      {
+         values.push_back(make_pair(*iter, weight));
+      }
+   }
+
+   sort(values.begin(), values.end());
+}
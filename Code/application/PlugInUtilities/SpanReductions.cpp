@@ -0,0 +1,388 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppConfig.h"
+#include "SpanReductions.h"
+
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define REDUCTIONS_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+#if defined(REDUCTIONS_SSE2)
+   // Loads four elements as two pairs of doubles
+   inline void load(const float* pData, __m128d& low, __m128d& high)
+   {
+      __m128 values = _mm_loadu_ps(pData);
+      low = _mm_cvtps_pd(values);
+      high = _mm_cvtps_pd(_mm_movehl_ps(values, values));
+   }
+
+   inline void load(const double* pData, __m128d& low, __m128d& high)
+   {
+      low = _mm_loadu_pd(pData);
+      high = _mm_loadu_pd(pData + 2);
+   }
+
+   // Replaces NaN with 0
+   inline __m128d valid(__m128d values)
+   {
+      return _mm_and_pd(values, _mm_cmpord_pd(values, values));
+   }
+
+   inline double horizontalSum(__m128d values)
+   {
+      double parts[2];
+      _mm_storeu_pd(parts, values);
+      return parts[0] + parts[1];
+   }
+
+   // _mm_min_pd() and _mm_max_pd() return the second operand when the first is NaN,
+   // so NaN elements are ignored by passing them first
+
+   template<typename T>
+   double minimumContiguous(const T* pData, size_t count)
+   {
+      __m128d minimum0 = _mm_set1_pd(numeric_limits<double>::infinity());
+      __m128d minimum1 = minimum0;
+      size_t i = 0;
+      for (; i + 4 <= count; i += 4)
+      {
+         __m128d low;
+         __m128d high;
+         load(pData + i, low, high);
+         minimum0 = _mm_min_pd(low, minimum0);
+         minimum1 = _mm_min_pd(high, minimum1);
+      }
+
+      double parts[2];
+      _mm_storeu_pd(parts, _mm_min_pd(minimum0, minimum1));
+      double result = parts[0] < parts[1] ? parts[0] : parts[1];
+      for (; i < count; ++i)
+      {
+         if (pData[i] < result)
+         {
+            result = pData[i];
+         }
+      }
+      return result;
+   }
+
+   template<typename T>
+   double maximumContiguous(const T* pData, size_t count)
+   {
+      __m128d maximum0 = _mm_set1_pd(-numeric_limits<double>::infinity());
+      __m128d maximum1 = maximum0;
+      size_t i = 0;
+      for (; i + 4 <= count; i += 4)
+      {
+         __m128d low;
+         __m128d high;
+         load(pData + i, low, high);
+         maximum0 = _mm_max_pd(low, maximum0);
+         maximum1 = _mm_max_pd(high, maximum1);
+      }
+
+      double parts[2];
+      _mm_storeu_pd(parts, _mm_max_pd(maximum0, maximum1));
+      double result = parts[0] > parts[1] ? parts[0] : parts[1];
+      for (; i < count; ++i)
+      {
+         if (pData[i] > result)
+         {
+            result = pData[i];
+         }
+      }
+      return result;
+   }
+
+   template<typename T>
+   double sumContiguous(const T* pData, size_t count)
+   {
+      __m128d sum0 = _mm_setzero_pd();
+      __m128d sum1 = _mm_setzero_pd();
+      size_t i = 0;
+      for (; i + 4 <= count; i += 4)
+      {
+         __m128d low;
+         __m128d high;
+         load(pData + i, low, high);
+         sum0 = _mm_add_pd(sum0, valid(low));
+         sum1 = _mm_add_pd(sum1, valid(high));
+      }
+
+      double result = horizontalSum(_mm_add_pd(sum0, sum1));
+      for (; i < count; ++i)
+      {
+         if (SpanReductions::isValid(pData[i]))
+         {
+            result += pData[i];
+         }
+      }
+      return result;
+   }
+
+   template<typename T>
+   double sumOfSquaresContiguous(const T* pData, size_t count)
+   {
+      __m128d sum0 = _mm_setzero_pd();
+      __m128d sum1 = _mm_setzero_pd();
+      size_t i = 0;
+      for (; i + 4 <= count; i += 4)
+      {
+         __m128d low;
+         __m128d high;
+         load(pData + i, low, high);
+         low = valid(low);
+         high = valid(high);
+         sum0 = _mm_add_pd(sum0, _mm_mul_pd(low, low));
+         sum1 = _mm_add_pd(sum1, _mm_mul_pd(high, high));
+      }
+
+      double result = horizontalSum(_mm_add_pd(sum0, sum1));
+      for (; i < count; ++i)
+      {
+         double value = pData[i];
+         if (SpanReductions::isValid(value))
+         {
+            result += value * value;
+         }
+      }
+      return result;
+   }
+
+   template<typename T>
+   double dotContiguous(const T* pLhs, const T* pRhs, size_t count)
+   {
+      __m128d sum0 = _mm_setzero_pd();
+      __m128d sum1 = _mm_setzero_pd();
+      size_t i = 0;
+      for (; i + 4 <= count; i += 4)
+      {
+         __m128d lhsLow;
+         __m128d lhsHigh;
+         __m128d rhsLow;
+         __m128d rhsHigh;
+         load(pLhs + i, lhsLow, lhsHigh);
+         load(pRhs + i, rhsLow, rhsHigh);
+         sum0 = _mm_add_pd(sum0, valid(_mm_mul_pd(lhsLow, rhsLow)));
+         sum1 = _mm_add_pd(sum1, valid(_mm_mul_pd(lhsHigh, rhsHigh)));
+      }
+
+      double result = horizontalSum(_mm_add_pd(sum0, sum1));
+      for (; i < count; ++i)
+      {
+         double product = static_cast<double>(pLhs[i]) * static_cast<double>(pRhs[i]);
+         if (SpanReductions::isValid(product))
+         {
+            result += product;
+         }
+      }
+      return result;
+   }
+
+   template<typename T>
+   void accumulateContiguous(const T* pData, size_t count, SpanReductions::Moments& moments)
+   {
+      const __m128d one = _mm_set1_pd(1.0);
+      __m128d count0 = _mm_setzero_pd();
+      __m128d count1 = _mm_setzero_pd();
+      __m128d sum0 = _mm_setzero_pd();
+      __m128d sum1 = _mm_setzero_pd();
+      __m128d squares0 = _mm_setzero_pd();
+      __m128d squares1 = _mm_setzero_pd();
+      __m128d minimum0 = _mm_set1_pd(moments.mMinimum);
+      __m128d minimum1 = minimum0;
+      __m128d maximum0 = _mm_set1_pd(moments.mMaximum);
+      __m128d maximum1 = maximum0;
+      size_t i = 0;
+      for (; i + 4 <= count; i += 4)
+      {
+         __m128d low;
+         __m128d high;
+         load(pData + i, low, high);
+         minimum0 = _mm_min_pd(low, minimum0);
+         minimum1 = _mm_min_pd(high, minimum1);
+         maximum0 = _mm_max_pd(low, maximum0);
+         maximum1 = _mm_max_pd(high, maximum1);
+
+         __m128d lowMask = _mm_cmpord_pd(low, low);
+         __m128d highMask = _mm_cmpord_pd(high, high);
+         low = _mm_and_pd(low, lowMask);
+         high = _mm_and_pd(high, highMask);
+         count0 = _mm_add_pd(count0, _mm_and_pd(one, lowMask));
+         count1 = _mm_add_pd(count1, _mm_and_pd(one, highMask));
+         sum0 = _mm_add_pd(sum0, low);
+         sum1 = _mm_add_pd(sum1, high);
+         squares0 = _mm_add_pd(squares0, _mm_mul_pd(low, low));
+         squares1 = _mm_add_pd(squares1, _mm_mul_pd(high, high));
+      }
+
+      if (i > 0)
+      {
+         SpanReductions::Moments partial;
+         partial.mCount = static_cast<size_t>(horizontalSum(_mm_add_pd(count0, count1)));
+         partial.mSum = horizontalSum(_mm_add_pd(sum0, sum1));
+         partial.mSumSquares = horizontalSum(_mm_add_pd(squares0, squares1));
+
+         double parts[2];
+         _mm_storeu_pd(parts, _mm_min_pd(minimum0, minimum1));
+         partial.mMinimum = parts[0] < parts[1] ? parts[0] : parts[1];
+         _mm_storeu_pd(parts, _mm_max_pd(maximum0, maximum1));
+         partial.mMaximum = parts[0] > parts[1] ? parts[0] : parts[1];
+         moments.merge(partial);
+      }
+
+      SpanReductions::accumulate<T>(DataSpan<T>(const_cast<T*>(pData) + i, count - i), moments);
+   }
+#endif
+}
+
+namespace SpanReductions
+{
+   double minimum(const DataSpan<float>& span)
+   {
+#if defined(REDUCTIONS_SSE2)
+      if (span.isContiguous())
+      {
+         return minimumContiguous(span.getData(), span.getCount());
+      }
+#endif
+      return minimum<float>(span);
+   }
+
+   double minimum(const DataSpan<double>& span)
+   {
+#if defined(REDUCTIONS_SSE2)
+      if (span.isContiguous())
+      {
+         return minimumContiguous(span.getData(), span.getCount());
+      }
+#endif
+      return minimum<double>(span);
+   }
+
+   double maximum(const DataSpan<float>& span)
+   {
+#if defined(REDUCTIONS_SSE2)
+      if (span.isContiguous())
+      {
+         return maximumContiguous(span.getData(), span.getCount());
+      }
+#endif
+      return maximum<float>(span);
+   }
+
+   double maximum(const DataSpan<double>& span)
+   {
+#if defined(REDUCTIONS_SSE2)
+      if (span.isContiguous())
+      {
+         return maximumContiguous(span.getData(), span.getCount());
+      }
+#endif
+      return maximum<double>(span);
+   }
+
+   double sum(const DataSpan<float>& span)
+   {
+#if defined(REDUCTIONS_SSE2)
+      if (span.isContiguous())
+      {
+         return sumContiguous(span.getData(), span.getCount());
+      }
+#endif
+      return sum<float>(span);
+   }
+
+   double sum(const DataSpan<double>& span)
+   {
+#if defined(REDUCTIONS_SSE2)
+      if (span.isContiguous())
+      {
+         return sumContiguous(span.getData(), span.getCount());
+      }
+#endif
+      return sum<double>(span);
+   }
+
+   double sumOfSquares(const DataSpan<float>& span)
+   {
+#if defined(REDUCTIONS_SSE2)
+      if (span.isContiguous())
+      {
+         return sumOfSquaresContiguous(span.getData(), span.getCount());
+      }
+#endif
+      return sumOfSquares<float>(span);
+   }
+
+   double sumOfSquares(const DataSpan<double>& span)
+   {
+#if defined(REDUCTIONS_SSE2)
+      if (span.isContiguous())
+      {
+         return sumOfSquaresContiguous(span.getData(), span.getCount());
+      }
+#endif
+      return sumOfSquares<double>(span);
+   }
+
+   double dot(const DataSpan<float>& lhs, const DataSpan<float>& rhs)
+   {
+#if defined(REDUCTIONS_SSE2)
+      if (lhs.isContiguous() && rhs.isContiguous())
+      {
+         return dotContiguous(lhs.getData(), rhs.getData(), min(lhs.getCount(), rhs.getCount()));
+      }
+#endif
+      return dot<float>(lhs, rhs);
+   }
+
+   double dot(const DataSpan<double>& lhs, const DataSpan<double>& rhs)
+   {
+#if defined(REDUCTIONS_SSE2)
+      if (lhs.isContiguous() && rhs.isContiguous())
+      {
+         return dotContiguous(lhs.getData(), rhs.getData(), min(lhs.getCount(), rhs.getCount()));
+      }
+#endif
+      return dot<double>(lhs, rhs);
+   }
+
+   void accumulate(const DataSpan<float>& span, Moments& moments)
+   {
+#if defined(REDUCTIONS_SSE2)
+      if (span.isContiguous())
+      {
+         accumulateContiguous(span.getData(), span.getCount(), moments);
+         return;
+      }
+#endif
+      accumulate<float>(span, moments);
+   }
+
+   void accumulate(const DataSpan<double>& span, Moments& moments)
+   {
+#if defined(REDUCTIONS_SSE2)
+      if (span.isContiguous())
+      {
+         accumulateContiguous(span.getData(), span.getCount(), moments);
+         return;
+      }
+#endif
+      accumulate<double>(span, moments);
+   }
+}
@@ -0,0 +1,330 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "Statistics.h"
+#include "StatisticsAccumulator.h"
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+using namespace std;
+
+namespace
+{
+   // Limits on the width of the bins which keep their scale factor a normal double
+   const int MIN_EXPONENT = -1000;
+   const int MAX_EXPONENT = 1000;
+
+   // Returns floor(index / 2^shift)
+   int64_t shiftIndex(int64_t index, int shift)
+   {
+      if (shift <= 0)
+      {
+         return index;
+      }
+      if (shift >= 63)
+      {
+         return index < 0 ? -1 : 0;
+      }
+      return index >= 0 ? index >> shift : -((-index - 1) >> shift) - 1;
+   }
+
+   int64_t getIndex(double value, int exponent)
+   {
+      return static_cast<int64_t>(floor(ldexp(value, -exponent)));
+   }
+}
+
+StatisticsAccumulator::StatisticsAccumulator(EncodingType type) :
+   mCount(0),
+   mSum(0.0),
+   mSumSquares(0.0),
+   mMinimum(numeric_limits<double>::max()),
+   mMaximum(-numeric_limits<double>::max()),
+   mExponent(0),
+   mFirst(1),
+   mScale(0.0),
+   mFirstBin(1.0),
+   mQuantiles(type)
+{
+   // The scale and first bin put every value outside of the histogram until the bins are allocated
+}
+
+void StatisticsAccumulator::merge(const StatisticsAccumulator& other)
+{
+   if (other.mCount == 0)
+   {
+      return;
+   }
+
+   if (mCount == 0)
+   {
+      *this = other;
+      return;
+   }
+
+   mCount += other.mCount;
+   mSum += other.mSum;
+   mSumSquares += other.mSumSquares;
+   mMinimum = min(mMinimum, other.mMinimum);
+   mMaximum = max(mMaximum, other.mMaximum);
+   mQuantiles.merge(other.mQuantiles);
+
+   int exponent = getRequiredExponent(mMinimum, mMaximum, max(mExponent, other.mExponent));
+   int64_t first = getIndex(mMinimum, exponent);
+   rebin(exponent, first);
+
+   const int shift = exponent - other.mExponent;
+   for (int bin = 0; bin < BIN_COUNT; ++bin)
+   {
+      unsigned int count = other.mBins[bin];
+      if (count != 0)
+      {
+         int64_t index = shiftIndex(other.mFirst + bin, shift) - first;
+         VERIFYNRV(index >= 0 && index < BIN_COUNT);
+         mBins[static_cast<size_t>(index)] += count;
+      }
+   }
+}
+
+uint64_t StatisticsAccumulator::getCount() const
+{
+   return mCount;
+}
+
+double StatisticsAccumulator::getMinimum() const
+{
+   return mCount > 0 ? mMinimum : 0.0;
+}
+
+double StatisticsAccumulator::getMaximum() const
+{
+   return mCount > 0 ? mMaximum : 0.0;
+}
+
+double StatisticsAccumulator::getAverage() const
+{
+   return mCount > 0 ? mSum / mCount : 0.0;
+}
+
+double StatisticsAccumulator::getStandardDeviation() const
+{
+   if (mCount < 2)
+   {
+      return 0.0;
+   }
+
+   // Use the same form as Statistics, with fabs() to prevent roundoff error from giving sqrt a negative
+   // when every value is the same
+   double count = static_cast<double>(mCount);
+   double numerator = fabs(count * mSumSquares - mSum * mSum);
+   return sqrt((numerator / count) / (count - 1.0));
+}
+
+void StatisticsAccumulator::getHistogram(bool isInteger, double* pBinCenters, unsigned int* pBinCounts,
+                                         double* pPercentiles) const
+{
+   VERIFYNRV(pBinCenters != NULL && pBinCounts != NULL && pPercentiles != NULL);
+
+   const double minimum = getMinimum();
+   const double maximum = getMaximum();
+
+   // Compute the bin centers in the same way as Statistics
+   double range = maximum - minimum;
+   bool oneBin = false;
+   if (range == 0.0)
+   {
+      range = 1.0;
+      oneBin = true;
+   }
+
+   const double width = isInteger ? ceil((range + 0.5) / 256.0) : range / 256.0;
+   for (int bin = 0; bin < 256; ++bin)
+   {
+      if (isInteger)
+      {
+         pBinCenters[bin] = minimum + bin * width + (width - 1.0) / 2.0;
+      }
+      else if (oneBin)
+      {
+         pBinCenters[bin] = minimum + bin * width;
+      }
+      else
+      {
+         pBinCenters[bin] = minimum + bin * width + width / 2.0;
+      }
+
+      pBinCounts[bin] = 0;
+   }
+
+   mQuantiles.getPercentiles(pPercentiles);
+   if (mCount == 0)
+   {
+      return;
+   }
+
+   // The counts of 8 and 16 bit integer data give an exact histogram
+   double firstValue = 0.0;
+   vector<unsigned int> counts;
+   if (mQuantiles.getCounts(firstValue, counts))
+   {
+      for (vector<unsigned int>::size_type i = 0; i < counts.size(); ++i)
+      {
+         if (counts[i] != 0)
+         {
+            int resultBin = static_cast<int>((firstValue + static_cast<double>(i) - minimum) / width);
+            pBinCounts[min(max(resultBin, 0), 255)] += counts[i];
+         }
+      }
+      return;
+   }
+
+   // Each accumulated bin is added to the result bin which contains its center
+   const double binWidth = ldexp(1.0, mExponent);
+   for (int bin = 0; bin < BIN_COUNT; ++bin)
+   {
+      if (mBins[bin] != 0)
+      {
+         double center = (static_cast<double>(mFirst + bin) + 0.5) * binWidth;
+         center = min(max(center, minimum), maximum);
+         int resultBin = static_cast<int>((center - minimum) / width);
+         pBinCounts[min(max(resultBin, 0), 255)] += mBins[bin];
+      }
+   }
+}
+
+const QuantileSketch& StatisticsAccumulator::getQuantiles() const
+{
+   return mQuantiles;
+}
+
+bool StatisticsAccumulator::setStatistics(Statistics* pStatistics, bool isInteger) const
+{
+   if (pStatistics == NULL)
+   {
+      return false;
+   }
+
+   double binCenters[256];
+   unsigned int binCounts[256];
+   vector<double> percentiles(1001);
+   getHistogram(isInteger, binCenters, binCounts, &percentiles[0]);
+
+   pStatistics->setMin(getMinimum());
+   pStatistics->setMax(getMaximum());
+   pStatistics->setAverage(getAverage());
+   pStatistics->setStandardDeviation(getStandardDeviation());
+   pStatistics->setPercentiles(&percentiles[0]);
+   pStatistics->setHistogram(binCenters, binCounts);
+   return true;
+}
+
+void StatisticsAccumulator::addToHistogram(double value)
+{
+   // The minimum and maximum already include the value
+   int exponent = mExponent;
+   if (mBins.empty())
+   {
+      // Start with bins which are fine relative to the first value, since the range of the data is not known
+      exponent = (value == 0.0) ? -32 : ilogb(fabs(value)) - 24;
+      exponent = min(max(exponent, MIN_EXPONENT), MAX_EXPONENT);
+   }
+
+   exponent = getRequiredExponent(mMinimum, mMaximum, exponent);
+
+   // Leave the unused bins on the side toward which the range of the data is growing
+   int64_t first = getIndex(mMinimum, exponent);
+   if (value <= mMinimum && mCount > 1)
+   {
+      first = getIndex(mMaximum, exponent) - (BIN_COUNT - 1);
+   }
+
+   rebin(exponent, first);
+
+   int64_t index = getIndex(value, exponent) - first;
+   VERIFYNRV(index >= 0 && index < BIN_COUNT);
+   ++mBins[static_cast<size_t>(index)];
+}
+
+void StatisticsAccumulator::rebin(int exponent, int64_t firstBin)
+{
+   if (mBins.empty())
+   {
+      mBins.resize(BIN_COUNT, 0);
+   }
+   else if (exponent != mExponent || firstBin != mFirst)
+   {
+      // The bins only become wider, so the bins are moved in place: the bins which move to a lower index in
+      // ascending order, then the leading bins which move to a higher index in descending order
+      const int shift = exponent - mExponent;
+      VERIFYNRV(shift >= 0);
+      int split = 0;
+      while (split < BIN_COUNT && shiftIndex(mFirst + split, shift) - firstBin > split)
+      {
+         ++split;
+      }
+
+      for (int bin = split; bin < BIN_COUNT; ++bin)
+      {
+         VERIFYNRV(moveBin(bin, shift, firstBin));
+      }
+
+      for (int bin = split - 1; bin >= 0; --bin)
+      {
+         VERIFYNRV(moveBin(bin, shift, firstBin));
+      }
+   }
+   else
+   {
+      return;
+   }
+
+   mExponent = exponent;
+   mFirst = firstBin;
+   mScale = ldexp(1.0, -exponent);
+   mFirstBin = static_cast<double>(firstBin);
+}
+
+bool StatisticsAccumulator::moveBin(int bin, int shift, int64_t firstBin)
+{
+   unsigned int count = mBins[bin];
+   if (count == 0)
+   {
+      return true;
+   }
+
+   int64_t index = shiftIndex(mFirst + bin, shift) - firstBin;
+   if (index < 0 || index >= BIN_COUNT)
+   {
+      return false;
+   }
+
+   mBins[bin] = 0;
+   mBins[static_cast<size_t>(index)] += count;
+   return true;
+}
+
+int StatisticsAccumulator::getRequiredExponent(double minimum, double maximum, int exponent) const
+{
+   // The bin indices must be exactly representable as doubles
+   double magnitude = max(fabs(minimum), fabs(maximum));
+   if (magnitude > 0.0)
+   {
+      exponent = max(exponent, ilogb(magnitude) - 51);
+   }
+
+   while (exponent < MAX_EXPONENT && getIndex(maximum, exponent) - getIndex(minimum, exponent) >= BIN_COUNT)
+   {
+      ++exponent;
+   }
+
+   return exponent;
+}
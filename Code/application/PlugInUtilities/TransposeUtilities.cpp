@@ -0,0 +1,336 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppConfig.h"
+#include "bthread.h"
+#include "TransposeUtilities.h"
+
+#include <algorithm>
+#include <string.h>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSPOSE_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+   // Matrices smaller than this are not worth starting threads for
+   const size_t sMinimumThreadedBytes = 4 * 1024 * 1024;
+
+   // The number of rows and columns in a block, chosen so that the source and
+   // destination cache lines touched by a block fit in the L1 cache
+   const size_t sBlockSize = 32;
+
+   struct Matrix
+   {
+      const unsigned char* const* mppSrcRows;
+      size_t mRows;
+      unsigned char* mpDst;
+      size_t mDstRowStride;
+      unsigned int mElementSize;
+   };
+
+   template<unsigned int N>
+   void transposeScalar(const Matrix& matrix, size_t rowBegin, size_t rowEnd, size_t columnBegin, size_t columnEnd)
+   {
+      for (size_t column = columnBegin; column < columnEnd; ++column)
+      {
+         unsigned char* pDst = matrix.mpDst + column * matrix.mDstRowStride + rowBegin * N;
+         for (size_t row = rowBegin; row < rowEnd; ++row, pDst += N)
+         {
+            // A constant size memcpy() compiles to a single unaligned load and store
+            memcpy(pDst, matrix.mppSrcRows[row] + column * N, N);
+         }
+      }
+   }
+
+   void transposeScalar(const Matrix& matrix, size_t rowBegin, size_t rowEnd, size_t columnBegin, size_t columnEnd)
+   {
+      const unsigned int elementSize = matrix.mElementSize;
+      for (size_t column = columnBegin; column < columnEnd; ++column)
+      {
+         unsigned char* pDst = matrix.mpDst + column * matrix.mDstRowStride + rowBegin * elementSize;
+         for (size_t row = rowBegin; row < rowEnd; ++row, pDst += elementSize)
+         {
+            memcpy(pDst, matrix.mppSrcRows[row] + column * elementSize, elementSize);
+         }
+      }
+   }
+
+   // Transposes a square tile of Tile x Tile elements in registers
+   template<unsigned int N>
+   struct Kernel
+   {
+      static const size_t Tile = 1;
+
+      static void transposeTile(const Matrix&, size_t, size_t)
+      {
+      }
+   };
+
+#if defined(TRANSPOSE_SSE2)
+   inline __m128i load(const Matrix& matrix, size_t row, size_t byteOffset)
+   {
+      return _mm_loadu_si128(reinterpret_cast<const __m128i*>(matrix.mppSrcRows[row] + byteOffset));
+   }
+
+   inline void store(const Matrix& matrix, size_t column, size_t byteOffset, __m128i value)
+   {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(matrix.mpDst + column * matrix.mDstRowStride + byteOffset), value);
+   }
+
+   template<>
+   struct Kernel<2>
+   {
+      static const size_t Tile = 8;
+
+      static void transposeTile(const Matrix& matrix, size_t row, size_t column)
+      {
+         const size_t srcOffset = column * 2;
+         __m128i a0 = _mm_unpacklo_epi16(load(matrix, row, srcOffset), load(matrix, row + 1, srcOffset));
+         __m128i a1 = _mm_unpackhi_epi16(load(matrix, row, srcOffset), load(matrix, row + 1, srcOffset));
+         __m128i a2 = _mm_unpacklo_epi16(load(matrix, row + 2, srcOffset), load(matrix, row + 3, srcOffset));
+         __m128i a3 = _mm_unpackhi_epi16(load(matrix, row + 2, srcOffset), load(matrix, row + 3, srcOffset));
+         __m128i a4 = _mm_unpacklo_epi16(load(matrix, row + 4, srcOffset), load(matrix, row + 5, srcOffset));
+         __m128i a5 = _mm_unpackhi_epi16(load(matrix, row + 4, srcOffset), load(matrix, row + 5, srcOffset));
+         __m128i a6 = _mm_unpacklo_epi16(load(matrix, row + 6, srcOffset), load(matrix, row + 7, srcOffset));
+         __m128i a7 = _mm_unpackhi_epi16(load(matrix, row + 6, srcOffset), load(matrix, row + 7, srcOffset));
+
+         __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+         __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+         __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+         __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+         __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+         __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+         __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+         __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+         const size_t dstOffset = row * 2;
+         store(matrix, column, dstOffset, _mm_unpacklo_epi64(b0, b4));
+         store(matrix, column + 1, dstOffset, _mm_unpackhi_epi64(b0, b4));
+         store(matrix, column + 2, dstOffset, _mm_unpacklo_epi64(b1, b5));
+         store(matrix, column + 3, dstOffset, _mm_unpackhi_epi64(b1, b5));
+         store(matrix, column + 4, dstOffset, _mm_unpacklo_epi64(b2, b6));
+         store(matrix, column + 5, dstOffset, _mm_unpackhi_epi64(b2, b6));
+         store(matrix, column + 6, dstOffset, _mm_unpacklo_epi64(b3, b7));
+         store(matrix, column + 7, dstOffset, _mm_unpackhi_epi64(b3, b7));
+      }
+   };
+
+   template<>
+   struct Kernel<4>
+   {
+      static const size_t Tile = 4;
+
+      static void transposeTile(const Matrix& matrix, size_t row, size_t column)
+      {
+         const size_t srcOffset = column * 4;
+         __m128i r0 = load(matrix, row, srcOffset);
+         __m128i r1 = load(matrix, row + 1, srcOffset);
+         __m128i r2 = load(matrix, row + 2, srcOffset);
+         __m128i r3 = load(matrix, row + 3, srcOffset);
+
+         __m128i a0 = _mm_unpacklo_epi32(r0, r1);
+         __m128i a1 = _mm_unpackhi_epi32(r0, r1);
+         __m128i a2 = _mm_unpacklo_epi32(r2, r3);
+         __m128i a3 = _mm_unpackhi_epi32(r2, r3);
+
+         const size_t dstOffset = row * 4;
+         store(matrix, column, dstOffset, _mm_unpacklo_epi64(a0, a2));
+         store(matrix, column + 1, dstOffset, _mm_unpackhi_epi64(a0, a2));
+         store(matrix, column + 2, dstOffset, _mm_unpacklo_epi64(a1, a3));
+         store(matrix, column + 3, dstOffset, _mm_unpackhi_epi64(a1, a3));
+      }
+   };
+
+   template<>
+   struct Kernel<8>
+   {
+      static const size_t Tile = 2;
+
+      static void transposeTile(const Matrix& matrix, size_t row, size_t column)
+      {
+         const size_t srcOffset = column * 8;
+         __m128i r0 = load(matrix, row, srcOffset);
+         __m128i r1 = load(matrix, row + 1, srcOffset);
+
+         const size_t dstOffset = row * 8;
+         store(matrix, column, dstOffset, _mm_unpacklo_epi64(r0, r1));
+         store(matrix, column + 1, dstOffset, _mm_unpackhi_epi64(r0, r1));
+      }
+   };
+#endif
+
+   template<unsigned int N>
+   void transposeBlock(const Matrix& matrix, size_t rowBegin, size_t rowEnd, size_t columnBegin, size_t columnEnd)
+   {
+      const size_t tile = Kernel<N>::Tile;
+      if (tile == 1)
+      {
+         transposeScalar<N>(matrix, rowBegin, rowEnd, columnBegin, columnEnd);
+         return;
+      }
+
+      const size_t rowTileEnd = rowBegin + (rowEnd - rowBegin) / tile * tile;
+      const size_t columnTileEnd = columnBegin + (columnEnd - columnBegin) / tile * tile;
+      for (size_t row = rowBegin; row < rowTileEnd; row += tile)
+      {
+         for (size_t column = columnBegin; column < columnTileEnd; column += tile)
+         {
+            Kernel<N>::transposeTile(matrix, row, column);
+         }
+      }
+
+      // Partial tiles along the bottom and right edges of the block
+      transposeScalar<N>(matrix, rowTileEnd, rowEnd, columnBegin, columnTileEnd);
+      transposeScalar<N>(matrix, rowBegin, rowEnd, columnTileEnd, columnEnd);
+   }
+
+   template<unsigned int N>
+   void transposeColumns(const Matrix& matrix, size_t columnBegin, size_t columnEnd)
+   {
+      for (size_t column = columnBegin; column < columnEnd; column += sBlockSize)
+      {
+         const size_t columnStop = min(column + sBlockSize, columnEnd);
+         for (size_t row = 0; row < matrix.mRows; row += sBlockSize)
+         {
+            transposeBlock<N>(matrix, row, min(row + sBlockSize, matrix.mRows), column, columnStop);
+         }
+      }
+   }
+
+   struct Job
+   {
+      const Matrix* mpMatrix;
+      size_t mColumnBegin;
+      size_t mColumnEnd;
+   };
+
+   void runJob(Job* pJob)
+   {
+      const Matrix& matrix = *pJob->mpMatrix;
+      switch (matrix.mElementSize)
+      {
+      case 1:
+         transposeColumns<1>(matrix, pJob->mColumnBegin, pJob->mColumnEnd);
+         break;
+      case 2:
+         transposeColumns<2>(matrix, pJob->mColumnBegin, pJob->mColumnEnd);
+         break;
+      case 4:
+         transposeColumns<4>(matrix, pJob->mColumnBegin, pJob->mColumnEnd);
+         break;
+      case 8:
+         transposeColumns<8>(matrix, pJob->mColumnBegin, pJob->mColumnEnd);
+         break;
+      case 16:
+         transposeColumns<16>(matrix, pJob->mColumnBegin, pJob->mColumnEnd);
+         break;
+      default:
+         transposeScalar(matrix, 0, matrix.mRows, pJob->mColumnBegin, pJob->mColumnEnd);
+         break;
+      }
+   }
+}
+
+void TransposeUtilities::transpose(const void* const* ppSrcRows, size_t rows, size_t columns,
+   void* pDst, size_t dstRowStride, unsigned int elementSize, unsigned int threadCount)
+{
+   if (ppSrcRows == NULL || pDst == NULL || rows == 0 || columns == 0 || elementSize == 0)
+   {
+      return;
+   }
+
+   Matrix matrix;
+   matrix.mppSrcRows = reinterpret_cast<const unsigned char* const*>(ppSrcRows);
+   matrix.mRows = rows;
+   matrix.mpDst = reinterpret_cast<unsigned char*>(pDst);
+   matrix.mDstRowStride = dstRowStride;
+   matrix.mElementSize = elementSize;
+
+   // Each thread writes a separate range of whole blocks of destination rows
+   size_t columnBlocks = (columns + sBlockSize - 1) / sBlockSize;
+   size_t jobCount = 1;
+   if (rows * columns * elementSize >= sMinimumThreadedBytes)
+   {
+      jobCount = max<size_t>(1, min<size_t>(threadCount, columnBlocks));
+   }
+
+   vector<Job> jobs(jobCount);
+   for (size_t i = 0; i < jobCount; ++i)
+   {
+      jobs[i].mpMatrix = &matrix;
+      jobs[i].mColumnBegin = min(columns, columnBlocks * i / jobCount * sBlockSize);
+      jobs[i].mColumnEnd = min(columns, columnBlocks * (i + 1) / jobCount * sBlockSize);
+   }
+
+   vector<boost::shared_ptr<BThread> > threads;
+   for (size_t i = 1; i < jobCount; ++i)
+   {
+      boost::shared_ptr<BThread> pThread(new BThread(&jobs[i], reinterpret_cast<void*>(runJob)));
+      if (pThread->ThreadLaunch())
+      {
+         threads.push_back(pThread);
+      }
+      else
+      {
+         runJob(&jobs[i]);
+      }
+   }
+
+   runJob(&jobs[0]);
+   for (vector<boost::shared_ptr<BThread> >::iterator iter = threads.begin(); iter != threads.end(); ++iter)
+   {
+      (*iter)->ThreadWait();
+   }
+}
+
+void TransposeUtilities::transpose(const void* pSrc, size_t srcRowStride, size_t rows, size_t columns,
+   void* pDst, size_t dstRowStride, unsigned int elementSize, unsigned int threadCount)
+{
+   if (pSrc == NULL || rows == 0)
+   {
+      return;
+   }
+
+   vector<const void*> srcRows(rows);
+   const unsigned char* pRow = reinterpret_cast<const unsigned char*>(pSrc);
+   for (size_t row = 0; row < rows; ++row, pRow += srcRowStride)
+   {
+      srcRows[row] = pRow;
+   }
+
+   transpose(&srcRows[0], rows, columns, pDst, dstRowStride, elementSize, threadCount);
+}
+
+void TransposeUtilities::transposePerElement(const void* const* ppSrcRows, size_t rows, size_t columns,
+   void* pDst, size_t dstRowStride, unsigned int elementSize)
+{
+   if (ppSrcRows == NULL || pDst == NULL)
+   {
+      return;
+   }
+
+   for (size_t row = 0; row < rows; ++row)
+   {
+      const unsigned char* pSrc = reinterpret_cast<const unsigned char*>(ppSrcRows[row]);
+      unsigned char* pDstElement = reinterpret_cast<unsigned char*>(pDst) + row * elementSize;
+      for (size_t column = 0; column < columns; ++column)
+      {
+         memcpy(pDstElement, pSrc, elementSize);
+         pDstElement += dstRowStride;
+         pSrc += elementSize;
+      }
+   }
+}
@@ -317,11 +317,12 @@ ConvolutionFilterShell::ConvolutionFilterThread::ConvolutionFilterThread(const C
                                                                          mta::ThreadReporter &reporter) :
                mta::AlgorithmThread(threadIndex, reporter),
                mInput(input),
-               mRowRange(getThreadRange(threadCount, input.mpIterCheck->getNumSelectedRows()))
+               mRowCount(input.mpIterCheck->getNumSelectedRows()),
+               mPercentDone(-1)
 {
    if (input.mpIterCheck->useAllPixels())
    {
-      mRowRange = getThreadRange(threadCount, input.mpDescriptor->getRowCount());
+      mRowCount = input.mpDescriptor->getRowCount();
    }
 }
 
@@ -333,28 +334,56 @@ void ConvolutionFilterShell::ConvolutionFilterThread::run()
 }
 
 template<class T>
-void ConvolutionFilterShell::ConvolutionFilterThread::convolve(const T*)
+void ConvolutionFilterShell::ConvolutionFilterThread::convolve(const T* pData)
 {
-   int numResultsCols = mInput.mpIterCheck->getNumSelectedColumns();
    if (mInput.mpResult == NULL)
    {
       return;
    }
 
-   const RasterDataDescriptor* pResultDescriptor = static_cast<const RasterDataDescriptor*>(
-      mInput.mpResult->getDataDescriptor());
+   // The rows are claimed in chunks, so that a thread whose rows are mostly outside of the AOI goes on to the
+   // rows which would otherwise be left to the other threads
+   int maxRowNum = static_cast<int>(mInput.mpDescriptor->getRowCount()) - 1;
+   mta::AlgorithmThread::Range chunk;
+   while (getNextChunk(mRowCount, chunk, 8))
+   {
+      if (mInput.mpAbortFlag != NULL && *mInput.mpAbortFlag)
+      {
+         return;
+      }
+
+      // account for AOIs which extend outside the dataset
+      mta::AlgorithmThread::Range rowRange;
+      rowRange.mFirst = std::max(0, chunk.mFirst);
+      rowRange.mLast = std::min(chunk.mLast, maxRowNum);
+      if (rowRange.mLast < rowRange.mFirst)
+      {
+         continue;
+      }
 
-   // account for AOIs which extend outside the dataset
+      if (convolveRows(pData, chunk, rowRange) == false)
+      {
+         return;
+      }
+   }
+}
+
+template<class T>
+bool ConvolutionFilterShell::ConvolutionFilterThread::convolveRows(const T*,
+                                                                   const mta::AlgorithmThread::Range& chunk,
+                                                                   const mta::AlgorithmThread::Range& rowRange)
+{
+   int numResultsCols = mInput.mpIterCheck->getNumSelectedColumns();
    int maxRowNum = static_cast<int>(mInput.mpDescriptor->getRowCount()) - 1;
-   mRowRange.mFirst = std::max(0, mRowRange.mFirst);
-   mRowRange.mLast = std::min(mRowRange.mLast, maxRowNum);
+   const RasterDataDescriptor* pResultDescriptor = static_cast<const RasterDataDescriptor*>(
+      mInput.mpResult->getDataDescriptor());
 
    unsigned int bandCount = mInput.mBands.size();
    for (unsigned int bandNum = 0; bandNum < bandCount; ++bandNum)
    {
       FactoryResource<DataRequest> pResultRequest;
-      pResultRequest->setRows(pResultDescriptor->getActiveRow(mRowRange.mFirst),
-         pResultDescriptor->getActiveRow(mRowRange.mLast));
+      pResultRequest->setRows(pResultDescriptor->getActiveRow(rowRange.mFirst),
+         pResultDescriptor->getActiveRow(rowRange.mLast));
       pResultRequest->setColumns(pResultDescriptor->getActiveColumn(0),
          pResultDescriptor->getActiveColumn(numResultsCols - 1));
       pResultRequest->setBands(pResultDescriptor->getActiveBand(bandNum),
@@ -363,13 +392,12 @@ void ConvolutionFilterShell::ConvolutionFilterThread::convolve(const T*)
       DataAccessor resultAccessor = mInput.mpResult->getDataAccessor(pResultRequest.release());
       if (!resultAccessor.isValid())
       {
-         return;
+         return false;
       }
 
-      int oldPercentDone = -1;
       int rowOffset = static_cast<int>(mInput.mpIterCheck->getOffset().mY);
-      int startRow = mRowRange.mFirst + rowOffset;
-      int stopRow = mRowRange.mLast + rowOffset;
+      int startRow = rowRange.mFirst + rowOffset;
+      int stopRow = rowRange.mLast + rowOffset;
 
       int columnOffset = static_cast<int>(mInput.mpIterCheck->getOffset().mX);
       int startColumn = columnOffset;
@@ -388,7 +416,7 @@ void ConvolutionFilterShell::ConvolutionFilterThread::convolve(const T*)
       DataAccessor accessor = mInput.mpRaster->getDataAccessor(pRequest.release());
       if (!accessor.isValid())
       {
-         return;
+         return false;
       }
 
       Service<ModelServices> model;
@@ -396,10 +424,11 @@ void ConvolutionFilterShell::ConvolutionFilterThread::convolve(const T*)
       int numRows = stopRow - startRow + 1;
       for (int row_index = startRow; row_index <= stopRow; ++row_index)
       {
-         int percentDone = 100 * ((bandNum * numRows) + (row_index - startRow)) / (numRows * bandCount); 
-         if (percentDone > oldPercentDone)
+         int percentDone = computeChunkPercent(mRowCount, chunk,
+            rowRange.mFirst + ((bandNum * numRows) + (row_index - startRow)) / bandCount);
+         if (percentDone > mPercentDone)
          {
-            oldPercentDone = percentDone;
+            mPercentDone = percentDone;
             getReporter().reportProgress(getThreadIndex(), percentDone);
          }
          if (mInput.mpAbortFlag != NULL && *mInput.mpAbortFlag)
@@ -425,7 +454,7 @@ void ConvolutionFilterShell::ConvolutionFilterThread::convolve(const T*)
                      accessor->toPixel(real_row, real_col);
                      if (accessor.isValid() == false)
                      {
-                        return;
+                        return false;
                      }
 
                      double val = 0.0;
@@ -436,7 +465,7 @@ void ConvolutionFilterShell::ConvolutionFilterThread::convolve(const T*)
             }
             if (resultAccessor.isValid() == false)
             {
-               return;
+               return false;
             }
 
             switchOnEncoding(pResultDescriptor->getDataType(), assignResult,
@@ -446,6 +475,8 @@ void ConvolutionFilterShell::ConvolutionFilterThread::convolve(const T*)
          resultAccessor->nextRow();
       }
    }
+
+   return true;
 }
 
 bool ConvolutionFilterShell::ConvolutionFilterThreadOutput::compileOverallResults(
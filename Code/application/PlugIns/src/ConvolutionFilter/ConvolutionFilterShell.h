@@ -80,9 +80,12 @@ protected:
    private:
       ConvolutionFilterThread& operator=(const ConvolutionFilterThread& rhs);
 
-      template<typename T> void convolve(const T*);
+      template<typename T> void convolve(const T* pData);
+      template<typename T> bool convolveRows(const T*, const mta::AlgorithmThread::Range& chunk,
+         const mta::AlgorithmThread::Range& rowRange);
       const ConvolutionFilterThreadInput& mInput;
-      mta::AlgorithmThread::Range mRowRange;
+      int mRowCount;
+      int mPercentDone;
    };
 
    struct ConvolutionFilterThreadOutput
@@ -243,43 +243,57 @@ void ComputeMaskedCvm(T* pData, MaskInput* pInput, RasterElement* pRaster)
    T* pPixel = NULL;
 
    memset(pInput->pMatrix, 0, sizeof(double) * pInput->numBands * pInput->numBands);
+   BitMaskIterator it(pInput->mpMask, pRaster);
+
+   // Only read the rows and columns which contain selected pixels
    FactoryResource<DataRequest> pRequest;
    pRequest->setInterleaveFormat(BIP);
-   DataAccessor accessor = pRaster->getDataAccessor(pRequest.release());
+   pRequest->setRows(pDescriptor->getActiveRow(it.getBoundingBoxStartRow()),
+      pDescriptor->getActiveRow(it.getBoundingBoxEndRow()));
+   pRequest->setColumns(pDescriptor->getActiveColumn(it.getBoundingBoxStartColumn()),
+      pDescriptor->getActiveColumn(it.getBoundingBoxEndColumn()));
+   DataAccessor accessor = pRaster->getDataAccessor(pRequest->copy());
    const Units* pUnits = pDescriptor->getUnits();
    double unitScale = (pUnits == NULL) ? 1.0 : pUnits->getScaleFromStandard();
-   BitMaskIterator it(pInput->mpMask, pRaster);
    int numPixels = it.getCount();
-   LocationType loc;
    float progScale = 100.0f / numPixels;
    int progSave = 0;
-   while (it != it.end())
+   bool aborted = false;
+   vector<pair<int, int> > spans;
+   for (int row = it.getBoundingBoxStartRow(); row <= it.getBoundingBoxEndRow() && !aborted; ++row)
    {
-      it.getPixelLocation(loc);
-      accessor->toPixel(loc.mY, loc.mX);
-      VERIFYNRV(accessor.isValid());
-      if (pInput->pProgress != NULL &&
-          progSave != static_cast<int>(progScale * lCount))
+      it.getRowSpans(row, spans);
+      for (vector<pair<int, int> >::const_iterator span = spans.begin(); span != spans.end() && !aborted; ++span)
       {
-         if ((pInput->pAbortFlag == NULL) || !(*pInput->pAbortFlag))
-         {
-            progSave = static_cast<int>(progScale * lCount);
-            pInput->pProgress->updateProgress("Computing Covariance Matrix...",
-               progSave, NORMAL);
-         }
-         else
+         accessor->toPixel(row, span->first);
+         for (int column = span->first; column < span->second; ++column)
          {
-            break;
+            VERIFYNRV(accessor.isValid());
+            if (pInput->pProgress != NULL &&
+                progSave != static_cast<int>(progScale * lCount))
+            {
+               if ((pInput->pAbortFlag == NULL) || !(*pInput->pAbortFlag))
+               {
+                  progSave = static_cast<int>(progScale * lCount);
+                  pInput->pProgress->updateProgress("Computing Covariance Matrix...",
+                     progSave, NORMAL);
+               }
+               else
+               {
+                  aborted = true;
+                  break;
+               }
+            }
+            pPixel = reinterpret_cast<T*>(accessor->getColumn());
+            ++lCount;
+            for (unsigned int band1 = 0; band1 < numBands; ++band1)
+            {
+               pInput->pAverage[band1] += unitScale * *pPixel;
+               ++pPixel;
+            }
+            accessor->nextColumn();
          }
       }
-      pPixel = reinterpret_cast<T*>(accessor->getColumn());
-      ++lCount;
-      ++it;
-      for (unsigned int band1 = 0; band1 < numBands; ++band1)
-      {
-         pInput->pAverage[band1] += unitScale * *pPixel;
-         ++pPixel;
-      }
    }
 
    for (unsigned int band1 = 0; band1 < numBands; ++band1)
@@ -290,47 +304,54 @@ void ComputeMaskedCvm(T* pData, MaskInput* pInput, RasterElement* pRaster)
 
    // calculate covariance matrix
    accessor = pRaster->getDataAccessor(pRequest->copy());
-   it.firstPixel();
    lCount = 0;
    progSave = 0;
-   while (it != it.end())
+   for (int row = it.getBoundingBoxStartRow(); row <= it.getBoundingBoxEndRow() && !aborted; ++row)
    {
-      if (pInput->pProgress != NULL &&
-          progSave != static_cast<int>(progScale * lCount))
+      it.getRowSpans(row, spans);
+      for (vector<pair<int, int> >::const_iterator span = spans.begin(); span != spans.end() && !aborted; ++span)
       {
-         if ((pInput->pAbortFlag == NULL) || !(*pInput->pAbortFlag))
-         {
-            progSave = static_cast<int>(progScale * lCount);
-            pInput->pProgress->updateProgress("Computing Covariance Matrix...",
-               progSave, NORMAL);
-         }
-         else
+         accessor->toPixel(row, span->first);
+         for (int column = span->first; column < span->second; ++column)
          {
-            break;
-         }
-      }
-      it.getPixelLocation(loc);
-      accessor->toPixel(loc.mY, loc.mX);
+            if (pInput->pProgress != NULL &&
+                progSave != static_cast<int>(progScale * lCount))
+            {
+               if ((pInput->pAbortFlag == NULL) || !(*pInput->pAbortFlag))
+               {
+                  progSave = static_cast<int>(progScale * lCount);
+                  pInput->pProgress->updateProgress("Computing Covariance Matrix...",
+                     progSave, NORMAL);
+               }
+               else
+               {
+                  aborted = true;
+                  break;
+               }
+            }
 
-      VERIFYNRV(accessor.isValid());
-      double* pMatrixRow = pInput->pMatrix;
-      double* pMatrixColumn = NULL;
-      pPixel = reinterpret_cast<T*>(accessor->getColumn());
+            VERIFYNRV(accessor.isValid());
+            double* pMatrixRow = pInput->pMatrix;
+            double* pMatrixColumn = NULL;
+            pPixel = reinterpret_cast<T*>(accessor->getColumn());
 
-      for (unsigned int band2 = 0; band2 < numBands; ++band2, pMatrixRow += (numBands + 1))
-      {
-         pData = pPixel;
-         pMatrixColumn = pMatrixRow;
-         for (unsigned int band1 = band2; band1 < numBands; ++band1)
-         {
-            *pMatrixColumn += ((unitScale * *pData) - pInput->pAverage[band1]) * ((unitScale * *pPixel) - pInput->pAverage[band2]);
-            ++pData;
-            ++pMatrixColumn;
+            for (unsigned int band2 = 0; band2 < numBands; ++band2, pMatrixRow += (numBands + 1))
+            {
+               pData = pPixel;
+               pMatrixColumn = pMatrixRow;
+               for (unsigned int band1 = band2; band1 < numBands; ++band1)
+               {
+                  *pMatrixColumn += ((unitScale * *pData) - pInput->pAverage[band1]) *
+                     ((unitScale * *pPixel) - pInput->pAverage[band2]);
+                  ++pData;
+                  ++pMatrixColumn;
+               }
+               ++pPixel;
+            }
+            ++lCount;
+            accessor->nextColumn();
          }
-         ++pPixel;
       }
-      ++lCount;
-      ++it;
    }
 
    // check if aborted
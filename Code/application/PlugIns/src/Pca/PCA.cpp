@@ -225,50 +225,63 @@ void ComputeMaskedCov(T* pData, MaskInput* pInput)
    T *pPixel = NULL;
 
    // calculate average spectrum
+   BitMaskIterator it(pInput->mpMask, pInput->mpRaster);
+
+   // Only read the rows and columns which contain selected pixels
    FactoryResource<DataRequest> pRequest;
    pRequest->setInterleaveFormat(BIP);
+   pRequest->setRows(pDescriptor->getActiveRow(it.getBoundingBoxStartRow()),
+      pDescriptor->getActiveRow(it.getBoundingBoxEndRow()));
+   pRequest->setColumns(pDescriptor->getActiveColumn(it.getBoundingBoxStartColumn()),
+      pDescriptor->getActiveColumn(it.getBoundingBoxEndColumn()));
 
    DataAccessor accessor = pInput->mpRaster->getDataAccessor(pRequest->copy());
-   BitMaskIterator it(pInput->mpMask, pInput->mpRaster);
    int numPixels = it.getCount();
    float progScale = 100.0f / numPixels;
-   LocationType loc;
-   pPixel = reinterpret_cast<T*>(accessor->getColumn());
    int mask = 0;
    int progSave = 0;
+   bool aborted = false;
    if (it == it.end())
    {
       pInput->mpProgress->updateProgress("No pixels Selected", 0, ERRORS);
    }
 
-   while (it != it.end())
+   vector<pair<int, int> > spans;
+   for (int row = it.getBoundingBoxStartRow(); row <= it.getBoundingBoxEndRow() && !aborted; ++row)
    {
-      if (pInput->mpProgress != NULL &&
-          progSave != static_cast<int>(progScale * mask))
+      it.getRowSpans(row, spans);
+      for (vector<pair<int, int> >::const_iterator span = spans.begin(); span != spans.end() && !aborted; ++span)
       {
-         if ((pInput->mpAbortFlag == NULL) || !(*pInput->mpAbortFlag))
-         {
-            progSave = static_cast<int>(progScale * mask);
-            pInput->mpProgress->updateProgress("Computing Average Signature...",
-               progSave , NORMAL);
-         }
-         else
+         accessor->toPixel(row, span->first);
+         for (int column = span->first; column < span->second; ++column)
          {
-            break;
+            if (pInput->mpProgress != NULL &&
+                progSave != static_cast<int>(progScale * mask))
+            {
+               if ((pInput->mpAbortFlag == NULL) || !(*pInput->mpAbortFlag))
+               {
+                  progSave = static_cast<int>(progScale * mask);
+                  pInput->mpProgress->updateProgress("Computing Average Signature...",
+                     progSave , NORMAL);
+               }
+               else
+               {
+                  aborted = true;
+                  break;
+               }
+            }
+            VERIFYNRV(accessor.isValid());
+            pPixel = reinterpret_cast<T*>(accessor->getColumn());
+            ++lCount;
+            for (band1 = 0; band1 < numBands; ++band1)
+            {
+               pAverage[band1] += *pPixel;
+               ++pPixel;
+            }
+            ++mask;
+            accessor->nextColumn();
          }
       }
-      it.getPixelLocation(loc);
-      accessor->toPixel(loc.mY, loc.mX);
-      VERIFYNRV(accessor.isValid());
-      pPixel = reinterpret_cast<T*>(accessor->getColumn());
-      ++lCount;
-      for (band1 = 0; band1 < numBands; ++band1)
-      {
-         pAverage[band1] += *pPixel;
-         ++pPixel;
-      }
-      ++it;
-      ++mask;
    }
 
    // check if aborted
@@ -281,44 +294,47 @@ void ComputeMaskedCov(T* pData, MaskInput* pInput)
 
       // calculate covariance matrix
       accessor = pInput->mpRaster->getDataAccessor(pRequest->copy());
-      it.firstPixel();
       mask = 0;
-      unsigned int numPixels2 = it.getCount();
-      float progScale2 = 100.0f / numPixels2;
-      LocationType loc2;
       progSave = 0;
-      while (it != it.end())
+      for (int row = it.getBoundingBoxStartRow(); row <= it.getBoundingBoxEndRow() && !aborted; ++row)
       {
-         if (pInput->mpProgress != NULL &&
-             progSave != static_cast<int>(progScale2 * mask))
-         {
-            if ((pInput->mpAbortFlag == NULL) || !(*pInput->mpAbortFlag))
-            {
-               progSave = static_cast<int>(progScale2 * mask);
-               pInput->mpProgress->updateProgress("Computing Covariance Matrix...",
-                  progSave, NORMAL);
-            }
-            else
-            {
-               break;
-            }
-         }
-         it.getPixelLocation(loc2);
-         accessor->toPixel(loc2.mY, loc2.mX);
-         VERIFYNRV(accessor.isValid());
-         pPixel = reinterpret_cast<T*>(accessor->getColumn());
-         for (band2 = 0; band2 < numBands; ++band2)
+         it.getRowSpans(row, spans);
+         for (vector<pair<int, int> >::const_iterator span = spans.begin(); span != spans.end() && !aborted; ++span)
          {
-            pData = pPixel;
-            for (band1 = band2; band1 < numBands; ++band1)
+            accessor->toPixel(row, span->first);
+            for (int column = span->first; column < span->second; ++column)
             {
-               pInput->mpMatrix[band2][band1] += (*pPixel-pAverage[band2]) * (*pData-pAverage[band1]);
-               ++pData;
+               if (pInput->mpProgress != NULL &&
+                   progSave != static_cast<int>(progScale * mask))
+               {
+                  if ((pInput->mpAbortFlag == NULL) || !(*pInput->mpAbortFlag))
+                  {
+                     progSave = static_cast<int>(progScale * mask);
+                     pInput->mpProgress->updateProgress("Computing Covariance Matrix...",
+                        progSave, NORMAL);
+                  }
+                  else
+                  {
+                     aborted = true;
+                     break;
+                  }
+               }
+               VERIFYNRV(accessor.isValid());
+               pPixel = reinterpret_cast<T*>(accessor->getColumn());
+               for (band2 = 0; band2 < numBands; ++band2)
+               {
+                  pData = pPixel;
+                  for (band1 = band2; band1 < numBands; ++band1)
+                  {
+                     pInput->mpMatrix[band2][band1] += (*pPixel-pAverage[band2]) * (*pData-pAverage[band1]);
+                     ++pData;
+                  }
+                  ++pPixel;
+               }
+               ++mask;
+               accessor->nextColumn();
             }
-            ++pPixel;
          }
-         ++mask;
-         ++it;
       }
    }
 
@@ -1549,46 +1565,49 @@ bool PCA::computePCAaoi()
       min = numeric_limits<double>::max();
       max = numeric_limits<double>::min();
 
-      it.firstPixel();
-      LocationType loc;
-
-      while (it != it.end())
+      // Only visit the runs of selected pixels in each row
+      vector<pair<int, int> > spans;
+      for (int row = y1; row <= y2 && !isAborted(); ++row)
       {
-         it.getPixelLocation(loc);
-         accessor->toPixel(loc.mY, loc.mX);
-         compValAccessor->toPixel(loc.mY - y1, loc.mX - x1);
-         VERIFY(accessor.isValid());
-         VERIFY(compValAccessor.isValid());
-
-         pTempVal = reinterpret_cast<double*>(compValAccessor->getColumn());
-         pOrigData = accessor->getColumn();
-         if (pOrigData == NULL)
+         it.getRowSpans(row, spans);
+         for (vector<pair<int, int> >::const_iterator span = spans.begin(); span != spans.end() && !isAborted(); ++span)
          {
-               mMessage = "Could not get the pixels in the Original cube!";
-            if (mpProgress != NULL)
+            accessor->toPixel(row, span->first);
+            compValAccessor->toPixel(row - y1, span->first - x1);
+            for (int column = span->first; column < span->second && !isAborted(); ++column)
             {
-               mpProgress->updateProgress(mMessage, currentProgress, ERRORS);
-            }
+               VERIFY(accessor.isValid());
+               VERIFY(compValAccessor.isValid());
 
-            mpStep->finalize(Message::Failure, mMessage);
-            return false;
-         }
+               pTempVal = reinterpret_cast<double*>(compValAccessor->getColumn());
+               pOrigData = accessor->getColumn();
+               if (pOrigData == NULL)
+               {
+                  mMessage = "Could not get the pixels in the Original cube!";
+                  if (mpProgress != NULL)
+                  {
+                     mpProgress->updateProgress(mMessage, currentProgress, ERRORS);
+                  }
 
-         switchOnEncoding(eDataType, ComputePcaValue, pOrigData, pTempVal, pCoefficients, mNumBands);
+                  mpStep->finalize(Message::Failure, mMessage);
+                  return false;
+               }
 
-         if (*pTempVal > max)
-         {
-            max = *pTempVal;
-         }
-         if (*pTempVal < min)
-         {
-            min = *pTempVal;
-         }
-         if (isAborted())
-         {
-            break;
+               switchOnEncoding(eDataType, ComputePcaValue, pOrigData, pTempVal, pCoefficients, mNumBands);
+
+               if (*pTempVal > max)
+               {
+                  max = *pTempVal;
+               }
+               if (*pTempVal < min)
+               {
+                  min = *pTempVal;
+               }
+
+               accessor->nextColumn();
+               compValAccessor->nextColumn();
+            }
          }
-          ++it;
       }
 
       if (!isAborted())
@@ -1615,31 +1634,37 @@ bool PCA::computePCAaoi()
             return false;
          }
 
-         it.firstPixel();
          compValAccessor = pComponentValues->getDataAccessor();
-         while (it != it.end())
+         for (int row = y1; row <= y2; ++row)
          {
-            it.getPixelLocation(loc);
-            pcaAccessor->toPixel(loc.mY, loc.mX);
-            compValAccessor->toPixel(loc.mY - y1, loc.mX - x1);
-            VERIFY(pcaAccessor.isValid());
-            VERIFY(compValAccessor.isValid());
-            pPCAData = pcaAccessor->getColumn();
-            pTempVal = reinterpret_cast<double*>(compValAccessor->getColumn());
-            if (pPCAData == NULL)
+            it.getRowSpans(row, spans);
+            for (vector<pair<int, int> >::const_iterator span = spans.begin(); span != spans.end(); ++span)
             {
-               mMessage = "Could not get the pixels in the PCA cube!";
-               if (mpProgress != NULL)
+               pcaAccessor->toPixel(row, span->first);
+               compValAccessor->toPixel(row - y1, span->first - x1);
+               for (int column = span->first; column < span->second; ++column)
                {
-                  mpProgress->updateProgress(mMessage, currentProgress, ERRORS);
-               }
+                  VERIFY(pcaAccessor.isValid());
+                  VERIFY(compValAccessor.isValid());
+                  pPCAData = pcaAccessor->getColumn();
+                  pTempVal = reinterpret_cast<double*>(compValAccessor->getColumn());
+                  if (pPCAData == NULL)
+                  {
+                     mMessage = "Could not get the pixels in the PCA cube!";
+                     if (mpProgress != NULL)
+                     {
+                        mpProgress->updateProgress(mMessage, currentProgress, ERRORS);
+                     }
 
-               mpStep->finalize(Message::Failure, mMessage);
-               return false;
-            }
+                     mpStep->finalize(Message::Failure, mMessage);
+                     return false;
+                  }
 
-            switchOnEncoding(mOutputDataType, StorePcaValue, pPCAData, pTempVal, &min, &scalefactor, &mMinScaleValue);
-            ++it;
+                  switchOnEncoding(mOutputDataType, StorePcaValue, pPCAData, pTempVal, &min, &scalefactor, &mMinScaleValue);
+                  pcaAccessor->nextColumn();
+                  compValAccessor->nextColumn();
+               }
+            }
          }
          if (isAborted())
          {
@@ -970,6 +970,7 @@ bool GeoTIFFImporter::createRasterPager(RasterElement *pRasterElement) const
    pagerPlugIn->getInArgList().setPlugInArgValue<unsigned int>("numBands", &bandCount);
    pagerPlugIn->getInArgList().setPlugInArgValue<unsigned int>("bytesPerElement", &bytesPerElement);
    pagerPlugIn->getInArgList().setPlugInArgValue("Filename", pFilename.get());
+   pagerPlugIn->getInArgList().setPlugInArgValue("Raster Element", pRasterElement);
    bool success = pagerPlugIn->execute();
 
    RasterPager* pPager = dynamic_cast<RasterPager*>(pagerPlugIn->getPlugIn());
@@ -37,7 +37,8 @@ CacheUnit::CacheUnit(const vector<unsigned int>& blockNumbers, size_t blockSize)
    mBlockNumbers(blockNumbers),
    mDataSize(blockSize),
    mpData(NULL),
-   mIsEmpty(true)
+   mIsEmpty(true),
+   mLastAccess(0)
 {
    mpData = mpModelSvcs->getMemoryBlock(mDataSize);
 }
@@ -94,7 +95,21 @@ void CacheUnit::setIsEmpty(bool v)
    mIsEmpty = v;
 }
 
-Cache::Cache() : mCacheSize(8)
+uint64_t CacheUnit::lastAccess() const
+{
+   return mLastAccess;
+}
+
+void CacheUnit::setLastAccess(uint64_t accessTime)
+{
+   mLastAccess = accessTime;
+}
+
+Cache::Cache(mta::DMutex& mutex) :
+   mCacheSize(8),
+   mMutex(mutex),
+   mpBudget(NULL),
+   mGrown(false)
 {
 }
 
@@ -103,8 +118,24 @@ void Cache::initCacheSize(unsigned int cacheSize)
    mCacheSize = cacheSize;
 }
 
+void Cache::setMemoryBudget(MemoryBudget* pBudget, const DataElement* pElement)
+{
+   if (mpBudget != NULL)
+   {
+      mpBudget->removeConsumer(this);
+   }
+
+   mpBudget = pBudget;
+   if (mpBudget != NULL)
+   {
+      mpBudget->addConsumer(this, pElement);
+   }
+}
+
 Cache::~Cache()
 {
+   setMemoryBudget(NULL, NULL);
+
    for (cache_t::iterator it = mCache.begin(); it != mCache.end(); ++it)
    {
       if (*it != NULL)
@@ -155,6 +186,7 @@ CacheUnit *Cache::getCacheUnit(vector<unsigned int> &blocks, size_t blockSize)
          }
       }
       returnUnit = new CacheUnit(blocks, dataSize);
+      mGrown = true;
    }
    if (returnUnit != NULL)
    {
@@ -167,11 +199,64 @@ CacheUnit *Cache::getCacheUnit(vector<unsigned int> &blocks, size_t blockSize)
       {
          mCache.push_back(returnUnit);
          returnUnit->get();
+         if (mpBudget != NULL)
+         {
+            returnUnit->setLastAccess(mpBudget->getAccessTime());
+         }
       }
    }
    return returnUnit;
 }
 
+bool Cache::takeGrowth()
+{
+   mta::MutexLock lock(mMutex);
+   bool grown = mGrown;
+   mGrown = false;
+   return grown;
+}
+
+int64_t Cache::getMemoryUsage() const
+{
+   mta::MutexLock lock(mMutex);
+   int64_t usage = 0;
+   for (cache_t::const_iterator it = mCache.begin(); it != mCache.end(); ++it)
+   {
+      usage += (*it)->dataSize();
+   }
+   return usage;
+}
+
+bool Cache::getOldestAccess(uint64_t& accessTime) const
+{
+   mta::MutexLock lock(mMutex);
+
+   // the units are ordered from least to most recently used
+   cache_t::const_iterator clean_it(find_if(mCache.begin(), mCache.end(), Cache::CacheCleaner));
+   if (clean_it == mCache.end())
+   {
+      return false;
+   }
+   accessTime = (*clean_it)->lastAccess();
+   return true;
+}
+
+int64_t Cache::releaseOldest()
+{
+   mta::MutexLock lock(mMutex);
+
+   // units which are referenced by a page cannot be released
+   cache_t::iterator clean_it(find_if(mCache.begin(), mCache.end(), Cache::CacheCleaner));
+   if (clean_it == mCache.end())
+   {
+      return 0;
+   }
+   int64_t size = (*clean_it)->dataSize();
+   delete *clean_it;
+   mCache.erase(clean_it);
+   return size;
+}
+
 bool Cache::CacheLocator(vector<unsigned int> blockNumbers, CacheUnit *pUnit)
 {
    // cases:
@@ -203,7 +288,8 @@ GeoTiffPager::GeoTiffPager() :
          mColumnCount(0),
          mBandCount(0),
          mBytesPerElement(0),
-         mpTiff(NULL)
+         mpTiff(NULL),
+         mBlockCache(mMutex)
 {
    setName("GeoTiffPager");
    setCopyright(APP_COPYRIGHT);
@@ -236,6 +322,7 @@ bool GeoTiffPager::getInputSpecification(PlugInArgList *&pArgList)
    VERIFY(pArgList->addArg<unsigned int>("bytesPerElement"));
    VERIFY(pArgList->addArg<unsigned int>("cacheBlocks", 8));
    VERIFY(pArgList->addArg<Filename>("Filename", NULL));
+   VERIFY(pArgList->addArg<RasterElement>("Raster Element", NULL));
 
    return true;
 }
@@ -289,6 +376,10 @@ bool GeoTiffPager::execute(PlugInArgList *pInputArgList, PlugInArgList *)
 
    mBlockCache.initCacheSize(cacheBlocks);
 
+   // the element is optional and is only used to report the memory used by the cache for the element
+   RasterElement* pRaster = pInputArgList->getPlugInArgValue<RasterElement>("Raster Element");
+   mBlockCache.setMemoryBudget(mpModelSvcs->getMemoryBudget(), pRaster);
+
    Filename* pFilename = pInputArgList->getPlugInArgValue<Filename>("Filename");
    if (pFilename == NULL)
    {
@@ -306,6 +397,20 @@ RasterPage* GeoTiffPager::getPage(DataRequest *pOriginalRequest,
       DimensionDescriptor startRow, 
       DimensionDescriptor startColumn, 
       DimensionDescriptor startBand)
+{
+   RasterPage* pPage = readPage(pOriginalRequest, startRow, startColumn, startBand);
+
+   // the budget locks mMutex to release units, so it is updated after readPage() unlocks it
+   if (mBlockCache.takeGrowth())
+   {
+      mpModelSvcs->getMemoryBudget()->update();
+   }
+
+   return pPage;
+}
+
+RasterPage* GeoTiffPager::readPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
+   DimensionDescriptor startColumn, DimensionDescriptor startBand)
 {
    if (pOriginalRequest == NULL)
    {
@@ -495,85 +600,125 @@ RasterPage* GeoTiffPager::getPage(DataRequest *pOriginalRequest,
          // This is stated in the TIFF 6.0 spec on page 68 (in the TileOffsets definition)
          const uint32 tileOffset(mInterleave == BIP ? 0 : bandNumber * tilesAcross * tilesDown);
 
-         // The 0-based index of the first desired tile
-         const ttile_t startTileIndex(rowNumber / tileLength);
+         // The number of bands in pPage
+         const unsigned int bandSkip(mInterleave == BIP ? mBandCount : 1);
 
-         // The tile containing the first column of the first requested row
-         const ttile_t startTile(tileOffset + startTileIndex * tilesAcross);
-         if (startTile < 0)
+         // A request which fits within a single tile is served from the decoded
+         // tile as-is instead of reassembling the full row of tiles.  Single-tile
+         // units cannot be confused with row units in the cache when there is more
+         // than one tile across since row units always contain every tile across.
+         const uint32 tileRow(rowNumber / tileLength);
+         const uint32 tileColumn(colNumber / tileWidth);
+         if (tilesAcross > 1 &&
+            (rowNumber + concurrentRows - 1) / tileLength == tileRow &&
+            (colNumber + concurrentColumns - 1) / tileWidth == tileColumn)
          {
-            throw string("Cannot determine startTile");
-         }
+            const ttile_t tile(tileOffset + tileRow * tilesAcross + tileColumn);
+            GeoTiffOnDisk::CacheUnit* pCacheUnit(mBlockCache.getCacheUnit(tile, tile, tileSize));
+            if (pCacheUnit == NULL)
+            {
+               throw string("Cannot create a cache unit");
+            }
 
-         // The 0-based index of the last desired tile
-         const ttile_t endTileIndex((rowNumber + concurrentRows - 1) / tileLength);
+            // The offset of the first requested data within the tile
+            const size_t offset(mBytesPerElement *
+               (((rowNumber % tileLength) * tileWidth + colNumber % tileWidth) * bandSkip +
+               (mInterleave == BSQ ? 0 : bandNumber)));
 
-         // The tile containing the last column of the last requested row
-         const ttile_t endTile(tileOffset + endTileIndex * tilesAcross + tilesAcross - 1);
-         if (endTile < 0)
-         {
-            throw string("Cannot determine endTile");
-         }
+            // The number of valid rows in the tile following the first requested row
+            const unsigned int numRows(min(tileLength - rowNumber % tileLength, mRowCount - rowNumber));
 
-         // Retrieve a block from the cache
-         GeoTiffOnDisk::CacheUnit* pCacheUnit(mBlockCache.getCacheUnit(startTile, endTile, tileSize));
-         if (pCacheUnit == NULL)
-         {
-            throw string("Cannot create a cache unit");
-         }
+            pPage = new GeoTiffPage(pCacheUnit, offset, numRows, tileWidth, bandSkip);
+            if (pCacheUnit->isEmpty())
+            {
+               if (TIFFReadEncodedTile(mpTiff, tile, pCacheUnit->data(), tileSize) != tileSize)
+               {
+                  throw string("Error reading TIFF data");
+               }
 
-         // The number of bands in pPage
-         const unsigned int bandSkip(mInterleave == BIP ? mBandCount : 1);
+               pCacheUnit->setIsEmpty(false);
+            }
+         }
+         else
+         {
+            // The 0-based index of the first desired tile
+            const ttile_t startTileIndex(rowNumber / tileLength);
 
-         // The number of columns in pPage
-         const unsigned int columnSkip(mColumnCount);
+            // The tile containing the first column of the first requested row
+            const ttile_t startTile(tileOffset + startTileIndex * tilesAcross);
+            if (startTile < 0)
+            {
+               throw string("Cannot determine startTile");
+            }
 
-         // The offset of the first requested data within pPage
-         const size_t offset(mBytesPerElement *
-            ((rowNumber % tileLength) * columnSkip * bandSkip + (mInterleave == BSQ ? 0 : bandNumber)));
+            // The 0-based index of the last desired tile
+            const ttile_t endTileIndex((rowNumber + concurrentRows - 1) / tileLength);
 
-         // The number of rows in pPage
-         const unsigned int rowSkip(tileLength * ((endTile - startTile + 1) / tilesAcross));
+            // The tile containing the last column of the last requested row
+            const ttile_t endTile(tileOffset + endTileIndex * tilesAcross + tilesAcross - 1);
+            if (endTile < 0)
+            {
+               throw string("Cannot determine endTile");
+            }
 
-         // Create a GeoTiffPage based on the computed values
-         pPage = new GeoTiffPage(pCacheUnit, offset, rowSkip, columnSkip, bandSkip);
-         if (pCacheUnit->isEmpty())
-         {
-            // Temporary storage for the working tile
-            vector<unsigned char> tileData(tileSize);
-            for (ttile_t curTile = startTile, tileNum = 0; curTile <= endTile; ++curTile, ++tileNum)
+            // Retrieve a block from the cache
+            GeoTiffOnDisk::CacheUnit* pCacheUnit(mBlockCache.getCacheUnit(startTile, endTile, tileSize));
+            if (pCacheUnit == NULL)
             {
-               if (TIFFReadEncodedTile(mpTiff, curTile, &tileData[0], tileSize) != tileSize)
-               {
-                  throw string("Error reading TIFF data");
-               }
+               throw string("Cannot create a cache unit");
+            }
 
-               // The starting address of this tile within pPage
-               char* pBlockPos(pCacheUnit->data());
+            // The number of columns in pPage
+            const unsigned int columnSkip(mColumnCount);
 
-               // Increment by one or more rows of tiles
-               pBlockPos += tileSize * tilesAcross * bandSkip * mBytesPerElement * (tileNum / tilesAcross);
+            // The offset of the first requested data within pPage
+            const size_t offset(mBytesPerElement *
+               (((rowNumber % tileLength) * columnSkip + colNumber) * bandSkip +
+               (mInterleave == BSQ ? 0 : bandNumber)));
 
-               // Increment by one or more tiles within a row
-               pBlockPos += tileWidth * bandSkip * mBytesPerElement * (tileNum % tilesAcross);
+            // The number of rows in pPage
+            const unsigned int rowSkip(tileLength * ((endTile - startTile + 1) / tilesAcross));
 
-               // The number of bytes to copy - this might be different for partial tiles (e.g.: at the end of a row)
-               size_t numBytesToCopy = tileWidth;
-               if ((tileNum + 1) % tilesAcross == 0 && mColumnCount % tileWidth != 0)
+            // Create a GeoTiffPage based on the computed values
+            pPage = new GeoTiffPage(pCacheUnit, offset, rowSkip, columnSkip, bandSkip);
+            if (pCacheUnit->isEmpty())
+            {
+               // Temporary storage for the working tile
+               vector<unsigned char> tileData(tileSize);
+               for (ttile_t curTile = startTile, tileNum = 0; curTile <= endTile; ++curTile, ++tileNum)
                {
-                  numBytesToCopy = mColumnCount % tileWidth;
+                  if (TIFFReadEncodedTile(mpTiff, curTile, &tileData[0], tileSize) != tileSize)
+                  {
+                     throw string("Error reading TIFF data");
+                  }
+
+                  // The starting address of this tile within pPage
+                  char* pBlockPos(pCacheUnit->data());
+
+                  // Increment by one or more rows of tiles
+                  pBlockPos += tileSize * tilesAcross * bandSkip * mBytesPerElement * (tileNum / tilesAcross);
+
+                  // Increment by one or more tiles within a row
+                  pBlockPos += tileWidth * bandSkip * mBytesPerElement * (tileNum % tilesAcross);
+
+                  // The number of bytes to copy - this might be different for partial tiles (e.g.: at the end of a row)
+                  size_t numBytesToCopy = tileWidth;
+                  if ((tileNum + 1) % tilesAcross == 0 && mColumnCount % tileWidth != 0)
+                  {
+                     numBytesToCopy = mColumnCount % tileWidth;
+                  }
+
+                  numBytesToCopy *= bandSkip * mBytesPerElement;
+                  for (uint32 row = 0; row < tileLength; ++row)
+                  {
+                     const size_t rowOffset = row * mColumnCount * bandSkip * mBytesPerElement;
+                     const size_t tileOffset2 = row * tileWidth * bandSkip * mBytesPerElement;
+                     memcpy(pBlockPos + rowOffset, &tileData[tileOffset2], numBytesToCopy);
+                  }
                }
 
-               numBytesToCopy *= bandSkip * mBytesPerElement;
-               for (uint32 row = 0; row < tileLength; ++row)
-               {
-                  const size_t rowOffset = row * mColumnCount * bandSkip * mBytesPerElement;
-                  const size_t tileOffset2 = row * tileWidth * bandSkip * mBytesPerElement;
-                  memcpy(pBlockPos + rowOffset, &tileData[tileOffset2], numBytesToCopy);
-               }
+               pCacheUnit->setIsEmpty(false);
             }
-
-            pCacheUnit->setIsEmpty(false);
          }
       }
    }
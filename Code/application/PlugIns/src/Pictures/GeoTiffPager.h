@@ -11,6 +11,7 @@
 #define GEOTIFFPAGER_H
 
 #include "DMutex.h"
+#include "MemoryBudget.h"
 #include "ModelServices.h"
 #include "PlugInManagerServices.h"
 #include "RasterPagerShell.h"
@@ -19,6 +20,7 @@
 
 #include <deque>
 
+class DataElement;
 class GeoTiffPage;
 class RasterElement;
 
@@ -39,6 +41,8 @@ public:
    char* data() const;
    bool isEmpty() const;
    void setIsEmpty(bool v);
+   uint64_t lastAccess() const;
+   void setLastAccess(uint64_t accessTime);
 
 private:
    unsigned int mReferenceCount;
@@ -47,28 +51,46 @@ private:
    char* mpData;
    Service<ModelServices> mpModelSvcs;
    bool mIsEmpty;
+   uint64_t mLastAccess;
 };
 
-class Cache
+/**
+ * The units are accounted by the MemoryBudget, which releases units which are
+ * not referenced by a page.  The pager's mutex must be locked when calling
+ * getCacheUnit() and when releasing a unit, and is locked by the budget.
+ */
+class Cache : public MemoryConsumer
 {
 public:
    typedef std::deque<CacheUnit*> cache_t;
 
 public:
-   Cache();
+   Cache(mta::DMutex& mutex);
    ~Cache();
 
    void initCacheSize(unsigned int cacheSize);
+   void setMemoryBudget(MemoryBudget* pBudget, const DataElement* pElement);
 
    CacheUnit* getCacheUnit(unsigned int startBlock, unsigned int endBlock, size_t blockSize);
    CacheUnit* getCacheUnit(std::vector<unsigned int>& blocks, size_t blockSize);
 
+   // Returns whether units were added since the last call, so that the budget should be updated
+   bool takeGrowth();
+
+   // MemoryConsumer
+   int64_t getMemoryUsage() const;
+   bool getOldestAccess(uint64_t& accessTime) const;
+   int64_t releaseOldest();
+
 private:
    static bool CacheLocator(std::vector<unsigned int> blockNumbers, CacheUnit* pUnit);
    static bool CacheCleaner(const CacheUnit* pUnit);
 
    cache_t mCache;
    unsigned int mCacheSize;
+   mta::DMutex& mMutex;
+   MemoryBudget* mpBudget;
+   bool mGrown;
    Service<ModelServices> mpModelSvcs;
 };
 
@@ -96,6 +118,9 @@ protected:
    GeoTiffPage* getPage(tstrip_t startStrip, tstrip_t endStrip, tsize_t stripSize);
 
 private:
+   RasterPage* readPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
+      DimensionDescriptor startColumn, DimensionDescriptor startBand);
+
    InterleaveFormatType mInterleave;
    unsigned int mRowCount;
    unsigned int mColumnCount;
@@ -9,6 +9,7 @@
 
 #include "AppVerify.h"
 #include "AppVersion.h"
+#include "ConfigurationSettings.h"
 #include "DataRequest.h"
 #include "DimensionDescriptor.h"
 #include "Jpeg2000Pager.h"
@@ -219,6 +220,12 @@ double Jpeg2000Pager::getChunkSize() const
    return msMaxCacheSize;
 }
 
+unsigned int Jpeg2000Pager::getMaxConcurrentFetches() const
+{
+   // Each unit is decoded with its own stream and codec, so units can be decoded at the same time
+   return ConfigurationSettings::getSettingThreadCount();
+}
+
 template <typename Out>
 CachedPage::UnitPtr Jpeg2000Pager::populateImageData(const DimensionDescriptor& startRow,
                                                      const DimensionDescriptor& startColumn,
@@ -369,6 +376,7 @@ opj_image_t* Jpeg2000Pager::decodeImage(unsigned int originalStartRow, unsigned
    }
    else
    {
+      mta::MutexLock lock(mFileMutex);
       fseek(mpFile, 0, SEEK_END);
 
       size_t fileSize = static_cast<size_t>(ftell(mpFile));
@@ -389,7 +397,10 @@ opj_image_t* Jpeg2000Pager::decodeImage(unsigned int originalStartRow, unsigned
    opj_stream_set_user_data_length(pStream, fileLength);
 
    // Seek to the required position in the file
-   fseek(mpFile, static_cast<long>(mOffset), SEEK_SET);
+   {
+      mta::MutexLock lock(mFileMutex);
+      fseek(mpFile, static_cast<long>(mOffset), SEEK_SET);
+   }
 
    // Create the appropriate codec
    opj_codec_t* pCodec = NULL;
@@ -11,6 +11,7 @@
 #define JPEG2000PAGER_H
 
 #include "CachedPager.h"
+#include "DMutex.h"
 
 #include <openjpeg.h>
 #include <stdio.h>
@@ -33,6 +34,7 @@ public:
 
 protected:
    virtual double getChunkSize() const;
+   virtual unsigned int getMaxConcurrentFetches() const;
 
    template <typename Out>
    CachedPage::UnitPtr populateImageData(const DimensionDescriptor& startRow, const DimensionDescriptor& startColumn,
@@ -46,6 +48,7 @@ private:
 
    char *mpFilename;
    FILE* mpFile;
+   mutable mta::DMutex mFileMutex;     // Each decode opens its own stream, so this only guards mpFile
    uint64_t mOffset;
    uint64_t mSize;
 };
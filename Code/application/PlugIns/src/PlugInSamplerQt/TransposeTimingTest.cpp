@@ -0,0 +1,152 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "ConfigurationSettings.h"
+#include "DesktopServices.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "TransposeTimingTest.h"
+#include "TransposeUtilities.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QString>
+#include <QtWidgets/QMessageBox>
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+REGISTER_PLUGIN_BASIC(OpticksPlugInSamplerQt, TransposeTimingTest);
+
+namespace
+{
+   // The size of one row of a typical hyperspectral BSQ cube being converted to BIP
+   const size_t sBands = 224;
+   const size_t sColumns = 2048;
+   const int sIterations = 20;
+}
+
+TransposeTimingTest::TransposeTimingTest()
+{
+   AlgorithmShell::setName("Transpose Timing Test");
+   setCreator("Opticks Community");
+   setVersion("Sample");
+   setCopyright("Copyright (C) 2008, Ball Aerospace & Technologies Corp.");
+   setDescription("Compares the time to convert rows between interleaves one element at a time "
+      "with the time to convert them using the blocked transpose.");
+   setProductionStatus(false);
+   setDescriptorId("{A6835204-34D1-4793-ADD6-CEB6218F574B}");
+   allowMultipleInstances(false);
+   setWizardSupported(false);
+   executeOnStartup(false);
+   destroyAfterExecute(true);
+   setMenuLocation("[Demo]\\Transpose Timing Test");
+}
+
+bool TransposeTimingTest::getInputSpecification(PlugInArgList*& pArgList)
+{
+   pArgList = NULL;
+   return true;
+}
+
+bool TransposeTimingTest::getOutputSpecification(PlugInArgList*& pArgList)
+{
+   if (isBatch())
+   {
+      VERIFY(pArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+      VERIFY(pArgList->addArg<string>("Results"));
+   }
+   else
+   {
+      pArgList = NULL;
+   }
+   return true;
+}
+
+bool TransposeTimingTest::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   if (isBatch())
+   {
+      VERIFY(pOutArgList != NULL);
+   }
+
+   const unsigned int threadCount = ConfigurationSettings::getSettingThreadCount();
+   const unsigned int elementSizes[] = {1, 2, 4, 8, 16};
+   QString results = QString("Transposing %1 x %2 elements, %3 iterations (ms)\n\n")
+      .arg(sBands).arg(sColumns).arg(sIterations);
+   results += QString("Size\tPer element\tBlocked\tBlocked (%1 threads)\n").arg(threadCount);
+
+   bool success = true;
+   for (unsigned int i = 0; i < sizeof(elementSizes) / sizeof(elementSizes[0]); ++i)
+   {
+      const unsigned int elementSize = elementSizes[i];
+      const size_t rowSize = sColumns * elementSize;
+      vector<unsigned char> source(sBands * rowSize);
+      for (size_t j = 0; j < source.size(); ++j)
+      {
+         source[j] = static_cast<unsigned char>(j * 31 + j / 7);
+      }
+
+      vector<const void*> sourceRows(sBands);
+      for (size_t band = 0; band < sBands; ++band)
+      {
+         sourceRows[band] = &source[band * rowSize];
+      }
+
+      vector<unsigned char> expected(source.size());
+      vector<unsigned char> actual(source.size());
+      const size_t dstRowStride = sBands * elementSize;
+
+      QElapsedTimer timer;
+      timer.start();
+      for (int iteration = 0; iteration < sIterations; ++iteration)
+      {
+         TransposeUtilities::transposePerElement(&sourceRows[0], sBands, sColumns,
+            &expected[0], dstRowStride, elementSize);
+      }
+      qint64 perElementTime = timer.restart();
+
+      for (int iteration = 0; iteration < sIterations; ++iteration)
+      {
+         TransposeUtilities::transpose(&sourceRows[0], sBands, sColumns, &actual[0], dstRowStride, elementSize);
+      }
+      qint64 blockedTime = timer.restart();
+      success = success && (actual == expected);
+
+      for (int iteration = 0; iteration < sIterations; ++iteration)
+      {
+         TransposeUtilities::transpose(&sourceRows[0], sBands, sColumns, &actual[0], dstRowStride, elementSize,
+            threadCount);
+      }
+      qint64 threadedTime = timer.elapsed();
+      success = success && (actual == expected);
+
+      results += QString("%1\t%2\t%3\t%4\n").arg(elementSize).arg(perElementTime).arg(blockedTime).arg(threadedTime);
+   }
+
+   if (success == false)
+   {
+      results += "\nThe blocked transpose did not match the per element transpose.\n";
+   }
+
+   if (isBatch())
+   {
+      string resultsText = results.toStdString();
+      pOutArgList->setPlugInArgValue<string>("Results", &resultsText);
+   }
+   else
+   {
+      QMessageBox::information(Service<DesktopServices>()->getMainWidget(), "Transpose Timing", results);
+   }
+
+   return success;
+}
@@ -0,0 +1,25 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef TRANSPOSETIMINGTEST_H
+#define TRANSPOSETIMINGTEST_H
+
+#include "AlgorithmShell.h"
+
+class TransposeTimingTest : public AlgorithmShell
+{
+public:
+   TransposeTimingTest();
+
+   bool getInputSpecification(PlugInArgList*& pArgList);
+   bool getOutputSpecification(PlugInArgList*& pArgList);
+   bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+};
+
+#endif
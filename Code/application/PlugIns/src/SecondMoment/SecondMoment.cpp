@@ -196,52 +196,69 @@ void ComputeMaskedSmm(T* pData, MaskInput* pInput, RasterElement* pRaster)
       return;
    }
 
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(pRaster->getDataDescriptor());
+   VERIFYNRV(pDescriptor != NULL);
+
    int lRow = 0, lColumn = 0;
    int lCount = 0;
    T* pBand1 = NULL;
    T* pBand2 = NULL;
    memset(pInput->pMatrix, 0, sizeof(double) * pInput->numBands * pInput->numBands);
+   BitMaskIterator it(pInput->mpMask, pRaster);
+
+   // Only read the rows and columns which contain selected pixels
    FactoryResource<DataRequest> pRequest;
    pRequest->setInterleaveFormat(BIP);
+   pRequest->setRows(pDescriptor->getActiveRow(it.getBoundingBoxStartRow()),
+      pDescriptor->getActiveRow(it.getBoundingBoxEndRow()));
+   pRequest->setColumns(pDescriptor->getActiveColumn(it.getBoundingBoxStartColumn()),
+      pDescriptor->getActiveColumn(it.getBoundingBoxEndColumn()));
    DataAccessor accessor = pRaster->getDataAccessor(pRequest.release());
-   BitMaskIterator it(pInput->mpMask, pRaster);
    int numPixels = it.getCount();
-   LocationType loc;
    float progScale = 100.0f / numPixels;
    int progSave = 0;
-   while (it != it.end())
+   bool aborted = false;
+   vector<pair<int, int> > spans;
+   for (int row = it.getBoundingBoxStartRow(); row <= it.getBoundingBoxEndRow() && !aborted; ++row)
    {
-      it.getPixelLocation(loc);
-      accessor->toPixel(loc.mY, loc.mX);
-      VERIFYNRV(accessor.isValid());
-      if (pInput->pProgress != NULL && 
-          progSave != static_cast<int>(progScale * lCount))
-      {
-         if ((pInput->pAbortFlag == NULL) || !(*pInput->pAbortFlag))
-         {
-            progSave = static_cast<int>(progScale * lCount);
-            pInput->pProgress->updateProgress("Computing Second Moment Matrix...",
-               progSave, NORMAL);
-         }
-         else
-         {
-            break;
-         }
-      }
-      ++lCount;
-      ++it;
-      pData = static_cast<T*>(accessor->getColumn());
-      pBand2 = pData;
-      for (lRow = 0; lRow < pInput->numBands; ++lRow)
+      it.getRowSpans(row, spans);
+      for (vector<pair<int, int> >::const_iterator span = spans.begin(); span != spans.end() && !aborted; ++span)
       {
-         pBand1 = pBand2;
-         int index = lRow * pInput->numBands + lRow;
-         for (lColumn = lRow; lColumn < pInput->numBands; ++lColumn, ++index)
+         accessor->toPixel(row, span->first);
+         for (int column = span->first; column < span->second; ++column)
          {
-            pInput->pMatrix[index] += (*pBand1) * (*pBand2);
-            ++pBand1;
+            VERIFYNRV(accessor.isValid());
+            if (pInput->pProgress != NULL && 
+                progSave != static_cast<int>(progScale * lCount))
+            {
+               if ((pInput->pAbortFlag == NULL) || !(*pInput->pAbortFlag))
+               {
+                  progSave = static_cast<int>(progScale * lCount);
+                  pInput->pProgress->updateProgress("Computing Second Moment Matrix...",
+                     progSave, NORMAL);
+               }
+               else
+               {
+                  aborted = true;
+                  break;
+               }
+            }
+            ++lCount;
+            pData = static_cast<T*>(accessor->getColumn());
+            pBand2 = pData;
+            for (lRow = 0; lRow < pInput->numBands; ++lRow)
+            {
+               pBand1 = pBand2;
+               int index = lRow * pInput->numBands + lRow;
+               for (lColumn = lRow; lColumn < pInput->numBands; ++lColumn, ++index)
+               {
+                  pInput->pMatrix[index] += (*pBand1) * (*pBand2);
+                  ++pBand1;
+               }
+               ++pBand2;
+            }
+            accessor->nextColumn();
          }
-         ++pBand2;
       }
    }
 
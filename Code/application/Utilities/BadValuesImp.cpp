@@ -17,11 +17,107 @@
 
 #include <QtCore/QString>
 
+#include <algorithm>
 #include <limits>
 #include <map>
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BADVALUES_SSE2
+#include <emmintrin.h>
+#endif
 
 XERCES_CPP_NAMESPACE_USE
 
+namespace
+{
+   // Larger than the magnitude of any integer data value, so that compiled bounds fit in an int64_t
+   const double INTEGER_LIMIT = 8589934592.0;
+
+   // Ranges of at most this many integers are added to the hash of individual bad integers
+   const int64_t MAX_HASHED_RANGE = 8;
+
+   const int64_t EMPTY_SLOT = std::numeric_limits<int64_t>::min();
+
+   double clampToIntegerLimit(double value)
+   {
+      return std::min(std::max(value, -INTEGER_LIMIT), INTEGER_LIMIT);
+   }
+
+   size_t getHashSlot(int64_t value, int shift)
+   {
+      // Fibonacci hashing spreads consecutive values across the table
+      return static_cast<size_t>((static_cast<uint64_t>(value) * 0x9E3779B97F4A7C15ULL) >> shift);
+   }
+
+#if defined(BADVALUES_SSE2)
+   // Returns a bit for each of the two values which is set for a bad value
+   inline int getBadBits(__m128d values, __m128d lower, __m128d upper, __m128d rangeStart, __m128d rangeEnd)
+   {
+      __m128d bad = _mm_or_pd(_mm_cmplt_pd(values, lower), _mm_cmpgt_pd(values, upper));
+      bad = _mm_or_pd(bad, _mm_and_pd(_mm_cmpgt_pd(values, rangeStart), _mm_cmplt_pd(values, rangeEnd)));
+      return _mm_movemask_pd(bad);
+   }
+
+   inline size_t storeMask(int bits, unsigned char* pMask)
+   {
+      pMask[0] = (bits & 1) ? 0 : 0xff;
+      pMask[1] = (bits & 2) ? 0 : 0xff;
+      return static_cast<size_t>((bits & 1) + (bits >> 1));
+   }
+
+   // Each function tests as many contiguous values as the vector width allows and returns the number tested
+   size_t getContiguousMask(const double* pData, size_t count, double lower, double upper, double rangeStart,
+      double rangeEnd, unsigned char* pMask, size_t& badValueCount)
+   {
+      __m128d lowerValues = _mm_set1_pd(lower);
+      __m128d upperValues = _mm_set1_pd(upper);
+      __m128d startValues = _mm_set1_pd(rangeStart);
+      __m128d endValues = _mm_set1_pd(rangeEnd);
+
+      size_t i = 0;
+      for (; i + 2 <= count; i += 2)
+      {
+         int bits = getBadBits(_mm_loadu_pd(pData + i), lowerValues, upperValues, startValues, endValues);
+         badValueCount += storeMask(bits, pMask + i);
+      }
+
+      return i;
+   }
+
+   size_t getContiguousMask(const float* pData, size_t count, double lower, double upper, double rangeStart,
+      double rangeEnd, unsigned char* pMask, size_t& badValueCount)
+   {
+      __m128d lowerValues = _mm_set1_pd(lower);
+      __m128d upperValues = _mm_set1_pd(upper);
+      __m128d startValues = _mm_set1_pd(rangeStart);
+      __m128d endValues = _mm_set1_pd(rangeEnd);
+
+      // The values are compared as doubles to give the same result as isBadValue()
+      size_t i = 0;
+      for (; i + 4 <= count; i += 4)
+      {
+         __m128 values = _mm_loadu_ps(pData + i);
+         int lowBits = getBadBits(_mm_cvtps_pd(values), lowerValues, upperValues, startValues, endValues);
+         int highBits = getBadBits(_mm_cvtps_pd(_mm_movehl_ps(values, values)), lowerValues, upperValues,
+            startValues, endValues);
+         badValueCount += storeMask(lowBits, pMask + i);
+         badValueCount += storeMask(highBits, pMask + i + 2);
+      }
+
+      return i;
+   }
+#else
+   template<typename T>
+   size_t getContiguousMask(const T* pData, size_t count, double lower, double upper, double rangeStart,
+      double rangeEnd, unsigned char* pMask, size_t& badValueCount)
+   {
+      return 0;
+   }
+#endif
+}
+
 BadValuesImp::BadValuesImp() :
    mToleranceStr(BadValues::getSettingTolerance()),
    mBadValuesBeingUpdated(false),
@@ -32,6 +128,7 @@ BadValuesImp::BadValuesImp() :
    mAdjustedSingleRangeUpper(std::numeric_limits<double>::max())
 {
    mTolerance = StringUtilities::fromDisplayString<double>(mToleranceStr);
+   compileCriteria();
 }
 
 BadValuesImp::~BadValuesImp()
@@ -93,33 +190,190 @@ bool BadValuesImp::isBadValue(double value) const
       return value > mAdjustedSingleRangeLower && value < mAdjustedSingleRangeUpper;
    }
 
-   if (empty())
+   // check thresholds, which are infinite when they are not set
+   if (value < mCompiledLower || value > mCompiledUpper)
+   {
+      return true;
+   }
+
+   // check the merged ranges which include individual values as range from value - tolerance to value + tolerance
+   if (mRangeStarts.empty())
    {
       return false;
    }
 
-   // check thresholds
-   if (mLowerThresholdStr.empty() == false && value < mAdjustedLower)
+   // the only range which can contain the value is the last one which starts below it
+   size_t index = std::lower_bound(mRangeStarts.begin(), mRangeStarts.end(), value) - mRangeStarts.begin();
+   return index > 0 && value < mRangeEnds[index - 1];
+}
+
+bool BadValuesImp::getValidityMask(const void* pData, EncodingType type, size_t count, ptrdiff_t stride,
+                                   unsigned char* pMask, size_t& badValueCount) const
+{
+   badValueCount = 0;
+   if (pData == NULL || pMask == NULL || type.isValid() == false)
    {
-      return true;
+      return false;
+   }
+
+   switch (type)
+   {
+   case INT1SBYTE:
+      badValueCount = getByteMask(static_cast<const signed char*>(pData), count, stride, pMask);
+      break;
+   case INT1UBYTE:
+      badValueCount = getByteMask(static_cast<const unsigned char*>(pData), count, stride, pMask);
+      break;
+   case INT2SBYTES:
+      badValueCount = getIntegerMask(static_cast<const short*>(pData), count, stride, pMask);
+      break;
+   case INT2UBYTES:
+      badValueCount = getIntegerMask(static_cast<const unsigned short*>(pData), count, stride, pMask);
+      break;
+   case INT4SBYTES:
+      badValueCount = getIntegerMask(static_cast<const int*>(pData), count, stride, pMask);
+      break;
+   case INT4UBYTES:
+      badValueCount = getIntegerMask(static_cast<const unsigned int*>(pData), count, stride, pMask);
+      break;
+   case FLT4BYTES:
+      badValueCount = getFloatMask(static_cast<const float*>(pData), count, stride, pMask);
+      break;
+   case FLT8BYTES:
+      badValueCount = getFloatMask(static_cast<const double*>(pData), count, stride, pMask);
+      break;
+   default:
+      return false;
    }
-   if (mUpperThresholdStr.empty() == false && value > mAdjustedUpper)
+
+   return true;
+}
+
+bool BadValuesImp::isBadInteger(int64_t value) const
+{
+   if (value <= mIntegerLower || value >= mIntegerUpper)
    {
       return true;
    }
 
-   // check adjusted ranges which include individual values as range from value - tolerance to value + tolerance
-   for (std::vector<std::pair<double, double> >::const_iterator it = mAdjustedRanges.begin();
-      it != mAdjustedRanges.end(); ++it)
+   if (mIntegerValues.empty() == false)
    {
-      if (value > it->first && value < it->second)
+      const size_t slotMask = mIntegerValues.size() - 1;
+      for (size_t slot = getHashSlot(value, mIntegerHashShift); ; slot = (slot + 1) & slotMask)
       {
-         return true;
+         int64_t entry = mIntegerValues[slot];
+         if (entry == value)
+         {
+            return true;
+         }
+         if (entry == EMPTY_SLOT)
+         {
+            break;
+         }
+      }
+   }
+
+   if (mIntegerRanges.empty() == false)
+   {
+      // the only range which can contain the value is the last one which starts at or below it
+      std::vector<std::pair<int64_t, int64_t> >::const_iterator it = std::upper_bound(mIntegerRanges.begin(),
+         mIntegerRanges.end(), std::make_pair(value, std::numeric_limits<int64_t>::max()));
+      if (it != mIntegerRanges.begin())
+      {
+         --it;
+         return value <= it->second;
       }
    }
+
    return false;
 }
 
+template<typename T>
+size_t BadValuesImp::getByteMask(const T* pData, size_t count, ptrdiff_t stride, unsigned char* pMask) const
+{
+   const unsigned char* pTable = std::numeric_limits<T>::is_signed ? mCharMask : mUnsignedCharMask;
+   const unsigned char* pValues = reinterpret_cast<const unsigned char*>(pData);
+
+   size_t badValueCount = 0;
+   for (size_t i = 0; i < count; ++i)
+   {
+      unsigned char valid = pTable[pValues[static_cast<ptrdiff_t>(i) * stride]];
+      pMask[i] = valid;
+      badValueCount += (valid == 0);
+   }
+
+   return badValueCount;
+}
+
+template<typename T>
+size_t BadValuesImp::getIntegerMask(const T* pData, size_t count, ptrdiff_t stride, unsigned char* pMask) const
+{
+   size_t badValueCount = 0;
+   if (mIntegerValues.empty() && mIntegerRanges.empty())
+   {
+      // only thresholds, which is tested without branches
+      const int64_t lower = mIntegerLower;
+      const int64_t upper = mIntegerUpper;
+      for (size_t i = 0; i < count; ++i)
+      {
+         int64_t value = pData[static_cast<ptrdiff_t>(i) * stride];
+         bool bad = (value <= lower) | (value >= upper);
+         pMask[i] = bad ? 0 : 0xff;
+         badValueCount += bad;
+      }
+
+      return badValueCount;
+   }
+
+   for (size_t i = 0; i < count; ++i)
+   {
+      bool bad = isBadInteger(pData[static_cast<ptrdiff_t>(i) * stride]);
+      pMask[i] = bad ? 0 : 0xff;
+      badValueCount += bad;
+   }
+
+   return badValueCount;
+}
+
+template<typename T>
+size_t BadValuesImp::getFloatMask(const T* pData, size_t count, ptrdiff_t stride, unsigned char* pMask) const
+{
+   size_t badValueCount = 0;
+   if (mRangeStarts.size() > 1)
+   {
+      for (size_t i = 0; i < count; ++i)
+      {
+         bool bad = isBadValue(pData[static_cast<ptrdiff_t>(i) * stride]);
+         pMask[i] = bad ? 0 : 0xff;
+         badValueCount += bad;
+      }
+
+      return badValueCount;
+   }
+
+   // thresholds and at most one range, where the empty range (0, 0) contains no values
+   const double lower = mCompiledLower;
+   const double upper = mCompiledUpper;
+   const double rangeStart = mRangeStarts.empty() ? 0.0 : mRangeStarts.front();
+   const double rangeEnd = mRangeEnds.empty() ? 0.0 : mRangeEnds.front();
+
+   size_t i = 0;
+   if (stride == 1)
+   {
+      i = getContiguousMask(pData, count, lower, upper, rangeStart, rangeEnd, pMask, badValueCount);
+   }
+
+   for (; i < count; ++i)
+   {
+      double value = pData[static_cast<ptrdiff_t>(i) * stride];
+      bool bad = (value < lower) | (value > upper) | ((value > rangeStart) & (value < rangeEnd));
+      pMask[i] = bad ? 0 : 0xff;
+      badValueCount += bad;
+   }
+
+   return badValueCount;
+}
+
 bool BadValuesImp::getSingleBadValueRange(double& lower, double& upper) const
 {
    lower = mAdjustedSingleRangeLower;
@@ -459,6 +713,7 @@ void BadValuesImp::clear()
    mAdjustedSingleRangeValid = false;
    mAdjustedSingleRangeLower = std::numeric_limits<double>::max();
    mAdjustedSingleRangeUpper = std::numeric_limits<double>::max();
+   compileCriteria();
 
    if (!mBadValuesBeingUpdated)
    {
@@ -617,7 +872,7 @@ void BadValuesImp::generateAdjustedValues()
       for (std::vector<std::string>::const_iterator it = mBadValueStrs.begin(); it != mBadValueStrs.end(); ++it)
       {
          bool error(false);
-         value = StringUtilities::fromDisplayString<double>(*it);
+         value = StringUtilities::fromDisplayString<double>(*it, &error);
          if (error || value <= mAdjustedLower || value >= mAdjustedUpper)
          {
             continue;
@@ -625,7 +880,7 @@ void BadValuesImp::generateAdjustedValues()
 
          // check if value is in a range
          bool valueInRange(false);
-         for (std::map<double,double>::const_iterator iti = tempRanges.begin(); iti != tempRanges.end(); ++it)
+         for (std::map<double,double>::const_iterator iti = tempRanges.begin(); iti != tempRanges.end(); ++iti)
          {
             if (value > iti->first && value < iti->second)
             {
@@ -652,8 +907,9 @@ void BadValuesImp::generateAdjustedValues()
       mAdjustedRanges.push_back(range);
    }
 
-   // special case a single range for better performance when calling isBadValue()
-   if (mAdjustedRanges.size() == 1)
+   // special case a single range for better performance when calling isBadValue(), which is only
+   // possible when there are no thresholds
+   if (mAdjustedRanges.size() == 1 && mLowerThresholdStr.empty() && mUpperThresholdStr.empty())
    {
       mAdjustedSingleRangeValid = true;
       mAdjustedSingleRangeLower = mAdjustedRanges.front().first;
@@ -666,10 +922,103 @@ void BadValuesImp::generateAdjustedValues()
       mAdjustedSingleRangeUpper = std::numeric_limits<double>::max();
    }
 
+   compileCriteria();
    generateBadValuesString();
    notify(SIGNAL_NAME(Subject, Modified));
 }
 
+void BadValuesImp::compileCriteria()
+{
+   // thresholds which are not set never match, including infinite values
+   mCompiledLower = mLowerThresholdStr.empty() ? -std::numeric_limits<double>::infinity() : mAdjustedLower;
+   mCompiledUpper = mUpperThresholdStr.empty() ? std::numeric_limits<double>::infinity() : mAdjustedUpper;
+
+   // merge overlapping ranges, which are sorted by their start, so that a value can be in at most one of them
+   mRangeStarts.clear();
+   mRangeEnds.clear();
+   for (std::vector<std::pair<double, double> >::const_iterator it = mAdjustedRanges.begin();
+      it != mAdjustedRanges.end(); ++it)
+   {
+      if (!(it->first < it->second))
+      {
+         continue;
+      }
+
+      if (mRangeEnds.empty() == false && it->first < mRangeEnds.back())
+      {
+         mRangeEnds.back() = std::max(mRangeEnds.back(), it->second);
+      }
+      else
+      {
+         mRangeStarts.push_back(it->first);
+         mRangeEnds.push_back(it->second);
+      }
+   }
+
+   // an integer is below a threshold L when it is at most ceil(L) - 1 and in the open range (a, b) when it is
+   // from floor(a) + 1 to ceil(b) - 1
+   mIntegerLower = static_cast<int64_t>(ceil(clampToIntegerLimit(mCompiledLower))) - 1;
+   mIntegerUpper = static_cast<int64_t>(floor(clampToIntegerLimit(mCompiledUpper))) + 1;
+
+   mIntegerRanges.clear();
+   std::vector<int64_t> integerValues;
+   for (size_t i = 0; i < mRangeStarts.size(); ++i)
+   {
+      int64_t first = std::max(static_cast<int64_t>(floor(clampToIntegerLimit(mRangeStarts[i]))) + 1,
+         mIntegerLower + 1);
+      int64_t last = std::min(static_cast<int64_t>(ceil(clampToIntegerLimit(mRangeEnds[i]))) - 1,
+         mIntegerUpper - 1);
+      if (first > last)
+      {
+         continue;
+      }
+
+      if (last - first < MAX_HASHED_RANGE)
+      {
+         for (int64_t value = first; value <= last; ++value)
+         {
+            integerValues.push_back(value);
+         }
+      }
+      else
+      {
+         mIntegerRanges.push_back(std::make_pair(first, last));
+      }
+   }
+
+   // build a hash table which is at most half full
+   mIntegerValues.clear();
+   mIntegerHashShift = 64;
+   if (integerValues.empty() == false)
+   {
+      size_t tableSize = 8;
+      mIntegerHashShift = 61;
+      while (tableSize < 2 * integerValues.size())
+      {
+         tableSize *= 2;
+         --mIntegerHashShift;
+      }
+
+      mIntegerValues.resize(tableSize, EMPTY_SLOT);
+      for (std::vector<int64_t>::const_iterator it = integerValues.begin(); it != integerValues.end(); ++it)
+      {
+         size_t slot = getHashSlot(*it, mIntegerHashShift);
+         while (mIntegerValues[slot] != EMPTY_SLOT && mIntegerValues[slot] != *it)
+         {
+            slot = (slot + 1) & (tableSize - 1);
+         }
+         mIntegerValues[slot] = *it;
+      }
+   }
+
+   // tables for 8 bit data, which give the mask value directly
+   for (int i = 0; i < 256; ++i)
+   {
+      mCharMask[i] = isBadInteger(static_cast<signed char>(i)) ? 0 : 0xff;
+      mUnsignedCharMask[i] = isBadInteger(i) ? 0 : 0xff;
+   }
+}
+
 const std::string& BadValuesImp::getObjectType() const
 {
    static std::string sType("BadValuesImp");
@@ -13,7 +13,9 @@
 #include "ConfigurationSettings.h"
 #include "SerializableImp.h"
 #include "SubjectImp.h"
+#include "TypesFile.h"
 
+#include <stddef.h>
 #include <string>
 #include <vector>
 
@@ -31,6 +33,8 @@ public:
    virtual double getDefaultBadValue() const;
    virtual bool isBadValue(double value) const;
    virtual bool getSingleBadValueRange(double& lower, double& upper) const;
+   virtual bool getValidityMask(const void* pData, EncodingType type, size_t count, ptrdiff_t stride,
+      unsigned char* pMask, size_t& badValueCount) const;
 
    virtual std::string getLowerBadValueThreshold() const;
    virtual std::string getUpperBadValueThreshold() const;
@@ -67,6 +71,15 @@ protected:
    bool isValidValueString(const std::string& valueStr) const;
 
 private:
+   void compileCriteria();
+   bool isBadInteger(int64_t value) const;
+   template<typename T>
+   size_t getByteMask(const T* pData, size_t count, ptrdiff_t stride, unsigned char* pMask) const;
+   template<typename T>
+   size_t getIntegerMask(const T* pData, size_t count, ptrdiff_t stride, unsigned char* pMask) const;
+   template<typename T>
+   size_t getFloatMask(const T* pData, size_t count, ptrdiff_t stride, unsigned char* pMask) const;
+
    std::string mBadValuesAsString;
    std::string mLowerThresholdStr;
    std::string mUpperThresholdStr;
@@ -82,6 +95,19 @@ private:
    double mAdjustedSingleRangeUpper;
    bool mBadValuesBeingUpdated;
    std::string mErrorMsg;
+
+   // The criteria compiled for testing values, which are rebuilt whenever the adjusted values change
+   double mCompiledLower;                       // Values below are bad, or -infinity without a lower threshold
+   double mCompiledUpper;                       // Values above are bad, or infinity without an upper threshold
+   std::vector<double> mRangeStarts;            // The merged, disjoint, sorted open ranges of bad values
+   std::vector<double> mRangeEnds;
+   int64_t mIntegerLower;                       // Integers at or below are bad
+   int64_t mIntegerUpper;                       // Integers at or above are bad
+   std::vector<std::pair<int64_t, int64_t> > mIntegerRanges;    // Closed ranges of more than a few integers
+   std::vector<int64_t> mIntegerValues;         // Open addressing hash table of individual bad integers
+   int mIntegerHashShift;
+   unsigned char mCharMask[256];                // The validity of each char value
+   unsigned char mUnsignedCharMask[256];        // The validity of each unsigned char value
 };
 
 #define BADVALUESADAPTEREXTENSION_CLASSES \
@@ -111,6 +137,11 @@ private:
    { \
       return impClass::getSingleBadValueRange(lower, upper); \
    } \
+   bool getValidityMask(const void* pData, EncodingType type, size_t count, ptrdiff_t stride, \
+      unsigned char* pMask, size_t& badValueCount) const \
+   { \
+      return impClass::getValidityMask(pData, type, count, stride, pMask, badValueCount); \
+   } \
    bool setLowerBadValueThreshold(const std::string& thresholdStr) \
    { \
       return impClass::setLowerBadValueThreshold(thresholdStr); \
@@ -0,0 +1,325 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "ConfigurationSettings.h"
+#include "ThreadPoolImp.h"
+
+#include <algorithm>
+
+using namespace std;
+
+ThreadPoolImp::Worker::Worker(ThreadPoolImp* pPool, unsigned int index) :
+   mpPool(pPool),
+   mIndex(index),
+   mThread(static_cast<void*>(this), reinterpret_cast<void*>(ThreadPoolImp::workerFunction)),
+   mLaunched(false),
+   mRunning(false)
+{
+}
+
+ThreadPoolImp::ThreadPoolImp(unsigned int maximumThreadCount) :
+   mPendingCount(0),
+   mBackgroundPendingCount(0),
+   mRunningCount(0),
+   mRunningBackgroundCount(0),
+   mThreadLimit(0),
+   mStopping(false)
+{
+   pthread_key_create(&mWorkerKey, NULL);
+
+   maximumThreadCount = max(maximumThreadCount, 1U);
+   for (unsigned int i = 0; i < maximumThreadCount; ++i)
+   {
+      mWorkers.push_back(new Worker(this, i));
+   }
+}
+
+ThreadPoolImp::~ThreadPoolImp()
+{
+   unsigned int runningCount = 0;
+   {
+      mta::MutexLock lock(mMutex);
+      mStopping = true;
+      runningCount = mRunningCount;
+   }
+
+   // Each signal wakes at most one worker, and a worker which is not waiting sees mStopping before it waits again
+   for (unsigned int i = 0; i < runningCount; ++i)
+   {
+      mTaskSignal.ThreadSignalActivate();
+   }
+
+   for (vector<Worker*>::iterator iter = mWorkers.begin(); iter != mWorkers.end(); ++iter)
+   {
+      if ((*iter)->mLaunched)
+      {
+         (*iter)->mThread.ThreadWait();
+      }
+      delete *iter;
+   }
+
+   pthread_key_delete(mWorkerKey);
+}
+
+void ThreadPoolImp::submit(ThreadPoolTask* pTask)
+{
+   queueTask(pTask, false);
+}
+
+void ThreadPoolImp::submitBackground(ThreadPoolTask* pTask)
+{
+   queueTask(pTask, true);
+}
+
+bool ThreadPoolImp::runPendingTask()
+{
+   // A thread which is waiting for a task does not run background tasks, which would hold it up for longer
+   bool background = false;
+   ThreadPoolTask* pTask = takeTask(getCurrentWorker(), false, background);
+   if (pTask == NULL)
+   {
+      return false;
+   }
+
+   pTask->execute();
+   return true;
+}
+
+bool ThreadPoolImp::isWorkerThread() const
+{
+   return getCurrentWorker() != NULL;
+}
+
+unsigned int ThreadPoolImp::getThreadCount() const
+{
+   mta::MutexLock lock(mMutex);
+   return mRunningCount;
+}
+
+void ThreadPoolImp::workerFunction(Worker* pWorker)
+{
+   pthread_setspecific(pWorker->mpPool->mWorkerKey, pWorker);
+   pWorker->mpPool->run(pWorker);
+}
+
+void ThreadPoolImp::run(Worker* pWorker)
+{
+   while (true)
+   {
+      {
+         mta::MutexLock lock(mMutex);
+         while (hasRunnableTask() == false && pWorker->mIndex < mThreadLimit && mStopping == false)
+         {
+            mTaskSignal.ThreadSignalWait(&mMutex);
+         }
+
+         if (mStopping)
+         {
+            return;
+         }
+
+         if (pWorker->mIndex >= mThreadLimit)
+         {
+            // The ThreadCount setting was lowered, so the worker stops and its queued tasks are stolen by the
+            // other workers, which are woken in case this worker took the signal for a task
+            pWorker->mRunning = false;
+            --mRunningCount;
+            if (hasRunnableTask())
+            {
+               mTaskSignal.ThreadSignalActivate();
+            }
+            return;
+         }
+      }
+
+      bool background = false;
+      ThreadPoolTask* pTask = takeTask(pWorker, true, background);
+      if (pTask != NULL)
+      {
+         pTask->execute();
+         if (background)
+         {
+            mta::MutexLock lock(mMutex);
+            --mRunningBackgroundCount;
+            if (mBackgroundPendingCount > 0)
+            {
+               mTaskSignal.ThreadSignalActivate();
+            }
+         }
+      }
+   }
+}
+
+void ThreadPoolImp::queueTask(ThreadPoolTask* pTask, bool background)
+{
+   VERIFYNRV(pTask != NULL);
+
+   {
+      mta::MutexLock lock(mMutex);
+      VERIFYNRV(mStopping == false);
+      launchWorkers();
+
+      // The task is counted before it is queued, so a worker which is woken before it is queued looks again
+      if (background)
+      {
+         ++mBackgroundPendingCount;
+      }
+      else
+      {
+         ++mPendingCount;
+      }
+   }
+
+   Worker* pWorker = getCurrentWorker();
+   if (background)
+   {
+      mta::MutexLock lock(mQueueMutex);
+      mBackgroundQueue.push_back(pTask);
+   }
+   else if (pWorker != NULL)
+   {
+      mta::MutexLock lock(pWorker->mMutex);
+      pWorker->mTasks.push_back(pTask);
+   }
+   else
+   {
+      mta::MutexLock lock(mQueueMutex);
+      mQueue.push_back(pTask);
+   }
+
+   mTaskSignal.ThreadSignalActivate();
+}
+
+void ThreadPoolImp::launchWorkers()
+{
+   // The setting is read each time that a task is submitted, so the workers above a lowered thread count stop
+   // the next time that they look for a task
+   unsigned int threadCount = ConfigurationSettings::getSettingThreadCount();
+   mThreadLimit = min(max(threadCount, 1U), static_cast<unsigned int>(mWorkers.size()));
+   for (unsigned int i = 0; i < mThreadLimit; ++i)
+   {
+      Worker* pWorker = mWorkers[i];
+      if (pWorker->mRunning)
+      {
+         continue;
+      }
+
+      if (pWorker->mLaunched)
+      {
+         // The worker has stopped since the setting was lowered, and only needs to be joined
+         pWorker->mThread.ThreadWait();
+         pWorker->mLaunched = false;
+      }
+
+      if (pWorker->mThread.ThreadLaunch() == false)
+      {
+         break;
+      }
+
+      pWorker->mLaunched = true;
+      pWorker->mRunning = true;
+      ++mRunningCount;
+   }
+}
+
+bool ThreadPoolImp::hasRunnableTask() const
+{
+   return mPendingCount > 0 || (mBackgroundPendingCount > 0 && mRunningBackgroundCount < getBackgroundLimit());
+}
+
+unsigned int ThreadPoolImp::getBackgroundLimit() const
+{
+   // One worker is kept for other tasks, unless there is only one
+   return max(mThreadLimit, 2U) - 1;
+}
+
+ThreadPoolImp::Worker* ThreadPoolImp::getCurrentWorker() const
+{
+   return reinterpret_cast<Worker*>(pthread_getspecific(mWorkerKey));
+}
+
+ThreadPoolTask* ThreadPoolImp::takeTask(Worker* pWorker, bool allowBackground, bool& background)
+{
+   background = false;
+
+   // A worker runs its own newest task first, since the data of the task which submitted it is most likely to
+   // still be in its cache, and otherwise takes the oldest task submitted from outside of the pool
+   ThreadPoolTask* pTask = NULL;
+   if (pWorker != NULL)
+   {
+      pTask = popTask(pWorker->mMutex, pWorker->mTasks, true);
+   }
+
+   if (pTask == NULL)
+   {
+      pTask = popTask(mQueueMutex, mQueue, false);
+   }
+
+   // Steal the oldest task of another worker, starting from the next worker so that the workers do not all steal
+   // from the first one
+   const unsigned int workerCount = static_cast<unsigned int>(mWorkers.size());
+   const unsigned int firstIndex = (pWorker == NULL ? 0 : pWorker->mIndex + 1);
+   for (unsigned int i = 0; i < workerCount && pTask == NULL; ++i)
+   {
+      Worker* pVictim = mWorkers[(firstIndex + i) % workerCount];
+      if (pVictim != pWorker)
+      {
+         pTask = popTask(pVictim->mMutex, pVictim->mTasks, false);
+      }
+   }
+
+   if (pTask != NULL)
+   {
+      mta::MutexLock lock(mMutex);
+      --mPendingCount;
+      return pTask;
+   }
+
+   // Background tasks are only run when no other tasks are queued, and never on every worker
+   if (allowBackground)
+   {
+      mta::MutexLock lock(mMutex);
+      if (mRunningBackgroundCount < getBackgroundLimit())
+      {
+         pTask = popTask(mQueueMutex, mBackgroundQueue, false);
+         if (pTask != NULL)
+         {
+            --mBackgroundPendingCount;
+            ++mRunningBackgroundCount;
+            background = true;
+         }
+      }
+   }
+
+   return pTask;
+}
+
+ThreadPoolTask* ThreadPoolImp::popTask(mta::DMutex& mutex, deque<ThreadPoolTask*>& tasks, bool newest)
+{
+   mta::MutexLock lock(mutex);
+   if (tasks.empty())
+   {
+      return NULL;
+   }
+
+   ThreadPoolTask* pTask = NULL;
+   if (newest)
+   {
+      pTask = tasks.back();
+      tasks.pop_back();
+   }
+   else
+   {
+      pTask = tasks.front();
+      tasks.pop_front();
+   }
+
+   return pTask;
+}
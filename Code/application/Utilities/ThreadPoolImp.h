@@ -0,0 +1,96 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2007 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef THREADPOOLIMP_H
+#define THREADPOOLIMP_H
+
+#include "bthread.h"
+#include "DMutex.h"
+#include "ThreadPool.h"
+
+#include <deque>
+#include <vector>
+
+class ThreadPoolImp : public ThreadPool
+{
+public:
+   /**
+    * Creates the pool without launching any workers.
+    *
+    * @param maximumThreadCount
+    *        The largest number of workers which are launched, regardless of
+    *        the ThreadCount setting.
+    */
+   ThreadPoolImp(unsigned int maximumThreadCount);
+
+   /**
+    * Stops and waits for the workers.  No tasks may be queued or running.
+    */
+   ~ThreadPoolImp();
+
+   void submit(ThreadPoolTask* pTask);
+   void submitBackground(ThreadPoolTask* pTask);
+   bool runPendingTask();
+   bool isWorkerThread() const;
+   unsigned int getThreadCount() const;
+
+private:
+   ThreadPoolImp(const ThreadPoolImp& rhs);
+   ThreadPoolImp& operator=(const ThreadPoolImp& rhs);
+
+   struct Worker
+   {
+      Worker(ThreadPoolImp* pPool, unsigned int index);
+
+      ThreadPoolImp* mpPool;
+      unsigned int mIndex;
+      BThread mThread;
+      bool mLaunched;                           // Guarded by the mMutex of the pool
+      bool mRunning;                            // Guarded by the mMutex of the pool
+      mta::DMutex mMutex;
+      std::deque<ThreadPoolTask*> mTasks;      // Guarded by mMutex
+   };
+
+   static void workerFunction(Worker* pWorker);
+   void run(Worker* pWorker);
+   void queueTask(ThreadPoolTask* pTask, bool background);
+
+   // Must be called with mMutex locked
+   void launchWorkers();
+   bool hasRunnableTask() const;
+   unsigned int getBackgroundLimit() const;
+
+   Worker* getCurrentWorker() const;
+   ThreadPoolTask* takeTask(Worker* pWorker, bool allowBackground, bool& background);
+   static ThreadPoolTask* popTask(mta::DMutex& mutex, std::deque<ThreadPoolTask*>& tasks, bool newest);
+
+   // The workers are created with the pool and launched when tasks are submitted, so that the vector does
+   // not change while the workers steal from each other
+   std::vector<Worker*> mWorkers;
+
+   // The numbers of queued tasks, running workers and running background tasks, the number of workers
+   // allowed by the ThreadCount setting and whether the workers are stopping, which are guarded by mMutex
+   mutable mta::DMutex mMutex;
+   mta::DThreadSignal mTaskSignal;
+   unsigned int mPendingCount;
+   unsigned int mBackgroundPendingCount;
+   unsigned int mRunningCount;
+   unsigned int mRunningBackgroundCount;
+   unsigned int mThreadLimit;
+   bool mStopping;
+
+   // Tasks which are submitted from outside of the pool, and background tasks
+   mta::DMutex mQueueMutex;
+   std::deque<ThreadPoolTask*> mQueue;
+   std::deque<ThreadPoolTask*> mBackgroundQueue;
+
+   pthread_key_t mWorkerKey;
+};
+
+#endif
@@ -131,6 +131,11 @@ unsigned int UtilityServicesImp::getNumProcessors() const
 #endif
 }
 
+ThreadPool* UtilityServicesImp::getThreadPool()
+{
+   return &mThreadPool;
+}
+
 std::string UtilityServicesImp::getDefaultClassification() const
 {
    if (!mClassificationOverride.empty())
@@ -10,6 +10,7 @@
 #ifndef _UTILITYSERVICESIMP_H
 #define _UTILITYSERVICESIMP_H
 
+#include "ThreadPoolImp.h"
 #include "UtilityServices.h"
 #include "TypesFile.h"
 
@@ -35,6 +36,7 @@ public:
    void destroyProgress(Progress* pProgress);
    MessageLogMgr* getMessageLog() const;
    unsigned int getNumProcessors() const;
+   ThreadPool* getThreadPool();
    std::string getDefaultClassification() const;
    ColorType getAutoColor(int color_index) const;
 
@@ -70,7 +72,7 @@ public:
 
 protected:
    virtual ~UtilityServicesImp() {};
-   UtilityServicesImp() {};
+   UtilityServicesImp() : mThreadPool(getNumProcessors()) {};
 
 private:
    std::map<DateTime*, DateTimeImp*> mDts;
@@ -90,6 +92,7 @@ private:
    static UtilityServicesImp* spInstance;
    static bool mDestroyed;
    std::string mClassificationOverride;
+   ThreadPoolImp mThreadPool;
 };
 
 #endif